@@ -2,6 +2,7 @@
 
 #include "engine.h"
 
+#include <cassert>
 #include <sstream>
 #include <string>
 
@@ -146,6 +147,96 @@ namespace metaldb::engine {
         std::vector<ColumnIndexType> _indexes;
     };
 
+    class Aggregate final : AggregateInstruction {
+    public:
+        using Function = AggregateInstruction::Function;
+        using ColumnIndexType = AggregateInstruction::ColumnIndexType;
+
+        struct Aggregation {
+            Function function;
+            ColumnIndexType column = 0;
+
+            bool operator==(const Aggregation& other) const noexcept {
+                return this->function == other.function && this->column == other.column;
+            }
+        };
+
+        Aggregate(const std::vector<Aggregation>& aggregations) : _aggregations(aggregations) {
+            assert(aggregations.size() <= MAX_NUM_AGGREGATIONS);
+        }
+        ~Aggregate() noexcept = default;
+
+        std::size_t numAggregations() const noexcept {
+            return this->_aggregations.size();
+        }
+
+        bool operator==(const Aggregate& other) const noexcept {
+            return this->_aggregations == other._aggregations;
+        }
+
+        std::string description() const noexcept {
+            std::stringstream sstream;
+
+            sstream << "Aggregate (" << this->_aggregations.size() << ") ";
+            for (const auto& aggregation : this->_aggregations) {
+                sstream << Aggregate::functionToString(aggregation.function) << "(";
+                if (aggregation.function == COUNT_ALL) {
+                    sstream << "*";
+                } else {
+                    sstream << (int) aggregation.column;
+                }
+                sstream << ") ";
+            }
+
+            return sstream.str();
+        }
+
+        static std::string functionToString(Function function) noexcept {
+            switch (function) {
+            case COUNT_ALL:
+            case COUNT:
+                return "COUNT";
+            case SUM:
+                return "SUM";
+            case MIN:
+                return "MIN";
+            case MAX:
+                return "MAX";
+            case AVG:
+                return "AVG";
+            }
+        }
+
+        static Aggregate deserialize(InstSerializedValue** input) noexcept {
+            // Assume we don't have the type encoded
+            const auto numAggregations = ReadBytesStartingAt<NumAggregationsType>(*input);
+            (*input) += sizeof(NumAggregationsType);
+
+            std::vector<Aggregation> aggregations(numAggregations);
+            for (auto& aggregation : aggregations) {
+                aggregation.function = ReadBytesStartingAt<Function>(*input);
+                (*input) += sizeof(Function);
+
+                aggregation.column = ReadBytesStartingAt<ColumnIndexType>(*input);
+                (*input) += sizeof(ColumnIndexType);
+            }
+            return Aggregate(aggregations);
+        }
+
+        instruction_serialized_type serialize() const noexcept {
+            instruction_serialized_type output;
+            WriteBytesStartingAt(output, (NumAggregationsType) this->_aggregations.size());
+            for (const auto& aggregation : this->_aggregations) {
+                WriteBytesStartingAt(output, aggregation.function);
+                WriteBytesStartingAt(output, aggregation.column);
+            }
+            return output;
+        }
+
+    private:
+        std::vector<Aggregation> _aggregations;
+    };
+
     class Output final {
     public:
         Output() = default;
@@ -185,6 +276,10 @@ namespace metaldb::engine {
             return this->encodeImpl(projection, PROJECTION);
         }
 
+        Encoder& encode(const class Aggregate& aggregate) noexcept {
+            return this->encodeImpl(aggregate, AGGREGATE);
+        }
+
         Encoder& encode(const class Output& output) noexcept {
             return this->encodeImpl(output, OUTPUT);
         }
@@ -0,0 +1,332 @@
+#include "ExternalSort.hpp"
+#include "ParallelRadixSort.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    template<typename T>
+    void AppendBigEndian(T value, std::string& key) noexcept {
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            key.push_back((char) ((value >> (8 * (sizeof(T) - i - 1))) & 0xff));
+        }
+    }
+}
+
+metaldb::ExternalSort::ExternalSort(std::vector<SortColumn> sortColumns, std::size_t memoryBudget) noexcept : _sortColumns(std::move(sortColumns)), _memoryBudget(memoryBudget) {}
+
+void metaldb::ExternalSort::AppendNormalizedKey(const OutputRowReader<BufferType>& reader, std::size_t row, const std::vector<SortColumn>& sortColumns, std::string& key) noexcept {
+    for (const auto& sortColumn : sortColumns) {
+        const auto start = key.size();
+        const auto type = reader.TypeOfColumn(sortColumn.column);
+        auto [data, size] = reader.ColumnData(sortColumn.column, row);
+
+        const bool isNull = size == 0 && (type == String_opt || type == Float_opt || type == Integer_opt);
+        key.push_back(isNull ? 1 : 0);
+        if (!isNull) {
+            switch (type) {
+            case Integer:
+            case Integer_opt: {
+                // Flipping the sign bit orders negative numbers first.
+                auto value = (std::uint64_t) ReadBytesStartingAt<types::IntegerType>(data);
+                AppendBigEndian(value ^ (1ULL << 63), key);
+                break;
+            }
+            case Float:
+            case Float_opt: {
+                static_assert(sizeof(types::FloatType) == sizeof(std::uint32_t));
+                std::uint32_t bits = 0;
+                std::copy_n(data, sizeof(bits), reinterpret_cast<char*>(&bits));
+
+                // Negative numbers have every bit flipped, so larger magnitudes come first.
+                bits = (bits & 0x80000000) ? ~bits : bits ^ 0x80000000;
+                AppendBigEndian(bits, key);
+                break;
+            }
+            case String:
+            case String_opt:
+            case Unknown:
+                // Zero bytes are escaped, so the terminator sorts before every other byte.
+                for (std::size_t i = 0; i < size; ++i) {
+                    key.push_back(data[i]);
+                    if (data[i] == 0) {
+                        key.push_back((char) 0xff);
+                    }
+                }
+                key.push_back(0);
+                key.push_back(0);
+                break;
+            }
+        }
+
+        if (!sortColumn.ascending) {
+            for (auto i = start; i < key.size(); ++i) {
+                key[i] = ~key[i];
+            }
+        }
+    }
+}
+
+bool metaldb::ExternalSort::MakeRadixSortItems(const OutputRowReader<BufferType>& reader, std::size_t startRow, std::size_t endRow, const std::vector<SortColumn>& sortColumns, std::vector<RadixSortItem>& items, std::uint32_t& numKeyBytes) noexcept {
+    std::vector<std::uint32_t> numBits;
+    std::uint32_t totalNumBits = 0;
+    for (const auto& sortColumn : sortColumns) {
+        const auto type = reader.TypeOfColumn(sortColumn.column);
+        switch (type) {
+        case Integer:
+        case Integer_opt:
+            numBits.push_back(type == Integer ? 64 : 65);
+            break;
+        case Float:
+        case Float_opt:
+            numBits.push_back(type == Float ? 32 : 33);
+            break;
+        case String:
+        case String_opt:
+        case Unknown:
+            return false;
+        }
+        totalNumBits += numBits.back();
+    }
+    if (sortColumns.empty() || totalNumBits > 64) {
+        return false;
+    }
+    numKeyBytes = (totalNumBits + 7) / 8;
+
+    items.resize(endRow - startRow);
+    for (auto row = startRow; row < endRow; ++row) {
+        std::uint64_t key = 0;
+        for (std::size_t i = 0; i < sortColumns.size(); ++i) {
+            const auto& sortColumn = sortColumns.at(i);
+            const auto type = reader.TypeOfColumn(sortColumn.column);
+            auto [data, size] = reader.ColumnData(sortColumn.column, row);
+
+            // The null marker is the highest bit of the column, so nulls sort last in ascending order.
+            std::uint64_t value = 0;
+            if (size == 0) {
+                value = 1ULL << (numBits.at(i) - 1);
+            } else if (type == Integer || type == Integer_opt) {
+                value = RadixSort::IntegerKey(ReadBytesStartingAt<types::IntegerType>(data));
+            } else {
+                value = RadixSort::FloatKey(ReadBytesStartingAt<types::FloatType>(data));
+            }
+
+            if (!sortColumn.ascending) {
+                value = ~value;
+            }
+            const auto mask = numBits.at(i) == 64 ? ~0ULL : (1ULL << numBits.at(i)) - 1;
+            key = (numBits.at(i) == 64 ? 0 : key << numBits.at(i)) | (value & mask);
+        }
+        items.at(row - startRow) = {key, (std::uint32_t) (row - startRow)};
+    }
+    return true;
+}
+
+auto metaldb::ExternalSort::SortedOrder(const OutputRowReader<BufferType>& reader, std::size_t startRow, std::size_t endRow, const std::vector<SortColumn>& sortColumns) noexcept -> std::vector<std::size_t> {
+    const auto numRows = endRow - startRow;
+    std::vector<std::size_t> order(numRows);
+
+    std::vector<RadixSortItem> items;
+    std::uint32_t numKeyBytes = 0;
+    if (ExternalSort::MakeRadixSortItems(reader, startRow, endRow, sortColumns, items, numKeyBytes)) {
+        // Callers already sort in parallel, so each sort only uses a single thread.
+        ParallelRadixSort::Sort(items, numKeyBytes, 1);
+        for (std::size_t i = 0; i < numRows; ++i) {
+            order[i] = items[i].row;
+        }
+        return order;
+    }
+
+    std::vector<std::string> keys(numRows);
+    for (std::size_t i = 0; i < numRows; ++i) {
+        ExternalSort::AppendNormalizedKey(reader, startRow + i, sortColumns, keys.at(i));
+    }
+
+    // Ties keep their input order, like the radix sort.
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return keys[lhs] < keys[rhs];
+    });
+    return order;
+}
+
+void metaldb::ExternalSort::addRun(const BufferType& buffer, std::size_t startRow, std::size_t endRow) noexcept {
+    if (buffer.empty()) {
+        return;
+    }
+
+    auto reader = OutputRowReader(buffer);
+    endRow = std::min<std::size_t>(endRow, reader.NumRows());
+    if (startRow >= endRow) {
+        return;
+    }
+
+    this->addOrderedRun(reader, startRow, endRow, ExternalSort::SortedOrder(reader, startRow, endRow, this->_sortColumns));
+}
+
+void metaldb::ExternalSort::addSortedRun(const BufferType& buffer, std::size_t startRow, std::size_t endRow) noexcept {
+    if (buffer.empty()) {
+        return;
+    }
+
+    auto reader = OutputRowReader(buffer);
+    endRow = std::min<std::size_t>(endRow, reader.NumRows());
+    if (startRow >= endRow) {
+        return;
+    }
+
+    std::vector<std::size_t> order(endRow - startRow);
+    std::iota(order.begin(), order.end(), 0);
+    this->addOrderedRun(reader, startRow, endRow, order);
+}
+
+void metaldb::ExternalSort::addOrderedRun(const OutputRowReader<BufferType>& reader, std::size_t startRow, std::size_t endRow, const std::vector<std::size_t>& order) noexcept {
+    const auto numRows = endRow - startRow;
+    auto writeRows = [&](std::size_t begin, std::size_t end, BufferType& output) {
+        OutputRowWriter writer;
+        for (auto i = begin; i < end; ++i) {
+            writer.copyRow(reader, startRow + order[i]);
+        }
+        writer.write(output);
+    };
+
+    // Reserve space for the run before writing it, so concurrent runs can't all fit under the budget at once.
+    const std::size_t estimatedNumBytes = (reader.NumBytes() * numRows) / reader.NumRows();
+    bool shouldSpill = false;
+    {
+        std::lock_guard lock(this->_mutex);
+        shouldSpill = this->_inMemoryBytes + estimatedNumBytes > this->_memoryBudget;
+        if (!shouldSpill) {
+            this->_inMemoryBytes += estimatedNumBytes;
+        }
+    }
+
+    if (!shouldSpill) {
+        auto run = std::make_shared<BufferType>();
+        writeRows(0, numRows, *run);
+
+        std::lock_guard lock(this->_mutex);
+        this->_inMemoryRuns.push_back(std::move(run));
+        return;
+    }
+
+    auto spillFile = std::make_unique<SpillFile>();
+    BufferType block;
+    for (std::size_t begin = 0; begin < numRows; begin += SpillBlockNumRows) {
+        block.clear();
+        writeRows(begin, std::min(begin + SpillBlockNumRows, numRows), block);
+        spillFile->append(block);
+    }
+
+    std::lock_guard lock(this->_mutex);
+    this->_spilledRuns.push_back(std::move(spillFile));
+}
+
+metaldb::ExternalSort::Merger::Merger(const ExternalSort& sort) noexcept : _sort(sort) {
+    this->_cursors.resize(sort._inMemoryRuns.size() + sort._spilledRuns.size());
+    for (std::size_t i = 0; i < sort._inMemoryRuns.size(); ++i) {
+        auto& cursor = this->_cursors.at(i);
+        cursor.buffer = sort._inMemoryRuns.at(i);
+        cursor.reader = std::make_unique<OutputRowReader<BufferType>>(*cursor.buffer);
+        this->loadKey(cursor);
+    }
+    for (std::size_t i = 0; i < sort._spilledRuns.size(); ++i) {
+        auto& cursor = this->_cursors.at(sort._inMemoryRuns.size() + i);
+        cursor.buffer = std::make_shared<BufferType>();
+        cursor.spillReader = std::make_unique<SpillFile::Reader>(*sort._spilledRuns.at(i));
+        this->loadKey(cursor);
+    }
+
+    this->_tree = std::make_unique<LoserTree<CursorLess>>(this->_cursors.size(), CursorLess{&this->_cursors});
+}
+
+bool metaldb::ExternalSort::Merger::CursorLess::operator()(std::size_t lhs, std::size_t rhs) const noexcept {
+    const auto& lhsCursor = (*this->cursors)[lhs];
+    const auto& rhsCursor = (*this->cursors)[rhs];
+    if (lhsCursor.done || rhsCursor.done) {
+        return !lhsCursor.done;
+    }
+    return lhsCursor.key < rhsCursor.key;
+}
+
+void metaldb::ExternalSort::Merger::loadKey(Cursor& cursor) const noexcept {
+    while (!cursor.reader || cursor.row >= cursor.reader->NumRows()) {
+        if (!cursor.spillReader || !cursor.spillReader->next(*cursor.buffer)) {
+            cursor.done = true;
+            return;
+        }
+        cursor.reader = std::make_unique<OutputRowReader<BufferType>>(*cursor.buffer);
+        cursor.row = 0;
+    }
+
+    cursor.key.clear();
+    ExternalSort::AppendNormalizedKey(*cursor.reader, cursor.row, this->_sort._sortColumns, cursor.key);
+}
+
+auto metaldb::ExternalSort::Merger::top() const noexcept -> const Cursor& {
+    return this->_cursors.at(this->_tree->top());
+}
+
+bool metaldb::ExternalSort::Merger::valid() const noexcept {
+    // Exhausted sources are last, so if the top is exhausted every run is.
+    return !this->_cursors.empty() && !this->top().done;
+}
+
+auto metaldb::ExternalSort::Merger::reader() const noexcept -> const OutputRowReader<BufferType>& {
+    return *this->top().reader;
+}
+
+auto metaldb::ExternalSort::Merger::row() const noexcept -> std::size_t {
+    return this->top().row;
+}
+
+auto metaldb::ExternalSort::Merger::key() const noexcept -> const std::string& {
+    return this->top().key;
+}
+
+void metaldb::ExternalSort::Merger::next() noexcept {
+    auto& cursor = this->_cursors.at(this->_tree->top());
+    cursor.row++;
+    this->loadKey(cursor);
+    this->_tree->replay();
+}
+
+void metaldb::ExternalSort::merge(OutputRowWriter& writer) const noexcept {
+    std::lock_guard lock(this->_mutex);
+    for (Merger merger(*this); merger.valid(); merger.next()) {
+        writer.copyRow(merger.reader(), merger.row());
+    }
+}
+
+void metaldb::ExternalSort::merge(const OutputRowWriter::OutputRowBuilder& builder, const std::function<void(BufferType&)>& consume) const noexcept {
+    std::lock_guard lock(this->_mutex);
+    OutputRowWriter writer(builder);
+    BufferType output;
+    auto flush = [&]() {
+        if (writer.CurrentNumRows() == 0) {
+            return;
+        }
+        output.clear();
+        writer.write(output);
+        consume(output);
+        writer = OutputRowWriter(builder);
+    };
+
+    for (Merger merger(*this); merger.valid(); merger.next()) {
+        writer.copyRow(merger.reader(), merger.row());
+        if (writer.CurrentNumRows() >= ChunkNumRows) {
+            flush();
+        }
+    }
+    flush();
+}
+
+auto metaldb::ExternalSort::NumRuns() const noexcept -> std::size_t {
+    std::lock_guard lock(this->_mutex);
+    return this->_inMemoryRuns.size() + this->_spilledRuns.size();
+}
+
+auto metaldb::ExternalSort::NumSpilledRuns() const noexcept -> std::size_t {
+    std::lock_guard lock(this->_mutex);
+    return this->_spilledRuns.size();
+}
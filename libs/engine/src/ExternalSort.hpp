@@ -0,0 +1,176 @@
+#pragma once
+
+#include "LoserTree.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+#include "SpillFile.hpp"
+
+#include "radix_sort.h"
+
+#include <metaldb/query_engine/partials.hpp>
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Sorts @b OutputRow buffers that may not fit in memory.
+     *
+     * Chunks of rows are sorted into runs, which can be done in parallel.  Once the runs held in memory exceed the memory budget,
+     * new runs are spilled to disk.  @b merge then merges every run with a @b LoserTree .
+     *
+     * Rows are compared by a normalized key, built so that comparing the keys of two rows byte by byte orders the rows,
+     * without looking at the type of each column.  When the sort columns are fixed width and fit in 64 bits, runs are instead
+     * sorted with a radix sort over integer keys.
+     */
+    class ExternalSort final {
+    public:
+        using BufferType = std::vector<char>;
+        using BufferPtr = std::shared_ptr<BufferType>;
+        using SortColumn = QueryEngine::SortPartial::SortColumn;
+
+        /**
+         * The number of rows sorted into each run.
+         */
+        static constexpr std::size_t ChunkNumRows = 64 * 1024;
+
+        /**
+         * Spilled runs are written in blocks of this many rows, so a merge only holds one block of each run in memory.
+         */
+        static constexpr std::size_t SpillBlockNumRows = 4 * 1024;
+
+        ExternalSort(std::vector<SortColumn> sortColumns, std::size_t memoryBudget) noexcept;
+
+        /**
+         * Sorts the rows in `[startRow, endRow)` of a buffer into a new run.  This can be called concurrently from multiple threads.
+         */
+        void addRun(const BufferType& buffer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) noexcept;
+
+        /**
+         * Adds the rows in `[startRow, endRow)` of a buffer that are already in sorted order as a new run, without sorting them.
+         * This can be called concurrently from multiple threads.
+         */
+        void addSortedRun(const BufferType& buffer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) noexcept;
+
+        /**
+         * Reads the rows of every run in sorted order, one row at a time.  Only one block of each spilled run is held in memory.
+         * No runs can be added while a merger is reading, and the sort must outlive it.
+         */
+        class Merger final {
+        public:
+            Merger(const ExternalSort& sort) noexcept;
+
+            Merger(const Merger&) = delete;
+            Merger& operator=(const Merger&) = delete;
+
+            /**
+             * Returns false once every row has been read.
+             */
+            bool valid() const noexcept;
+
+            const OutputRowReader<BufferType>& reader() const noexcept;
+
+            std::size_t row() const noexcept;
+
+            /**
+             * The normalized key of the current row.
+             */
+            const std::string& key() const noexcept;
+
+            /**
+             * Moves to the next row in sorted order.
+             */
+            void next() noexcept;
+
+        private:
+            struct Cursor {
+                BufferPtr buffer;
+                std::unique_ptr<OutputRowReader<BufferType>> reader;
+                std::size_t row = 0;
+
+                // Only spilled runs have more than one block.
+                std::unique_ptr<SpillFile::Reader> spillReader;
+
+                std::string key;
+                bool done = false;
+            };
+
+            // Exhausted cursors are ordered last, as the @b LoserTree requires.
+            struct CursorLess {
+                const std::vector<Cursor>* cursors;
+
+                bool operator()(std::size_t lhs, std::size_t rhs) const noexcept;
+            };
+
+            const ExternalSort& _sort;
+            std::vector<Cursor> _cursors;
+            std::unique_ptr<LoserTree<CursorLess>> _tree;
+
+            /**
+             * Reads the key of the current row of a cursor, moving to its next block if needed.
+             */
+            void loadKey(Cursor& cursor) const noexcept;
+
+            const Cursor& top() const noexcept;
+        };
+
+        /**
+         * Merges every run into @b writer , in sorted order.
+         */
+        void merge(OutputRowWriter& writer) const noexcept;
+
+        /**
+         * Merges every run in sorted order, passing the rows to @b consume as @b OutputRow buffers of at most
+         * @b ChunkNumRows rows written with @b builder .  Only one chunk of the output is in memory at a time.  The callback
+         * may take the contents of the buffer.
+         */
+        void merge(const OutputRowWriter::OutputRowBuilder& builder, const std::function<void(BufferType&)>& consume) const noexcept;
+
+        std::size_t NumRuns() const noexcept;
+
+        std::size_t NumSpilledRuns() const noexcept;
+
+        /**
+         * Appends the normalized key of a row to @b key .
+         *
+         * Each column is a null marker followed by its value, so nulls sort last in ascending order and first in descending order.
+         * Numbers are written big endian with their sign flipped, strings have their zero bytes escaped and are zero terminated,
+         * and every byte of a descending column is inverted.
+         */
+        static void AppendNormalizedKey(const OutputRowReader<BufferType>& reader, std::size_t row, const std::vector<SortColumn>& sortColumns, std::string& key) noexcept;
+
+        /**
+         * Builds a radix sort item for each row in `[startRow, endRow)`, whose keys order the rows like their normalized keys.
+         * The row of each item is relative to @b startRow .
+         *
+         * Each column takes 64 bits for an integer or 32 bits for a float, plus a bit for the null marker of a nullable column.
+         * Returns false if the sort columns don't fit in 64 bits, or aren't all numbers.
+         */
+        static bool MakeRadixSortItems(const OutputRowReader<BufferType>& reader, std::size_t startRow, std::size_t endRow, const std::vector<SortColumn>& sortColumns, std::vector<RadixSortItem>& items, std::uint32_t& numKeyBytes) noexcept;
+
+        /**
+         * Returns the rows in `[startRow, endRow)` in sorted order, relative to @b startRow .  The rows are sorted with a radix
+         * sort when @b MakeRadixSortItems can build their keys, and by their normalized keys otherwise.
+         */
+        static std::vector<std::size_t> SortedOrder(const OutputRowReader<BufferType>& reader, std::size_t startRow, std::size_t endRow, const std::vector<SortColumn>& sortColumns) noexcept;
+
+    private:
+        std::vector<SortColumn> _sortColumns;
+        std::size_t _memoryBudget;
+
+        /**
+         * Copies the rows in `[startRow, endRow)` of a buffer into a new run, in the order of @b order , which is relative to
+         * @b startRow .  The run is spilled if it doesn't fit in the memory budget.
+         */
+        void addOrderedRun(const OutputRowReader<BufferType>& reader, std::size_t startRow, std::size_t endRow, const std::vector<std::size_t>& order) noexcept;
+
+        mutable std::mutex _mutex;
+        std::size_t _inMemoryBytes = 0;
+        std::vector<BufferPtr> _inMemoryRuns;
+        std::vector<std::unique_ptr<SpillFile>> _spilledRuns;
+    };
+}
@@ -0,0 +1,108 @@
+#include "GraceHashJoin.hpp"
+#include "RadixPartitioner.hpp"
+
+#include <iostream>
+
+metaldb::GraceHashJoin::GraceHashJoin(JoinType joinType, std::vector<ColumnType> lhsColumnTypes, ColumnIndexType lhsColumn, std::vector<ColumnType> rhsColumnTypes, ColumnIndexType rhsColumn, std::uint8_t numPartitionBits, std::size_t memoryBudget) noexcept : _joinType(joinType), _lhsColumnTypes(std::move(lhsColumnTypes)), _lhsColumn(lhsColumn), _rhsColumnTypes(std::move(rhsColumnTypes)), _rhsColumn(rhsColumn), _numPartitionBits(std::max<std::uint8_t>(numPartitionBits, 1)), _memoryBudget(memoryBudget), _partitions(1UL << this->_numPartitionBits) {}
+
+auto metaldb::GraceHashJoin::OutputColumnTypes() const noexcept -> std::vector<ColumnType> {
+    return this->makeHashJoin().OutputColumnTypes();
+}
+
+auto metaldb::GraceHashJoin::makeHashJoin() const noexcept -> HashJoin {
+    return HashJoin(this->_joinType, this->_lhsColumnTypes, this->_lhsColumn, this->_rhsColumnTypes, this->_rhsColumn);
+}
+
+void metaldb::GraceHashJoin::spillBuild(const BufferType& buffer) noexcept {
+    this->spill(buffer, true, 0, this->_partitions);
+}
+
+void metaldb::GraceHashJoin::spillProbe(const BufferType& buffer) noexcept {
+    this->spill(buffer, false, 0, this->_partitions);
+}
+
+auto metaldb::GraceHashJoin::NumBuildBytes() const noexcept -> std::size_t {
+    std::size_t numBytes = 0;
+    for (const auto& partition : this->_partitions) {
+        numBytes += partition.build->NumBytes();
+    }
+    return numBytes;
+}
+
+void metaldb::GraceHashJoin::spill(const BufferType& buffer, bool isBuild, std::uint8_t startBit, std::vector<Partition>& partitions) const noexcept {
+    if (buffer.empty()) {
+        return;
+    }
+
+    const bool buildIsLhs = this->makeHashJoin().BuildIsLhs();
+    const bool isLhs = isBuild == buildIsLhs;
+    RadixPartitioner partitioner(isLhs ? this->_lhsColumnTypes : this->_rhsColumnTypes, isLhs ? this->_lhsColumn : this->_rhsColumn, this->_numPartitionBits, startBit);
+
+    auto partitionBuffers = partitioner.partition(buffer);
+    for (std::size_t i = 0; i < partitionBuffers.size(); ++i) {
+        if (OutputRowReader(*partitionBuffers.at(i)).NumRows() == 0) {
+            continue;
+        }
+
+        auto& partition = partitions.at(i);
+        (isBuild ? partition.build : partition.probe)->append(*partitionBuffers.at(i));
+    }
+}
+
+void metaldb::GraceHashJoin::join(const std::function<void(BufferType&)>& consume) const noexcept {
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = this->OutputColumnTypes();
+    for (const auto& partition : this->_partitions) {
+        this->joinPartition(partition, this->_numPartitionBits, builder, consume);
+    }
+}
+
+void metaldb::GraceHashJoin::joinPartition(const Partition& partition, std::uint8_t startBit, const OutputRowWriter::OutputRowBuilder& builder, const std::function<void(BufferType&)>& consume) const noexcept {
+    if (partition.probe->NumRows() == 0) {
+        // Every output row comes from a probe row.
+        return;
+    }
+
+    constexpr std::uint8_t numHashBits = sizeof(JoinHashTable::HashType) * 8;
+    const bool canSplit = startBit + this->_numPartitionBits <= numHashBits;
+    if (partition.build->NumBytes() > this->_memoryBudget && canSplit) {
+        std::vector<Partition> subpartitions(1UL << this->_numPartitionBits);
+        partition.build->forEachBuffer([&](BufferType& buffer) {
+            this->spill(buffer, true, startBit, subpartitions);
+        });
+
+        // If every row has the same key, splitting again won't help.
+        bool isSkewed = false;
+        for (const auto& subpartition : subpartitions) {
+            isSkewed = isSkewed || subpartition.build->NumRows() == partition.build->NumRows();
+        }
+
+        if (!isSkewed) {
+            partition.probe->forEachBuffer([&](BufferType& buffer) {
+                this->spill(buffer, false, startBit, subpartitions);
+            });
+
+            for (const auto& subpartition : subpartitions) {
+                this->joinPartition(subpartition, startBit + this->_numPartitionBits, builder, consume);
+            }
+            return;
+        }
+
+        std::cout << "Join partition has too many duplicate keys to split, joining " << partition.build->NumBytes() << " bytes in memory" << std::endl;
+    }
+
+    // The build side fits, so join in memory and stream the probe side through one chunk at a time.
+    auto hashJoin = this->makeHashJoin();
+    hashJoin.build(partition.build->readAll());
+    OutputRowWriter writer(builder);
+    partition.probe->forEachBuffer([&](BufferType& buffer) {
+        hashJoin.probe(buffer, writer);
+    });
+    if (writer.CurrentNumRows() == 0) {
+        return;
+    }
+
+    BufferType output;
+    writer.write(output);
+    consume(output);
+}
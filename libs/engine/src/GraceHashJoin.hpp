@@ -0,0 +1,84 @@
+#pragma once
+
+#include "HashJoin.hpp"
+#include "OutputRowWriter.hpp"
+#include "SpillFile.hpp"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * An equi-join for build sides that do not fit in memory.
+     *
+     * Both sides are radix partitioned by the hash of their key as chunks arrive, and every partition is appended to its own
+     * @b SpillFile .  Partitions are then joined one at a time with a @b HashJoin , and the output of each is handed off before
+     * the next is joined.  A partition whose build side is still larger than
+     * the memory budget is partitioned again using the next bits of the hash, until it fits or it cannot be split any further.
+     */
+    class GraceHashJoin final {
+    public:
+        using BufferType = std::vector<char>;
+        using BufferPtr = std::shared_ptr<BufferType>;
+        using JoinType = HashJoin::JoinType;
+        using ColumnIndexType = HashJoin::ColumnIndexType;
+
+        GraceHashJoin(JoinType joinType, std::vector<ColumnType> lhsColumnTypes, ColumnIndexType lhsColumn, std::vector<ColumnType> rhsColumnTypes, ColumnIndexType rhsColumn, std::uint8_t numPartitionBits, std::size_t memoryBudget) noexcept;
+
+        ~GraceHashJoin() noexcept = default;
+
+        /**
+         * Returns the types of the columns written by @b join .
+         */
+        std::vector<ColumnType> OutputColumnTypes() const noexcept;
+
+        /**
+         * Partitions a chunk of the build side and appends it to the spill files.  This can be called concurrently.
+         */
+        void spillBuild(const BufferType& buffer) noexcept;
+
+        /**
+         * Partitions a chunk of the probe side and appends it to the spill files.  This can be called concurrently.
+         */
+        void spillProbe(const BufferType& buffer) noexcept;
+
+        /**
+         * Joins every partition, passing the joined rows of each one to @b consume as an @b OutputRow buffer, so only a
+         * single partition's output is in memory at a time.  Partitions without any joined rows are skipped.  The callback
+         * owns the buffer it is given and may move from it.
+         * All of the chunks must be spilled first.
+         */
+        void join(const std::function<void(BufferType&)>& consume) const noexcept;
+
+        /**
+         * Returns the number of bytes written to the spill files for the build side.
+         */
+        std::size_t NumBuildBytes() const noexcept;
+
+    private:
+        struct Partition {
+            std::unique_ptr<SpillFile> build = std::make_unique<SpillFile>();
+            std::unique_ptr<SpillFile> probe = std::make_unique<SpillFile>();
+        };
+
+        JoinType _joinType;
+        std::vector<ColumnType> _lhsColumnTypes;
+        ColumnIndexType _lhsColumn;
+        std::vector<ColumnType> _rhsColumnTypes;
+        ColumnIndexType _rhsColumn;
+        std::uint8_t _numPartitionBits;
+        std::size_t _memoryBudget;
+
+        std::vector<Partition> _partitions;
+
+        HashJoin makeHashJoin() const noexcept;
+
+        /**
+         * Splits the chunk by the partitioning bits starting at @b startBit , and appends each part to the matching spill file.
+         */
+        void spill(const BufferType& buffer, bool isBuild, std::uint8_t startBit, std::vector<Partition>& partitions) const noexcept;
+
+        void joinPartition(const Partition& partition, std::uint8_t startBit, const OutputRowWriter::OutputRowBuilder& builder, const std::function<void(BufferType&)>& consume) const noexcept;
+    };
+}
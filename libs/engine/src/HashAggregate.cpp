@@ -0,0 +1,377 @@
+#include "HashAggregate.hpp"
+#include "HyperLogLog.hpp"
+#include "TDigest.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+namespace {
+    /**
+     * Returns the type without its nullability.  The nullable type is always one more.
+     */
+    metaldb::ColumnType BaseColumnType(metaldb::ColumnType type) noexcept {
+        switch (type) {
+        case metaldb::String_opt:
+        case metaldb::Float_opt:
+        case metaldb::Integer_opt:
+            return (metaldb::ColumnType) (type - 1);
+        case metaldb::String:
+        case metaldb::Float:
+        case metaldb::Integer:
+        case metaldb::Unknown:
+            return type;
+        }
+    }
+
+    metaldb::ColumnType ColumnTypeWithNullability(metaldb::ColumnType type, bool nullable) noexcept {
+        type = BaseColumnType(type);
+        return nullable && type != metaldb::Unknown ? (metaldb::ColumnType) (type + 1) : type;
+    }
+
+    double ReadNumber(metaldb::ColumnType baseType, const char* data) noexcept {
+        if (baseType == metaldb::Integer) {
+            return (double) metaldb::ReadBytesStartingAt<metaldb::types::IntegerType>(data);
+        }
+        return metaldb::ReadBytesStartingAt<metaldb::types::FloatType>(data);
+    }
+}
+
+metaldb::HashAggregate::HashAggregate(std::vector<ColumnType> inputColumnTypes, std::vector<ColumnIndexType> groupByColumns, std::vector<Aggregation> aggregations) noexcept : _inputColumnTypes(std::move(inputColumnTypes)), _groupByColumns(std::move(groupByColumns)), _aggregations(std::move(aggregations)) {}
+
+auto metaldb::HashAggregate::AggregationType(const Aggregation& aggregation) const noexcept -> ColumnType {
+    switch (aggregation.function) {
+    case Function::COUNT:
+    case Function::APPROX_COUNT_DISTINCT:
+        return Integer;
+    case Function::AVG:
+    case Function::APPROX_PERCENTILE:
+        return Float;
+    case Function::SUM:
+    case Function::MIN:
+    case Function::MAX:
+        return BaseColumnType(this->_inputColumnTypes.at(*aggregation.column));
+    }
+}
+
+auto metaldb::HashAggregate::AggregationIsNullable(const Aggregation& aggregation) const noexcept -> bool {
+    if (aggregation.function == Function::COUNT || aggregation.function == Function::APPROX_COUNT_DISTINCT) {
+        return false;
+    }
+
+    // Without a group by there is always an output row, even when there are no values.
+    const auto inputType = this->_inputColumnTypes.at(*aggregation.column);
+    return this->_groupByColumns.empty() || inputType != BaseColumnType(inputType);
+}
+
+auto metaldb::HashAggregate::PartialColumnTypes() const noexcept -> std::vector<ColumnType> {
+    std::vector<ColumnType> columnTypes;
+    for (const auto& column : this->_groupByColumns) {
+        columnTypes.push_back(this->_inputColumnTypes.at(column));
+    }
+    for (const auto& aggregation : this->_aggregations) {
+        if (aggregation.function == Function::AVG) {
+            // The bytes of the sum as a double, then the count.
+            columnTypes.push_back(String);
+            columnTypes.push_back(Integer);
+        } else if (aggregation.function == Function::APPROX_COUNT_DISTINCT || aggregation.function == Function::APPROX_PERCENTILE) {
+            // The serialized sketch.
+            columnTypes.push_back(String);
+        } else {
+            columnTypes.push_back(ColumnTypeWithNullability(this->AggregationType(aggregation), this->AggregationIsNullable(aggregation)));
+        }
+    }
+    return columnTypes;
+}
+
+auto metaldb::HashAggregate::FinalColumnTypes() const noexcept -> std::vector<ColumnType> {
+    std::vector<ColumnType> columnTypes;
+    for (const auto& column : this->_groupByColumns) {
+        columnTypes.push_back(this->_inputColumnTypes.at(column));
+    }
+    for (const auto& aggregation : this->_aggregations) {
+        columnTypes.push_back(ColumnTypeWithNullability(this->AggregationType(aggregation), this->AggregationIsNullable(aggregation)));
+    }
+    return columnTypes;
+}
+
+auto metaldb::HashAggregate::NumGroups() const noexcept -> std::size_t {
+    return this->_keyOffsets.size() - 1;
+}
+
+auto metaldb::HashAggregate::findOrInsertGroup(const std::vector<char>& key) noexcept -> std::size_t {
+    const auto hash = JoinHashTable::Hash(key.data(), key.size());
+
+    std::optional<std::size_t> group;
+    this->_table.probe(hash, [&](const JoinHashTable::Entry& entry) {
+        const auto keyStart = this->_keyData.begin() + this->_keyOffsets.at(entry.row);
+        const auto keyEnd = this->_keyData.begin() + this->_keyOffsets.at(entry.row + 1);
+        if (std::equal(keyStart, keyEnd, key.begin(), key.end())) {
+            group = entry.row;
+        }
+    });
+    if (group) {
+        return *group;
+    }
+
+    const auto newGroup = this->NumGroups();
+    this->_table.insert(hash, 0, (JoinHashTable::RowRefType) newGroup);
+    this->_keyData.insert(this->_keyData.end(), key.begin(), key.end());
+    this->_keyOffsets.push_back(this->_keyData.size());
+    this->_states.resize(this->_states.size() + this->_aggregations.size());
+    return newGroup;
+}
+
+namespace {
+    /**
+     * Folds a single value into the state of an aggregation.  Null values are skipped.
+     */
+    template<typename State>
+    void FoldValue(State& state, metaldb::QueryEngine::AggregatePartial::Function function, metaldb::ColumnType baseType, const char* data, std::size_t size) noexcept {
+        using Function = metaldb::QueryEngine::AggregatePartial::Function;
+        if (size == 0) {
+            return;
+        }
+
+        switch (function) {
+        case Function::COUNT:
+            break;
+        case Function::SUM:
+            if (baseType == metaldb::Integer) {
+                state.integer += metaldb::ReadBytesStartingAt<metaldb::types::IntegerType>(data);
+            } else {
+                state.floating += ReadNumber(baseType, data);
+            }
+            break;
+        case Function::AVG:
+            state.floating += ReadNumber(baseType, data);
+            break;
+        case Function::APPROX_COUNT_DISTINCT:
+            metaldb::HyperLogLog::Add(state.string, data, size);
+            break;
+        case Function::APPROX_PERCENTILE:
+            metaldb::TDigest::Add(state.string, ReadNumber(baseType, data));
+            break;
+        case Function::MIN:
+        case Function::MAX: {
+            const bool isMin = function == Function::MIN;
+            const bool isFirst = state.count == 0;
+            if (baseType == metaldb::String) {
+                std::string_view value(data, size);
+                if (isFirst || (isMin ? value < state.string : value > state.string)) {
+                    state.string = value;
+                }
+            } else if (baseType == metaldb::Integer) {
+                auto value = metaldb::ReadBytesStartingAt<metaldb::types::IntegerType>(data);
+                if (isFirst || (isMin ? value < state.integer : value > state.integer)) {
+                    state.integer = value;
+                }
+            } else {
+                auto value = ReadNumber(baseType, data);
+                if (isFirst || (isMin ? value < state.floating : value > state.floating)) {
+                    state.floating = value;
+                }
+            }
+            break;
+        }
+        }
+        state.count++;
+    }
+}
+
+void metaldb::HashAggregate::update(const BufferType& buffer, std::size_t startRow, std::size_t endRow) noexcept {
+    if (buffer.empty()) {
+        return;
+    }
+
+    auto reader = OutputRowReader(buffer);
+    endRow = std::min<std::size_t>(endRow, reader.NumRows());
+
+    std::vector<char> key;
+    for (std::size_t row = startRow; row < endRow; ++row) {
+        key.clear();
+        for (const auto& column : this->_groupByColumns) {
+            auto [data, size] = reader.ColumnData(column, row);
+            key.push_back((char) size);
+            key.insert(key.end(), data, data + size);
+        }
+
+        const auto group = this->findOrInsertGroup(key);
+        for (std::size_t i = 0; i < this->_aggregations.size(); ++i) {
+            const auto& aggregation = this->_aggregations.at(i);
+            auto& state = this->_states.at(group * this->_aggregations.size() + i);
+            if (!aggregation.column) {
+                // COUNT(*) counts every row, including nulls.
+                state.count++;
+                continue;
+            }
+
+            auto [data, size] = reader.ColumnData(*aggregation.column, row);
+            FoldValue(state, aggregation.function, BaseColumnType(this->_inputColumnTypes.at(*aggregation.column)), data, size);
+        }
+    }
+}
+
+void metaldb::HashAggregate::merge(const BufferType& partialBuffer) noexcept {
+    if (partialBuffer.empty()) {
+        return;
+    }
+
+    auto reader = OutputRowReader(partialBuffer);
+    const auto numGroupByColumns = this->_groupByColumns.size();
+
+    std::vector<char> key;
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        key.clear();
+        for (std::size_t column = 0; column < numGroupByColumns; ++column) {
+            auto [data, size] = reader.ColumnData(column, row);
+            key.push_back((char) size);
+            key.insert(key.end(), data, data + size);
+        }
+
+        const auto group = this->findOrInsertGroup(key);
+        auto column = numGroupByColumns;
+        for (std::size_t i = 0; i < this->_aggregations.size(); ++i) {
+            const auto& aggregation = this->_aggregations.at(i);
+            auto& state = this->_states.at(group * this->_aggregations.size() + i);
+            const auto valueColumn = column++;
+            auto [data, size] = reader.ColumnData(valueColumn, row);
+
+            switch (aggregation.function) {
+            case Function::COUNT:
+                state.count += ReadBytesStartingAt<types::IntegerType>(data);
+                break;
+            case Function::AVG: {
+                // The kernel writes the sum as a float, and @b writePartial as the bytes of a double.
+                if (reader.TypeOfColumn(valueColumn) == Float) {
+                    state.floating += ReadBytesStartingAt<types::FloatType>(data);
+                } else if (size == sizeof(double)) {
+                    state.floating += ReadBytesStartingAt<double>(data);
+                }
+                auto [countData, countSize] = reader.ColumnData(column++, row);
+                state.count += ReadBytesStartingAt<types::IntegerType>(countData);
+                break;
+            }
+            case Function::APPROX_COUNT_DISTINCT:
+                HyperLogLog::Merge(state.string, data, size);
+                state.count += size > 0;
+                break;
+            case Function::APPROX_PERCENTILE:
+                TDigest::Merge(state.string, data, size);
+                state.count += size > 0;
+                break;
+            case Function::SUM:
+            case Function::MIN:
+            case Function::MAX:
+                // The partial value is folded in like any other value.
+                FoldValue(state, aggregation.function, this->AggregationType(aggregation), data, size);
+                break;
+            }
+        }
+    }
+}
+
+void metaldb::HashAggregate::writePartial(OutputRowWriter& writer) const noexcept {
+    this->write(writer, true);
+}
+
+void metaldb::HashAggregate::writeFinal(OutputRowWriter& writer) const noexcept {
+    this->write(writer, false);
+}
+
+void metaldb::HashAggregate::write(OutputRowWriter& writer, bool isPartial) const noexcept {
+    using Scratch = std::array<char, sizeof(double)>;
+    static_assert(sizeof(types::IntegerType) <= sizeof(Scratch) && sizeof(types::FloatType) <= sizeof(Scratch));
+
+    // Every aggregation writes at most 2 columns.
+    std::vector<Scratch> scratch(this->_aggregations.size() * 2);
+    std::vector<std::string> sketches(this->_aggregations.size());
+    std::vector<OutputRowWriter::ColumnValue> columns;
+
+    auto writeRow = [&](const char* key, const State* states) {
+        columns.clear();
+        for (std::size_t column = 0; column < this->_groupByColumns.size(); ++column) {
+            const auto size = (OutputRow::ColumnSizeType) *key;
+            columns.push_back({key + 1, size});
+            key += 1 + size;
+        }
+
+        std::size_t scratchIndex = 0;
+        auto writeValue = [&](auto value) {
+            auto& bytes = scratch.at(scratchIndex++);
+            std::copy_n(reinterpret_cast<const char*>(&value), sizeof(value), bytes.data());
+            columns.push_back({bytes.data(), (OutputRow::ColumnSizeType) sizeof(value)});
+        };
+
+        for (std::size_t i = 0; i < this->_aggregations.size(); ++i) {
+            const auto& aggregation = this->_aggregations.at(i);
+            const auto& state = states[i];
+            switch (aggregation.function) {
+            case Function::COUNT:
+                writeValue(state.count);
+                break;
+            case Function::AVG:
+                if (isPartial) {
+                    // A float sum would round every partial, which adds up over many of them.
+                    writeValue(state.floating);
+                    writeValue(state.count);
+                } else if (state.count == 0) {
+                    columns.emplace_back();
+                } else {
+                    writeValue((types::FloatType) (state.floating / state.count));
+                }
+                break;
+            case Function::APPROX_COUNT_DISTINCT:
+                if (isPartial) {
+                    HyperLogLog::Serialize(state.string, sketches.at(i));
+                    columns.push_back({sketches.at(i).data(), (OutputRow::ColumnSizeType) sketches.at(i).size()});
+                } else {
+                    writeValue(HyperLogLog::Estimate(state.string));
+                }
+                break;
+            case Function::APPROX_PERCENTILE:
+                if (isPartial) {
+                    TDigest::Serialize(state.string, sketches.at(i));
+                    columns.push_back({sketches.at(i).data(), (OutputRow::ColumnSizeType) sketches.at(i).size()});
+                } else if (state.count == 0) {
+                    columns.emplace_back();
+                } else {
+                    writeValue((types::FloatType) TDigest::Quantile(state.string, aggregation.percentile));
+                }
+                break;
+            case Function::SUM:
+            case Function::MIN:
+            case Function::MAX:
+                if (state.count == 0) {
+                    columns.emplace_back();
+                    break;
+                }
+                switch (this->AggregationType(aggregation)) {
+                case Integer:
+                    writeValue(state.integer);
+                    break;
+                case Float:
+                    writeValue((types::FloatType) state.floating);
+                    break;
+                default:
+                    columns.push_back({state.string.data(), (OutputRow::ColumnSizeType) state.string.size()});
+                    break;
+                }
+                break;
+            }
+        }
+
+        writer.appendRow(columns);
+    };
+
+    if (this->NumGroups() == 0 && this->_groupByColumns.empty() && !isPartial) {
+        // An aggregate over no rows still has a value.
+        std::vector<State> emptyStates(this->_aggregations.size());
+        writeRow(nullptr, emptyStates.data());
+        return;
+    }
+
+    for (std::size_t group = 0; group < this->NumGroups(); ++group) {
+        writeRow(this->_keyData.data() + this->_keyOffsets.at(group), this->_states.data() + group * this->_aggregations.size());
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "JoinHashTable.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include <metaldb/query_engine/partials.hpp>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * A hash aggregate over @b OutputRow buffers, grouping rows by the bytes of their group by columns.
+     *
+     * Aggregation happens in two phases.  @b update folds rows into the state of each group, and @b writePartial writes that state
+     * as an @b OutputRow chunk.  @b merge folds partial chunks from any number of aggregates together, and @b writeFinal writes
+     * the result.  A partial chunk has the group by columns followed by the state of each aggregation, where AVG keeps both
+     * its sum, as the bytes of a double, and a count, and the approximate functions keep a serialized sketch.
+     */
+    class HashAggregate final {
+    public:
+        using BufferType = std::vector<char>;
+        using Function = QueryEngine::AggregatePartial::Function;
+        using Aggregation = QueryEngine::AggregatePartial::Aggregation;
+        using ColumnIndexType = QueryEngine::AggregatePartial::ColumnIndexType;
+
+        /**
+         * The number of rows folded into each partial chunk, unless the planner picked a size for the aggregate.
+         */
+        static constexpr std::size_t ChunkNumRows = QueryEngine::AggregatePartial::DefaultChunkNumRows;
+
+        HashAggregate(std::vector<ColumnType> inputColumnTypes, std::vector<ColumnIndexType> groupByColumns, std::vector<Aggregation> aggregations) noexcept;
+
+        ~HashAggregate() noexcept = default;
+
+        /**
+         * Returns the types of the columns written by @b writePartial , and read by @b merge .
+         */
+        std::vector<ColumnType> PartialColumnTypes() const noexcept;
+
+        /**
+         * Returns the types of the columns written by @b writeFinal .
+         */
+        std::vector<ColumnType> FinalColumnTypes() const noexcept;
+
+        /**
+         * Folds the rows in `[startRow, endRow)` of an input buffer into the aggregate.
+         */
+        void update(const BufferType& buffer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) noexcept;
+
+        /**
+         * Folds a chunk written by @b writePartial into the aggregate.
+         */
+        void merge(const BufferType& partialBuffer) noexcept;
+
+        void writePartial(OutputRowWriter& writer) const noexcept;
+
+        /**
+         * Writes a row for each group.  Without a group by, a single row is always written, even if there were no input rows.
+         */
+        void writeFinal(OutputRowWriter& writer) const noexcept;
+
+        std::size_t NumGroups() const noexcept;
+
+    private:
+        struct State {
+            // The number of values folded in, which excludes nulls.
+            types::IntegerType count = 0;
+            types::IntegerType integer = 0;
+            double floating = 0;
+
+            // The MIN or MAX of strings, or the sketch of an approximate function.
+            std::string string;
+        };
+
+        std::vector<ColumnType> _inputColumnTypes;
+        std::vector<ColumnIndexType> _groupByColumns;
+        std::vector<Aggregation> _aggregations;
+
+        // Maps the hash of a group's key to the index of the group.
+        JoinHashTable _table;
+
+        // The keys of every group back to back.  Each column of a key is its size followed by its bytes.
+        std::vector<char> _keyData;
+        std::vector<std::size_t> _keyOffsets = {0};
+
+        // The state of every aggregation of every group.
+        std::vector<State> _states;
+
+        ColumnType AggregationType(const Aggregation& aggregation) const noexcept;
+
+        bool AggregationIsNullable(const Aggregation& aggregation) const noexcept;
+
+        std::size_t findOrInsertGroup(const std::vector<char>& key) noexcept;
+
+        void write(OutputRowWriter& writer, bool isPartial) const noexcept;
+    };
+}
@@ -0,0 +1,160 @@
+#include "HashJoin.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+    /**
+     * Returns the nullable version of a column type.  The nullable type is always one more.
+     */
+    metaldb::ColumnType NullableColumnType(metaldb::ColumnType type) noexcept {
+        switch (type) {
+        case metaldb::String:
+        case metaldb::Float:
+        case metaldb::Integer:
+            return (metaldb::ColumnType) (type + 1);
+        case metaldb::String_opt:
+        case metaldb::Float_opt:
+        case metaldb::Integer_opt:
+        case metaldb::Unknown:
+            return type;
+        }
+    }
+
+    /**
+     * Returns true if a key is null.  A null has no data, but so does an empty string, which is only null in a nullable column.
+     */
+    bool IsNullKey(metaldb::ColumnType type, std::size_t keySize) noexcept {
+        return keySize == 0 && NullableColumnType(type) == type;
+    }
+}
+
+metaldb::HashJoin::HashJoin(JoinType joinType, std::vector<ColumnType> lhsColumnTypes, ColumnIndexType lhsColumn, std::vector<ColumnType> rhsColumnTypes, ColumnIndexType rhsColumn) noexcept : HashJoin(joinType, std::move(lhsColumnTypes), lhsColumn, std::move(rhsColumnTypes), rhsColumn, joinType == JoinType::RIGHT) {}
+
+metaldb::HashJoin::HashJoin(JoinType joinType, std::vector<ColumnType> lhsColumnTypes, ColumnIndexType lhsColumn, std::vector<ColumnType> rhsColumnTypes, ColumnIndexType rhsColumn, bool buildIsLhs) noexcept : _joinType(joinType), _lhsColumnTypes(std::move(lhsColumnTypes)), _lhsColumn(lhsColumn), _rhsColumnTypes(std::move(rhsColumnTypes)), _rhsColumn(rhsColumn), _buildIsLhs(buildIsLhs) {
+    assert(joinType == JoinType::INNER || buildIsLhs == (joinType == JoinType::RIGHT));
+}
+
+auto metaldb::HashJoin::OutputColumnTypes() const noexcept -> std::vector<ColumnType> {
+    std::vector<ColumnType> columnTypes;
+    for (const auto& type : this->_lhsColumnTypes) {
+        columnTypes.push_back(this->_joinType == JoinType::RIGHT ? NullableColumnType(type) : type);
+    }
+    for (const auto& type : this->_rhsColumnTypes) {
+        columnTypes.push_back(this->_joinType == JoinType::LEFT ? NullableColumnType(type) : type);
+    }
+    return columnTypes;
+}
+
+auto metaldb::HashJoin::BuildIsLhs() const noexcept -> bool {
+    return this->_buildIsLhs;
+}
+
+auto metaldb::HashJoin::BuildColumn() const noexcept -> ColumnIndexType {
+    return this->BuildIsLhs() ? this->_lhsColumn : this->_rhsColumn;
+}
+
+auto metaldb::HashJoin::ProbeColumn() const noexcept -> ColumnIndexType {
+    return this->BuildIsLhs() ? this->_rhsColumn : this->_lhsColumn;
+}
+
+auto metaldb::HashJoin::NumBuildRows() const noexcept -> std::size_t {
+    return this->_table.size();
+}
+
+void metaldb::HashJoin::build(const std::vector<BufferPtr>& buildBuffers) noexcept {
+    this->_buildBuffers.clear();
+    this->_buildReaders.clear();
+    for (const auto& buffer : buildBuffers) {
+        if (buffer && !buffer->empty()) {
+            this->_buildBuffers.push_back(buffer);
+        }
+    }
+
+    // Readers reference the buffers, which are owned by the join.
+    std::size_t numRows = 0;
+    this->_buildReaders.reserve(this->_buildBuffers.size());
+    for (const auto& buffer : this->_buildBuffers) {
+        this->_buildReaders.emplace_back(*buffer);
+        numRows += this->_buildReaders.back().NumRows();
+    }
+
+    const auto buildColumn = this->BuildColumn();
+    const auto buildColumnType = this->BuildIsLhs() ? this->_lhsColumnTypes.at(this->_lhsColumn) : this->_rhsColumnTypes.at(this->_rhsColumn);
+    this->_table = JoinHashTable(numRows);
+    for (std::size_t partition = 0; partition < this->_buildReaders.size(); ++partition) {
+        const auto& reader = this->_buildReaders.at(partition);
+        for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+            auto [keyData, keySize] = reader.ColumnData(buildColumn, row);
+            if (IsNullKey(buildColumnType, keySize)) {
+                // Null keys never match anything.
+                continue;
+            }
+            this->_table.insert(JoinHashTable::Hash(keyData, keySize), partition, row);
+        }
+    }
+}
+
+void metaldb::HashJoin::probe(const BufferType& probeBuffer, OutputRowWriter& writer) const noexcept {
+    if (probeBuffer.empty()) {
+        return;
+    }
+
+    const auto probeColumn = this->ProbeColumn();
+    const auto buildColumn = this->BuildColumn();
+    const auto probeColumnType = this->BuildIsLhs() ? this->_rhsColumnTypes.at(this->_rhsColumn) : this->_lhsColumnTypes.at(this->_lhsColumn);
+    const bool keepUnmatched = this->_joinType != JoinType::INNER;
+
+    // The values of every joined row are gathered into the same vector.
+    std::vector<OutputRowWriter::ColumnValue> columns;
+    columns.reserve(this->_lhsColumnTypes.size() + this->_rhsColumnTypes.size());
+
+    auto probeReader = OutputRowReader(probeBuffer);
+    for (std::size_t row = 0; row < probeReader.NumRows(); ++row) {
+        auto [keyData, keySize] = probeReader.ColumnData(probeColumn, row);
+
+        bool matched = false;
+        if (!IsNullKey(probeColumnType, keySize)) {
+            this->_table.probe(JoinHashTable::Hash(keyData, keySize), [&](const JoinHashTable::Entry& entry) {
+                const auto& buildReader = this->_buildReaders.at(entry.partition);
+                auto [buildKeyData, buildKeySize] = buildReader.ColumnData(buildColumn, entry.row);
+                if (buildKeySize != keySize || !std::equal(keyData, keyData + keySize, buildKeyData)) {
+                    // Hash collision
+                    return;
+                }
+                matched = true;
+                this->appendJoinedRow(probeReader, row, &buildReader, entry.row, columns, writer);
+            });
+        }
+
+        if (!matched && keepUnmatched) {
+            this->appendJoinedRow(probeReader, row, nullptr, 0, columns, writer);
+        }
+    }
+}
+
+void metaldb::HashJoin::appendJoinedRow(const OutputRowReader<BufferType>& probeReader, std::size_t probeRow, const OutputRowReader<BufferType>* buildReader, std::size_t buildRow, std::vector<OutputRowWriter::ColumnValue>& columns, OutputRowWriter& writer) const noexcept {
+    columns.clear();
+
+    auto appendSide = [&](const OutputRowReader<BufferType>* reader, std::size_t row, std::size_t numColumns) {
+        for (std::size_t col = 0; col < numColumns; ++col) {
+            if (reader == nullptr) {
+                // Not matched, so write a null.
+                columns.emplace_back();
+            } else {
+                auto [data, size] = reader->ColumnData(col, row);
+                columns.push_back({data, size});
+            }
+        }
+    };
+
+    if (this->BuildIsLhs()) {
+        appendSide(buildReader, buildRow, this->_lhsColumnTypes.size());
+        appendSide(&probeReader, probeRow, this->_rhsColumnTypes.size());
+    } else {
+        appendSide(&probeReader, probeRow, this->_lhsColumnTypes.size());
+        appendSide(buildReader, buildRow, this->_rhsColumnTypes.size());
+    }
+
+    writer.appendRow(columns);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "JoinHashTable.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include <metaldb/query_engine/partials.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * An equi-join over @b OutputRow buffers.
+     *
+     * Every buffer on the build side is a partition, and all of their rows are inserted into a single @b JoinHashTable .
+     * The probe side is then streamed through the table one buffer (chunk) at a time, where each chunk produces its own
+     * @b OutputRow chunk.  The output always has the lhs columns followed by the rhs columns.
+     */
+    class HashJoin final {
+    public:
+        using BufferType = std::vector<char>;
+        using BufferPtr = std::shared_ptr<BufferType>;
+        using JoinType = QueryEngine::JoinPartial::JoinType;
+        using ColumnIndexType = QueryEngine::JoinPartial::ColumnIndexType;
+
+        HashJoin(JoinType joinType, std::vector<ColumnType> lhsColumnTypes, ColumnIndexType lhsColumn, std::vector<ColumnType> rhsColumnTypes, ColumnIndexType rhsColumn) noexcept;
+
+        /**
+         * @param buildIsLhs Inserts the lhs into the hash table.  An inner join can build either side, but an outer join must build
+         * the side it does not preserve.
+         */
+        HashJoin(JoinType joinType, std::vector<ColumnType> lhsColumnTypes, ColumnIndexType lhsColumn, std::vector<ColumnType> rhsColumnTypes, ColumnIndexType rhsColumn, bool buildIsLhs) noexcept;
+
+        ~HashJoin() noexcept = default;
+
+        /**
+         * Returns the types of the columns written by @b probe .
+         * Columns from the side that is not preserved by an outer join are nullable.
+         */
+        std::vector<ColumnType> OutputColumnTypes() const noexcept;
+
+        /**
+         * Returns true if the lhs is inserted into the hash table.
+         * The side preserved by an outer join is always the probe side, so unmatched rows can be written as they are probed.
+         * Otherwise the rhs is built unless chosen at construction.
+         */
+        bool BuildIsLhs() const noexcept;
+
+        /**
+         * Inserts every row of every build buffer into the hash table.  The buffers are kept alive by the join.
+         */
+        void build(const std::vector<BufferPtr>& buildBuffers) noexcept;
+
+        /**
+         * Probes the hash table with every row in a chunk, appending the joined rows to @b writer .
+         * This can be called concurrently from multiple threads once @b build has finished.
+         */
+        void probe(const BufferType& probeBuffer, OutputRowWriter& writer) const noexcept;
+
+        /**
+         * Returns the number of rows in the hash table.
+         */
+        std::size_t NumBuildRows() const noexcept;
+
+    private:
+        JoinType _joinType;
+        std::vector<ColumnType> _lhsColumnTypes;
+        ColumnIndexType _lhsColumn;
+        std::vector<ColumnType> _rhsColumnTypes;
+        ColumnIndexType _rhsColumn;
+        bool _buildIsLhs;
+
+        std::vector<BufferPtr> _buildBuffers;
+        std::vector<OutputRowReader<BufferType>> _buildReaders;
+        JoinHashTable _table;
+
+        ColumnIndexType BuildColumn() const noexcept;
+
+        ColumnIndexType ProbeColumn() const noexcept;
+
+        /**
+         * Appends a probe row joined with a build row, or with nulls if @b buildReader is nullptr.  @b columns is scratch
+         * space that is reused for every row, so joining a row doesn't allocate.
+         */
+        void appendJoinedRow(const OutputRowReader<BufferType>& probeReader, std::size_t probeRow, const OutputRowReader<BufferType>* buildReader, std::size_t buildRow, std::vector<OutputRowWriter::ColumnValue>& columns, OutputRowWriter& writer) const noexcept;
+    };
+}
@@ -0,0 +1,112 @@
+#include "HashSetOperation.hpp"
+
+metaldb::HashSetOperation::HashSetOperation(Operation operation, std::vector<ColumnType> columnTypes) noexcept : _operation(operation), _columnTypes(std::move(columnTypes)), _aggregate(this->makeAggregate(this->NeedsSides())) {}
+
+auto metaldb::HashSetOperation::NeedsSides() const noexcept -> bool {
+    return this->_operation == Operation::INTERSECT || this->_operation == Operation::EXCEPT;
+}
+
+auto metaldb::HashSetOperation::makeAggregate(bool withSides) const noexcept -> HashAggregate {
+    auto inputColumnTypes = this->_columnTypes;
+    std::vector<HashAggregate::ColumnIndexType> groupByColumns;
+    for (std::size_t column = 0; column < this->_columnTypes.size(); ++column) {
+        groupByColumns.push_back((HashAggregate::ColumnIndexType) column);
+    }
+
+    std::vector<HashAggregate::Aggregation> aggregations;
+    if (withSides) {
+        // The side is an extra input column after every other column.
+        const auto sideColumn = (HashAggregate::ColumnIndexType) this->_columnTypes.size();
+        inputColumnTypes.push_back(Integer);
+        aggregations.push_back({HashAggregate::Function::MIN, sideColumn});
+        aggregations.push_back({HashAggregate::Function::MAX, sideColumn});
+    }
+    return HashAggregate(std::move(inputColumnTypes), std::move(groupByColumns), std::move(aggregations));
+}
+
+auto metaldb::HashSetOperation::PartialColumnTypes() const noexcept -> std::vector<ColumnType> {
+    return this->_aggregate.PartialColumnTypes();
+}
+
+auto metaldb::HashSetOperation::NumDistinctRows() const noexcept -> std::size_t {
+    return this->_aggregate.NumGroups();
+}
+
+void metaldb::HashSetOperation::writePartial(const BufferType& buffer, bool isLhs, OutputRowWriter& writer, std::size_t startRow, std::size_t endRow) const noexcept {
+    auto distinct = this->makeAggregate(false);
+    distinct.update(buffer, startRow, endRow);
+    if (!this->NeedsSides()) {
+        distinct.writePartial(writer);
+        return;
+    }
+
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = distinct.PartialColumnTypes();
+    OutputRowWriter distinctWriter(builder);
+    distinct.writePartial(distinctWriter);
+
+    BufferType distinctBuffer;
+    distinctWriter.write(distinctBuffer);
+    if (distinctBuffer.empty()) {
+        return;
+    }
+    auto reader = OutputRowReader(distinctBuffer);
+
+    // The MIN and MAX side of a single row are both its side.
+    const types::IntegerType side = isLhs ? 0 : 1;
+    const OutputRowWriter::ColumnValue sideValue{reinterpret_cast<const char*>(&side), (OutputRow::ColumnSizeType) sizeof(side)};
+    std::vector<OutputRowWriter::ColumnValue> columns;
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        columns.clear();
+        for (std::size_t column = 0; column < this->_columnTypes.size(); ++column) {
+            auto [data, size] = reader.ColumnData(column, row);
+            columns.push_back({data, (OutputRow::ColumnSizeType) size});
+        }
+        columns.push_back(sideValue);
+        columns.push_back(sideValue);
+        writer.appendRow(columns);
+    }
+}
+
+void metaldb::HashSetOperation::merge(const BufferType& partialBuffer) noexcept {
+    this->_aggregate.merge(partialBuffer);
+}
+
+void metaldb::HashSetOperation::writeFinal(OutputRowWriter& writer) const noexcept {
+    if (!this->NeedsSides()) {
+        this->_aggregate.writeFinal(writer);
+        return;
+    }
+
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = this->_aggregate.FinalColumnTypes();
+    OutputRowWriter finalWriter(builder);
+    this->_aggregate.writeFinal(finalWriter);
+
+    BufferType finalBuffer;
+    finalWriter.write(finalBuffer);
+    if (finalBuffer.empty()) {
+        return;
+    }
+    auto reader = OutputRowReader(finalBuffer);
+
+    const auto minSideColumn = this->_columnTypes.size();
+    std::vector<OutputRowWriter::ColumnValue> columns;
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        const auto minSide = ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(minSideColumn, row).first);
+        const auto maxSide = ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(minSideColumn + 1, row).first);
+
+        // Intersect keeps rows on both sides, and except keeps rows only on the lhs.
+        const bool keep = this->_operation == Operation::INTERSECT ? minSide == 0 && maxSide == 1 : maxSide == 0;
+        if (!keep) {
+            continue;
+        }
+
+        columns.clear();
+        for (std::size_t column = 0; column < this->_columnTypes.size(); ++column) {
+            auto [data, size] = reader.ColumnData(column, row);
+            columns.push_back({data, (OutputRow::ColumnSizeType) size});
+        }
+        writer.appendRow(columns);
+    }
+}
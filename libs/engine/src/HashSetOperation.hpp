@@ -0,0 +1,71 @@
+#pragma once
+
+#include "HashAggregate.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include <metaldb/query_engine/partials.hpp>
+
+#include <limits>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Removes duplicate rows from @b OutputRow buffers, for `DISTINCT`, `UNION`, `INTERSECT` and `EXCEPT`.
+     *
+     * This is a @b HashAggregate grouped by every column.  @b writePartial removes the duplicates within a single chunk, and
+     * @b merge folds those chunks together.  For `INTERSECT` and `EXCEPT` each partial row also has the side it came from,
+     * where the lhs is 0 and the rhs is 1.  The final phase keeps the MIN and MAX side of each row, which tells whether the row
+     * was on either or both sides.
+     */
+    class HashSetOperation final {
+    public:
+        using BufferType = std::vector<char>;
+        using Operation = QueryEngine::SetOperationPartial::Operation;
+
+        /**
+         * The number of rows deduplicated into each partial chunk.
+         */
+        static constexpr std::size_t ChunkNumRows = HashAggregate::ChunkNumRows;
+
+        HashSetOperation(Operation operation, std::vector<ColumnType> columnTypes) noexcept;
+
+        ~HashSetOperation() noexcept = default;
+
+        /**
+         * Returns the types of the columns written by @b writePartial , and read by @b merge .
+         */
+        std::vector<ColumnType> PartialColumnTypes() const noexcept;
+
+        /**
+         * Writes the distinct rows in `[startRow, endRow)` of a chunk from one side of the operation.
+         */
+        void writePartial(const BufferType& buffer, bool isLhs, OutputRowWriter& writer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) const noexcept;
+
+        /**
+         * Folds a chunk written by @b writePartial into the result.
+         */
+        void merge(const BufferType& partialBuffer) noexcept;
+
+        /**
+         * Writes every distinct row kept by the operation, which has the same columns as the input.
+         */
+        void writeFinal(OutputRowWriter& writer) const noexcept;
+
+        /**
+         * Returns the number of distinct rows merged, from both sides.
+         */
+        std::size_t NumDistinctRows() const noexcept;
+
+    private:
+        Operation _operation;
+        std::vector<ColumnType> _columnTypes;
+
+        // Groups by every column, with the MIN and MAX side when the sides are needed.
+        HashAggregate _aggregate;
+
+        bool NeedsSides() const noexcept;
+
+        HashAggregate makeAggregate(bool withSides) const noexcept;
+    };
+}
@@ -0,0 +1,71 @@
+#include "HyperLogLog.hpp"
+#include "JoinHashTable.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+void metaldb::HyperLogLog::Add(Registers& registers, const char* data, std::size_t size) noexcept {
+    registers.resize(NumRegisters, 0);
+
+    // The first bits pick the register, and the rest count leading zeros.
+    const auto hash = JoinHashTable::Hash(data, size);
+    const auto index = hash >> (64 - PrecisionBits);
+    const auto rest = hash << PrecisionBits;
+    const auto rank = (char) std::min<int>(std::countl_zero(rest) + 1, 64 - PrecisionBits + 1);
+    registers[index] = std::max(registers[index], rank);
+}
+
+void metaldb::HyperLogLog::Merge(Registers& registers, const char* data, std::size_t size) noexcept {
+    if (size != NumSerializedBytes) {
+        return;
+    }
+
+    registers.resize(NumRegisters, 0);
+    for (std::size_t i = 0; i < NumRegisters; ++i) {
+        const auto bit = i * RegisterBits;
+        const auto word = (std::uint32_t) (std::uint8_t) data[bit / 8] | ((bit / 8 + 1 < size ? (std::uint32_t) (std::uint8_t) data[bit / 8 + 1] : 0) << 8);
+        const auto value = (char) ((word >> (bit % 8)) & ((1 << RegisterBits) - 1));
+        registers[i] = std::max(registers[i], value);
+    }
+}
+
+void metaldb::HyperLogLog::Serialize(const Registers& registers, std::string& output) noexcept {
+    output.clear();
+    if (registers.empty()) {
+        return;
+    }
+
+    output.resize(NumSerializedBytes, 0);
+    for (std::size_t i = 0; i < NumRegisters; ++i) {
+        const auto bit = i * RegisterBits;
+        const auto value = (std::uint32_t) (std::uint8_t) registers[i] << (bit % 8);
+        output[bit / 8] = (char) (output[bit / 8] | (value & 0xff));
+        if (bit / 8 + 1 < NumSerializedBytes) {
+            output[bit / 8 + 1] = (char) (output[bit / 8 + 1] | (value >> 8));
+        }
+    }
+}
+
+auto metaldb::HyperLogLog::Estimate(const Registers& registers) noexcept -> types::IntegerType {
+    if (registers.empty()) {
+        return 0;
+    }
+
+    constexpr double numRegisters = NumRegisters;
+    const double alpha = 0.7213 / (1 + 1.079 / numRegisters);
+
+    double sum = 0;
+    std::size_t numZeros = 0;
+    for (const auto value : registers) {
+        sum += std::ldexp(1.0, -(int) value);
+        numZeros += value == 0;
+    }
+
+    auto estimate = alpha * numRegisters * numRegisters / sum;
+    if (estimate <= 2.5 * numRegisters && numZeros > 0) {
+        // Small cardinalities are estimated better by counting the empty registers.
+        estimate = numRegisters * std::log(numRegisters / numZeros);
+    }
+    return (types::IntegerType) std::llround(estimate);
+}
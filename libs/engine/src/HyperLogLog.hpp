@@ -0,0 +1,47 @@
+#pragma once
+
+#include "constants.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace metaldb {
+    /**
+     * Estimates the number of distinct values with a HyperLogLog sketch, whose size is fixed no matter how many values are added.
+     *
+     * The registers are kept one per byte in a @b std::string , so they can live in the state of a @b HashAggregate .  They are
+     * serialized with 6 bits per register, so a sketch fits in a single String column.  Sketches are merged by taking the maximum
+     * of each register, so sketches of each chunk can be built independently.  The standard error is about `1.04 / sqrt(NumRegisters)`.
+     */
+    class HyperLogLog final {
+    public:
+        using Registers = std::string;
+
+        static constexpr std::uint32_t PrecisionBits = 8;
+        static constexpr std::size_t NumRegisters = 1 << PrecisionBits;
+        static constexpr std::uint32_t RegisterBits = 6;
+
+        /**
+         * The size of a serialized sketch, which must fit in a String column.
+         */
+        static constexpr std::size_t NumSerializedBytes = (NumRegisters * RegisterBits) / 8;
+
+        /**
+         * Adds the value with the bytes `[data, data + size)`.
+         */
+        static void Add(Registers& registers, const char* data, std::size_t size) noexcept;
+
+        /**
+         * Merges a sketch written by @b Serialize into @b registers .  An empty sketch has no values.
+         */
+        static void Merge(Registers& registers, const char* data, std::size_t size) noexcept;
+
+        /**
+         * Writes the registers into @b output , which is left empty if no values were added.
+         */
+        static void Serialize(const Registers& registers, std::string& output) noexcept;
+
+        static types::IntegerType Estimate(const Registers& registers) noexcept;
+    };
+}
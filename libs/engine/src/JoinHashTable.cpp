@@ -0,0 +1,88 @@
+#include "JoinHashTable.hpp"
+
+#include <algorithm>
+
+namespace {
+    // Finalizer from MurmurHash3, spreads every input bit across the output.
+    std::uint64_t Mix(std::uint64_t value) noexcept {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
+    }
+
+    std::size_t NextPowerOfTwo(std::size_t value) noexcept {
+        std::size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+metaldb::JoinHashTable::JoinHashTable(std::size_t expectedNumEntries) noexcept {
+    this->resize(NextPowerOfTwo(std::max<std::size_t>(expectedNumEntries * MaxLoadFactorInverse, 16)));
+}
+
+auto metaldb::JoinHashTable::Hash(const char* data, std::size_t size) noexcept -> HashType {
+    constexpr std::uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+
+    // Consume the key 8 bytes at a time.
+    HashType hash = multiplier ^ size;
+    for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t), data += sizeof(std::uint64_t)) {
+        std::uint64_t word = 0;
+        std::copy_n(data, sizeof(word), reinterpret_cast<char*>(&word));
+        hash = (hash ^ Mix(word)) * multiplier;
+    }
+
+    if (size > 0) {
+        std::uint64_t word = 0;
+        std::copy_n(data, size, reinterpret_cast<char*>(&word));
+        hash = (hash ^ Mix(word)) * multiplier;
+    }
+
+    return Mix(hash);
+}
+
+auto metaldb::JoinHashTable::NormalizeHash(HashType hash) noexcept -> HashType {
+    // Zero marks an empty slot.
+    return hash == EmptyHash ? 1 : hash;
+}
+
+void metaldb::JoinHashTable::insert(HashType hash, RowRefType partition, RowRefType row) noexcept {
+    if ((this->_size + 1) * MaxLoadFactorInverse > this->_entries.size()) {
+        this->resize(std::max<std::size_t>(this->_entries.size() * 2, 16));
+    }
+
+    hash = JoinHashTable::NormalizeHash(hash);
+    auto slot = hash & this->_mask;
+    while (this->_entries[slot].hash != EmptyHash) {
+        slot = (slot + 1) & this->_mask;
+    }
+
+    this->_entries[slot] = Entry{hash, partition, row};
+    this->_size++;
+}
+
+auto metaldb::JoinHashTable::size() const noexcept -> std::size_t {
+    return this->_size;
+}
+
+auto metaldb::JoinHashTable::capacity() const noexcept -> std::size_t {
+    return this->_entries.size();
+}
+
+void metaldb::JoinHashTable::resize(std::size_t numSlots) noexcept {
+    auto oldEntries = std::move(this->_entries);
+    this->_entries = std::vector<Entry>(numSlots);
+    this->_mask = numSlots - 1;
+    this->_size = 0;
+
+    for (const auto& entry : oldEntries) {
+        if (entry.hash != EmptyHash) {
+            this->insert(entry.hash, entry.partition, entry.row);
+        }
+    }
+}
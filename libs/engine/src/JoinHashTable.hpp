@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * An open-addressing (linear probing) multi-map from a hash of the join key to the row it came from.
+     *
+     * Entries are 16 bytes, so 4 fit in a cache line, and the table only stores the hash.  The caller is expected to compare the
+     * actual key bytes of any row returned by @b probe , which is rare for anything but a true match.
+     */
+    class JoinHashTable final {
+    public:
+        using HashType = std::uint64_t;
+        using RowRefType = std::uint32_t;
+
+        struct Entry final {
+            HashType hash = EmptyHash;
+            RowRefType partition = 0;
+            RowRefType row = 0;
+        };
+        static_assert(sizeof(Entry) == 16, "Entries should stay 16 bytes to keep them aligned to a cache line.");
+
+        JoinHashTable() = default;
+
+        /**
+         * Creates a table that can hold @b expectedNumEntries without growing.
+         */
+        explicit JoinHashTable(std::size_t expectedNumEntries) noexcept;
+
+        ~JoinHashTable() noexcept = default;
+
+        /**
+         * Hashes a key.  The same bytes always produce the same hash, regardless of which side of a join they are from.
+         */
+        static HashType Hash(const char* data, std::size_t size) noexcept;
+
+        /**
+         * Inserts a row into the table.  Duplicate hashes are allowed.
+         */
+        void insert(HashType hash, RowRefType partition, RowRefType row) noexcept;
+
+        /**
+         * Calls @b callback with every entry that has the same hash.
+         */
+        template<typename Callback>
+        void probe(HashType hash, Callback&& callback) const noexcept {
+            if (this->_entries.empty()) {
+                return;
+            }
+
+            hash = JoinHashTable::NormalizeHash(hash);
+            for (auto slot = hash & this->_mask;; slot = (slot + 1) & this->_mask) {
+                const auto& entry = this->_entries[slot];
+                if (entry.hash == EmptyHash) {
+                    return;
+                }
+                if (entry.hash == hash) {
+                    callback(entry);
+                }
+            }
+        }
+
+        /**
+         * Returns the number of entries in the table.
+         */
+        std::size_t size() const noexcept;
+
+        /**
+         * Returns the number of slots in the table.
+         */
+        std::size_t capacity() const noexcept;
+
+    private:
+        static constexpr HashType EmptyHash = 0;
+
+        // Keep the table at most half full, so probe sequences stay short.
+        static constexpr std::size_t MaxLoadFactorInverse = 2;
+
+        std::vector<Entry> _entries;
+        std::size_t _mask = 0;
+        std::size_t _size = 0;
+
+        static HashType NormalizeHash(HashType hash) noexcept;
+
+        void resize(std::size_t numSlots) noexcept;
+    };
+}
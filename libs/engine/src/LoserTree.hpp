@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * A tournament tree for merging k sorted sources, which finds the next smallest value in `log(k)` comparisons.
+     *
+     * Each internal node keeps the loser of the match played there, and the overall winner is kept at the root.  When the
+     * winning source advances, only the matches on the path from its leaf to the root are replayed.
+     *
+     * @b Less is called with the indexes of two sources, and must order exhausted sources after every other source.
+     */
+    template<typename Less>
+    class LoserTree final {
+    public:
+        LoserTree(std::size_t numSources, Less less) : _numSources(numSources), _less(std::move(less)), _losers(std::max<std::size_t>(numSources, 1), 0) {
+            // Leaves are at [numSources, 2 * numSources), and the children of node n are 2n and 2n + 1.
+            std::vector<std::size_t> winners(2 * this->_numSources, 0);
+            for (std::size_t source = 0; source < this->_numSources; ++source) {
+                winners.at(this->_numSources + source) = source;
+            }
+
+            for (std::size_t node = this->_numSources - 1; node >= 1 && node < this->_numSources; --node) {
+                auto lhs = winners.at(2 * node);
+                auto rhs = winners.at((2 * node) + 1);
+                if (this->_less(rhs, lhs)) {
+                    std::swap(lhs, rhs);
+                }
+                winners.at(node) = lhs;
+                this->_losers.at(node) = rhs;
+            }
+
+            if (this->_numSources > 1) {
+                this->_losers.at(0) = winners.at(1);
+            }
+        }
+
+        /**
+         * Returns the source with the smallest value.  It may be exhausted, if every source is.
+         */
+        std::size_t top() const noexcept {
+            return this->_losers.at(0);
+        }
+
+        /**
+         * Replays the matches of the @b top source, after it has advanced to its next value.
+         */
+        void replay() noexcept {
+            auto winner = this->_losers.at(0);
+            for (auto node = (this->_numSources + winner) / 2; node >= 1; node /= 2) {
+                if (this->_less(this->_losers.at(node), winner)) {
+                    std::swap(this->_losers.at(node), winner);
+                }
+            }
+            this->_losers.at(0) = winner;
+        }
+
+    private:
+        std::size_t _numSources;
+        Less _less;
+
+        // The winner is at index 0.
+        std::vector<std::size_t> _losers;
+    };
+}
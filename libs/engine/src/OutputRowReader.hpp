@@ -4,6 +4,7 @@
 #include "output_row.h"
 
 #include <vector>
+#include <algorithm>
 #include <cassert>
 
 namespace metaldb {
@@ -43,22 +44,24 @@ namespace metaldb {
                 }
             }
             
+            std::size_t fixedRowSize = 0;
+            for (const auto& columnSize : this->_columnSizes) {
+                fixedRowSize += columnSize;
+            }
+            
             std::size_t i = this->_sizeOfHeader;
             while (i < this->_numBytes) {
                 this->_rowStartOffset.push_back(i);
                 
                 // Read the column sizes for the dynamic sized ones
-                auto columnSizes = this->_columnSizes;
-                for (const auto& varLengthCol : this->_variableLengthColumns) {
-                    columnSizes.at(varLengthCol) = ReadBytesStartingAt<OutputRow::ColumnSizeType>(&instructions.at(i));
+                auto rowSize = fixedRowSize;
+                for (std::size_t col = 0; col < this->_variableLengthColumns.size(); ++col) {
+                    rowSize += ReadBytesStartingAt<OutputRow::ColumnSizeType>(&instructions.at(i));
                     i += sizeof(OutputRow::ColumnSizeType);
                 }
                 
-                // Read the row
-                for (int col = 0; col < this->_numColumns; ++col) {
-                    auto columnSize = columnSizes.at(col);
-                    i += columnSize;
-                }
+                // Skip the row
+                i += rowSize;
             }
         }
         
@@ -69,11 +72,11 @@ namespace metaldb {
         }
         
         bool ColumnIsVariableLength(size_t column) const noexcept {
-            return this->_variableLengthColumns.find(column) != this->_variableLengthColumns.end();
+            return std::find(this->_variableLengthColumns.begin(), this->_variableLengthColumns.end(), column) != this->_variableLengthColumns.end();
         }
         
         OutputRow::ColumnSizeType SizeOfColumn(size_t column, size_t row) const noexcept {
-            return this->ColumnSizesForRow(row).at(column);
+            return this->ColumnIndexInfo(column, row).second;
         }
         
         ColumnType TypeOfColumn(size_t column) const noexcept {
@@ -85,13 +88,37 @@ namespace metaldb {
         }
         
         OutputRow::NumBytesType StartOfColumn(size_t column, size_t row) const noexcept {
-            const auto columnSizes = this->ColumnSizesForRow(row);
-            return this->StartOfColumn(column, row, columnSizes);
+            return this->ColumnIndexInfo(column, row).first;
         }
         
+        /**
+         * Returns the offset of a column in a row, along with the size of the column.  The sizes are read in place, so this
+         * doesn't allocate, and can be called for every column of every row.
+         */
         std::pair<OutputRow::NumBytesType, OutputRow::ColumnSizeType> ColumnIndexInfo(size_t column, size_t row) const noexcept {
-            auto columnSizes = this->ColumnSizesForRow(row);
-            return std::make_pair(this->StartOfColumn(column, row, columnSizes), columnSizes.at(column));
+            auto sizeOffset = this->_rowStartOffset.at(row);
+            OutputRow::NumBytesType offset = sizeOffset + (this->_variableLengthColumns.size() * sizeof(OutputRow::ColumnSizeType));
+            for (size_t i = 0;; ++i) {
+                auto columnSize = this->_columnSizes.at(i);
+                if (metaldb::ColumnVariableSize(this->_columnTypes.at(i))) {
+                    // The sizes of the variable length columns start the row, in the order of the columns.
+                    columnSize = ReadBytesStartingAt<OutputRow::ColumnSizeType>(&this->_instructions.at(sizeOffset));
+                    sizeOffset += sizeof(OutputRow::ColumnSizeType);
+                }
+                if (i == column) {
+                    return std::make_pair(offset, columnSize);
+                }
+                offset += columnSize;
+            }
+        }
+        
+        /**
+         * Returns a pointer to the first byte of a column in a row, along with the size of the column.
+         * Null columns have a size of 0.
+         */
+        std::pair<const value_type*, OutputRow::ColumnSizeType> ColumnData(size_t column, size_t row) const noexcept {
+            auto [columnStart, columnSize] = this->ColumnIndexInfo(column, row);
+            return std::make_pair(this->_instructions.data() + columnStart, columnSize);
         }
         
         OutputRow::SizeOfHeaderType SizeOfHeader() const noexcept {
@@ -136,30 +163,5 @@ namespace metaldb {
         std::vector<ColumnType> _columnTypes;
         std::vector<OutputRow::ColumnSizeType> _variableLengthColumns;
         std::vector<OutputRow::NumBytesType> _rowStartOffset;
-        
-        OutputRow::NumBytesType StartOfColumn(OutputRow::NumColumnsType column, OutputRow::NumRowsType row, const std::vector<OutputRow::ColumnSizeType>& columnSizes) const noexcept {
-            auto offset = this->_rowStartOffset.at(row);
-            
-            // Skip the variableLength sizes.
-            offset += this->_variableLengthColumns.size();
-            
-            // Jump N columns.
-            for (auto i = 0; i < column; ++i) {
-                offset += columnSizes.at(i);
-            }
-            return offset;
-        }
-        
-        std::vector<OutputRow::ColumnSizeType> ColumnSizesForRow(OutputRow::NumRowsType row) const noexcept {
-            auto rowStart = this->_rowStartOffset.at(row);
-            
-            auto columnSizes = this->_columnSizes;
-            for (const auto& varLengthCol : this->_variableLengthColumns) {
-                columnSizes.at(varLengthCol) = ReadBytesStartingAt<OutputRow::ColumnSizeType>(&this->_instructions.at(rowStart));
-                rowStart += sizeof(OutputRow::ColumnSizeType);
-            }
-            
-            return columnSizes;
-        }
     };
 }
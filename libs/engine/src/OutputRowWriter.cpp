@@ -45,6 +45,28 @@ void metaldb::OutputRowWriter::appendTempRow(const metaldb::TempRow& row) noexce
     this->_numRows++;
 }
 
+void metaldb::OutputRowWriter::appendRow(const std::vector<ColumnValue>& columns) noexcept {
+    assert(this->_hasCopiedHeader);
+    assert(columns.size() == this->NumColumns());
+
+    // Copy the variable row sizes and the data
+    for (std::size_t col = 0; col < columns.size(); ++col) {
+        if (metaldb::ColumnVariableSize(this->_columnTypes.at(col))) {
+            // Write the size of it.
+            this->appendToData(columns.at(col).size);
+        } else {
+            assert(columns.at(col).size == metaldb::BaseColumnSize(this->_columnTypes.at(col)));
+        }
+    }
+    for (const auto& column : columns) {
+        // Write the bytes to it.
+        for (std::size_t i = 0; i < column.size; ++i) {
+            this->appendToData(column.data[i]);
+        }
+    }
+    this->_numRows++;
+}
+
 auto metaldb::OutputRowWriter::SizeOfHeader() const noexcept -> OutputRow::SizeOfHeaderType {
     return OutputRow::SizeOfHeader(this->NumColumns());
 }
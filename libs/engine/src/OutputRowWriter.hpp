@@ -14,6 +14,14 @@ namespace metaldb {
         public:
             std::vector<ColumnType> columnTypes;
         };
+
+        /**
+         * A pointer to the bytes of a single column and its size.  A column with no data is null.
+         */
+        struct ColumnValue {
+            const char* data = nullptr;
+            OutputRow::ColumnSizeType size = 0;
+        };
         
         OutputRowWriter() = default;
         OutputRowWriter(const OutputRowBuilder& builder);
@@ -25,6 +33,12 @@ namespace metaldb {
         size_t size() const noexcept;
         
         void appendTempRow(const metaldb::TempRow& row) noexcept;
+
+        /**
+         * Appends a row assembled from individual column values.  The writer must be created from an @b OutputRowBuilder ,
+         * and there must be one value for each column.  Null values are only valid for nullable column types.
+         */
+        void appendRow(const std::vector<ColumnValue>& columns) noexcept;
         
         template<typename Container>
         void copyRow(const OutputRowReader<Container>& reader, std::size_t row) noexcept {
@@ -0,0 +1,73 @@
+#include "ParallelRadixSort.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+    template<typename Fn>
+    void ForEachBlock(std::size_t numBlocks, const Fn& fn) noexcept {
+        if (numBlocks == 1) {
+            fn(0);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(numBlocks);
+        for (std::size_t block = 0; block < numBlocks; ++block) {
+            threads.emplace_back(fn, block);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+void metaldb::ParallelRadixSort::Sort(std::vector<RadixSortItem>& items, std::uint32_t numKeyBytes, std::size_t maxNumThreads) noexcept {
+    using SizeType = RadixSort::SizeType;
+    if (items.size() < 2) {
+        return;
+    }
+
+    if (maxNumThreads == 0) {
+        maxNumThreads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    const auto numItems = (SizeType) items.size();
+    const auto numBlocks = (SizeType) std::clamp<std::size_t>(items.size() / MinBlockNumItems, 1, maxNumThreads);
+    const SizeType blockNumItems = (numItems + numBlocks - 1) / numBlocks;
+
+    std::vector<RadixSortItem> scratch(items.size());
+    std::vector<SizeType> counts(RadixSort::NumBuckets * numBlocks);
+    auto* input = &items;
+    auto* output = &scratch;
+
+    for (std::uint32_t pass = 0; pass < RadixSort::NumPasses(numKeyBytes); ++pass) {
+        ForEachBlock(numBlocks, [&](std::size_t block) {
+            const auto begin = std::min(numItems, (SizeType) block * blockNumItems);
+            const auto end = std::min(numItems, begin + blockNumItems);
+            RadixSort::Histogram(input->data(), begin, end, pass, (SizeType) block, numBlocks, counts.data());
+        });
+
+        // Every item has the same digit, so this pass wouldn't move anything.
+        const auto digit = RadixSort::Digit(input->front().key, pass);
+        SizeType numWithDigit = 0;
+        for (SizeType block = 0; block < numBlocks; ++block) {
+            numWithDigit += counts.at(RadixSort::CountIndex(digit, block, numBlocks));
+        }
+        if (numWithDigit == numItems) {
+            continue;
+        }
+
+        ExclusivePrefixSum(counts.data(), (std::uint32_t) counts.size());
+
+        ForEachBlock(numBlocks, [&](std::size_t block) {
+            const auto begin = std::min(numItems, (SizeType) block * blockNumItems);
+            const auto end = std::min(numItems, begin + blockNumItems);
+            RadixSort::Scatter(input->data(), begin, end, pass, (SizeType) block, numBlocks, counts.data(), output->data());
+        });
+        std::swap(input, output);
+    }
+
+    if (input != &items) {
+        items.swap(scratch);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "radix_sort.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Runs the passes of a @b RadixSort on the CPU, with each block of items handled by its own thread.
+     */
+    class ParallelRadixSort final {
+    public:
+        /**
+         * Blocks are at least this many items, so small sorts don't pay for starting threads.
+         */
+        static constexpr std::size_t MinBlockNumItems = 16 * 1024;
+
+        /**
+         * Sorts @b items by their key.  Items with equal keys keep their order.
+         * @param numKeyBytes Only the lowest bytes of each key are sorted by, one pass per byte.
+         * @param maxNumThreads The maximum number of threads to use, or 0 to use every core.
+         */
+        static void Sort(std::vector<RadixSortItem>& items, std::uint32_t numKeyBytes = sizeof(std::uint64_t), std::size_t maxNumThreads = 0) noexcept;
+    };
+}
@@ -0,0 +1,43 @@
+#include "RadixPartitioner.hpp"
+#include "OutputRowReader.hpp"
+
+#include <cassert>
+
+metaldb::RadixPartitioner::RadixPartitioner(std::vector<ColumnType> columnTypes, ColumnIndexType keyColumn, std::uint8_t numPartitionBits, std::uint8_t startBit) noexcept : _columnTypes(std::move(columnTypes)), _keyColumn(keyColumn), _numPartitionBits(numPartitionBits), _startBit(startBit) {
+    assert(numPartitionBits + startBit <= sizeof(JoinHashTable::HashType) * 8);
+}
+
+auto metaldb::RadixPartitioner::NumPartitions() const noexcept -> std::size_t {
+    return 1UL << this->_numPartitionBits;
+}
+
+auto metaldb::RadixPartitioner::PartitionOf(JoinHashTable::HashType hash) const noexcept -> std::size_t {
+    if (this->_numPartitionBits == 0) {
+        return 0;
+    }
+    return (hash << this->_startBit) >> (sizeof(hash) * 8 - this->_numPartitionBits);
+}
+
+auto metaldb::RadixPartitioner::partition(const BufferType& buffer) const noexcept -> std::vector<BufferPtr> {
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = this->_columnTypes;
+    std::vector<OutputRowWriter> writers(this->NumPartitions(), OutputRowWriter(builder));
+
+    if (!buffer.empty()) {
+        auto reader = OutputRowReader(buffer);
+        for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+            auto [keyData, keySize] = reader.ColumnData(this->_keyColumn, row);
+            const auto partition = keySize == 0 ? 0 : this->PartitionOf(JoinHashTable::Hash(keyData, keySize));
+            writers.at(partition).copyRow(reader, row);
+        }
+    }
+
+    std::vector<BufferPtr> partitions;
+    partitions.reserve(writers.size());
+    for (const auto& writer : writers) {
+        auto partitionBuffer = std::make_shared<BufferType>();
+        writer.write(*partitionBuffer);
+        partitions.push_back(std::move(partitionBuffer));
+    }
+    return partitions;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "JoinHashTable.hpp"
+#include "OutputRowWriter.hpp"
+
+#include "column_type.h"
+
+#include <memory>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Splits the rows of @b OutputRow buffers into partitions by the top bits of the hash of a key column.
+     *
+     * Rows with equal keys always land in the same partition, so both sides of a join can be partitioned the same way and each
+     * pair of partitions joined independently.  The top bits are used so the bottom bits are still spread out within a partition's
+     * @b JoinHashTable .
+     */
+    class RadixPartitioner final {
+    public:
+        using BufferType = std::vector<char>;
+        using BufferPtr = std::shared_ptr<BufferType>;
+        using ColumnIndexType = OutputRow::NumColumnsType;
+
+        /**
+         * @param startBit The number of top bits of the hash to skip.  Repartitioning a partition must skip the bits that were already used.
+         */
+        RadixPartitioner(std::vector<ColumnType> columnTypes, ColumnIndexType keyColumn, std::uint8_t numPartitionBits, std::uint8_t startBit = 0) noexcept;
+
+        ~RadixPartitioner() noexcept = default;
+
+        /**
+         * Returns the number of partitions, `2^numPartitionBits`.
+         */
+        std::size_t NumPartitions() const noexcept;
+
+        /**
+         * Returns the partition a hash belongs to.
+         */
+        std::size_t PartitionOf(JoinHashTable::HashType hash) const noexcept;
+
+        /**
+         * Splits a buffer into one @b OutputRow buffer per partition.
+         * Rows with a null key are kept in the first partition.
+         */
+        std::vector<BufferPtr> partition(const BufferType& buffer) const noexcept;
+
+    private:
+        std::vector<ColumnType> _columnTypes;
+        ColumnIndexType _keyColumn;
+        std::uint8_t _numPartitionBits;
+        std::uint8_t _startBit;
+    };
+}
@@ -0,0 +1,141 @@
+#include "RowFilter.hpp"
+
+#include "temp_row.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+
+namespace {
+    template<typename T>
+    bool Compare(metaldb::QueryEngine::Predicate::Operation operation, const T& lhs, const T& rhs) noexcept {
+        using Predicate = metaldb::QueryEngine::Predicate;
+        switch (operation) {
+        case Predicate::EQ:
+            return lhs == rhs;
+        case Predicate::LT:
+            return lhs < rhs;
+        case Predicate::LTE:
+            return lhs <= rhs;
+        case Predicate::GT:
+            return lhs > rhs;
+        case Predicate::GTE:
+            return lhs >= rhs;
+        case Predicate::AND:
+        case Predicate::OR:
+            break;
+        }
+        return false;
+    }
+}
+
+metaldb::RowFilter::RowFilter(Predicate predicate) noexcept : _predicate(std::move(predicate)) {}
+
+auto metaldb::RowFilter::Matches(const Predicate& predicate, const OutputRowReader<BufferType>& reader, std::size_t row) noexcept -> bool {
+    switch (predicate.operation) {
+    case Predicate::AND:
+        return std::all_of(predicate.children.begin(), predicate.children.end(), [&](const auto& child) {
+            return RowFilter::Matches(child, reader, row);
+        });
+    case Predicate::OR:
+        return std::any_of(predicate.children.begin(), predicate.children.end(), [&](const auto& child) {
+            return RowFilter::Matches(child, reader, row);
+        });
+    case Predicate::EQ:
+    case Predicate::LT:
+    case Predicate::LTE:
+    case Predicate::GT:
+    case Predicate::GTE:
+        break;
+    }
+
+    if (predicate.column >= reader.NumColumns()) {
+        return false;
+    }
+
+    const auto type = reader.TypeOfColumn(predicate.column);
+    auto [data, size] = reader.ColumnData(predicate.column, row);
+    if (size == 0 && (type == String_opt || type == Integer_opt || type == Float_opt)) {
+        return false;
+    }
+
+    switch (type) {
+    case Integer:
+    case Integer_opt: {
+        const auto value = ReadBytesStartingAt<types::IntegerType>(data);
+        if (auto constant = std::get_if<std::int64_t>(&predicate.value)) {
+            return Compare<std::int64_t>(predicate.operation, value, *constant);
+        } else if (auto constant = std::get_if<double>(&predicate.value)) {
+            return Compare<double>(predicate.operation, value, *constant);
+        }
+        return false;
+    }
+    case Float:
+    case Float_opt: {
+        const auto value = ReadBytesStartingAt<types::FloatType>(data);
+        if (auto constant = std::get_if<std::int64_t>(&predicate.value)) {
+            return Compare<double>(predicate.operation, value, (double) *constant);
+        } else if (auto constant = std::get_if<double>(&predicate.value)) {
+            return Compare<double>(predicate.operation, value, *constant);
+        }
+        return false;
+    }
+    case String:
+    case String_opt:
+        if (auto constant = std::get_if<std::string>(&predicate.value)) {
+            return Compare<std::string_view>(predicate.operation, std::string_view(data, size), *constant);
+        }
+        return false;
+    case Unknown:
+        break;
+    }
+    return false;
+}
+
+auto metaldb::RowFilter::matches(const OutputRowReader<BufferType>& reader, std::size_t row) const noexcept -> bool {
+    return RowFilter::Matches(this->_predicate, reader, row);
+}
+
+auto metaldb::RowFilter::sample(const BufferType& buffer, std::size_t startRow, std::size_t endRow) const noexcept -> std::vector<QueryEngine::ConjunctStatistics> {
+    if (this->_predicate.operation != Predicate::AND || buffer.empty()) {
+        return {};
+    }
+
+    auto reader = OutputRowReader(buffer);
+    endRow = std::min<std::size_t>(endRow, reader.NumRows());
+
+    // Each conjunct is timed over every row on its own, since timing a single row costs more than evaluating it.
+    std::vector<QueryEngine::ConjunctStatistics> statistics;
+    for (const auto& conjunct : this->_predicate.children) {
+        QueryEngine::ConjunctStatistics conjunctStatistics;
+        const auto start = std::chrono::steady_clock::now();
+        for (auto row = startRow; row < endRow; ++row) {
+            conjunctStatistics.numPassed += RowFilter::Matches(conjunct, reader, row);
+        }
+        conjunctStatistics.nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        conjunctStatistics.numRows = endRow > startRow ? endRow - startRow : 0;
+        statistics.push_back(conjunctStatistics);
+    }
+    return statistics;
+}
+
+void metaldb::RowFilter::reorder(const std::vector<QueryEngine::ConjunctStatistics>& statistics) noexcept {
+    if (this->_predicate.operation != Predicate::AND || statistics.size() != this->_predicate.children.size()) {
+        return;
+    }
+    this->_predicate.reorder(QueryEngine::ConjunctStatistics::Order(statistics));
+}
+
+void metaldb::RowFilter::filter(const BufferType& buffer, OutputRowWriter& writer, std::size_t startRow, std::size_t endRow) const noexcept {
+    if (buffer.empty()) {
+        return;
+    }
+
+    auto reader = OutputRowReader(buffer);
+    endRow = std::min<std::size_t>(endRow, reader.NumRows());
+    for (auto row = startRow; row < endRow; ++row) {
+        if (this->matches(reader, row)) {
+            writer.copyRow(reader, row);
+        }
+    }
+}
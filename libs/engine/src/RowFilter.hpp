@@ -0,0 +1,60 @@
+#pragma once
+
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include <metaldb/query_engine/predicate.hpp>
+
+#include <limits>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Copies the rows of a buffer that match a @b Predicate .  A comparison with a null value never matches.
+     *
+     * Integer columns are compared exactly with integer constants, and every other number is compared as a double.  Strings
+     * are compared byte by byte, like their zone maps.
+     */
+    class RowFilter final {
+    public:
+        using BufferType = std::vector<char>;
+        using Predicate = QueryEngine::Predicate;
+
+        /**
+         * The number of rows filtered by each call to @b filter when chunking a buffer.
+         */
+        static constexpr std::size_t ChunkNumRows = 64 * 1024;
+
+        /**
+         * The number of rows each conjunct is sampled on before the conjuncts are ordered.
+         */
+        static constexpr std::size_t SampleNumRows = 4 * 1024;
+
+        RowFilter(Predicate predicate) noexcept;
+
+        /**
+         * Evaluates each conjunct of an AND on its own over the rows in `[startRow, endRow)` of a buffer, and returns how many
+         * of them passed and how long it took.  There is a @b ConjunctStatistics for each conjunct, or none if the predicate
+         * isn't an AND.
+         */
+        std::vector<QueryEngine::ConjunctStatistics> sample(const BufferType& buffer, std::size_t startRow = 0, std::size_t endRow = SampleNumRows) const noexcept;
+
+        /**
+         * Orders the conjuncts of an AND from their @b sample , so a row is dropped after as little work as possible.  Not
+         * thread safe, so the rows must be filtered after it returns.
+         */
+        void reorder(const std::vector<QueryEngine::ConjunctStatistics>& statistics) noexcept;
+
+        bool matches(const OutputRowReader<BufferType>& reader, std::size_t row) const noexcept;
+
+        /**
+         * Copies the rows in `[startRow, endRow)` of a buffer that match into a writer.
+         */
+        void filter(const BufferType& buffer, OutputRowWriter& writer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) const noexcept;
+
+    private:
+        Predicate _predicate;
+
+        static bool Matches(const Predicate& predicate, const OutputRowReader<BufferType>& reader, std::size_t row) noexcept;
+    };
+}
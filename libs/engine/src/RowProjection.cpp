@@ -0,0 +1,24 @@
+#include "RowProjection.hpp"
+
+#include <algorithm>
+
+metaldb::RowProjection::RowProjection(std::vector<ColumnIndexType> columnIndexes) noexcept : _columnIndexes(std::move(columnIndexes)) {}
+
+void metaldb::RowProjection::project(const BufferType& buffer, OutputRowWriter& writer, std::size_t startRow, std::size_t endRow) const noexcept {
+    if (buffer.empty()) {
+        return;
+    }
+
+    auto reader = OutputRowReader(buffer);
+    endRow = std::min<std::size_t>(endRow, reader.NumRows());
+
+    // The values of every row are gathered into the same vector.
+    std::vector<OutputRowWriter::ColumnValue> columns(this->_columnIndexes.size());
+    for (auto row = startRow; row < endRow; ++row) {
+        for (std::size_t i = 0; i < this->_columnIndexes.size(); ++i) {
+            auto [data, size] = reader.ColumnData(this->_columnIndexes.at(i), row);
+            columns.at(i) = {data, size};
+        }
+        writer.appendRow(columns);
+    }
+}
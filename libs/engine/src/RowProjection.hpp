@@ -0,0 +1,37 @@
+#pragma once
+
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include <metaldb/query_engine/partials.hpp>
+
+#include <limits>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Copies some of the columns of each row of a buffer, in any order.  This is the PROJECTION instruction on the CPU, for rows
+     * that were already parsed by another partial, such as a join or an aggregate.
+     */
+    class RowProjection final {
+    public:
+        using BufferType = std::vector<char>;
+        using ColumnIndexType = QueryEngine::ProjectionPartial::ColumnIndexType;
+
+        /**
+         * The number of rows projected by each call to @b project when chunking a buffer.
+         */
+        static constexpr std::size_t ChunkNumRows = 64 * 1024;
+
+        RowProjection(std::vector<ColumnIndexType> columnIndexes) noexcept;
+
+        /**
+         * Appends the projected columns of the rows in `[startRow, endRow)` of a buffer to a writer, which must be created with
+         * the types of the projected columns.
+         */
+        void project(const BufferType& buffer, OutputRowWriter& writer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) const noexcept;
+
+    private:
+        std::vector<ColumnIndexType> _columnIndexes;
+    };
+}
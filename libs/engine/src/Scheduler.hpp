@@ -8,6 +8,13 @@
 #include <taskflow/taskflow.hpp>
 
 #include "MetalManager.hpp"
+#include "HashJoin.hpp"
+
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace metaldb {
     class Scheduler final {
@@ -28,7 +35,56 @@ namespace metaldb {
     public:
         // Helper function.
         // Takes in a rawTable, and splits it into a list of pairs with `MaxNumRows` serialized rows, and the number of rows in the chunk.
-        static std::vector<std::pair<IntermediateBufferTypePtr, std::size_t>> SerializeRawTable(const metaldb::reader::RawTable& rawTable, std::size_t maxNumRows) noexcept;
+        // Only the rows in `rowRanges` are serialized, if there are any.  `rowSuffix` is appended to every row, such as the
+        // values of partition columns that aren't in the file.
+        static std::vector<std::pair<IntermediateBufferTypePtr, std::size_t>> SerializeRawTable(const metaldb::reader::RawTable& rawTable, std::size_t maxNumRows, const std::optional<std::vector<std::pair<std::size_t, std::size_t>>>& rowRanges = std::nullopt, const std::string& rowSuffix = "") noexcept;
+
+        // Helper function.
+        // Returns the type of each column in a table definition, as they are written in an `OutputRow`.
+        static std::vector<ColumnType> ColumnTypes(const QueryEngine::TableDefinition& definition) noexcept;
+
+        // Helper function.
+        // Copies the rows the GPU wrote to an output buffer into an `OutputRow` buffer of their own.
+        static IntermediateBufferType CopyOutputBuffer(const MetalManager::OutputBufferType& buffer) noexcept;
+
+        // Where the output of a stage goes a chunk at a time, instead of being merged into its output buffer.  A parent that
+        // takes chunks as they're made, like a grace join spilling them to disk, sets `consume` before the stage runs.  Chunks
+        // may be consumed concurrently.  Stages that don't make their output in chunks still merge it into their buffer.
+        struct OutputChunks final {
+            std::function<void(const IntermediateBufferType&)> consume;
+
+            // Set when more than one stage reads the buffer, so no parent can release it once it's done with it.
+            bool shared = false;
+        };
+        using OutputChunksPtr = std::shared_ptr<OutputChunks>;
+
+        // A hash table that is built by whichever join runs first, then shared read-only.
+        struct SharedHashJoin final {
+            std::once_flag built;
+            std::shared_ptr<HashJoin> hashJoin;
+        };
+
+        // State shared while registering every stage of a plan.
+        struct Context final {
+            // Stages that are a child of more than one stage are only run once.
+            std::unordered_map<const QueryEngine::Stage*, std::pair<tf::Task, IntermediateBufferTypePtr>> registeredStages;
+
+            // Broadcast hash tables, keyed by the first buffer of their build side.
+            std::unordered_map<const IntermediateBufferType*, std::shared_ptr<SharedHashJoin>> broadcastJoins;
+
+            // Where the chunks of each stage go, keyed by the stage's output buffer.
+            std::unordered_map<const IntermediateBufferType*, OutputChunksPtr> outputChunks;
+
+            // The output buffers of stages with more than one parent, which every parent reads whole.
+            std::unordered_set<const IntermediateBufferType*> sharedBuffers;
+        };
+
+        // Returns where the stage writing to `buffer` sends its chunks.  The stage checks it once it runs.
+        static OutputChunksPtr OutputChunksFor(const IntermediateBufferTypePtr& buffer, Context& context) noexcept;
+
+        // Sends the chunks of the stage writing to `buffer` to `consume`, unless another stage reads the buffer too.  Either way,
+        // whatever the stage still merges into its buffer has to be consumed from there.
+        static void ConsumeOutputChunks(const IntermediateBufferTypePtr& buffer, Context& context, std::function<void(const IntermediateBufferType&)> consume) noexcept;
 
         struct Parameters final {
             tf::Taskflow* _Nonnull taskflow;
@@ -38,15 +94,16 @@ namespace metaldb {
             std::shared_ptr<std::vector<char>> serializedData;
             const std::vector<IntermediateBufferTypePtr>& childOutputBuffers;
             IntermediateBufferTypePtr outputBuffer;
+            Context& context;
 
-            Parameters(tf::Taskflow* _Nonnull taskflow_, std::shared_ptr<engine::Encoder> encoder_, tf::Task* _Nonnull doWorkTask_, std::shared_ptr<MetalManager> manager_, std::shared_ptr<std::vector<char>> serializedData_, const std::vector<IntermediateBufferTypePtr>& childOutputBuffers_, IntermediateBufferTypePtr outputBuffer_) : taskflow(taskflow_), encoder(encoder_), doWorkTask(doWorkTask_), manager(manager_), serializedData(serializedData_), childOutputBuffers(childOutputBuffers_), outputBuffer(outputBuffer_) {}
+            Parameters(tf::Taskflow* _Nonnull taskflow_, std::shared_ptr<engine::Encoder> encoder_, tf::Task* _Nonnull doWorkTask_, std::shared_ptr<MetalManager> manager_, std::shared_ptr<std::vector<char>> serializedData_, const std::vector<IntermediateBufferTypePtr>& childOutputBuffers_, IntermediateBufferTypePtr outputBuffer_, Context& context_) : taskflow(taskflow_), encoder(encoder_), doWorkTask(doWorkTask_), manager(manager_), serializedData(serializedData_), childOutputBuffers(childOutputBuffers_), outputBuffer(outputBuffer_), context(context_) {}
 
             ~Parameters() noexcept = default;
         };
 
-        static tf::Task registerStage(tf::Task& taskDoWork, const std::shared_ptr<QueryEngine::Stage>& stage, tf::Taskflow* _Nonnull taskflow, std::shared_ptr<MetalManager> manager, IntermediateBufferTypePtr outputBuffer) noexcept;
+        static tf::Task registerStage(tf::Task& taskDoWork, const std::shared_ptr<QueryEngine::Stage>& stage, tf::Taskflow* _Nonnull taskflow, std::shared_ptr<MetalManager> manager, IntermediateBufferTypePtr outputBuffer, Context& context) noexcept;
 
-        static void registerBaseStage(tf::Task& taskDoWork, const std::shared_ptr<QueryEngine::Stage>& stage, tf::Taskflow* _Nonnull taskflow, std::shared_ptr<MetalManager> manager, std::vector<IntermediateBufferTypePtr>&& childOutputBuffers, IntermediateBufferTypePtr outputBuffer) noexcept;
+        static void registerBaseStage(tf::Task& taskDoWork, const std::shared_ptr<QueryEngine::Stage>& stage, tf::Taskflow* _Nonnull taskflow, std::shared_ptr<MetalManager> manager, std::vector<IntermediateBufferTypePtr>&& childOutputBuffers, IntermediateBufferTypePtr outputBuffer, Context& context) noexcept;
 
         static tf::Task registerBasePartial(const std::shared_ptr<QueryEngine::StagePartial>& partial, Parameters& parameters) noexcept;
 
@@ -56,6 +113,18 @@ namespace metaldb {
 
         static tf::Task registerShufflePartial(std::shared_ptr<QueryEngine::ShuffleOutputPartial> output, Parameters& parameters) noexcept;
 
+        static tf::Task registerJoinPartial(std::shared_ptr<QueryEngine::JoinPartial> join, Parameters& parameters) noexcept;
+
+        static tf::Task registerAggregatePartial(std::shared_ptr<QueryEngine::AggregatePartial> aggregate, Parameters& parameters) noexcept;
+
+        static tf::Task registerSortPartial(std::shared_ptr<QueryEngine::SortPartial> sort, Parameters& parameters) noexcept;
+
+        static tf::Task registerSetOperationPartial(std::shared_ptr<QueryEngine::SetOperationPartial> setOperation, Parameters& parameters) noexcept;
+
+        static tf::Task registerFilterPartial(std::shared_ptr<QueryEngine::FilterPartial> filter, Parameters& parameters) noexcept;
+
+        static tf::Task registerWindowPartial(std::shared_ptr<QueryEngine::WindowPartial> window, Parameters& parameters) noexcept;
+
         static tf::Task registerWritePartial(std::shared_ptr<QueryEngine::WritePartial> write, Parameters& parameters) noexcept;
     };
 }
@@ -1,13 +1,25 @@
 #include "Scheduler.hpp"
 #include "OutputRowReader.hpp"
 #include "OutputRowWriter.hpp"
+#include "ExternalSort.hpp"
+#include "GraceHashJoin.hpp"
+#include "HashAggregate.hpp"
+#include "HashJoin.hpp"
+#include "HashSetOperation.hpp"
+#include "RadixPartitioner.hpp"
+#include "RowFilter.hpp"
+#include "RowProjection.hpp"
+#include "SortMergeJoin.hpp"
+#include "StatisticsCollector.hpp"
+#include "TopN.hpp"
+#include "WindowEvaluator.hpp"
 
 #include <iostream>
 #include <filesystem>
 #include <algorithm>
 #include <cassert>
 
-auto metaldb::Scheduler::SerializeRawTable(const metaldb::reader::RawTable& rawTable, std::size_t maxChunkSize) noexcept -> std::vector<std::pair<IntermediateBufferTypePtr, std::size_t>> {
+auto metaldb::Scheduler::SerializeRawTable(const metaldb::reader::RawTable& rawTable, std::size_t maxChunkSize, const std::optional<std::vector<std::pair<std::size_t, std::size_t>>>& rowRanges, const std::string& rowSuffix) noexcept -> std::vector<std::pair<IntermediateBufferTypePtr, std::size_t>> {
     using SizeOfHeaderType = RawTable::SizeOfHeaderType;
     using SizeOfDataType = RawTable::SizeOfDataType;
     using NumRowsType = RawTable::NumRowsType;
@@ -16,7 +28,6 @@ auto metaldb::Scheduler::SerializeRawTable(const metaldb::reader::RawTable& rawT
     std::vector<std::pair<IntermediateBufferTypePtr, std::size_t>> output;
     auto rawDataSerialized = MakeBufferPtr();
 
-    std::size_t lastDataOffset = 0;
     auto prepareChunk = [&](NumRowsType startRow, NumRowsType endRow) {
         const auto numRowsLocal = endRow - startRow;
         if (numRowsLocal == 0 || endRow < startRow /* if overflowed */) {
@@ -56,9 +67,9 @@ auto metaldb::Scheduler::SerializeRawTable(const metaldb::reader::RawTable& rawT
         {
             assert(rawDataSerialized->size() == RawTable::RowIndexOffset);
             for (auto row = startRow; row < endRow; ++row) {
-                // Last data access stores the highest index on the last iteration, which we offset
-                // because those rows are not in this batch.
-                RowIndexType index = rawTable.rowIndexes.at(row) - lastDataOffset;
+                // Offset by the start of the first row, because the rows before it are not in this batch.
+                // Every row before this one in the batch also had the suffix appended.
+                RowIndexType index = rawTable.rowIndexes.at(row) - rawTable.rowIndexes.at(startRow) + ((row - startRow) * rowSuffix.size());
                 WriteBytesStartingAt(*rawDataSerialized, index);
             }
             sizeOfHeader += (sizeof(RowIndexType) * numRowsLocal);
@@ -74,7 +85,6 @@ auto metaldb::Scheduler::SerializeRawTable(const metaldb::reader::RawTable& rawT
                         rawDataSerialized->push_back(rawTable.data.at(i));
                     }
                     numBytes += (rawTable.data.size() - index);
-                    lastDataOffset = std::max(lastDataOffset, rawTable.data.size() - 1);
                 } else {
                     // Read until the next row
                     RowIndexType nextRow = rawTable.rowIndexes.at(row + 1);
@@ -82,8 +92,10 @@ auto metaldb::Scheduler::SerializeRawTable(const metaldb::reader::RawTable& rawT
                         rawDataSerialized->push_back(rawTable.data.at(i));
                     }
                     numBytes += (nextRow - index);
-                    lastDataOffset = std::max(lastDataOffset, nextRow - 0UL);
                 }
+
+                rawDataSerialized->insert(rawDataSerialized->end(), rowSuffix.begin(), rowSuffix.end());
+                numBytes += rowSuffix.size();
             }
         }
 
@@ -96,19 +108,34 @@ auto metaldb::Scheduler::SerializeRawTable(const metaldb::reader::RawTable& rawT
         rawDataSerialized = MakeBufferPtr();
     };
 
-    // Chunk it into the max size appropriately.
-    NumRowsType i = 0;
-    auto numRows = rawTable.NumRows();
-    if (numRows > maxChunkSize) {
-        for (; i < numRows - maxChunkSize; i += maxChunkSize) {
-            prepareChunk(i, i + maxChunkSize);
+    // Chunk each range into the max size appropriately.
+    const auto numRows = rawTable.NumRows();
+    const auto ranges = rowRanges.value_or(std::vector<std::pair<std::size_t, std::size_t>>{{0, numRows}});
+    for (auto [startRow, endRow] : ranges) {
+        endRow = std::min<std::size_t>(endRow, numRows);
+        for (auto i = startRow; i < endRow; i += maxChunkSize) {
+            prepareChunk(i, std::min(i + maxChunkSize, endRow));
         }
     }
-    prepareChunk(i, numRows);
 
     return output;
 }
 
+auto metaldb::Scheduler::ColumnTypes(const QueryEngine::TableDefinition& definition) noexcept -> std::vector<ColumnType> {
+    std::vector<ColumnType> columnTypes;
+    std::transform(definition.columns.begin(), definition.columns.end(), std::back_inserter(columnTypes), [](auto col) {
+        // The nullable type is always one more.
+        if (col.type == Unknown) {
+            return col.type;
+        } else if (col.nullable) {
+            return (metaldb::ColumnType) (col.type + 1);
+        } else {
+            return col.type;
+        }
+    });
+    return columnTypes;
+}
+
 auto metaldb::Scheduler::schedule(const QueryEngine::QueryPlan& plan) noexcept -> tf::Taskflow {
     tf::Taskflow taskflow;
     auto manager = MetalManager::Create();
@@ -118,10 +145,11 @@ auto metaldb::Scheduler::schedule(const QueryEngine::QueryPlan& plan) noexcept -
         return taskflow;
     }
 
+    Context context;
     for (const auto& stage : plan.stages) {
         auto placeholder = taskflow.emplace([]{}).name("Do Stage");
         auto buffer = MakeBufferPtr();
-        Scheduler::registerStage(placeholder, stage, &taskflow, manager, buffer);
+        Scheduler::registerStage(placeholder, stage, &taskflow, manager, buffer, context);
     }
 
     return taskflow;
@@ -131,32 +159,75 @@ auto metaldb::Scheduler::MakeBufferPtr() noexcept -> IntermediateBufferTypePtr {
     return std::make_shared<IntermediateBufferType>();
 }
 
+auto metaldb::Scheduler::CopyOutputBuffer(const MetalManager::OutputBufferType& buffer) noexcept -> IntermediateBufferType {
+    OutputRowWriter writer;
+    auto reader = OutputRowReader(buffer);
+    for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+        writer.copyRow(reader, i);
+    }
+
+    IntermediateBufferType chunk;
+    if (writer.CurrentNumRows() > 0) {
+        writer.write(chunk);
+    }
+    return chunk;
+}
+
+auto metaldb::Scheduler::OutputChunksFor(const IntermediateBufferTypePtr& buffer, Context& context) noexcept -> OutputChunksPtr {
+    auto& outputChunks = context.outputChunks[buffer.get()];
+    if (!outputChunks) {
+        outputChunks = std::make_shared<OutputChunks>();
+    }
+    return outputChunks;
+}
+
+void metaldb::Scheduler::ConsumeOutputChunks(const IntermediateBufferTypePtr& buffer, Context& context, std::function<void(const IntermediateBufferType&)> consume) noexcept {
+    if (context.sharedBuffers.count(buffer.get()) > 0) {
+        return;
+    }
+    Scheduler::OutputChunksFor(buffer, context)->consume = std::move(consume);
+}
+
 auto metaldb::Scheduler::MakeOutputBufferPtr() noexcept -> std::shared_ptr<MetalManager::OutputBufferType> {
     return std::make_shared<MetalManager::OutputBufferType>();
 }
 
-auto metaldb::Scheduler::registerStage(tf::Task& taskDoWork, const std::shared_ptr<QueryEngine::Stage>& stage, tf::Taskflow* _Nonnull taskflow, std::shared_ptr<MetalManager> manager, IntermediateBufferTypePtr outputBuffer) noexcept -> tf::Task {
+auto metaldb::Scheduler::registerStage(tf::Task& taskDoWork, const std::shared_ptr<QueryEngine::Stage>& stage, tf::Taskflow* _Nonnull taskflow, std::shared_ptr<MetalManager> manager, IntermediateBufferTypePtr outputBuffer, Context& context) noexcept -> tf::Task {
     // First register all children
     std::vector<IntermediateBufferTypePtr> childOutputBuffers;
     childOutputBuffers.reserve(stage->children.size() + 1);
     for (auto& child : stage->children) {
+        if (auto it = context.registeredStages.find(child.get()); it != context.registeredStages.end()) {
+            // Already registered by another parent, so share its output.  Every parent reads the whole buffer, so its chunks
+            // can't go to just one of them.
+            auto& [childDoWork, childBuffer] = it->second;
+            childDoWork.precede(taskDoWork);
+            childOutputBuffers.push_back(childBuffer);
+            context.sharedBuffers.insert(childBuffer.get());
+            auto childChunks = Scheduler::OutputChunksFor(childBuffer, context);
+            childChunks->consume = nullptr;
+            childChunks->shared = true;
+            continue;
+        }
+
         auto childBuffer = MakeBufferPtr();
         auto childDoWork = taskflow->placeholder();
-        Scheduler::registerStage(childDoWork, child, taskflow, manager, childBuffer);
+        Scheduler::registerStage(childDoWork, child, taskflow, manager, childBuffer, context);
         childDoWork.precede(taskDoWork);
         childOutputBuffers.push_back(childBuffer);
+        context.registeredStages.emplace(child.get(), std::make_pair(childDoWork, childBuffer));
     }
 
-    Scheduler::registerBaseStage(taskDoWork, stage, taskflow, manager, std::move(childOutputBuffers), outputBuffer);
+    Scheduler::registerBaseStage(taskDoWork, stage, taskflow, manager, std::move(childOutputBuffers), outputBuffer, context);
     return taskDoWork;
 }
 
-void metaldb::Scheduler::registerBaseStage(tf::Task& taskDoWork, const std::shared_ptr<QueryEngine::Stage>& stage, tf::Taskflow* _Nonnull taskflow, std::shared_ptr<MetalManager> manager, std::vector<IntermediateBufferTypePtr>&& childOutputBuffers, IntermediateBufferTypePtr outputBuffer) noexcept {
+void metaldb::Scheduler::registerBaseStage(tf::Task& taskDoWork, const std::shared_ptr<QueryEngine::Stage>& stage, tf::Taskflow* _Nonnull taskflow, std::shared_ptr<MetalManager> manager, std::vector<IntermediateBufferTypePtr>&& childOutputBuffers, IntermediateBufferTypePtr outputBuffer, Context& context) noexcept {
     // Create the substeps within the graph for this particular stage.
     auto encoder = std::make_shared<engine::Encoder>();
     auto serializedData = MakeBufferPtr();
     auto encodeWorkTask = [&]{
-        Parameters parameters{taskflow, encoder, &taskDoWork, manager, serializedData, childOutputBuffers, outputBuffer};
+        Parameters parameters{taskflow, encoder, &taskDoWork, manager, serializedData, childOutputBuffers, outputBuffer, context};
         return Scheduler::registerBasePartial(stage->partial, parameters);
     }();
 
@@ -167,6 +238,7 @@ void metaldb::Scheduler::registerBaseStage(tf::Task& taskDoWork, const std::shar
 
     childOutputBuffers.push_back(serializedData);
 
+    auto outputChunks = Scheduler::OutputChunksFor(outputBuffer, context);
     auto maxNumRows = manager->MaxNumRows();
     taskDoWork.work([=](tf::Subflow& subflow) {
         // Doing GPU work.
@@ -192,6 +264,9 @@ void metaldb::Scheduler::registerBaseStage(tf::Task& taskDoWork, const std::shar
             auto subtaskNewBuffer = MakeOutputBufferPtr();
             subflow.emplace([=]() {
                 manager->run(*localCurrentInputBuffer, encoder->data(), *subtaskNewBuffer, numRows);
+                if (outputChunks->consume) {
+                    outputChunks->consume(Scheduler::CopyOutputBuffer(*subtaskNewBuffer));
+                }
             })
             .name("Do Work Chunk")
             .precede(mergeSubtasks);
@@ -223,6 +298,11 @@ void metaldb::Scheduler::registerBaseStage(tf::Task& taskDoWork, const std::shar
         submitWork();
 
         mergeSubtasks.work([=]{
+            if (outputChunks->consume) {
+                // Every chunk was consumed as it was made.
+                return;
+            }
+
             OutputRowWriter writer;
             for (auto& subtaskBuffer : subtaskOutputBuffers) {
                 auto reader = OutputRowReader(*subtaskBuffer);
@@ -250,6 +330,24 @@ auto metaldb::Scheduler::registerBasePartial(const std::shared_ptr<QueryEngine::
     } else if (auto write = std::dynamic_pointer_cast<QueryEngine::WritePartial>(partial)) {
         task = Scheduler::registerWritePartial(write, parameters);
 
+    } else if (auto join = std::dynamic_pointer_cast<QueryEngine::JoinPartial>(partial)) {
+        task = Scheduler::registerJoinPartial(join, parameters);
+
+    } else if (auto aggregate = std::dynamic_pointer_cast<QueryEngine::AggregatePartial>(partial)) {
+        task = Scheduler::registerAggregatePartial(aggregate, parameters);
+
+    } else if (auto sort = std::dynamic_pointer_cast<QueryEngine::SortPartial>(partial)) {
+        task = Scheduler::registerSortPartial(sort, parameters);
+
+    } else if (auto setOperation = std::dynamic_pointer_cast<QueryEngine::SetOperationPartial>(partial)) {
+        task = Scheduler::registerSetOperationPartial(setOperation, parameters);
+
+    } else if (auto window = std::dynamic_pointer_cast<QueryEngine::WindowPartial>(partial)) {
+        task = Scheduler::registerWindowPartial(window, parameters);
+
+    } else if (auto filter = std::dynamic_pointer_cast<QueryEngine::FilterPartial>(partial)) {
+        task = Scheduler::registerFilterPartial(filter, parameters);
+
     } else if (auto output = std::dynamic_pointer_cast<QueryEngine::ShuffleOutputPartial>(partial)) {
         task = Scheduler::registerShufflePartial(output, parameters);
     } else {
@@ -269,9 +367,33 @@ auto metaldb::Scheduler::registerReadPartial(std::shared_ptr<QueryEngine::ReadPa
     auto filename = read->filepath;
     auto method = read->method;
     auto definition = read->definition;
+    auto collectedStatistics = read->collectedStatistics;
+    auto fileSize = read->fileSize;
+    auto rowRanges = std::make_shared<std::optional<std::vector<std::pair<std::size_t, std::size_t>>>>(read->rowRanges);
+    auto partitionValues = read->partitionValues;
+
+    // Partition columns aren't in the file, so their values are appended to every row before it's parsed.
+    std::string rowSuffix;
+    for (const auto& value : partitionValues) {
+        rowSuffix += ",";
+        rowSuffix += value.value_or("");
+    }
 
     auto rawTablePtr = reader::RawTable::Placeholder();
     auto readRawTableTask = parameters.taskflow->emplace([=]() {
+        // The ranges are from the statistics of the file when the plan was made, so a file that changed since is read whole.
+        std::error_code error;
+        if (*rowRanges && std::filesystem::file_size(filename, error) != fileSize) {
+            std::cout << "File changed since it was planned, reading every row: " << filename << std::endl;
+            rowRanges->reset();
+        }
+
+        // None of the rows are read, so the file isn't opened and the raw table stays empty.
+        if (*rowRanges && (*rowRanges)->empty()) {
+            std::cout << "Skipping read command for file: " << filename << std::endl;
+            return;
+        }
+
         std::cout << "Running read command for file: " << filename << std::endl;
         std::filesystem::path path;
         path.append(filename);
@@ -291,6 +413,7 @@ auto metaldb::Scheduler::registerReadPartial(std::shared_ptr<QueryEngine::ReadPa
     auto manager = parameters.manager;
     auto encoder = parameters.encoder;
     auto outputBuffer = parameters.outputBuffer;
+    auto outputChunks = Scheduler::OutputChunksFor(outputBuffer, parameters.context);
     auto maxNumRows = manager->MaxNumRows();
     auto maxNumBytes = manager->MaxMemory();
     assert(!parameters.doWorkTask->has_work());
@@ -302,7 +425,7 @@ auto metaldb::Scheduler::registerReadPartial(std::shared_ptr<QueryEngine::ReadPa
         auto subtaskBuffers = [&]() {
             auto currentMaxNumRows = maxNumRows;
             while (true) {
-                auto subtaskBuffers = Scheduler::SerializeRawTable(*rawTablePtr, currentMaxNumRows);
+                auto subtaskBuffers = Scheduler::SerializeRawTable(*rawTablePtr, currentMaxNumRows, *rowRanges, rowSuffix);
                 // Verify none exceed the max length
                 bool allPassed = true;
                 for (const auto& [childBufferPtr, numRows] : subtaskBuffers) {
@@ -322,6 +445,42 @@ auto metaldb::Scheduler::registerReadPartial(std::shared_ptr<QueryEngine::ReadPa
             }
         }();
 
+        if (collectedStatistics) {
+            // Statistics are collected from the raw rows in parallel with the parse, and keep the raw table alive until then.
+            auto collectors = std::make_shared<std::vector<StatisticsCollector>>();
+            const auto numRows = rawTablePtr->NumRows();
+            for (std::size_t startRow = 0; startRow < numRows; startRow += StatisticsCollector::ChunkNumRows) {
+                collectors->emplace_back(Scheduler::ColumnTypes(*definition), partitionValues);
+            }
+
+            auto mergeStatistics = subflow.emplace([=]() {
+                StatisticsCollector collector(Scheduler::ColumnTypes(*definition), partitionValues);
+                std::vector<std::vector<QueryEngine::ZoneMap>> chunks;
+                for (const auto& chunkCollector : *collectors) {
+                    collector.merge(chunkCollector);
+                    chunks.push_back(chunkCollector.ZoneMaps());
+                }
+
+                // The planner already set the size and modification time of the file that was read.
+                const auto fileSize = collectedStatistics->fileSize;
+                const auto modifiedTime = collectedStatistics->modifiedTime;
+                *collectedStatistics = collector.Statistics();
+                collectedStatistics->fileSize = fileSize;
+                collectedStatistics->modifiedTime = modifiedTime;
+                collectedStatistics->chunkNumRows = StatisticsCollector::ChunkNumRows;
+                collectedStatistics->chunks = std::move(chunks);
+            }).name("Merge statistics");
+
+            for (std::size_t i = 0; i < collectors->size(); ++i) {
+                subflow.emplace([=]() {
+                    const auto startRow = i * StatisticsCollector::ChunkNumRows;
+                    collectors->at(i).addRows(*rawTablePtr, startRow, startRow + StatisticsCollector::ChunkNumRows);
+                })
+                .name("Collect Statistics Chunk")
+                .precede(mergeStatistics);
+            }
+        }
+
         // We can free the rawTable
         rawTablePtr.reset();
 
@@ -333,6 +492,9 @@ auto metaldb::Scheduler::registerReadPartial(std::shared_ptr<QueryEngine::ReadPa
                 auto bufferPtr = localCurrentInputBuffer;
                 auto localOutput = subtaskNewBuffer;
                 manager->run(*bufferPtr, encoder->data(), *localOutput, numRowsLocal);
+                if (outputChunks->consume) {
+                    outputChunks->consume(Scheduler::CopyOutputBuffer(*localOutput));
+                }
             })
             .name("Do Work Chunk")
             .precede(mergeSubtasks);
@@ -342,6 +504,11 @@ auto metaldb::Scheduler::registerReadPartial(std::shared_ptr<QueryEngine::ReadPa
         }
 
         mergeSubtasks.work([=]() mutable {
+            if (outputChunks->consume) {
+                // Every chunk was consumed as it was parsed.
+                return;
+            }
+
             OutputRowWriter writer;
             for (auto& subtaskBuffer : subtaskOutputBuffers) {
                 auto reader = OutputRowReader(*subtaskBuffer);
@@ -362,20 +529,7 @@ auto metaldb::Scheduler::registerReadPartial(std::shared_ptr<QueryEngine::ReadPa
 
     return parameters.taskflow->emplace([=]() {
         // Encode the commands
-        auto columnTypes = [&]{
-            std::vector<ColumnType> columnTypes;
-            std::transform(definition->columns.begin(), definition->columns.end(), std::back_inserter(columnTypes), [](auto col) {
-                // The nullable type is always one more.
-                if (col.type == Unknown) {
-                    return col.type;
-                } else if (col.nullable) {
-                    return (metaldb::ColumnType) (col.type + 1);
-                } else {
-                    return col.type;
-                }
-            });
-            return columnTypes;
-        }();
+        auto columnTypes = Scheduler::ColumnTypes(*definition);
         engine::ParseRow parseRow(method, columnTypes, /* skipHeader */ false);
         encoder->encode(parseRow);
     })
@@ -385,12 +539,73 @@ auto metaldb::Scheduler::registerReadPartial(std::shared_ptr<QueryEngine::ReadPa
 auto metaldb::Scheduler::registerProjectionPartial(std::shared_ptr<QueryEngine::ProjectionPartial> projection, Parameters& parameters) noexcept -> tf::Task {
     std::cout << "Registering Projection partial" << projection->id() << std::endl;
 
-    auto encoder = parameters.encoder;
+    if (projection->execution == QueryEngine::GPU) {
+        auto encoder = parameters.encoder;
+        return parameters.taskflow->emplace([=]() {
+            engine::Projection projectionInstr(projection->columnIndexes);
+            encoder->encode(projectionInstr);
+        })
+        .name("Encode Projection Task");
+    }
+
+    // Rows that were already parsed by another partial are projected on the CPU.
+    auto childOutputBuffers = parameters.childOutputBuffers;
+    auto outputBuffer = parameters.outputBuffer;
+    auto outputChunks = Scheduler::OutputChunksFor(outputBuffer, parameters.context);
+    parameters.doWorkTask->work([=](tf::Subflow& subflow) {
+        auto rowProjection = std::make_shared<RowProjection>(projection->columnIndexes);
+        auto mergeChunks = subflow.placeholder();
+
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = Scheduler::ColumnTypes(*projection->definition);
+        std::vector<IntermediateBufferTypePtr> chunkOutputBuffers;
+        for (auto& childBuffer : childOutputBuffers) {
+            const std::size_t numRows = childBuffer->empty() ? 0 : OutputRowReader(*childBuffer).NumRows();
+            for (std::size_t startRow = 0; startRow < numRows; startRow += RowProjection::ChunkNumRows) {
+                auto chunkOutputBuffer = MakeBufferPtr();
+                subflow.emplace([=]() {
+                    OutputRowWriter writer(builder);
+                    rowProjection->project(*childBuffer, writer, startRow, startRow + RowProjection::ChunkNumRows);
+                    if (writer.CurrentNumRows() == 0) {
+                        return;
+                    }
+                    if (outputChunks->consume) {
+                        IntermediateBufferType chunk;
+                        writer.write(chunk);
+                        outputChunks->consume(chunk);
+                        return;
+                    }
+                    writer.write(*chunkOutputBuffer);
+                })
+                .name("Project Chunk")
+                .precede(mergeChunks);
+
+                chunkOutputBuffers.emplace_back(std::move(chunkOutputBuffer));
+            }
+        }
+
+        mergeChunks.work([=]() {
+            if (outputChunks->consume) {
+                return;
+            }
+
+            OutputRowWriter writer(builder);
+            for (auto& chunkOutputBuffer : chunkOutputBuffers) {
+                if (chunkOutputBuffer->empty()) {
+                    continue;
+                }
+                auto reader = OutputRowReader(*chunkOutputBuffer);
+                for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+                    writer.copyRow(reader, i);
+                }
+            }
+            writer.write(*outputBuffer);
+        }).name("Merge projection chunks");
+    }).name("Do Projection Work");
+
     return parameters.taskflow->emplace([=]() {
-        engine::Projection projectionInstr(projection->columnIndexes);
-        encoder->encode(projectionInstr);
-    })
-    .name("Encode Projection Task");
+        // The columns are projected entirely in the 'doWorkTask'.
+    }).name("Projection");
 }
 
 auto metaldb::Scheduler::registerShufflePartial(std::shared_ptr<QueryEngine::ShuffleOutputPartial> output, Parameters& parameters) noexcept -> tf::Task {
@@ -404,6 +619,703 @@ auto metaldb::Scheduler::registerShufflePartial(std::shared_ptr<QueryEngine::Shu
     .name("Encode Shuffle Partial");
 }
 
+auto metaldb::Scheduler::registerJoinPartial(std::shared_ptr<QueryEngine::JoinPartial> join, Parameters& parameters) noexcept -> tf::Task {
+    std::cout << "Registering Join partial" << join->id() << std::endl;
+
+    auto outputBuffer = parameters.outputBuffer;
+
+    // The children are all of the lhs buffers, followed by all of the rhs buffers.
+    const auto& childOutputBuffers = parameters.childOutputBuffers;
+    const auto numLhsChildren = std::min(join->numLhsChildren, childOutputBuffers.size());
+    std::vector<IntermediateBufferTypePtr> lhsBuffers(childOutputBuffers.begin(), childOutputBuffers.begin() + numLhsChildren);
+    std::vector<IntermediateBufferTypePtr> rhsBuffers(childOutputBuffers.begin() + numLhsChildren, childOutputBuffers.end());
+    auto buildBuffers = join->buildIsLhs() ? lhsBuffers : rhsBuffers;
+    auto probeBuffers = join->buildIsLhs() ? rhsBuffers : lhsBuffers;
+
+    // Every broadcast join over the same build stage shares its hash table.
+    auto sharedHashJoin = std::make_shared<SharedHashJoin>();
+    if (join->strategy == QueryEngine::JoinPartial::BROADCAST && !buildBuffers.empty()) {
+        auto& broadcastJoin = parameters.context.broadcastJoins[buildBuffers.front().get()];
+        if (!broadcastJoin) {
+            broadcastJoin = sharedHashJoin;
+        }
+        sharedHashJoin = broadcastJoin;
+    }
+
+    // A grace join spills the chunks of its children as they're made, so neither side is ever whole in memory.  Whatever a
+    // child still merges into its buffer is spilled once it's done.
+    std::shared_ptr<GraceHashJoin> graceJoin;
+    if (join->strategy == QueryEngine::JoinPartial::GRACE) {
+        graceJoin = std::make_shared<GraceHashJoin>(join->joinType, Scheduler::ColumnTypes(*join->lhsDefinition), join->lhsColumnIndex, Scheduler::ColumnTypes(*join->rhsDefinition), join->rhsColumnIndex, join->numPartitionBits, join->memoryBudget);
+        for (auto& buffer : buildBuffers) {
+            Scheduler::ConsumeOutputChunks(buffer, parameters.context, [=](const IntermediateBufferType& chunk) {
+                graceJoin->spillBuild(chunk);
+            });
+        }
+        for (auto& buffer : probeBuffers) {
+            Scheduler::ConsumeOutputChunks(buffer, parameters.context, [=](const IntermediateBufferType& chunk) {
+                graceJoin->spillProbe(chunk);
+            });
+        }
+    }
+
+    // A sort merge join sorts the chunks of its children into runs as they're made, so neither side is ever whole in memory.
+    // Whatever a child still merges into its buffer is sorted once it's done.
+    std::shared_ptr<SortMergeJoin> sortMergeJoin;
+    if (join->strategy == QueryEngine::JoinPartial::SORT_MERGE) {
+        sortMergeJoin = std::make_shared<SortMergeJoin>(join->joinType, Scheduler::ColumnTypes(*join->lhsDefinition), join->lhsColumnIndex, Scheduler::ColumnTypes(*join->rhsDefinition), join->rhsColumnIndex, join->memoryBudget, join->lhsSorted, join->rhsSorted);
+        for (auto& buffer : lhsBuffers) {
+            Scheduler::ConsumeOutputChunks(buffer, parameters.context, [=](const IntermediateBufferType& chunk) {
+                sortMergeJoin->addLhs(chunk);
+            });
+        }
+        for (auto& buffer : rhsBuffers) {
+            Scheduler::ConsumeOutputChunks(buffer, parameters.context, [=](const IntermediateBufferType& chunk) {
+                sortMergeJoin->addRhs(chunk);
+            });
+        }
+    }
+
+    // Whether each child's buffer is read by another stage too is only known once every stage is registered.
+    std::unordered_map<const IntermediateBufferType*, OutputChunksPtr> childOutputChunks;
+    for (const auto& buffer : childOutputBuffers) {
+        childOutputChunks.emplace(buffer.get(), Scheduler::OutputChunksFor(buffer, parameters.context));
+    }
+
+    auto outputChunks = Scheduler::OutputChunksFor(outputBuffer, parameters.context);
+    parameters.doWorkTask->work([=](tf::Subflow& subflow) {
+        auto makeHashJoin = [=]() {
+            return std::make_shared<HashJoin>(join->joinType, Scheduler::ColumnTypes(*join->lhsDefinition), join->lhsColumnIndex, Scheduler::ColumnTypes(*join->rhsDefinition), join->rhsColumnIndex, join->buildIsLhs());
+        };
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = makeHashJoin()->OutputColumnTypes();
+
+        // Grace and sort merge joins add a buffer for each chunk of output as it's joined.
+        auto subtaskOutputBuffers = std::make_shared<std::vector<IntermediateBufferTypePtr>>();
+        auto mergeSubtasks = subflow.placeholder();
+
+        switch (join->strategy) {
+        case QueryEngine::JoinPartial::HASH:
+        case QueryEngine::JoinPartial::BROADCAST: {
+            auto buildTask = subflow.emplace([=]() {
+                // Only the first join to run builds a broadcast hash table.
+                std::call_once(sharedHashJoin->built, [&]() {
+                    sharedHashJoin->hashJoin = makeHashJoin();
+                    sharedHashJoin->hashJoin->build(buildBuffers);
+                    std::cout << "Built hash table with " << sharedHashJoin->hashJoin->NumBuildRows() << " rows" << std::endl;
+                });
+            }).name("Build Hash Table");
+            mergeSubtasks.succeed(buildTask);
+
+            // The hash table is read-only once built, so every probe chunk can run in parallel.
+            for (auto& probeBuffer : probeBuffers) {
+                auto subtaskNewBuffer = MakeBufferPtr();
+                subflow.emplace([=]() {
+                    OutputRowWriter writer(builder);
+                    sharedHashJoin->hashJoin->probe(*probeBuffer, writer);
+                    writer.write(*subtaskNewBuffer);
+                })
+                .name("Probe Chunk")
+                .succeed(buildTask)
+                .precede(mergeSubtasks);
+
+                subtaskOutputBuffers->emplace_back(std::move(subtaskNewBuffer));
+            }
+            break;
+        }
+        case QueryEngine::JoinPartial::RADIX_PARTITIONED: {
+            const auto& buildDefinition = join->buildIsLhs() ? join->lhsDefinition : join->rhsDefinition;
+            const auto& probeDefinition = join->buildIsLhs() ? join->rhsDefinition : join->lhsDefinition;
+            auto buildPartitioner = std::make_shared<RadixPartitioner>(Scheduler::ColumnTypes(*buildDefinition), join->buildIsLhs() ? join->lhsColumnIndex : join->rhsColumnIndex, join->numPartitionBits);
+            auto probePartitioner = std::make_shared<RadixPartitioner>(Scheduler::ColumnTypes(*probeDefinition), join->buildIsLhs() ? join->rhsColumnIndex : join->lhsColumnIndex, join->numPartitionBits);
+
+            // Every input buffer is split into one buffer per partition, stored as [input][partition].
+            using PartitionedBuffers = std::vector<std::vector<IntermediateBufferTypePtr>>;
+            auto partitionedBuild = std::make_shared<PartitionedBuffers>(buildBuffers.size());
+            auto partitionedProbe = std::make_shared<PartitionedBuffers>(probeBuffers.size());
+
+            auto partitionTasks = subflow.emplace([]() { /* sync */ }).name("Partitioned");
+            for (std::size_t i = 0; i < buildBuffers.size(); ++i) {
+                auto buffer = buildBuffers.at(i);
+                subflow.emplace([=]() {
+                    partitionedBuild->at(i) = buildPartitioner->partition(*buffer);
+                }).name("Partition Build Chunk").precede(partitionTasks);
+            }
+            for (std::size_t i = 0; i < probeBuffers.size(); ++i) {
+                auto buffer = probeBuffers.at(i);
+                subflow.emplace([=]() {
+                    partitionedProbe->at(i) = probePartitioner->partition(*buffer);
+                }).name("Partition Probe Chunk").precede(partitionTasks);
+            }
+
+            // Each partition is joined independently, so they all run in parallel.
+            for (std::size_t partition = 0; partition < buildPartitioner->NumPartitions(); ++partition) {
+                auto subtaskNewBuffer = MakeBufferPtr();
+                subflow.emplace([=]() {
+                    std::vector<IntermediateBufferTypePtr> partitionBuildBuffers;
+                    for (const auto& partitions : *partitionedBuild) {
+                        partitionBuildBuffers.push_back(partitions.at(partition));
+                    }
+
+                    auto hashJoin = makeHashJoin();
+                    hashJoin->build(partitionBuildBuffers);
+
+                    OutputRowWriter writer(builder);
+                    for (const auto& partitions : *partitionedProbe) {
+                        hashJoin->probe(*partitions.at(partition), writer);
+                    }
+                    writer.write(*subtaskNewBuffer);
+                })
+                .name("Join Partition")
+                .succeed(partitionTasks)
+                .precede(mergeSubtasks);
+
+                subtaskOutputBuffers->emplace_back(std::move(subtaskNewBuffer));
+            }
+            mergeSubtasks.succeed(partitionTasks);
+            break;
+        }
+        case QueryEngine::JoinPartial::GRACE: {
+            auto spillTasks = subflow.emplace([]() { /* sync */ }).name("Spilled");
+            for (auto& buffer : buildBuffers) {
+                auto bufferChunks = childOutputChunks.at(buffer.get());
+                subflow.emplace([=]() {
+                    graceJoin->spillBuild(*buffer);
+
+                    // The chunk is on disk now, so release it, unless another stage still reads it.
+                    if (!bufferChunks->shared) {
+                        buffer->clear();
+                        buffer->shrink_to_fit();
+                    }
+                }).name("Spill Build Chunk").precede(spillTasks);
+            }
+            for (auto& buffer : probeBuffers) {
+                auto bufferChunks = childOutputChunks.at(buffer.get());
+                subflow.emplace([=]() {
+                    graceJoin->spillProbe(*buffer);
+                    if (!bufferChunks->shared) {
+                        buffer->clear();
+                        buffer->shrink_to_fit();
+                    }
+                }).name("Spill Probe Chunk").precede(spillTasks);
+            }
+
+            // Partitions are joined one after another so only one build side is in memory at a time.  Each partition's output
+            // is passed on before the next one is joined.
+            subflow.emplace([=]() {
+                std::cout << "Spilled " << graceJoin->NumBuildBytes() << " bytes of the build side" << std::endl;
+                graceJoin->join([&](IntermediateBufferType& partitionOutput) {
+                    if (outputChunks->consume) {
+                        outputChunks->consume(partitionOutput);
+                    } else {
+                        subtaskOutputBuffers->push_back(std::make_shared<IntermediateBufferType>(std::move(partitionOutput)));
+                    }
+                });
+            })
+            .name("Join Spilled Partitions")
+            .succeed(spillTasks)
+            .precede(mergeSubtasks);
+            break;
+        }
+        case QueryEngine::JoinPartial::SORT_MERGE: {
+            // Every chunk of both sides is sorted into its own run, so they all run in parallel.  Each buffer is released once
+            // all of its runs are made.
+            auto sortTasks = subflow.emplace([]() { /* sync */ }).name("Sorted");
+            for (const auto isLhs : {true, false}) {
+                for (auto& buffer : isLhs ? lhsBuffers : rhsBuffers) {
+                    auto bufferChunks = childOutputChunks.at(buffer.get());
+                    auto releaseTask = subflow.emplace([=]() {
+                        if (!bufferChunks->shared) {
+                            buffer->clear();
+                            buffer->shrink_to_fit();
+                        }
+                    }).name("Release Join Chunk").precede(sortTasks);
+
+                    const std::size_t numRows = buffer->empty() ? 0 : OutputRowReader(*buffer).NumRows();
+                    for (std::size_t startRow = 0; startRow < numRows; startRow += ExternalSort::ChunkNumRows) {
+                        subflow.emplace([=]() {
+                            if (isLhs) {
+                                sortMergeJoin->addLhs(*buffer, startRow, startRow + ExternalSort::ChunkNumRows);
+                            } else {
+                                sortMergeJoin->addRhs(*buffer, startRow, startRow + ExternalSort::ChunkNumRows);
+                            }
+                        }).name("Sort Join Chunk").precede(releaseTask);
+                    }
+                }
+            }
+
+            // The output is passed on a chunk at a time as it's merged.
+            subflow.emplace([=]() {
+                sortMergeJoin->join([&](IntermediateBufferType& output) {
+                    if (outputChunks->consume) {
+                        outputChunks->consume(output);
+                    } else {
+                        subtaskOutputBuffers->push_back(std::make_shared<IntermediateBufferType>(std::move(output)));
+                    }
+                });
+                std::cout << "Sort merge join spilled " << sortMergeJoin->NumSpilledRuns() << " runs" << std::endl;
+            })
+            .name("Merge Sorted Sides")
+            .succeed(sortTasks)
+            .precede(mergeSubtasks);
+            break;
+        }
+        }
+
+        mergeSubtasks.work([=]() {
+            // Each buffer is released once it's merged, so the output isn't in memory twice.
+            OutputRowWriter writer(builder);
+            for (auto& subtaskBuffer : *subtaskOutputBuffers) {
+                if (outputChunks->consume) {
+                    outputChunks->consume(*subtaskBuffer);
+                } else {
+                    auto reader = OutputRowReader(*subtaskBuffer);
+                    for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+                        writer.copyRow(reader, i);
+                    }
+                }
+                subtaskBuffer = MakeBufferPtr();
+            }
+            if (outputChunks->consume) {
+                return;
+            }
+
+            writer.write(*outputBuffer);
+            std::cout << "Join output -- Num Columns: " << (int) writer.NumColumns() << " -- Num Bytes: " << (int) writer.NumBytes() << " -- Num Rows: " << (int) writer.CurrentNumRows() << std::endl;
+        }).name("Merge join chunks");
+    }).name("Do Join Work");
+
+    return parameters.taskflow->emplace([=]() {
+        // The join happens entirely in the 'doWorkTask'.
+    }).name("Join");
+}
+
+auto metaldb::Scheduler::registerAggregatePartial(std::shared_ptr<QueryEngine::AggregatePartial> aggregate, Parameters& parameters) noexcept -> tf::Task {
+    std::cout << "Registering Aggregate partial" << aggregate->id() << std::endl;
+
+    if (aggregate->execution == QueryEngine::GPU) {
+        // Each chunk is reduced to a single row in the kernel, and the final phase merges them.
+        auto encoder = parameters.encoder;
+        return parameters.taskflow->emplace([=]() {
+            std::vector<engine::Aggregate::Aggregation> aggregations;
+            for (const auto& aggregation : aggregate->aggregations) {
+                const auto column = aggregation.column.value_or(0);
+                switch (aggregation.function) {
+                case QueryEngine::AggregatePartial::COUNT:
+                    aggregations.push_back({aggregation.column ? AggregateInstruction::COUNT : AggregateInstruction::COUNT_ALL, column});
+                    break;
+                case QueryEngine::AggregatePartial::SUM:
+                    aggregations.push_back({AggregateInstruction::SUM, column});
+                    break;
+                case QueryEngine::AggregatePartial::MIN:
+                    aggregations.push_back({AggregateInstruction::MIN, column});
+                    break;
+                case QueryEngine::AggregatePartial::MAX:
+                    aggregations.push_back({AggregateInstruction::MAX, column});
+                    break;
+                case QueryEngine::AggregatePartial::AVG:
+                    aggregations.push_back({AggregateInstruction::AVG, column});
+                    break;
+                case QueryEngine::AggregatePartial::APPROX_COUNT_DISTINCT:
+                case QueryEngine::AggregatePartial::APPROX_PERCENTILE:
+                    // Sketches are only built on the CPU, which the planner guarantees.
+                    std::cerr << "Sketches can't be aggregated in the kernel (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                    break;
+                }
+            }
+            engine::Aggregate aggregateInstr(aggregations);
+            encoder->encode(aggregateInstr);
+        })
+        .name("Encode Aggregate Task");
+    }
+
+    auto childOutputBuffers = parameters.childOutputBuffers;
+    auto outputBuffer = parameters.outputBuffer;
+    auto makeHashAggregate = [=]() {
+        return HashAggregate(Scheduler::ColumnTypes(*aggregate->inputDefinition), aggregate->groupByColumnIndexes, aggregate->aggregations);
+    };
+
+    if (aggregate->phase == QueryEngine::AggregatePartial::FINAL) {
+        parameters.doWorkTask->work([=]() {
+            auto hashAggregate = makeHashAggregate();
+            for (auto& childBuffer : childOutputBuffers) {
+                hashAggregate.merge(*childBuffer);
+            }
+
+            OutputRowWriter::OutputRowBuilder builder;
+            builder.columnTypes = hashAggregate.FinalColumnTypes();
+            OutputRowWriter writer(builder);
+            hashAggregate.writeFinal(writer);
+            writer.write(*outputBuffer);
+            std::cout << "Aggregate output -- Num Groups: " << hashAggregate.NumGroups() << " -- Num Bytes: " << (int) writer.NumBytes() << std::endl;
+        }).name("Do Final Aggregate Work");
+
+    } else {
+        parameters.doWorkTask->work([=](tf::Subflow& subflow) {
+            OutputRowWriter::OutputRowBuilder builder;
+            builder.columnTypes = makeHashAggregate().PartialColumnTypes();
+
+            std::vector<IntermediateBufferTypePtr> subtaskOutputBuffers;
+            auto mergeSubtasks = subflow.placeholder();
+
+            // Every chunk is aggregated on its own, so they all run in parallel.
+            // The planner sizes the chunks from the estimated number of groups.
+            const auto chunkNumRows = aggregate->chunkNumRows;
+            for (auto& childBuffer : childOutputBuffers) {
+                const std::size_t numRows = childBuffer->empty() ? 0 : OutputRowReader(*childBuffer).NumRows();
+                for (std::size_t startRow = 0; startRow < numRows; startRow += chunkNumRows) {
+                    auto subtaskNewBuffer = MakeBufferPtr();
+                    subflow.emplace([=]() {
+                        auto hashAggregate = makeHashAggregate();
+                        hashAggregate.update(*childBuffer, startRow, startRow + chunkNumRows);
+
+                        OutputRowWriter writer(builder);
+                        hashAggregate.writePartial(writer);
+                        writer.write(*subtaskNewBuffer);
+                    })
+                    .name("Aggregate Chunk")
+                    .precede(mergeSubtasks);
+
+                    subtaskOutputBuffers.emplace_back(std::move(subtaskNewBuffer));
+                }
+            }
+
+            mergeSubtasks.work([=]() {
+                // The partial aggregates are only concatenated, they are merged by the final phase.
+                OutputRowWriter writer(builder);
+                for (auto& subtaskBuffer : subtaskOutputBuffers) {
+                    auto reader = OutputRowReader(*subtaskBuffer);
+                    for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+                        writer.copyRow(reader, i);
+                    }
+                }
+                writer.write(*outputBuffer);
+            }).name("Merge aggregate chunks");
+        }).name("Do Partial Aggregate Work");
+    }
+
+    return parameters.taskflow->emplace([=]() {
+        // The aggregate happens entirely in the 'doWorkTask'.
+    }).name("Aggregate");
+}
+
+auto metaldb::Scheduler::registerSortPartial(std::shared_ptr<QueryEngine::SortPartial> sort, Parameters& parameters) noexcept -> tf::Task {
+    std::cout << "Registering Sort partial" << sort->id() << std::endl;
+
+    auto childOutputBuffers = parameters.childOutputBuffers;
+    auto outputBuffer = parameters.outputBuffer;
+    if (sort->limit) {
+        parameters.doWorkTask->work([=](tf::Subflow& subflow) {
+            auto topN = std::make_shared<TopN>(sort->sortColumns, *sort->limit);
+            auto mergeHeaps = subflow.placeholder();
+
+            // Every chunk keeps its own heap, so they all run in parallel.
+            for (auto& childBuffer : childOutputBuffers) {
+                const std::size_t numRows = childBuffer->empty() ? 0 : OutputRowReader(*childBuffer).NumRows();
+                for (std::size_t startRow = 0; startRow < numRows; startRow += TopN::ChunkNumRows) {
+                    subflow.emplace([=]() {
+                        topN->addChunk(*childBuffer, startRow, startRow + TopN::ChunkNumRows);
+                    })
+                    .name("Top-N Chunk")
+                    .precede(mergeHeaps);
+                }
+            }
+
+            mergeHeaps.work([=]() {
+                OutputRowWriter::OutputRowBuilder builder;
+                builder.columnTypes = Scheduler::ColumnTypes(*sort->definition);
+                OutputRowWriter writer(builder);
+                topN->write(writer);
+                writer.write(*outputBuffer);
+                std::cout << "Top-N output -- Num Discarded Rows: " << topN->NumDiscardedRows() << " -- Num Rows: " << writer.CurrentNumRows() << std::endl;
+            }).name("Write top-n rows");
+        }).name("Do Top-N Work");
+
+        return parameters.taskflow->emplace([=]() {
+            // The top-n happens entirely in the 'doWorkTask'.
+        }).name("Top-N");
+    }
+
+    // Chunks are sorted into runs as the children make them, so the input is never whole in memory.  Whatever a child still
+    // merges into its buffer is sorted once it's done.
+    auto externalSort = std::make_shared<ExternalSort>(sort->sortColumns, sort->memoryBudget);
+    std::vector<OutputChunksPtr> childOutputChunks;
+    for (auto& childBuffer : childOutputBuffers) {
+        Scheduler::ConsumeOutputChunks(childBuffer, parameters.context, [=](const IntermediateBufferType& chunk) {
+            externalSort->addRun(chunk);
+        });
+        childOutputChunks.push_back(Scheduler::OutputChunksFor(childBuffer, parameters.context));
+    }
+
+    auto outputChunks = Scheduler::OutputChunksFor(outputBuffer, parameters.context);
+    parameters.doWorkTask->work([=](tf::Subflow& subflow) {
+        auto mergeRuns = subflow.placeholder();
+
+        // Every chunk is sorted into its own run, so they all run in parallel.  Each buffer is released once all of its runs
+        // are made, unless another stage reads it too.
+        for (std::size_t i = 0; i < childOutputBuffers.size(); ++i) {
+            auto childBuffer = childOutputBuffers.at(i);
+            auto childChunks = childOutputChunks.at(i);
+            auto releaseTask = subflow.emplace([=]() {
+                if (!childChunks->shared) {
+                    childBuffer->clear();
+                    childBuffer->shrink_to_fit();
+                }
+            })
+            .name("Release Sort Chunk")
+            .precede(mergeRuns);
+
+            const std::size_t numRows = childBuffer->empty() ? 0 : OutputRowReader(*childBuffer).NumRows();
+            for (std::size_t startRow = 0; startRow < numRows; startRow += ExternalSort::ChunkNumRows) {
+                subflow.emplace([=]() {
+                    externalSort->addRun(*childBuffer, startRow, startRow + ExternalSort::ChunkNumRows);
+                })
+                .name("Sort Run")
+                .precede(releaseTask);
+            }
+        }
+
+        mergeRuns.work([=]() {
+            OutputRowWriter::OutputRowBuilder builder;
+            builder.columnTypes = Scheduler::ColumnTypes(*sort->definition);
+
+            // A parent that takes chunks gets the merged rows a chunk at a time, so the output isn't whole in memory either.
+            if (outputChunks->consume) {
+                externalSort->merge(builder, [&](IntermediateBufferType& chunk) {
+                    outputChunks->consume(chunk);
+                });
+                std::cout << "Sort output -- Num Runs: " << externalSort->NumRuns() << " -- Num Spilled Runs: " << externalSort->NumSpilledRuns() << std::endl;
+                return;
+            }
+
+            OutputRowWriter writer(builder);
+            externalSort->merge(writer);
+            writer.write(*outputBuffer);
+            std::cout << "Sort output -- Num Runs: " << externalSort->NumRuns() << " -- Num Spilled Runs: " << externalSort->NumSpilledRuns() << " -- Num Rows: " << writer.CurrentNumRows() << std::endl;
+        }).name("Merge sorted runs");
+    }).name("Do Sort Work");
+
+    return parameters.taskflow->emplace([=]() {
+        // The sort happens entirely in the 'doWorkTask'.
+    }).name("Sort");
+}
+
+auto metaldb::Scheduler::registerSetOperationPartial(std::shared_ptr<QueryEngine::SetOperationPartial> setOperation, Parameters& parameters) noexcept -> tf::Task {
+    std::cout << "Registering Set Operation partial" << setOperation->id() << std::endl;
+
+    auto childOutputBuffers = parameters.childOutputBuffers;
+    auto outputBuffer = parameters.outputBuffer;
+    auto makeHashSetOperation = [=]() {
+        return HashSetOperation(setOperation->operation, Scheduler::ColumnTypes(*setOperation->definition));
+    };
+
+    if (setOperation->phase == QueryEngine::AggregatePartial::FINAL) {
+        parameters.doWorkTask->work([=]() {
+            auto hashSetOperation = makeHashSetOperation();
+            for (auto& childBuffer : childOutputBuffers) {
+                hashSetOperation.merge(*childBuffer);
+            }
+
+            OutputRowWriter::OutputRowBuilder builder;
+            builder.columnTypes = Scheduler::ColumnTypes(*setOperation->definition);
+            OutputRowWriter writer(builder);
+            hashSetOperation.writeFinal(writer);
+            writer.write(*outputBuffer);
+            std::cout << "Set operation output -- Num Distinct Rows: " << hashSetOperation.NumDistinctRows() << " -- Num Rows: " << writer.CurrentNumRows() << std::endl;
+        }).name("Do Final Set Operation Work");
+
+    } else {
+        const bool isLhs = setOperation->isLhs;
+        parameters.doWorkTask->work([=](tf::Subflow& subflow) {
+            OutputRowWriter::OutputRowBuilder builder;
+            builder.columnTypes = makeHashSetOperation().PartialColumnTypes();
+
+            std::vector<IntermediateBufferTypePtr> subtaskOutputBuffers;
+            auto mergeSubtasks = subflow.placeholder();
+
+            // Duplicates are removed within each chunk first, so they all run in parallel.
+            for (auto& childBuffer : childOutputBuffers) {
+                const std::size_t numRows = childBuffer->empty() ? 0 : OutputRowReader(*childBuffer).NumRows();
+                for (std::size_t startRow = 0; startRow < numRows; startRow += HashSetOperation::ChunkNumRows) {
+                    auto subtaskNewBuffer = MakeBufferPtr();
+                    subflow.emplace([=]() {
+                        OutputRowWriter writer(builder);
+                        makeHashSetOperation().writePartial(*childBuffer, isLhs, writer, startRow, startRow + HashSetOperation::ChunkNumRows);
+                        writer.write(*subtaskNewBuffer);
+                    })
+                    .name("Deduplicate Chunk")
+                    .precede(mergeSubtasks);
+
+                    subtaskOutputBuffers.emplace_back(std::move(subtaskNewBuffer));
+                }
+            }
+
+            mergeSubtasks.work([=]() {
+                // The chunks are only concatenated, duplicates across chunks are removed by the final phase.
+                OutputRowWriter writer(builder);
+                for (auto& subtaskBuffer : subtaskOutputBuffers) {
+                    if (subtaskBuffer->empty()) {
+                        continue;
+                    }
+                    auto reader = OutputRowReader(*subtaskBuffer);
+                    for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+                        writer.copyRow(reader, i);
+                    }
+                }
+                writer.write(*outputBuffer);
+            }).name("Merge deduplicated chunks");
+        }).name("Do Partial Set Operation Work");
+    }
+
+    return parameters.taskflow->emplace([=]() {
+        // The set operation happens entirely in the 'doWorkTask'.
+    }).name("Set Operation");
+}
+
+auto metaldb::Scheduler::registerWindowPartial(std::shared_ptr<QueryEngine::WindowPartial> window, Parameters& parameters) noexcept -> tf::Task {
+    std::cout << "Registering Window partial" << window->id() << std::endl;
+
+    auto childOutputBuffers = parameters.childOutputBuffers;
+    auto outputBuffer = parameters.outputBuffer;
+    parameters.doWorkTask->work([=](tf::Subflow& subflow) {
+        auto evaluator = std::make_shared<WindowEvaluator>(Scheduler::ColumnTypes(*window->inputDefinition), window->partitionColumns, window->sortColumns, window->functions);
+        auto bucketChunks = subflow.placeholder();
+        auto mergeBuckets = subflow.placeholder();
+
+        // Every chunk is split into buckets in parallel.
+        for (auto& childBuffer : childOutputBuffers) {
+            const std::size_t numRows = childBuffer->empty() ? 0 : OutputRowReader(*childBuffer).NumRows();
+            for (std::size_t startRow = 0; startRow < numRows; startRow += WindowEvaluator::ChunkNumRows) {
+                subflow.emplace([=]() {
+                    evaluator->addChunk(*childBuffer, startRow, startRow + WindowEvaluator::ChunkNumRows);
+                })
+                .name("Bucket Window Chunk")
+                .precede(bucketChunks);
+            }
+        }
+
+        // Every partition is in a single bucket, so the buckets are evaluated in parallel.
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = Scheduler::ColumnTypes(*window->definition);
+        std::vector<IntermediateBufferTypePtr> bucketOutputBuffers;
+        for (std::size_t bucket = 0; bucket < WindowEvaluator::NumBuckets; ++bucket) {
+            auto bucketOutputBuffer = MakeBufferPtr();
+            subflow.emplace([=]() {
+                OutputRowWriter writer(builder);
+                evaluator->evaluateBucket(bucket, writer);
+                if (writer.CurrentNumRows() > 0) {
+                    writer.write(*bucketOutputBuffer);
+                }
+            })
+            .name("Evaluate Window Bucket")
+            .succeed(bucketChunks)
+            .precede(mergeBuckets);
+
+            bucketOutputBuffers.emplace_back(std::move(bucketOutputBuffer));
+        }
+
+        mergeBuckets.work([=]() {
+            OutputRowWriter writer(builder);
+            for (auto& bucketOutputBuffer : bucketOutputBuffers) {
+                if (bucketOutputBuffer->empty()) {
+                    continue;
+                }
+                auto reader = OutputRowReader(*bucketOutputBuffer);
+                for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+                    writer.copyRow(reader, i);
+                }
+            }
+            writer.write(*outputBuffer);
+            std::cout << "Window output -- Num Rows: " << writer.CurrentNumRows() << std::endl;
+        }).name("Merge window buckets");
+    }).name("Do Window Work");
+
+    return parameters.taskflow->emplace([=]() {
+        // The window functions are evaluated entirely in the 'doWorkTask'.
+    }).name("Window");
+}
+
+auto metaldb::Scheduler::registerFilterPartial(std::shared_ptr<QueryEngine::FilterPartial> filter, Parameters& parameters) noexcept -> tf::Task {
+    std::cout << "Registering Filter partial" << filter->id() << std::endl;
+
+    auto childOutputBuffers = parameters.childOutputBuffers;
+    auto outputBuffer = parameters.outputBuffer;
+    auto outputChunks = Scheduler::OutputChunksFor(outputBuffer, parameters.context);
+    parameters.doWorkTask->work([=](tf::Subflow& subflow) {
+        auto rowFilter = std::make_shared<RowFilter>(filter->predicate);
+        auto mergeChunks = subflow.placeholder();
+
+        // The conjuncts are sampled on the first rows before any chunk is filtered, then ordered for every chunk.
+        std::optional<tf::Task> sampleConjuncts;
+        auto observedConjuncts = filter->observedConjuncts;
+        auto sampleBuffer = std::find_if(childOutputBuffers.begin(), childOutputBuffers.end(), [](const auto& buffer) { return !buffer->empty(); });
+        if (observedConjuncts && sampleBuffer != childOutputBuffers.end()) {
+            auto childBuffer = *sampleBuffer;
+            sampleConjuncts = subflow.emplace([=]() {
+                *observedConjuncts = rowFilter->sample(*childBuffer);
+                rowFilter->reorder(*observedConjuncts);
+            })
+            .name("Sample Filter Conjuncts")
+            .precede(mergeChunks);
+        }
+
+        // Every chunk is filtered in parallel, and the matching rows are written in order.
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = Scheduler::ColumnTypes(*filter->definition);
+        std::vector<IntermediateBufferTypePtr> chunkOutputBuffers;
+        for (auto& childBuffer : childOutputBuffers) {
+            const std::size_t numRows = childBuffer->empty() ? 0 : OutputRowReader(*childBuffer).NumRows();
+            for (std::size_t startRow = 0; startRow < numRows; startRow += RowFilter::ChunkNumRows) {
+                auto chunkOutputBuffer = MakeBufferPtr();
+                auto filterChunk = subflow.emplace([=]() {
+                    OutputRowWriter writer(builder);
+                    rowFilter->filter(*childBuffer, writer, startRow, startRow + RowFilter::ChunkNumRows);
+                    if (writer.CurrentNumRows() == 0) {
+                        return;
+                    }
+                    if (outputChunks->consume) {
+                        IntermediateBufferType chunk;
+                        writer.write(chunk);
+                        outputChunks->consume(chunk);
+                        return;
+                    }
+                    writer.write(*chunkOutputBuffer);
+                })
+                .name("Filter Chunk")
+                .precede(mergeChunks);
+                if (sampleConjuncts) {
+                    filterChunk.succeed(*sampleConjuncts);
+                }
+
+                chunkOutputBuffers.emplace_back(std::move(chunkOutputBuffer));
+            }
+        }
+
+        mergeChunks.work([=]() {
+            if (outputChunks->consume) {
+                return;
+            }
+
+            OutputRowWriter writer(builder);
+            for (auto& chunkOutputBuffer : chunkOutputBuffers) {
+                if (chunkOutputBuffer->empty()) {
+                    continue;
+                }
+                auto reader = OutputRowReader(*chunkOutputBuffer);
+                for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+                    writer.copyRow(reader, i);
+                }
+            }
+            writer.write(*outputBuffer);
+            std::cout << "Filter output -- Num Rows: " << writer.CurrentNumRows() << std::endl;
+        }).name("Merge filter chunks");
+    }).name("Do Filter Work");
+
+    return parameters.taskflow->emplace([=]() {
+        // The rows are filtered entirely in the 'doWorkTask'.
+    }).name("Filter");
+}
+
 auto metaldb::Scheduler::registerWritePartial(std::shared_ptr<QueryEngine::WritePartial> write, Parameters& parameters) noexcept -> tf::Task {
     std::cout << "Registering Write partial" << write->id() << std::endl;
 
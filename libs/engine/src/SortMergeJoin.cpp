@@ -0,0 +1,140 @@
+#include "SortMergeJoin.hpp"
+
+namespace {
+    /**
+     * Keys are sorted ascending, so a null key starts with the null marker.
+     */
+    bool IsNullKey(const std::string& key) noexcept {
+        return !key.empty() && key.front() == 1;
+    }
+}
+
+metaldb::SortMergeJoin::SortMergeJoin(JoinType joinType, std::vector<ColumnType> lhsColumnTypes, ColumnIndexType lhsColumn, std::vector<ColumnType> rhsColumnTypes, ColumnIndexType rhsColumn, std::size_t memoryBudget, bool lhsSorted, bool rhsSorted) noexcept : _joinType(joinType), _lhsColumnTypes(std::move(lhsColumnTypes)), _lhsColumn(lhsColumn), _rhsColumnTypes(std::move(rhsColumnTypes)), _rhsColumn(rhsColumn), _lhsSorted(lhsSorted), _rhsSorted(rhsSorted), _lhsSort({{lhsColumn, true}}, memoryBudget / 2), _rhsSort({{rhsColumn, true}}, memoryBudget / 2) {}
+
+auto metaldb::SortMergeJoin::OutputColumnTypes() const noexcept -> std::vector<ColumnType> {
+    return HashJoin(this->_joinType, this->_lhsColumnTypes, this->_lhsColumn, this->_rhsColumnTypes, this->_rhsColumn).OutputColumnTypes();
+}
+
+void metaldb::SortMergeJoin::addLhs(const BufferType& buffer, std::size_t startRow, std::size_t endRow) noexcept {
+    if (this->_lhsSorted) {
+        this->_lhsSort.addSortedRun(buffer, startRow, endRow);
+    } else {
+        this->_lhsSort.addRun(buffer, startRow, endRow);
+    }
+}
+
+void metaldb::SortMergeJoin::addRhs(const BufferType& buffer, std::size_t startRow, std::size_t endRow) noexcept {
+    if (this->_rhsSorted) {
+        this->_rhsSort.addSortedRun(buffer, startRow, endRow);
+    } else {
+        this->_rhsSort.addRun(buffer, startRow, endRow);
+    }
+}
+
+auto metaldb::SortMergeJoin::NumSpilledRuns() const noexcept -> std::size_t {
+    return this->_lhsSort.NumSpilledRuns() + this->_rhsSort.NumSpilledRuns();
+}
+
+void metaldb::SortMergeJoin::join(const std::function<void(BufferType&)>& consume) const noexcept {
+    const bool keepLhs = this->_joinType == JoinType::LEFT;
+    const bool keepRhs = this->_joinType == JoinType::RIGHT;
+
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = this->OutputColumnTypes();
+    OutputRowWriter writer(builder);
+    BufferType output;
+
+    // The values of every joined row are gathered into the same vector.
+    std::vector<OutputRowWriter::ColumnValue> columns;
+    columns.reserve(this->_lhsColumnTypes.size() + this->_rhsColumnTypes.size());
+    auto flush = [&]() {
+        if (writer.CurrentNumRows() == 0) {
+            return;
+        }
+        output.clear();
+        writer.write(output);
+        consume(output);
+        writer = OutputRowWriter(builder);
+    };
+    auto append = [&](const OutputRowReader<BufferType>* lhsReader, std::size_t lhsRow, const OutputRowReader<BufferType>* rhsReader, std::size_t rhsRow) {
+        this->appendJoinedRow(lhsReader, lhsRow, rhsReader, rhsRow, columns, writer);
+        if (writer.CurrentNumRows() >= ChunkNumRows) {
+            flush();
+        }
+    };
+
+    ExternalSort::Merger lhs(this->_lhsSort);
+    ExternalSort::Merger rhs(this->_rhsSort);
+
+    // The rhs rows with the current key, which are joined with every lhs row with the same key.
+    std::string groupKey;
+    BufferType group;
+    while (lhs.valid()) {
+        if (IsNullKey(lhs.key())) {
+            // Null keys never match anything, and are sorted after every other key.
+            if (keepLhs) {
+                append(&lhs.reader(), lhs.row(), nullptr, 0);
+            }
+            lhs.next();
+            continue;
+        }
+
+        while (rhs.valid() && !IsNullKey(rhs.key()) && rhs.key() < lhs.key()) {
+            if (keepRhs) {
+                append(nullptr, 0, &rhs.reader(), rhs.row());
+            }
+            rhs.next();
+        }
+
+        if (!rhs.valid() || IsNullKey(rhs.key()) || rhs.key() != lhs.key()) {
+            if (keepLhs) {
+                append(&lhs.reader(), lhs.row(), nullptr, 0);
+            }
+            lhs.next();
+            continue;
+        }
+
+        // Copy out the rhs rows with this key, since the merger may move to another block while reading them.
+        groupKey = rhs.key();
+        OutputRowWriter groupWriter;
+        while (rhs.valid() && rhs.key() == groupKey) {
+            groupWriter.copyRow(rhs.reader(), rhs.row());
+            rhs.next();
+        }
+        group.clear();
+        groupWriter.write(group);
+        auto groupReader = OutputRowReader(group);
+
+        while (lhs.valid() && lhs.key() == groupKey) {
+            for (std::size_t row = 0; row < groupReader.NumRows(); ++row) {
+                append(&lhs.reader(), lhs.row(), &groupReader, row);
+            }
+            lhs.next();
+        }
+    }
+
+    for (; rhs.valid() && keepRhs; rhs.next()) {
+        append(nullptr, 0, &rhs.reader(), rhs.row());
+    }
+    flush();
+}
+
+void metaldb::SortMergeJoin::appendJoinedRow(const OutputRowReader<BufferType>* lhsReader, std::size_t lhsRow, const OutputRowReader<BufferType>* rhsReader, std::size_t rhsRow, std::vector<OutputRowWriter::ColumnValue>& columns, OutputRowWriter& writer) const noexcept {
+    columns.clear();
+
+    auto appendSide = [&](const OutputRowReader<BufferType>* reader, std::size_t row, std::size_t numColumns) {
+        for (std::size_t col = 0; col < numColumns; ++col) {
+            if (reader == nullptr) {
+                // Not matched, so write a null.
+                columns.emplace_back();
+            } else {
+                auto [data, size] = reader->ColumnData(col, row);
+                columns.push_back({data, size});
+            }
+        }
+    };
+
+    appendSide(lhsReader, lhsRow, this->_lhsColumnTypes.size());
+    appendSide(rhsReader, rhsRow, this->_rhsColumnTypes.size());
+    writer.appendRow(columns);
+}
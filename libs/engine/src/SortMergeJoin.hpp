@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ExternalSort.hpp"
+#include "HashJoin.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * An equi-join that sorts both sides on their key, then merges them.
+     *
+     * Each side is sorted with its own @b ExternalSort , so chunks can be added in parallel and sides larger than the memory
+     * budget are spilled.  A side that's already in key order is only split into runs, without being sorted again.  The merge
+     * streams both sides in key order, and only holds the rows of the rhs with the current key in memory, so unlike a hash
+     * join neither side has to fit in memory.  The output is in key order, with the lhs columns followed by the rhs columns,
+     * and is passed on in chunks.
+     */
+    class SortMergeJoin final {
+    public:
+        using BufferType = std::vector<char>;
+        using BufferPtr = std::shared_ptr<BufferType>;
+        using JoinType = HashJoin::JoinType;
+        using ColumnIndexType = HashJoin::ColumnIndexType;
+
+        /**
+         * The most rows passed on by each call to the callback of @b join .
+         */
+        static constexpr std::size_t ChunkNumRows = 64 * 1024;
+
+        /**
+         * @param memoryBudget The sorted runs of each side are spilled once they exceed half of this many bytes.
+         * @param lhsSorted Whether the lhs is added in ascending order of its key, so it isn't sorted again.
+         * @param rhsSorted Whether the rhs is added in ascending order of its key.
+         */
+        SortMergeJoin(JoinType joinType, std::vector<ColumnType> lhsColumnTypes, ColumnIndexType lhsColumn, std::vector<ColumnType> rhsColumnTypes, ColumnIndexType rhsColumn, std::size_t memoryBudget, bool lhsSorted = false, bool rhsSorted = false) noexcept;
+
+        ~SortMergeJoin() noexcept = default;
+
+        /**
+         * Returns the types of the columns written by @b join .
+         */
+        std::vector<ColumnType> OutputColumnTypes() const noexcept;
+
+        /**
+         * Sorts the rows in `[startRow, endRow)` of a chunk of the lhs.  This can be called concurrently.  If the lhs is sorted,
+         * the rows of each call only have to be in order among themselves.
+         */
+        void addLhs(const BufferType& buffer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) noexcept;
+
+        /**
+         * Sorts the rows in `[startRow, endRow)` of a chunk of the rhs.  This can be called concurrently.
+         */
+        void addRhs(const BufferType& buffer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) noexcept;
+
+        /**
+         * Merges both sides, passing the joined rows to @b consume as @b OutputRow buffers of at most @b ChunkNumRows rows, in
+         * key order.  Only one chunk of the output is in memory at a time.  The callback may take the contents of the buffer.
+         * Every chunk must be added first.
+         */
+        void join(const std::function<void(BufferType&)>& consume) const noexcept;
+
+        /**
+         * Returns the number of sorted runs of both sides that were spilled to disk.
+         */
+        std::size_t NumSpilledRuns() const noexcept;
+
+    private:
+        JoinType _joinType;
+        std::vector<ColumnType> _lhsColumnTypes;
+        ColumnIndexType _lhsColumn;
+        std::vector<ColumnType> _rhsColumnTypes;
+        ColumnIndexType _rhsColumn;
+        bool _lhsSorted;
+        bool _rhsSorted;
+
+        ExternalSort _lhsSort;
+        ExternalSort _rhsSort;
+
+        /**
+         * Appends a lhs row joined with a rhs row, where a nullptr reader is a side of nulls.  @b columns is scratch space
+         * that is reused for every row.
+         */
+        void appendJoinedRow(const OutputRowReader<BufferType>* lhsReader, std::size_t lhsRow, const OutputRowReader<BufferType>* rhsReader, std::size_t rhsRow, std::vector<OutputRowWriter::ColumnValue>& columns, OutputRowWriter& writer) const noexcept;
+    };
+}
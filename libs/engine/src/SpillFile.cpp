@@ -0,0 +1,114 @@
+#include "SpillFile.hpp"
+#include "OutputRowReader.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+metaldb::SpillFile::SpillFile() noexcept {
+    static std::atomic<std::uint64_t> counter = 0;
+    auto filename = "metaldb-spill-" + std::to_string(getpid()) + "-" + std::to_string(counter++) + ".bin";
+    this->_path = SpillFile::Directory() / filename;
+}
+
+metaldb::SpillFile::~SpillFile() noexcept {
+    std::error_code error;
+    std::filesystem::remove(this->_path, error);
+}
+
+auto metaldb::SpillFile::Directory() noexcept -> std::filesystem::path {
+    std::error_code error;
+    auto directory = std::filesystem::temp_directory_path(error);
+    if (error) {
+        return std::filesystem::current_path();
+    }
+    return directory;
+}
+
+void metaldb::SpillFile::append(const BufferType& buffer) noexcept {
+    if (buffer.empty()) {
+        return;
+    }
+
+    std::lock_guard lock(this->_mutex);
+
+    // Files are only opened while appending, so there is no limit on the number of spill files at once.
+    std::ofstream stream(this->_path, std::ios::binary | std::ios::app);
+    if (!stream.write(buffer.data(), buffer.size())) {
+        std::cerr << "Failed to write to spill file: " << this->_path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        return;
+    }
+    this->_numBytes += buffer.size();
+    this->_numRows += OutputRowReader(buffer).NumRows();
+}
+
+void metaldb::SpillFile::forEachBuffer(const std::function<void(BufferType&)>& callback) const noexcept {
+    auto reader = Reader(*this);
+    BufferType buffer;
+    while (reader.next(buffer)) {
+        callback(buffer);
+    }
+}
+
+auto metaldb::SpillFile::readAll() const noexcept -> std::vector<BufferPtr> {
+    std::vector<BufferPtr> buffers;
+    this->forEachBuffer([&](BufferType& buffer) {
+        buffers.push_back(std::make_shared<BufferType>(std::move(buffer)));
+    });
+    return buffers;
+}
+
+auto metaldb::SpillFile::NumBytes() const noexcept -> std::size_t {
+    std::lock_guard lock(this->_mutex);
+    return this->_numBytes;
+}
+
+auto metaldb::SpillFile::NumRows() const noexcept -> std::size_t {
+    std::lock_guard lock(this->_mutex);
+    return this->_numRows;
+}
+
+auto metaldb::SpillFile::path() const noexcept -> const std::filesystem::path& {
+    return this->_path;
+}
+
+metaldb::SpillFile::Reader::Reader(const SpillFile& file) noexcept : _path(file.path()), _numBytes(file.NumBytes()) {
+    if (this->_numBytes == 0) {
+        return;
+    }
+
+    this->_stream.open(this->_path, std::ios::binary);
+    if (!this->_stream) {
+        std::cerr << "Failed to open spill file: " << this->_path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        this->_numBytes = 0;
+    }
+}
+
+auto metaldb::SpillFile::Reader::next(BufferType& buffer) noexcept -> bool {
+    if (this->_offset >= this->_numBytes) {
+        return false;
+    }
+
+    // Read up to the number of bytes, then the rest of the buffer.
+    constexpr auto sizeOfPrefix = OutputRow::NumBytesOffset + sizeof(OutputRow::NumBytesType);
+    buffer.resize(sizeOfPrefix);
+    if (!this->_stream.read(buffer.data(), sizeOfPrefix)) {
+        std::cerr << "Spill file is truncated: " << this->_path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        this->_numBytes = 0;
+        return false;
+    }
+
+    const auto numBytes = OutputRowReader<BufferType>::NumBytes(buffer);
+    buffer.resize(numBytes);
+    if (numBytes < sizeOfPrefix || !this->_stream.read(buffer.data() + sizeOfPrefix, numBytes - sizeOfPrefix)) {
+        std::cerr << "Spill file is truncated: " << this->_path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        this->_numBytes = 0;
+        return false;
+    }
+
+    this->_offset += numBytes;
+    return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * A temporary file of @b OutputRow buffers, used by operators whose state does not fit in memory.
+     *
+     * The buffers are written back to back, and are read back one at a time using the number of bytes in each header.
+     * The file is removed when the @b SpillFile is destroyed.
+     */
+    class SpillFile final {
+    public:
+        using BufferType = std::vector<char>;
+        using BufferPtr = std::shared_ptr<BufferType>;
+
+        /**
+         * Reads the buffers of a @b SpillFile back one at a time, in the order they were appended.
+         * Only the buffers appended before the reader was created are read.
+         */
+        class Reader final {
+        public:
+            Reader(const SpillFile& file) noexcept;
+
+            /**
+             * Reads the next buffer into @b buffer .  Returns false once every buffer has been read, or the file can't be read.
+             */
+            bool next(BufferType& buffer) noexcept;
+
+        private:
+            std::filesystem::path _path;
+            std::ifstream _stream;
+            std::size_t _offset = 0;
+            std::size_t _numBytes;
+        };
+
+        SpillFile() noexcept;
+
+        SpillFile(const SpillFile&) = delete;
+        SpillFile& operator=(const SpillFile&) = delete;
+
+        ~SpillFile() noexcept;
+
+        /**
+         * Returns the directory temporary files are created in.
+         */
+        static std::filesystem::path Directory() noexcept;
+
+        /**
+         * Appends an @b OutputRow buffer to the end of the file.  This can be called concurrently from multiple threads.
+         */
+        void append(const BufferType& buffer) noexcept;
+
+        /**
+         * Reads the buffers back in the order they were appended, one at a time, so only a single buffer is in memory.
+         * The callback owns the buffer it is given and may move from it.
+         */
+        void forEachBuffer(const std::function<void(BufferType&)>& callback) const noexcept;
+
+        /**
+         * Reads every buffer in the file into memory.
+         */
+        std::vector<BufferPtr> readAll() const noexcept;
+
+        /**
+         * Returns the number of bytes appended to the file.
+         */
+        std::size_t NumBytes() const noexcept;
+
+        /**
+         * Returns the number of rows in all of the buffers appended to the file.
+         */
+        std::size_t NumRows() const noexcept;
+
+        const std::filesystem::path& path() const noexcept;
+
+    private:
+        std::filesystem::path _path;
+        mutable std::mutex _mutex;
+        std::size_t _numBytes = 0;
+        std::size_t _numRows = 0;
+    };
+}
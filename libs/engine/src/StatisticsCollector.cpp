@@ -0,0 +1,130 @@
+#include "StatisticsCollector.hpp"
+
+#include "strings.h"
+
+#include <algorithm>
+#include <string_view>
+
+metaldb::StatisticsCollector::StatisticsCollector(std::vector<ColumnType> columnTypes, std::vector<std::optional<std::string>> constantValues) noexcept : _columnTypes(std::move(columnTypes)), _constantValues(std::move(constantValues)), _columns(_columnTypes.size()) {}
+
+void metaldb::StatisticsCollector::addValue(std::size_t column, const char* data, std::size_t size) noexcept {
+    auto& state = this->_columns.at(column);
+    const auto type = this->_columnTypes.at(column);
+    if (size == 0 && (type == String_opt || type == Integer_opt || type == Float_opt)) {
+        state.nullCount++;
+        return;
+    }
+    state.totalSize += size;
+
+    auto addNumber = [&](auto value) {
+        state.min = std::min(state.min.value_or(value), (double) value);
+        state.max = std::max(state.max.value_or(value), (double) value);
+
+        // Numbers are hashed by value, so different spellings of the same number are a single value.
+        HyperLogLog::Add(state.registers, reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    switch (type) {
+    case Integer:
+    case Integer_opt:
+        addNumber((types::IntegerType) metal::strings::stoi(data, size));
+        break;
+    case Float:
+    case Float_opt:
+        addNumber((types::FloatType) metal::strings::stof(data, size));
+        break;
+    case String:
+    case String_opt:
+    case Unknown: {
+        const auto value = std::string_view(data, size);
+        if (!state.minString || value < *state.minString) {
+            state.minString = value;
+        }
+        if (!state.maxString || value > *state.maxString) {
+            state.maxString = value;
+        }
+        HyperLogLog::Add(state.registers, data, size);
+        break;
+    }
+    }
+}
+
+void metaldb::StatisticsCollector::addRows(const reader::RawTable& rawTable, std::size_t startRow, std::size_t endRow) noexcept {
+    endRow = std::min<std::size_t>(endRow, rawTable.NumRows());
+    const auto numRawColumns = this->_columnTypes.size() - std::min(this->_constantValues.size(), this->_columnTypes.size());
+    for (auto row = startRow; row < endRow; ++row) {
+        const auto* start = rawTable.data.data() + rawTable.rowIndexes.at(row);
+        const auto* end = rawTable.data.data() + (row + 1 < rawTable.NumRows() ? rawTable.rowIndexes.at(row + 1) : rawTable.data.size());
+
+        // Rows have no newlines, and missing trailing columns are empty.
+        for (std::size_t column = 0; column < numRawColumns; ++column) {
+            const auto* columnEnd = std::min(std::find(start, end, ','), end);
+            auto size = (std::size_t) (columnEnd - start);
+            const auto* data = start;
+            if (size >= 2 && ((data[0] == '"' && data[size - 1] == '"') || (data[0] == '\'' && data[size - 1] == '\''))) {
+                data++;
+                size -= 2;
+            }
+            this->addValue(column, data, size);
+            start = columnEnd == end ? end : columnEnd + 1;
+        }
+
+        for (auto column = numRawColumns; column < this->_columnTypes.size(); ++column) {
+            const auto& value = this->_constantValues.at(column - numRawColumns);
+            this->addValue(column, value ? value->data() : nullptr, value ? value->size() : 0);
+        }
+        this->_numRows++;
+    }
+}
+
+void metaldb::StatisticsCollector::merge(const StatisticsCollector& other) noexcept {
+    this->_numRows += other._numRows;
+    std::string serialized;
+    for (std::size_t column = 0; column < this->_columns.size(); ++column) {
+        auto& state = this->_columns.at(column);
+        const auto& otherState = other._columns.at(column);
+        state.nullCount += otherState.nullCount;
+        state.totalSize += otherState.totalSize;
+        if (otherState.min) {
+            state.min = std::min(state.min.value_or(*otherState.min), *otherState.min);
+            state.max = std::max(state.max.value_or(*otherState.max), *otherState.max);
+        }
+        if (otherState.minString && (!state.minString || *otherState.minString < *state.minString)) {
+            state.minString = otherState.minString;
+        }
+        if (otherState.maxString && (!state.maxString || *otherState.maxString > *state.maxString)) {
+            state.maxString = otherState.maxString;
+        }
+
+        HyperLogLog::Serialize(otherState.registers, serialized);
+        HyperLogLog::Merge(state.registers, serialized.data(), serialized.size());
+    }
+}
+
+auto metaldb::StatisticsCollector::Statistics() const noexcept -> QueryEngine::FileStatistics {
+    QueryEngine::FileStatistics statistics;
+    statistics.rowCount = this->_numRows;
+    for (const auto& state : this->_columns) {
+        QueryEngine::ColumnStatistics column;
+        column.nullCount = state.nullCount;
+        column.min = state.min;
+        column.max = state.max;
+        column.minString = state.minString;
+        column.maxString = state.maxString;
+        column.distinctCount = (std::size_t) HyperLogLog::Estimate(state.registers);
+
+        const auto numValues = this->_numRows - state.nullCount;
+        column.averageSize = numValues == 0 ? 0 : (double) state.totalSize / numValues;
+        statistics.columns.push_back(column);
+    }
+    return statistics;
+}
+
+auto metaldb::StatisticsCollector::ZoneMaps() const noexcept -> std::vector<QueryEngine::ZoneMap> {
+    std::vector<QueryEngine::ZoneMap> zoneMaps;
+    zoneMaps.reserve(this->_columns.size());
+    for (const auto& state : this->_columns) {
+        zoneMaps.push_back({state.min, state.max, state.minString, state.maxString});
+    }
+    return zoneMaps;
+}
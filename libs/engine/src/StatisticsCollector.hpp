@@ -0,0 +1,70 @@
+#pragma once
+
+#include "HyperLogLog.hpp"
+
+#include "column_type.h"
+
+#include <metaldb/query_engine/statistics.hpp>
+#include <metaldb/reader/RawTable.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Collects the @b FileStatistics of a file from the rows of its @b RawTable , before they are parsed.
+     *
+     * Each chunk of rows can be collected by its own collector in parallel, and the collectors merged afterwards.  Distinct
+     * counts are estimated with a @b HyperLogLog sketch per column, so merging never needs the values themselves.  Fields
+     * are split and parsed like the ParseRow instruction does, so numbers match what the scan outputs.
+     */
+    class StatisticsCollector final {
+    public:
+        /**
+         * The number of rows collected by each chunk.
+         */
+        static constexpr std::size_t ChunkNumRows = 64 * 1024;
+
+        /**
+         * The last columns have @b constantValues on every row instead of being in the raw rows, like the partition columns
+         * of a file.  A constant without a value is null.
+         */
+        StatisticsCollector(std::vector<ColumnType> columnTypes, std::vector<std::optional<std::string>> constantValues = {}) noexcept;
+
+        /**
+         * Adds the rows in `[startRow, endRow)` of a raw table.
+         */
+        void addRows(const reader::RawTable& rawTable, std::size_t startRow, std::size_t endRow) noexcept;
+
+        /**
+         * Adds the rows collected by another collector of the same columns.
+         */
+        void merge(const StatisticsCollector& other) noexcept;
+
+        QueryEngine::FileStatistics Statistics() const noexcept;
+
+        /**
+         * The ranges of the values of each column, without the rest of the statistics.  Used for the zone maps of each chunk.
+         */
+        std::vector<QueryEngine::ZoneMap> ZoneMaps() const noexcept;
+
+    private:
+        struct ColumnState {
+            std::size_t nullCount = 0;
+            std::optional<double> min;
+            std::optional<double> max;
+            std::optional<std::string> minString;
+            std::optional<std::string> maxString;
+            std::size_t totalSize = 0;
+            HyperLogLog::Registers registers;
+        };
+
+        std::vector<ColumnType> _columnTypes;
+        std::vector<std::optional<std::string>> _constantValues;
+        std::size_t _numRows = 0;
+        std::vector<ColumnState> _columns;
+
+        void addValue(std::size_t column, const char* data, std::size_t size) noexcept;
+    };
+}
@@ -0,0 +1,118 @@
+#include "TDigest.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+    /**
+     * The k1 scale function, which limits how much weight a centroid can hold at quantile @b q .
+     * The limit shrinks towards both tails.
+     */
+    double Scale(double q, double compression) noexcept {
+        return compression / (2 * std::numbers::pi) * std::asin((2 * q) - 1);
+    }
+
+    double InverseScale(double k, double compression) noexcept {
+        return (std::sin(k * 2 * std::numbers::pi / compression) + 1) / 2;
+    }
+}
+
+auto metaldb::TDigest::Read(const char* data, std::size_t size) noexcept -> std::vector<Centroid> {
+    std::vector<Centroid> centroids(size / sizeof(Centroid));
+    std::copy_n(data, centroids.size() * sizeof(Centroid), reinterpret_cast<char*>(centroids.data()));
+    return centroids;
+}
+
+void metaldb::TDigest::Write(const std::vector<Centroid>& centroids, std::string& output) noexcept {
+    output.assign(reinterpret_cast<const char*>(centroids.data()), centroids.size() * sizeof(Centroid));
+}
+
+auto metaldb::TDigest::Compress(std::vector<Centroid> centroids, std::size_t maxCentroids) noexcept -> std::vector<Centroid> {
+    std::sort(centroids.begin(), centroids.end(), [](const Centroid& lhs, const Centroid& rhs) {
+        return lhs.mean < rhs.mean;
+    });
+
+    double totalWeight = 0;
+    for (const auto& centroid : centroids) {
+        totalWeight += centroid.weight;
+    }
+
+    // The k1 scale makes about `compression / 2` centroids, so shrink it until they fit.
+    std::vector<Centroid> output;
+    for (double compression = 2.0 * maxCentroids; centroids.size() > maxCentroids; compression *= 0.9) {
+        output.clear();
+        Centroid current = centroids.front();
+        double weightBefore = 0;
+        double limit = InverseScale(Scale(0, compression) + 1, compression);
+        for (std::size_t i = 1; i < centroids.size(); ++i) {
+            const auto& next = centroids.at(i);
+            if ((weightBefore + current.weight + next.weight) / totalWeight <= limit) {
+                const auto weight = current.weight + next.weight;
+                current.mean += (next.mean - current.mean) * (next.weight / weight);
+                current.weight = weight;
+                continue;
+            }
+
+            output.push_back(current);
+            weightBefore += current.weight;
+            limit = InverseScale(Scale(std::min(weightBefore / totalWeight, 1.0), compression) + 1, compression);
+            current = next;
+        }
+        output.push_back(current);
+
+        if (output.size() <= maxCentroids) {
+            return output;
+        }
+    }
+    return centroids;
+}
+
+void metaldb::TDigest::Add(Centroids& centroids, double value) noexcept {
+    const Centroid centroid{(float) value, 1};
+    centroids.append(reinterpret_cast<const char*>(&centroid), sizeof(centroid));
+    if (centroids.size() >= MaxBufferedCentroids * sizeof(Centroid)) {
+        Write(Compress(Read(centroids.data(), centroids.size()), MaxCentroids), centroids);
+    }
+}
+
+void metaldb::TDigest::Merge(Centroids& centroids, const char* data, std::size_t size) noexcept {
+    centroids.append(data, size - (size % sizeof(Centroid)));
+    if (centroids.size() >= MaxBufferedCentroids * sizeof(Centroid)) {
+        Write(Compress(Read(centroids.data(), centroids.size()), MaxCentroids), centroids);
+    }
+}
+
+void metaldb::TDigest::Serialize(const Centroids& centroids, std::string& output) noexcept {
+    Write(Compress(Read(centroids.data(), centroids.size()), MaxSerializedCentroids), output);
+}
+
+auto metaldb::TDigest::Quantile(const Centroids& centroids, double q) noexcept -> double {
+    auto sorted = Compress(Read(centroids.data(), centroids.size()), MaxBufferedCentroids);
+    if (sorted.empty()) {
+        return 0;
+    }
+
+    double totalWeight = 0;
+    for (const auto& centroid : sorted) {
+        totalWeight += centroid.weight;
+    }
+
+    // Each centroid's mean is at the middle of its weight, and values between them are interpolated.
+    const auto target = std::clamp(q, 0.0, 1.0) * totalWeight;
+    double weightBefore = 0;
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        const auto center = weightBefore + (sorted.at(i).weight / 2);
+        if (target <= center) {
+            if (i == 0) {
+                return sorted.at(i).mean;
+            }
+            const auto& previous = sorted.at(i - 1);
+            const auto previousCenter = weightBefore - (previous.weight / 2);
+            const auto t = (target - previousCenter) / (center - previousCenter);
+            return previous.mean + (t * (sorted.at(i).mean - previous.mean));
+        }
+        weightBefore += sorted.at(i).weight;
+    }
+    return sorted.back().mean;
+}
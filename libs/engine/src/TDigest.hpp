@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Estimates quantiles with a merging t-digest, which keeps a bounded number of weighted centroids.
+     *
+     * Centroids are kept as bytes in a @b std::string , so they can live in the state of a @b HashAggregate .  New values are
+     * buffered as centroids of weight 1, and the buffer is compressed to @b MaxCentroids once it is full.  Compression merges
+     * neighbouring centroids while they stay under a size limit that shrinks towards both tails, so extreme quantiles stay
+     * accurate.  A serialized digest is compressed to at most @b MaxSerializedCentroids centroids, so it fits in a single String
+     * column.
+     */
+    class TDigest final {
+    public:
+        using Centroids = std::string;
+
+        /**
+         * The maximum number of centroids written by @b Serialize .
+         */
+        static constexpr std::size_t MaxSerializedCentroids = 31;
+
+        /**
+         * The number of centroids kept in memory after compressing.  Compressing to more centroids than are serialized keeps
+         * merges from losing accuracy at every step.
+         */
+        static constexpr std::size_t MaxCentroids = 128;
+
+        /**
+         * The number of centroids buffered before compressing.
+         */
+        static constexpr std::size_t MaxBufferedCentroids = 2 * MaxCentroids;
+
+        static void Add(Centroids& centroids, double value) noexcept;
+
+        /**
+         * Merges a digest written by @b Serialize into @b centroids .
+         */
+        static void Merge(Centroids& centroids, const char* data, std::size_t size) noexcept;
+
+        /**
+         * Writes a compressed copy of @b centroids into @b output .
+         */
+        static void Serialize(const Centroids& centroids, std::string& output) noexcept;
+
+        /**
+         * Returns the estimated value at quantile @b q , between 0 and 1.  There must be at least one value.
+         */
+        static double Quantile(const Centroids& centroids, double q) noexcept;
+
+    private:
+        struct Centroid {
+            float mean;
+            float weight;
+        };
+
+        static std::vector<Centroid> Read(const char* data, std::size_t size) noexcept;
+
+        static void Write(const std::vector<Centroid>& centroids, std::string& output) noexcept;
+
+        /**
+         * Merges neighbouring centroids until there are at most @b maxCentroids .  The result is sorted by mean.
+         */
+        static std::vector<Centroid> Compress(std::vector<Centroid> centroids, std::size_t maxCentroids) noexcept;
+    };
+}
@@ -0,0 +1,118 @@
+#include "TopN.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+    template<typename T>
+    bool KeyLess(const T& lhs, const T& rhs) noexcept {
+        return lhs.key < rhs.key;
+    }
+}
+
+metaldb::TopN::TopN(std::vector<SortColumn> sortColumns, std::size_t limit) noexcept : _sortColumns(std::move(sortColumns)), _limit(limit) {}
+
+void metaldb::TopN::addChunk(const BufferType& buffer, std::size_t startRow, std::size_t endRow) noexcept {
+    if (buffer.empty() || this->_limit == 0) {
+        return;
+    }
+
+    auto reader = OutputRowReader(buffer);
+    endRow = std::min<std::size_t>(endRow, reader.NumRows());
+    if (startRow >= endRow) {
+        return;
+    }
+
+    // Rows that can't beat the worst row already kept by every merged chunk are discarded straight away.
+    std::string threshold;
+    bool hasThreshold = false;
+    {
+        std::lock_guard lock(this->_mutex);
+        hasThreshold = this->_heap.size() == this->_limit;
+        if (hasThreshold) {
+            threshold = this->_heap.front().key;
+        }
+    }
+
+    struct Entry {
+        std::string key;
+        std::size_t row;
+    };
+    std::vector<Entry> heap;
+    std::size_t numDiscardedRows = 0;
+    std::string key;
+    for (auto row = startRow; row < endRow; ++row) {
+        key.clear();
+        ExternalSort::AppendNormalizedKey(reader, row, this->_sortColumns, key);
+        if (hasThreshold && key >= threshold) {
+            ++numDiscardedRows;
+            continue;
+        }
+
+        if (heap.size() < this->_limit) {
+            heap.push_back({key, row});
+            std::push_heap(heap.begin(), heap.end(), KeyLess<Entry>);
+        } else if (key < heap.front().key) {
+            std::pop_heap(heap.begin(), heap.end(), KeyLess<Entry>);
+            heap.back() = {key, row};
+            std::push_heap(heap.begin(), heap.end(), KeyLess<Entry>);
+        } else {
+            ++numDiscardedRows;
+        }
+    }
+    this->_numDiscardedRows += numDiscardedRows;
+
+    // Copy the kept rows out of the chunk.
+    auto kept = std::make_shared<BufferType>();
+    {
+        OutputRowWriter writer;
+        for (const auto& entry : heap) {
+            writer.copyRow(reader, entry.row);
+        }
+        writer.write(*kept);
+    }
+
+    std::lock_guard lock(this->_mutex);
+    for (std::size_t i = 0; i < heap.size(); ++i) {
+        auto& entry = heap.at(i);
+        if (this->_heap.size() < this->_limit) {
+            this->_heap.push_back({std::move(entry.key), kept, i});
+            std::push_heap(this->_heap.begin(), this->_heap.end(), KeyLess<Candidate>);
+        } else if (entry.key < this->_heap.front().key) {
+            std::pop_heap(this->_heap.begin(), this->_heap.end(), KeyLess<Candidate>);
+            this->_heap.back() = {std::move(entry.key), kept, i};
+            std::push_heap(this->_heap.begin(), this->_heap.end(), KeyLess<Candidate>);
+        }
+    }
+}
+
+void metaldb::TopN::write(OutputRowWriter& writer) const noexcept {
+    std::lock_guard lock(this->_mutex);
+
+    std::vector<const Candidate*> sorted;
+    for (const auto& candidate : this->_heap) {
+        sorted.push_back(&candidate);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Candidate* lhs, const Candidate* rhs) {
+        return lhs->key < rhs->key;
+    });
+
+    // Candidates share the buffer of the chunk they came from, so only read each buffer once.
+    std::unordered_map<const BufferType*, OutputRowReader<BufferType>> readers;
+    for (const auto* candidate : sorted) {
+        auto it = readers.find(candidate->buffer.get());
+        if (it == readers.end()) {
+            it = readers.emplace(candidate->buffer.get(), OutputRowReader(*candidate->buffer)).first;
+        }
+        writer.copyRow(it->second, candidate->row);
+    }
+}
+
+auto metaldb::TopN::NumRows() const noexcept -> std::size_t {
+    std::lock_guard lock(this->_mutex);
+    return this->_heap.size();
+}
+
+auto metaldb::TopN::NumDiscardedRows() const noexcept -> std::size_t {
+    return this->_numDiscardedRows;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ExternalSort.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include <metaldb/query_engine/partials.hpp>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Keeps the first @b limit rows of @b OutputRow buffers in sort order, without sorting every row.
+     *
+     * Each chunk keeps its best rows in a bounded heap, and only those rows are copied out of the chunk.  The heaps of every
+     * chunk are merged into a single heap, whose worst key is the threshold a row must beat to make the cut.  Chunks read the
+     * threshold before they start, so once the first chunks are merged most rows of later chunks are discarded after
+     * building their key.
+     *
+     * Rows are compared by the same normalized key as @b ExternalSort .  Without any sort columns every key is equal, so this
+     * keeps the first @b limit rows it sees.
+     */
+    class TopN final {
+    public:
+        using BufferType = ExternalSort::BufferType;
+        using BufferPtr = ExternalSort::BufferPtr;
+        using SortColumn = ExternalSort::SortColumn;
+
+        /**
+         * The number of rows in each chunk with its own heap.
+         */
+        static constexpr std::size_t ChunkNumRows = ExternalSort::ChunkNumRows;
+
+        TopN(std::vector<SortColumn> sortColumns, std::size_t limit) noexcept;
+
+        /**
+         * Adds the rows in `[startRow, endRow)` of a buffer.  This can be called concurrently from multiple threads.
+         */
+        void addChunk(const BufferType& buffer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) noexcept;
+
+        /**
+         * Writes the kept rows into @b writer , in sorted order.
+         */
+        void write(OutputRowWriter& writer) const noexcept;
+
+        std::size_t NumRows() const noexcept;
+
+        /**
+         * The number of rows that were discarded because they could not beat the threshold, without being pushed onto a heap.
+         */
+        std::size_t NumDiscardedRows() const noexcept;
+
+    private:
+        struct Candidate {
+            std::string key;
+
+            // The rows kept by a chunk are copied into a buffer of their own, so the chunk doesn't need to stay alive.
+            BufferPtr buffer;
+            std::size_t row;
+        };
+
+        std::vector<SortColumn> _sortColumns;
+        std::size_t _limit;
+
+        mutable std::mutex _mutex;
+
+        // A max heap by key, so the worst kept row is at the front.
+        std::vector<Candidate> _heap;
+
+        std::atomic<std::size_t> _numDiscardedRows = 0;
+    };
+}
@@ -0,0 +1,251 @@
+#include "WindowEvaluator.hpp"
+#include "ExternalSort.hpp"
+#include "JoinHashTable.hpp"
+
+#include <algorithm>
+
+namespace {
+    /**
+     * Returns the nullable version of a column type.  The nullable type is always one more.
+     */
+    metaldb::ColumnType NullableColumnType(metaldb::ColumnType type) noexcept {
+        switch (type) {
+        case metaldb::String:
+        case metaldb::Float:
+        case metaldb::Integer:
+            return (metaldb::ColumnType) (type + 1);
+        case metaldb::String_opt:
+        case metaldb::Float_opt:
+        case metaldb::Integer_opt:
+        case metaldb::Unknown:
+            return type;
+        }
+    }
+
+    bool IsIntegerColumnType(metaldb::ColumnType type) noexcept {
+        return type == metaldb::Integer || type == metaldb::Integer_opt;
+    }
+}
+
+metaldb::WindowEvaluator::WindowEvaluator(std::vector<ColumnType> inputColumnTypes, std::vector<ColumnIndexType> partitionColumns, std::vector<SortColumn> sortColumns, std::vector<WindowFunction> functions) noexcept : _inputColumnTypes(std::move(inputColumnTypes)), _partitionColumns(std::move(partitionColumns)), _sortColumns(std::move(sortColumns)), _functions(std::move(functions)) {}
+
+auto metaldb::WindowEvaluator::FunctionType(const WindowFunction& function) const noexcept -> ColumnType {
+    switch (function.function) {
+    case Function::ROW_NUMBER:
+    case Function::RANK:
+        return Integer;
+    case Function::SUM: {
+        // The sum is null until the first value that isn't null.
+        const auto inputType = this->_inputColumnTypes.at(*function.column);
+        const auto baseType = IsIntegerColumnType(inputType) ? Integer : Float;
+        return inputType == NullableColumnType(inputType) ? NullableColumnType(baseType) : baseType;
+    }
+    case Function::LAG:
+    case Function::LEAD:
+        // The first or last rows of a partition have no row at the offset.
+        return NullableColumnType(this->_inputColumnTypes.at(*function.column));
+    }
+}
+
+auto metaldb::WindowEvaluator::OutputColumnTypes() const noexcept -> std::vector<ColumnType> {
+    auto columnTypes = this->_inputColumnTypes;
+    for (const auto& function : this->_functions) {
+        columnTypes.push_back(this->FunctionType(function));
+    }
+    return columnTypes;
+}
+
+auto metaldb::WindowEvaluator::NumRows(std::size_t bucket) const noexcept -> std::size_t {
+    std::lock_guard lock(this->_mutex);
+    std::size_t numRows = 0;
+    for (const auto& buffer : this->_buckets.at(bucket)) {
+        numRows += OutputRowReader(*buffer).NumRows();
+    }
+    return numRows;
+}
+
+void metaldb::WindowEvaluator::addChunk(const BufferType& buffer, std::size_t startRow, std::size_t endRow) noexcept {
+    if (buffer.empty()) {
+        return;
+    }
+
+    auto reader = OutputRowReader(buffer);
+    endRow = std::min<std::size_t>(endRow, reader.NumRows());
+
+    std::array<std::unique_ptr<OutputRowWriter>, NumBuckets> writers;
+    std::vector<char> key;
+    for (auto row = startRow; row < endRow; ++row) {
+        key.clear();
+        for (const auto& column : this->_partitionColumns) {
+            auto [data, size] = reader.ColumnData(column, row);
+            key.push_back((char) size);
+            key.insert(key.end(), data, data + size);
+        }
+
+        // Without partition columns every row is in the first bucket.
+        const auto bucket = this->_partitionColumns.empty() ? 0 : JoinHashTable::Hash(key.data(), key.size()) % NumBuckets;
+        auto& writer = writers.at(bucket);
+        if (!writer) {
+            writer = std::make_unique<OutputRowWriter>();
+        }
+        writer->copyRow(reader, row);
+    }
+
+    std::lock_guard lock(this->_mutex);
+    for (std::size_t bucket = 0; bucket < NumBuckets; ++bucket) {
+        if (writers.at(bucket)) {
+            auto output = std::make_shared<BufferType>();
+            writers.at(bucket)->write(*output);
+            this->_buckets.at(bucket).push_back(std::move(output));
+        }
+    }
+}
+
+void metaldb::WindowEvaluator::evaluateBucket(std::size_t bucket, OutputRowWriter& writer) const noexcept {
+    std::vector<BufferPtr> buffers;
+    {
+        std::lock_guard lock(this->_mutex);
+        buffers = this->_buckets.at(bucket);
+    }
+    if (buffers.empty()) {
+        return;
+    }
+
+    BufferType rows;
+    {
+        OutputRowWriter rowsWriter;
+        for (const auto& buffer : buffers) {
+            auto reader = OutputRowReader(*buffer);
+            for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+                rowsWriter.copyRow(reader, row);
+            }
+        }
+        rowsWriter.write(rows);
+    }
+    buffers.clear();
+
+    // Sorting by the partition columns first keeps the rows of each partition together.
+    auto reader = OutputRowReader(rows);
+    const auto numRows = reader.NumRows();
+    std::vector<SortColumn> partitionSortColumns;
+    for (const auto& column : this->_partitionColumns) {
+        partitionSortColumns.push_back({column, true});
+    }
+    auto sortColumns = partitionSortColumns;
+    sortColumns.insert(sortColumns.end(), this->_sortColumns.begin(), this->_sortColumns.end());
+    const auto order = ExternalSort::SortedOrder(reader, 0, numRows, sortColumns);
+
+    const bool hasRank = std::any_of(this->_functions.begin(), this->_functions.end(), [](const WindowFunction& function) {
+        return function.function == Function::RANK;
+    });
+
+    struct State {
+        types::IntegerType integer = 0;
+        double floating = 0;
+        bool hasValue = false;
+    };
+    std::vector<State> states(this->_functions.size());
+
+    using Scratch = std::array<char, sizeof(types::IntegerType)>;
+    static_assert(sizeof(types::FloatType) <= sizeof(Scratch));
+    std::vector<Scratch> scratch(this->_functions.size());
+    std::vector<OutputRowWriter::ColumnValue> columns;
+
+    std::string partitionKey;
+    std::string nextPartitionKey;
+    std::string orderKey;
+    std::string previousOrderKey;
+
+    std::size_t partitionEnd = 0;
+    if (numRows > 0) {
+        ExternalSort::AppendNormalizedKey(reader, order.at(0), partitionSortColumns, nextPartitionKey);
+    }
+    for (std::size_t partitionStart = 0; partitionStart < numRows; partitionStart = partitionEnd) {
+        // Find where the partition ends, so `LEAD` knows how far it can read.
+        std::swap(partitionKey, nextPartitionKey);
+        for (partitionEnd = partitionStart + 1; partitionEnd < numRows; ++partitionEnd) {
+            nextPartitionKey.clear();
+            ExternalSort::AppendNormalizedKey(reader, order.at(partitionEnd), partitionSortColumns, nextPartitionKey);
+            if (nextPartitionKey != partitionKey) {
+                break;
+            }
+        }
+
+        std::fill(states.begin(), states.end(), State());
+        types::IntegerType rank = 0;
+        for (auto i = partitionStart; i < partitionEnd; ++i) {
+            const auto row = order.at(i);
+            const auto rowNumber = (types::IntegerType) (i - partitionStart + 1);
+            if (hasRank) {
+                // Rows with equal order columns share the rank of the first of them.
+                std::swap(orderKey, previousOrderKey);
+                orderKey.clear();
+                ExternalSort::AppendNormalizedKey(reader, row, this->_sortColumns, orderKey);
+                if (i == partitionStart || orderKey != previousOrderKey) {
+                    rank = rowNumber;
+                }
+            }
+
+            columns.clear();
+            for (std::size_t column = 0; column < this->_inputColumnTypes.size(); ++column) {
+                auto [data, size] = reader.ColumnData(column, row);
+                columns.push_back({data, (OutputRow::ColumnSizeType) size});
+            }
+
+            for (std::size_t f = 0; f < this->_functions.size(); ++f) {
+                const auto& function = this->_functions.at(f);
+                auto& state = states.at(f);
+                auto writeValue = [&](auto value) {
+                    auto& bytes = scratch.at(f);
+                    std::copy_n(reinterpret_cast<const char*>(&value), sizeof(value), bytes.data());
+                    columns.push_back({bytes.data(), (OutputRow::ColumnSizeType) sizeof(value)});
+                };
+
+                switch (function.function) {
+                case Function::ROW_NUMBER:
+                    writeValue(rowNumber);
+                    break;
+                case Function::RANK:
+                    writeValue(rank);
+                    break;
+                case Function::SUM: {
+                    const bool isInteger = IsIntegerColumnType(this->_inputColumnTypes.at(*function.column));
+                    auto [data, size] = reader.ColumnData(*function.column, row);
+                    if (size > 0) {
+                        if (isInteger) {
+                            state.integer += ReadBytesStartingAt<types::IntegerType>(data);
+                        } else {
+                            state.floating += ReadBytesStartingAt<types::FloatType>(data);
+                        }
+                        state.hasValue = true;
+                    }
+
+                    if (!state.hasValue) {
+                        columns.emplace_back();
+                    } else if (isInteger) {
+                        writeValue(state.integer);
+                    } else {
+                        writeValue((types::FloatType) state.floating);
+                    }
+                    break;
+                }
+                case Function::LAG:
+                case Function::LEAD: {
+                    const bool isLag = function.function == Function::LAG;
+                    const bool inPartition = isLag ? i - partitionStart >= function.offset : partitionEnd - i > function.offset;
+                    if (!inPartition) {
+                        columns.emplace_back();
+                        break;
+                    }
+                    const auto otherRow = order.at(isLag ? i - function.offset : i + function.offset);
+                    auto [data, size] = reader.ColumnData(*function.column, otherRow);
+                    columns.push_back({data, (OutputRow::ColumnSizeType) size});
+                    break;
+                }
+                }
+            }
+
+            writer.appendRow(columns);
+        }
+    }
+}
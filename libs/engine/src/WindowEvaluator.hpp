@@ -0,0 +1,76 @@
+#pragma once
+
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include <metaldb/query_engine/partials.hpp>
+
+#include <array>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace metaldb {
+    /**
+     * Evaluates window functions over `PARTITION BY ... ORDER BY ...`, appending a column for each function to every row.
+     *
+     * @b addChunk splits rows into buckets by the hash of their partition columns, so every partition is in a single bucket.
+     * @b evaluateBucket sorts a bucket by its partition and order columns, then walks it once.  Every function does constant
+     * work per row: running sums and ranks carry over from the previous row, and `LAG`/`LEAD` read a row at a fixed offset.
+     *
+     * The running sum is over the rows from the start of the partition up to the current row, so rows with equal order
+     * columns get different sums.
+     */
+    class WindowEvaluator final {
+    public:
+        using BufferType = std::vector<char>;
+        using BufferPtr = std::shared_ptr<BufferType>;
+        using Function = QueryEngine::WindowPartial::Function;
+        using WindowFunction = QueryEngine::WindowPartial::WindowFunction;
+        using SortColumn = QueryEngine::WindowPartial::SortColumn;
+        using ColumnIndexType = QueryEngine::WindowPartial::ColumnIndexType;
+
+        /**
+         * The number of rows bucketed by each call to @b addChunk .
+         */
+        static constexpr std::size_t ChunkNumRows = 64 * 1024;
+
+        /**
+         * The number of buckets, which bounds how many partitions are evaluated in parallel.
+         */
+        static constexpr std::size_t NumBuckets = 64;
+
+        WindowEvaluator(std::vector<ColumnType> inputColumnTypes, std::vector<ColumnIndexType> partitionColumns, std::vector<SortColumn> sortColumns, std::vector<WindowFunction> functions) noexcept;
+
+        /**
+         * Returns the input columns followed by a column for each function.
+         */
+        std::vector<ColumnType> OutputColumnTypes() const noexcept;
+
+        /**
+         * Splits the rows in `[startRow, endRow)` of a buffer into buckets.  This can be called concurrently from multiple threads.
+         */
+        void addChunk(const BufferType& buffer, std::size_t startRow = 0, std::size_t endRow = std::numeric_limits<std::size_t>::max()) noexcept;
+
+        /**
+         * Writes the rows of a bucket with their function columns, sorted by partition and order columns.  Different buckets
+         * can be evaluated concurrently, once every chunk has been added.
+         */
+        void evaluateBucket(std::size_t bucket, OutputRowWriter& writer) const noexcept;
+
+        std::size_t NumRows(std::size_t bucket) const noexcept;
+
+    private:
+        std::vector<ColumnType> _inputColumnTypes;
+        std::vector<ColumnIndexType> _partitionColumns;
+        std::vector<SortColumn> _sortColumns;
+        std::vector<WindowFunction> _functions;
+
+        // Each chunk writes its own buffer for every bucket it has rows for.
+        mutable std::mutex _mutex;
+        std::array<std::vector<BufferPtr>, NumBuckets> _buckets;
+
+        ColumnType FunctionType(const WindowFunction& function) const noexcept;
+    };
+}
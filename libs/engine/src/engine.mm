@@ -1,15 +1,25 @@
 #include <metaldb/engine/Engine.hpp>
+#include <metaldb/query_engine/catalog.hpp>
 #include <metaldb/query_engine/query_engine.hpp>
 #include <metaldb/query_engine/parser.hpp>
+#include <metaldb/query_engine/schema_inference.hpp>
 
 #include "engine.h"
 #include "Scheduler.hpp"
 
+#include <filesystem>
+#include <vector>
+
 auto metaldb::engine::Engine::runImpl() -> Dataframe {
     QueryEngine::Parser parser;
     QueryEngine::QueryEngine query;
-    auto parseAst = parser.Parse("eg query.");
-    {
+
+    // The catalog has the tables, the files in them and their statistics from previous runs.
+    const std::string catalogPath = "../../datasets/metaldb.catalog";
+    QueryEngine::Catalog::Read(catalogPath, query.metadata);
+
+    // Tables that aren't in the catalog yet.
+    if (!query.metadata.getTable("taxi")) {
         QueryEngine::TableDefinition taxiTable;
         taxiTable.name = "taxi";
         taxiTable.filePath = "../../datasets/taxi";
@@ -35,13 +45,13 @@ auto metaldb::engine::Engine::runImpl() -> Dataframe {
             taxiTable.columns.emplace_back("trip_type",                 ColumnType::Float);
             taxiTable.columns.emplace_back("congestion_surcharge",      ColumnType::Float);
         }
-        query.metadata.tables.push_back(taxiTable);
+        query.metadata.addTable(taxiTable);
 
         taxiTable.name = "taxi_sample";
         taxiTable.filePath = "../../datasets/taxi_sample";
-        query.metadata.tables.push_back(std::move(taxiTable));
+        query.metadata.addTable(std::move(taxiTable));
     }
-    {
+    if (!query.metadata.getTable("iris")) {
         QueryEngine::TableDefinition irisTable;
         irisTable.name = "iris";
         irisTable.filePath = "../../datasets/iris";
@@ -52,9 +62,28 @@ auto metaldb::engine::Engine::runImpl() -> Dataframe {
             irisTable.columns.emplace_back("petal.width",       ColumnType::Float);
             irisTable.columns.emplace_back("variety",       10, ColumnType::String);
         }
-        query.metadata.tables.push_back(std::move(irisTable));
+        query.metadata.addTable(std::move(irisTable));
+    }
+
+    // Every other directory of datasets is a table, with its schema inferred from a sample of its files.
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("../../datasets", error)) {
+        const auto name = entry.path().filename().string();
+        if (entry.is_directory(error) && !query.metadata.getTable(name)) {
+            QueryEngine::SchemaInference::Register(name, entry.path().string(), query.metadata);
+        }
+    }
+
+    // The constants of the query are bound to the statement, so the same query with other constants reuses its parse.
+    std::vector<QueryEngine::AST::Parameter::Value> arguments;
+    auto statement = query.prepare(parser, "SELECT lpep_pickup_datetime AS pickup, lpep_dropoff_datetime AS dropoff INTO 'output' FROM taxi_sample", arguments);
+    if (!statement->expr) {
+        return Dataframe();
+    }
+    auto plan = query.compile(*statement, arguments);
+    if (plan.stages.empty()) {
+        return Dataframe();
     }
-    auto plan = query.compile(parseAst);
 
     // Use 1 thread for now
     // Could easily expand to multiple in the future
@@ -62,6 +91,8 @@ auto metaldb::engine::Engine::runImpl() -> Dataframe {
     auto taskflow = Scheduler::schedule(plan);
     auto future = executor.run(taskflow);
     future.wait();
+    query.recordStatistics(plan);
+    QueryEngine::Catalog::Write(catalogPath, query.metadata);
 
     return Dataframe();
 }
@@ -0,0 +1,140 @@
+#include <cpptest/cpptest.hpp>
+#include <metaldb/engine/Instructions.hpp>
+
+#include "OutputRowReader.hpp"
+
+static metaldb::TempRow GenerateTempRow(std::size_t i) {
+    metaldb::TempRow::TempRowBuilder builder;
+    builder.numColumns = 2;
+    builder.columnTypes[0] = metaldb::ColumnType::Integer;
+    builder.columnTypes[1] = metaldb::ColumnType::Float_opt;
+
+    // Every third row has a null float.
+    const bool isNull = i % 3 == 2;
+    builder.columnSizes[1] = isNull ? 0 : sizeof(metaldb::types::FloatType);
+
+    metaldb::TempRow tempRow = builder;
+    tempRow.Append((metaldb::types::IntegerType) i);
+    if (!isNull) {
+        tempRow.Append((metaldb::types::FloatType) i);
+    }
+    return tempRow;
+}
+
+class AggregateInstructionTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(AggregateInstructionTest)
+
+NEW_TEST(AggregateInstructionTest, SerializeAggregateInstruction) {
+    using namespace metaldb;
+    using namespace metaldb::engine;
+    Aggregate aggregate({{AggregateInstruction::COUNT_ALL}, {AggregateInstruction::SUM, 1}, {AggregateInstruction::MAX, 1}});
+
+    Encoder encoder;
+    encoder.encode(aggregate);
+    auto buffer = encoder.data();
+
+    CPPTEST_ASSERT(buffer.size() > 2);
+    CPPTEST_ASSERT(buffer.at(0) == 1); // Size.
+    CPPTEST_ASSERT((InstructionType) buffer.at(1) == InstructionType::AGGREGATE);
+
+    AggregateInstruction aggregateInst = &buffer.at(2);
+    CPPTEST_ASSERT(aggregateInst.NumAggregations() == 3);
+    {
+        CPPTEST_ASSERT(aggregateInst.GetFunction(0) == AggregateInstruction::COUNT_ALL);
+        CPPTEST_ASSERT(aggregateInst.GetFunction(1) == AggregateInstruction::SUM);
+        CPPTEST_ASSERT(aggregateInst.GetColumnIndex(1) == 1);
+        CPPTEST_ASSERT(aggregateInst.GetFunction(2) == AggregateInstruction::MAX);
+        CPPTEST_ASSERT(aggregateInst.GetColumnIndex(2) == 1);
+    }
+    CPPTEST_ASSERT((std::size_t) (aggregateInst.End() - &buffer.at(0)) == buffer.size());
+
+    auto* input = &buffer.at(2);
+    CPPTEST_ASSERT(Aggregate::deserialize(&input) == aggregate);
+    CPPTEST_ASSERT((std::size_t) (input - &buffer.at(0)) == buffer.size());
+}
+
+NEW_TEST(AggregateInstructionTest, ReduceChunkToSingleRow) {
+    using namespace metaldb;
+    using namespace metaldb::engine;
+    Aggregate aggregate({{AggregateInstruction::COUNT_ALL}, {AggregateInstruction::COUNT, 1}, {AggregateInstruction::SUM, 1}, {AggregateInstruction::MIN, 1}, {AggregateInstruction::MAX, 1}, {AggregateInstruction::AVG, 1}});
+
+    Encoder encoder;
+    encoder.encode(aggregate);
+    auto buffer = encoder.data();
+    AggregateInstruction aggregateInst = &buffer.at(2);
+    OutputInstruction outputInst = nullptr;
+
+    std::array<metaldb::OutputSerializedValue, 1000> output{0};
+    std::array<metaldb::OutputRow::NumBytesType, DbConstants::MAX_NUM_ROWS> scratch{0};
+    metaldb::RawTable rawTable(nullptr);
+    metaldb::DbConstants constants{rawTable, output.data(), scratch.data()};
+
+    constexpr std::size_t numRows = 10;
+    for (std::size_t i = 0; i < numRows; ++i) {
+        constants.thread_position_in_threadgroup = i;
+        auto tempRow = GenerateTempRow(i);
+        if (i == 4) {
+            // Removed by a filter.
+            tempRow = TempRow();
+        }
+        auto aggregateRow = aggregateInst.GetRow(tempRow, constants);
+        outputInst.WriteRow(aggregateRow, constants);
+    }
+
+    // Values 0, 1, 3, 6, 7, 9 are included.
+    auto reader = metaldb::OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 1);
+    CPPTEST_ASSERT(reader.NumColumns() == 7);
+    {
+        CPPTEST_ASSERT(reader.TypeOfColumn(0) == ColumnType::Integer);
+        CPPTEST_ASSERT(reader.TypeOfColumn(2) == ColumnType::Float_opt);
+        CPPTEST_ASSERT(reader.TypeOfColumn(5) == ColumnType::Float);
+        CPPTEST_ASSERT(reader.TypeOfColumn(6) == ColumnType::Integer);
+    }
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(0, 0).first) == 9);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(1, 0).first) == 6);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(reader.ColumnData(2, 0).first) == 26);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(reader.ColumnData(3, 0).first) == 0);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(reader.ColumnData(4, 0).first) == 9);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(reader.ColumnData(5, 0).first) == 26);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(6, 0).first) == 6);
+}
+
+NEW_TEST(AggregateInstructionTest, NoValuesIsNull) {
+    using namespace metaldb;
+    using namespace metaldb::engine;
+    Aggregate aggregate({{AggregateInstruction::COUNT, 1}, {AggregateInstruction::MIN, 1}});
+
+    Encoder encoder;
+    encoder.encode(aggregate);
+    auto buffer = encoder.data();
+    AggregateInstruction aggregateInst = &buffer.at(2);
+    OutputInstruction outputInst = nullptr;
+
+    std::array<metaldb::OutputSerializedValue, 1000> output{0};
+    std::array<metaldb::OutputRow::NumBytesType, DbConstants::MAX_NUM_ROWS> scratch{0};
+    metaldb::RawTable rawTable(nullptr);
+    metaldb::DbConstants constants{rawTable, output.data(), scratch.data()};
+
+    constants.thread_position_in_threadgroup = 0;
+    auto tempRow = GenerateTempRow(2);
+    auto aggregateRow = aggregateInst.GetRow(tempRow, constants);
+    outputInst.WriteRow(aggregateRow, constants);
+
+    auto reader = metaldb::OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 1);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(0, 0).first) == 0);
+    CPPTEST_ASSERT(reader.ColumnData(1, 0).second == 0);
+}
+
+CPPTEST_END_CLASS(AggregateInstructionTest)
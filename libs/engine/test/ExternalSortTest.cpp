@@ -0,0 +1,205 @@
+#include <cpptest/cpptest.hpp>
+
+#include "ExternalSort.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include "temp_row.h"
+
+#include <metaldb/query_engine/metadata.hpp>
+
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace {
+    struct Row {
+        metaldb::types::IntegerType key;
+        std::optional<metaldb::types::FloatType> value;
+    };
+
+    std::vector<char> GenerateBuffer(const std::vector<Row>& rows) {
+        metaldb::OutputRowWriter writer;
+        for (const auto& row : rows) {
+            metaldb::TempRow::TempRowBuilder builder;
+            builder.numColumns = 2;
+            builder.columnTypes[0] = metaldb::ColumnType::Integer;
+            builder.columnTypes[1] = metaldb::ColumnType::Float_opt;
+            builder.columnSizes[1] = row.value ? sizeof(metaldb::types::FloatType) : 0;
+
+            metaldb::TempRow tempRow = builder;
+            tempRow.Append(row.key);
+            if (row.value) {
+                tempRow.Append(*row.value);
+            }
+            writer.appendTempRow(tempRow);
+        }
+
+        std::vector<char> buffer;
+        writer.write(buffer);
+        return buffer;
+    }
+
+    std::vector<Row> ReadBuffer(const std::vector<char>& buffer) {
+        std::vector<Row> rows;
+        auto reader = metaldb::OutputRowReader(buffer);
+        for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+            Row row{metaldb::ReadBytesStartingAt<metaldb::types::IntegerType>(reader.ColumnData(0, i).first), std::nullopt};
+            auto [data, size] = reader.ColumnData(1, i);
+            if (size > 0) {
+                row.value = metaldb::ReadBytesStartingAt<metaldb::types::FloatType>(data);
+            }
+            rows.push_back(row);
+        }
+        return rows;
+    }
+
+    std::vector<Row> GenerateRows(std::size_t numRows) {
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<metaldb::types::IntegerType> keys(-50, 50);
+        std::uniform_real_distribution<metaldb::types::FloatType> values(-1000, 1000);
+
+        std::vector<Row> rows;
+        for (std::size_t i = 0; i < numRows; ++i) {
+            const bool isNull = i % 7 == 0;
+            rows.push_back({keys(generator), isNull ? std::nullopt : std::optional(values(generator))});
+        }
+        return rows;
+    }
+
+    std::vector<Row> Sort(const std::vector<char>& buffer, std::vector<metaldb::ExternalSort::SortColumn> sortColumns, std::size_t memoryBudget, std::size_t runNumRows, std::size_t* numSpilledRuns = nullptr) {
+        metaldb::ExternalSort sort(std::move(sortColumns), memoryBudget);
+        const auto numRows = metaldb::OutputRowReader(buffer).NumRows();
+        for (std::size_t startRow = 0; startRow < numRows; startRow += runNumRows) {
+            sort.addRun(buffer, startRow, startRow + runNumRows);
+        }
+        if (numSpilledRuns) {
+            *numSpilledRuns = sort.NumSpilledRuns();
+        }
+
+        metaldb::OutputRowWriter writer;
+        sort.merge(writer);
+
+        std::vector<char> output;
+        writer.write(output);
+        return ReadBuffer(output);
+    }
+
+    // Nulls are last in ascending order.
+    bool ValueLess(const std::optional<metaldb::types::FloatType>& lhs, const std::optional<metaldb::types::FloatType>& rhs) {
+        if (!lhs || !rhs) {
+            return lhs.has_value() && !rhs.has_value();
+        }
+        return *lhs < *rhs;
+    }
+}
+
+class ExternalSortTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(ExternalSortTest)
+
+NEW_TEST(ExternalSortTest, NormalizedKeysCompareLikeValues) {
+    using namespace metaldb;
+    auto buffer = GenerateBuffer({{-5, -2.5f}, {3, 0.5f}, {-1, std::nullopt}, {3, -10.0f}});
+    auto reader = OutputRowReader(buffer);
+
+    auto keyOf = [&](std::size_t row, std::vector<ExternalSort::SortColumn> sortColumns) {
+        std::string key;
+        ExternalSort::AppendNormalizedKey(reader, row, sortColumns, key);
+        return key;
+    };
+
+    // Integers, including negative numbers.
+    CPPTEST_ASSERT(keyOf(0, {{0}}) < keyOf(2, {{0}}));
+    CPPTEST_ASSERT(keyOf(2, {{0}}) < keyOf(1, {{0}}));
+
+    // Floats, with nulls last.
+    CPPTEST_ASSERT(keyOf(3, {{1}}) < keyOf(0, {{1}}));
+    CPPTEST_ASSERT(keyOf(0, {{1}}) < keyOf(1, {{1}}));
+    CPPTEST_ASSERT(keyOf(1, {{1}}) < keyOf(2, {{1}}));
+
+    // Descending reverses the order, with nulls first.
+    CPPTEST_ASSERT(keyOf(2, {{1, false}}) < keyOf(1, {{1, false}}));
+    CPPTEST_ASSERT(keyOf(1, {{1, false}}) < keyOf(0, {{1, false}}));
+
+    // Ties on the first column are broken by the second.
+    CPPTEST_ASSERT(keyOf(3, {{0}, {1}}) < keyOf(1, {{0}, {1}}));
+}
+
+NEW_TEST(ExternalSortTest, MergeRuns) {
+    using namespace metaldb;
+    auto rows = GenerateRows(1000);
+    auto buffer = GenerateBuffer(rows);
+
+    // 7 runs, which is not a power of 2.
+    auto sorted = Sort(buffer, {{0, true}, {1, false}}, QueryEngine::Metadata::DefaultMemoryBudget, 150);
+    CPPTEST_ASSERT(sorted.size() == rows.size());
+    for (std::size_t i = 1; i < sorted.size(); ++i) {
+        const auto& previous = sorted.at(i - 1);
+        const auto& current = sorted.at(i);
+        CPPTEST_ASSERT(previous.key <= current.key);
+        if (previous.key == current.key) {
+            CPPTEST_ASSERT(!ValueLess(previous.value, current.value));
+        }
+    }
+}
+
+NEW_TEST(ExternalSortTest, SpillRunsOverBudget) {
+    using namespace metaldb;
+    auto rows = GenerateRows(20'000);
+    auto buffer = GenerateBuffer(rows);
+
+    std::size_t numSpilledRuns = 0;
+    auto inMemory = Sort(buffer, {{1, true}}, QueryEngine::Metadata::DefaultMemoryBudget, 5000, &numSpilledRuns);
+    CPPTEST_ASSERT(numSpilledRuns == 0);
+
+    // Only the first run fits, so the others are spilled in multiple blocks.
+    auto spilled = Sort(buffer, {{1, true}}, buffer.size() / 3, 5000, &numSpilledRuns);
+    CPPTEST_ASSERT(numSpilledRuns == 3);
+
+    CPPTEST_ASSERT(spilled.size() == rows.size());
+    CPPTEST_ASSERT(inMemory.size() == spilled.size());
+    for (std::size_t i = 0; i < spilled.size(); ++i) {
+        CPPTEST_ASSERT(inMemory.at(i).value == spilled.at(i).value);
+        if (i > 0) {
+            CPPTEST_ASSERT(!ValueLess(spilled.at(i).value, spilled.at(i - 1).value));
+        }
+    }
+}
+
+NEW_TEST(ExternalSortTest, MergeInChunks) {
+    using namespace metaldb;
+    const auto numRows = ExternalSort::ChunkNumRows + 1000;
+    auto buffer = GenerateBuffer(GenerateRows(numRows));
+
+    ExternalSort sort({{0, true}}, QueryEngine::Metadata::DefaultMemoryBudget);
+    for (std::size_t startRow = 0; startRow < numRows; startRow += ExternalSort::ChunkNumRows) {
+        sort.addRun(buffer, startRow, startRow + ExternalSort::ChunkNumRows);
+    }
+
+    // The rows stay in sorted order across chunks.
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = OutputRowReader(buffer).ColumnTypes();
+    std::vector<std::size_t> chunkNumRows;
+    std::optional<types::IntegerType> previous;
+    sort.merge(builder, [&](std::vector<char>& chunk) {
+        auto rows = ReadBuffer(chunk);
+        chunkNumRows.push_back(rows.size());
+        for (const auto& row : rows) {
+            CPPTEST_ASSERT(!previous || *previous <= row.key);
+            previous = row.key;
+        }
+    });
+    CPPTEST_ASSERT((chunkNumRows == std::vector<std::size_t>{ExternalSort::ChunkNumRows, 1000}));
+}
+
+CPPTEST_END_CLASS(ExternalSortTest)
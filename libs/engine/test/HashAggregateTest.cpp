@@ -0,0 +1,271 @@
+#include <cpptest/cpptest.hpp>
+
+#include "HashAggregate.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include "temp_row.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+static std::vector<char> GenerateBuffer(const std::vector<std::pair<metaldb::types::IntegerType, metaldb::types::FloatType>>& rows) {
+    metaldb::OutputRowWriter writer;
+    for (const auto& [key, value] : rows) {
+        metaldb::TempRow::TempRowBuilder builder;
+        builder.numColumns = 2;
+        builder.columnTypes[0] = metaldb::ColumnType::Integer;
+        builder.columnTypes[1] = metaldb::ColumnType::Float;
+
+        metaldb::TempRow tempRow = builder;
+        tempRow.Append(key);
+        tempRow.Append(value);
+        writer.appendTempRow(tempRow);
+    }
+
+    std::vector<char> buffer;
+    writer.write(buffer);
+    return buffer;
+}
+
+static std::vector<metaldb::HashAggregate::Aggregation> AllAggregations() {
+    using Function = metaldb::HashAggregate::Function;
+    return {
+        {Function::COUNT, std::nullopt},
+        {Function::SUM, 1},
+        {Function::MIN, 1},
+        {Function::MAX, 1},
+        {Function::AVG, 1},
+    };
+}
+
+class HashAggregateTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(HashAggregateTest)
+
+NEW_TEST(HashAggregateTest, GroupBy) {
+    using namespace metaldb;
+    auto buffer = GenerateBuffer({{1, 1.f}, {2, 10.f}, {1, 3.f}, {2, 30.f}, {3, 5.f}});
+
+    HashAggregate aggregate({Integer, Float}, {0}, AllAggregations());
+    aggregate.update(buffer);
+    CPPTEST_ASSERT(aggregate.NumGroups() == 3);
+
+    auto columnTypes = aggregate.FinalColumnTypes();
+    CPPTEST_ASSERT(columnTypes.size() == 6);
+    CPPTEST_ASSERT(columnTypes.at(1) == Integer);
+    CPPTEST_ASSERT(columnTypes.at(2) == Float);
+    CPPTEST_ASSERT(columnTypes.at(5) == Float);
+
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = columnTypes;
+    OutputRowWriter writer(builder);
+    aggregate.writeFinal(writer);
+
+    std::vector<char> output;
+    writer.write(output);
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 3);
+
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        auto key = ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(0, row).first);
+        auto count = ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(1, row).first);
+        auto sum = ReadBytesStartingAt<types::FloatType>(reader.ColumnData(2, row).first);
+        auto min = ReadBytesStartingAt<types::FloatType>(reader.ColumnData(3, row).first);
+        auto max = ReadBytesStartingAt<types::FloatType>(reader.ColumnData(4, row).first);
+        auto avg = ReadBytesStartingAt<types::FloatType>(reader.ColumnData(5, row).first);
+        if (key == 2) {
+            CPPTEST_ASSERT(count == 2);
+            CPPTEST_ASSERT(sum == 40.f);
+            CPPTEST_ASSERT(min == 10.f);
+            CPPTEST_ASSERT(max == 30.f);
+            CPPTEST_ASSERT(avg == 20.f);
+        } else if (key == 3) {
+            CPPTEST_ASSERT(count == 1);
+            CPPTEST_ASSERT(avg == 5.f);
+        }
+    }
+}
+
+NEW_TEST(HashAggregateTest, MergePartials) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rows;
+    for (types::IntegerType i = 0; i < 1000; ++i) {
+        rows.push_back({i % 7, (types::FloatType) i});
+    }
+    auto buffer = GenerateBuffer(rows);
+
+    HashAggregate expected({Integer, Float}, {0}, AllAggregations());
+    expected.update(buffer);
+
+    // Aggregate each chunk separately, then merge the partials.
+    HashAggregate final({Integer, Float}, {0}, AllAggregations());
+    for (std::size_t startRow = 0; startRow < rows.size(); startRow += 300) {
+        HashAggregate chunk({Integer, Float}, {0}, AllAggregations());
+        chunk.update(buffer, startRow, startRow + 300);
+
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = chunk.PartialColumnTypes();
+        OutputRowWriter writer(builder);
+        chunk.writePartial(writer);
+
+        std::vector<char> partial;
+        writer.write(partial);
+        final.merge(partial);
+    }
+    CPPTEST_ASSERT(final.NumGroups() == 7);
+
+    auto write = [](const HashAggregate& aggregate) {
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = aggregate.FinalColumnTypes();
+        OutputRowWriter writer(builder);
+        aggregate.writeFinal(writer);
+
+        std::vector<char> output;
+        writer.write(output);
+        return output;
+    };
+    auto expectedOutput = write(expected);
+    auto finalOutput = write(final);
+
+    // Both see the groups in the same order.
+    CPPTEST_ASSERT(expectedOutput == finalOutput);
+}
+
+NEW_TEST(HashAggregateTest, MergeAverageKeepsPrecision) {
+    using namespace metaldb;
+    using Function = HashAggregate::Function;
+    const std::vector<HashAggregate::Aggregation> aggregations = {{Function::AVG, 1}};
+
+    // The sum of the first chunk, 2^24 + 1, isn't a float.
+    HashAggregate result({Integer, Float}, {}, aggregations);
+    for (const auto& rows : {std::vector<std::pair<types::IntegerType, types::FloatType>>{{0, 16777216.f}, {0, 1.f}}, {{0, -16777216.f}, {0, 1.f}}}) {
+        HashAggregate chunk({Integer, Float}, {}, aggregations);
+        chunk.update(GenerateBuffer(rows));
+
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = chunk.PartialColumnTypes();
+        OutputRowWriter writer(builder);
+        chunk.writePartial(writer);
+
+        std::vector<char> partial;
+        writer.write(partial);
+        result.merge(partial);
+    }
+
+    // The kernel writes its sum as a float.
+    {
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = {Float, Integer};
+        OutputRowWriter writer(builder);
+        const types::FloatType sum = 6;
+        const types::IntegerType count = 4;
+        writer.appendRow({{reinterpret_cast<const char*>(&sum), sizeof(sum)}, {reinterpret_cast<const char*>(&count), sizeof(count)}});
+
+        std::vector<char> partial;
+        writer.write(partial);
+        result.merge(partial);
+    }
+
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = result.FinalColumnTypes();
+    OutputRowWriter writer(builder);
+    result.writeFinal(writer);
+
+    std::vector<char> output;
+    writer.write(output);
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 1);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(reader.ColumnData(0, 0).first) == 1.f);
+}
+
+NEW_TEST(HashAggregateTest, NoGroupByOverNoRows) {
+    using namespace metaldb;
+    HashAggregate aggregate({Integer, Float}, {}, AllAggregations());
+    aggregate.update(GenerateBuffer({}));
+
+    auto columnTypes = aggregate.FinalColumnTypes();
+    CPPTEST_ASSERT(columnTypes.at(0) == Integer);
+    CPPTEST_ASSERT(columnTypes.at(1) == Float_opt);
+
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = columnTypes;
+    OutputRowWriter writer(builder);
+    aggregate.writeFinal(writer);
+
+    std::vector<char> output;
+    writer.write(output);
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 1);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(0, 0).first) == 0);
+    CPPTEST_ASSERT(reader.SizeOfColumn(1, 0) == 0);
+    CPPTEST_ASSERT(reader.SizeOfColumn(4, 0) == 0);
+}
+
+NEW_TEST(HashAggregateTest, MergeSketches) {
+    using namespace metaldb;
+    using Function = HashAggregate::Function;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rows;
+    for (types::IntegerType i = 0; i < 10'000; ++i) {
+        rows.push_back({i % 2, (types::FloatType) (i / 2)});
+    }
+    auto buffer = GenerateBuffer(rows);
+
+    const std::vector<HashAggregate::Aggregation> aggregations = {
+        {Function::APPROX_COUNT_DISTINCT, 1},
+        {Function::APPROX_PERCENTILE, 1, 0.9},
+    };
+
+    HashAggregate result({Integer, Float}, {0}, aggregations);
+    for (std::size_t startRow = 0; startRow < rows.size(); startRow += 3000) {
+        HashAggregate chunk({Integer, Float}, {0}, aggregations);
+        chunk.update(buffer, startRow, startRow + 3000);
+
+        auto partialColumnTypes = chunk.PartialColumnTypes();
+        CPPTEST_ASSERT(partialColumnTypes.at(1) == String);
+        CPPTEST_ASSERT(partialColumnTypes.at(2) == String);
+
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = partialColumnTypes;
+        OutputRowWriter writer(builder);
+        chunk.writePartial(writer);
+
+        std::vector<char> partial;
+        writer.write(partial);
+        result.merge(partial);
+    }
+
+    auto columnTypes = result.FinalColumnTypes();
+    CPPTEST_ASSERT(columnTypes.at(1) == Integer);
+    CPPTEST_ASSERT(columnTypes.at(2) == Float);
+
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = columnTypes;
+    OutputRowWriter writer(builder);
+    result.writeFinal(writer);
+
+    std::vector<char> output;
+    writer.write(output);
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 2);
+
+    // Each group has 5000 distinct values, from 0 to 4999.
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        auto distinct = ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(1, row).first);
+        auto percentile = ReadBytesStartingAt<types::FloatType>(reader.ColumnData(2, row).first);
+        CPPTEST_ASSERT(distinct > 4000 && distinct < 6000);
+        CPPTEST_ASSERT(percentile > 4400 && percentile < 4600);
+    }
+}
+
+CPPTEST_END_CLASS(HashAggregateTest)
@@ -0,0 +1,470 @@
+#include <cpptest/cpptest.hpp>
+
+#include "GraceHashJoin.hpp"
+#include "HashJoin.hpp"
+#include "JoinHashTable.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+#include "RadixPartitioner.hpp"
+#include "SortMergeJoin.hpp"
+#include "SpillFile.hpp"
+
+#include "temp_row.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+static std::shared_ptr<std::vector<char>> GenerateBuffer(const std::vector<std::pair<metaldb::types::IntegerType, metaldb::types::FloatType>>& rows) {
+    metaldb::OutputRowWriter writer;
+    for (const auto& [key, value] : rows) {
+        metaldb::TempRow::TempRowBuilder builder;
+        builder.numColumns = 2;
+        builder.columnTypes[0] = metaldb::ColumnType::Integer;
+        builder.columnTypes[1] = metaldb::ColumnType::Float;
+
+        metaldb::TempRow tempRow = builder;
+        tempRow.Append(key);
+        tempRow.Append(value);
+        writer.appendTempRow(tempRow);
+    }
+
+    auto buffer = std::make_shared<std::vector<char>>();
+    writer.write(*buffer);
+    return buffer;
+}
+
+static std::vector<char> RunJoin(metaldb::HashJoin& join, const std::vector<std::shared_ptr<std::vector<char>>>& buildBuffers, const std::vector<std::shared_ptr<std::vector<char>>>& probeBuffers) {
+    metaldb::OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = join.OutputColumnTypes();
+    metaldb::OutputRowWriter writer(builder);
+
+    join.build(buildBuffers);
+    for (const auto& probeBuffer : probeBuffers) {
+        join.probe(*probeBuffer, writer);
+    }
+
+    std::vector<char> output;
+    writer.write(output);
+    return output;
+}
+
+// Copies every chunk of a sort merge join's output into a single buffer, keeping their order.
+static std::vector<char> RunSortMergeJoin(const metaldb::SortMergeJoin& join) {
+    metaldb::OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = join.OutputColumnTypes();
+    metaldb::OutputRowWriter writer(builder);
+
+    join.join([&](std::vector<char>& buffer) {
+        auto reader = metaldb::OutputRowReader(buffer);
+        for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+            writer.copyRow(reader, row);
+        }
+    });
+
+    std::vector<char> output;
+    writer.write(output);
+    return output;
+}
+
+class HashJoinTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(HashJoinTest)
+
+NEW_TEST(HashJoinTest, HashTableProbe) {
+    metaldb::JoinHashTable table;
+    for (metaldb::JoinHashTable::RowRefType i = 0; i < 1000; ++i) {
+        // Every key is inserted twice.
+        table.insert(i % 500, 0, i);
+    }
+    CPPTEST_ASSERT(table.size() == 1000);
+    CPPTEST_ASSERT(table.capacity() >= 2000);
+
+    std::size_t numMatches = 0;
+    table.probe(7, [&](const metaldb::JoinHashTable::Entry& entry) {
+        CPPTEST_ASSERT(entry.row == 7 || entry.row == 507);
+        numMatches++;
+    });
+    CPPTEST_ASSERT(numMatches == 2);
+
+    numMatches = 0;
+    table.probe(5000, [&](const auto&) {
+        numMatches++;
+    });
+    CPPTEST_ASSERT(numMatches == 0);
+}
+
+NEW_TEST(HashJoinTest, InnerJoin) {
+    using namespace metaldb;
+    auto lhs = GenerateBuffer({{1, 1.5f}, {2, 2.5f}, {3, 3.5f}});
+    auto rhsPartition1 = GenerateBuffer({{2, 20.f}, {3, 30.f}});
+    auto rhsPartition2 = GenerateBuffer({{3, 31.f}, {4, 40.f}});
+
+    HashJoin join(HashJoin::JoinType::INNER, {Integer, Float}, 0, {Integer, Float}, 0);
+    CPPTEST_ASSERT(!join.BuildIsLhs());
+
+    auto output = RunJoin(join, {rhsPartition1, rhsPartition2}, {lhs});
+    CPPTEST_ASSERT(join.NumBuildRows() == 4);
+
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumColumns() == 4);
+    CPPTEST_ASSERT(reader.NumRows() == 3);
+
+    types::FloatType sumOfRhs = 0;
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        auto [lhsKey, lhsKeySize] = reader.ColumnData(0, row);
+        auto [rhsKey, rhsKeySize] = reader.ColumnData(2, row);
+        CPPTEST_ASSERT(lhsKeySize == sizeof(types::IntegerType));
+        CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(lhsKey) == ReadBytesStartingAt<types::IntegerType>(rhsKey));
+
+        auto [rhsValue, rhsValueSize] = reader.ColumnData(3, row);
+        sumOfRhs += ReadBytesStartingAt<types::FloatType>(rhsValue);
+    }
+    CPPTEST_ASSERT(sumOfRhs == 20.f + 30.f + 31.f);
+}
+
+NEW_TEST(HashJoinTest, LeftJoinKeepsUnmatchedRows) {
+    using namespace metaldb;
+    auto lhs = GenerateBuffer({{1, 1.5f}, {2, 2.5f}});
+    auto rhs = GenerateBuffer({{2, 20.f}});
+
+    HashJoin join(HashJoin::JoinType::LEFT, {Integer, Float}, 0, {Integer, Float}, 0);
+    auto columnTypes = join.OutputColumnTypes();
+    CPPTEST_ASSERT(columnTypes.at(0) == Integer);
+    CPPTEST_ASSERT(columnTypes.at(1) == Float);
+    CPPTEST_ASSERT(columnTypes.at(2) == Integer_opt);
+    CPPTEST_ASSERT(columnTypes.at(3) == Float_opt);
+
+    auto output = RunJoin(join, {rhs}, {lhs});
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 2);
+
+    // The first row has no match, so the rhs is null.
+    CPPTEST_ASSERT(reader.SizeOfColumn(2, 0) == 0);
+    CPPTEST_ASSERT(reader.SizeOfColumn(3, 0) == 0);
+
+    auto [rhsValue, rhsValueSize] = reader.ColumnData(3, 1);
+    CPPTEST_ASSERT(rhsValueSize == sizeof(types::FloatType));
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(rhsValue) == 20.f);
+}
+
+NEW_TEST(HashJoinTest, RightJoinBuildsLhs) {
+    using namespace metaldb;
+    auto lhs = GenerateBuffer({{2, 2.5f}});
+    auto rhs = GenerateBuffer({{1, 10.f}, {2, 20.f}, {2, 21.f}});
+
+    HashJoin join(HashJoin::JoinType::RIGHT, {Integer, Float}, 0, {Integer, Float}, 0);
+    CPPTEST_ASSERT(join.BuildIsLhs());
+
+    auto output = RunJoin(join, {lhs}, {rhs});
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 3);
+    CPPTEST_ASSERT(reader.TypeOfColumn(0) == Integer_opt);
+    CPPTEST_ASSERT(reader.TypeOfColumn(2) == Integer);
+
+    // The lhs is still written first.
+    CPPTEST_ASSERT(reader.SizeOfColumn(0, 0) == 0);
+    auto [lhsKey, lhsKeySize] = reader.ColumnData(0, 1);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(lhsKey) == 2);
+}
+
+NEW_TEST(HashJoinTest, EmptyStringKeysMatch) {
+    using namespace metaldb;
+    auto generateKeys = [](ColumnType type, const std::vector<std::string>& keys) {
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = {type};
+        OutputRowWriter writer(builder);
+        for (const auto& key : keys) {
+            writer.appendRow({{key.data(), (OutputRow::ColumnSizeType) key.size()}});
+        }
+        auto buffer = std::make_shared<std::vector<char>>();
+        writer.write(*buffer);
+        return buffer;
+    };
+
+    // An empty string is a key like any other.
+    HashJoin join(HashJoin::JoinType::INNER, {String}, 0, {String}, 0);
+    auto output = RunJoin(join, {generateKeys(String, {"", "b"})}, {generateKeys(String, {"", "a"})});
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 1);
+    CPPTEST_ASSERT(reader.SizeOfColumn(0, 0) == 0);
+    CPPTEST_ASSERT(reader.SizeOfColumn(1, 0) == 0);
+
+    // In a nullable column it's null, which never matches.
+    HashJoin nullableJoin(HashJoin::JoinType::INNER, {String}, 0, {String_opt}, 0);
+    auto nullableOutput = RunJoin(nullableJoin, {generateKeys(String_opt, {"", "a"})}, {generateKeys(String, {"", "a"})});
+    CPPTEST_ASSERT(nullableJoin.NumBuildRows() == 1);
+    auto nullableReader = OutputRowReader(nullableOutput);
+    CPPTEST_ASSERT(nullableReader.NumRows() == 1);
+    CPPTEST_ASSERT(nullableReader.SizeOfColumn(0, 0) == 1);
+}
+
+NEW_TEST(HashJoinTest, InnerJoinCanBuildLhs) {
+    using namespace metaldb;
+    auto lhs = GenerateBuffer({{2, 2.5f}, {3, 3.5f}});
+    auto rhsChunk1 = GenerateBuffer({{1, 10.f}, {2, 20.f}});
+    auto rhsChunk2 = GenerateBuffer({{3, 30.f}, {3, 31.f}});
+
+    // The small lhs is built once, and every rhs chunk probes it.
+    HashJoin join(HashJoin::JoinType::INNER, {Integer, Float}, 0, {Integer, Float}, 0, true);
+    CPPTEST_ASSERT(join.BuildIsLhs());
+
+    auto output = RunJoin(join, {lhs}, {rhsChunk1, rhsChunk2});
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 3);
+
+    // The lhs is still written first.
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        auto [lhsValue, lhsValueSize] = reader.ColumnData(1, row);
+        auto [rhsValue, rhsValueSize] = reader.ColumnData(3, row);
+        CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(lhsValue) < 4.f);
+        CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(rhsValue) >= 20.f);
+    }
+}
+
+NEW_TEST(HashJoinTest, RadixPartitionKeepsKeysTogether) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rows;
+    for (types::IntegerType i = 0; i < 200; ++i) {
+        rows.push_back({i % 50, (types::FloatType) i});
+    }
+    auto buffer = GenerateBuffer(rows);
+
+    RadixPartitioner partitioner({Integer, Float}, 0, 3);
+    CPPTEST_ASSERT(partitioner.NumPartitions() == 8);
+
+    auto partitions = partitioner.partition(*buffer);
+    CPPTEST_ASSERT(partitions.size() == 8);
+
+    std::size_t numRows = 0;
+    for (std::size_t partition = 0; partition < partitions.size(); ++partition) {
+        auto reader = OutputRowReader(*partitions.at(partition));
+        CPPTEST_ASSERT(reader.NumColumns() == 2);
+        numRows += reader.NumRows();
+        for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+            auto [keyData, keySize] = reader.ColumnData(0, row);
+            CPPTEST_ASSERT(partitioner.PartitionOf(JoinHashTable::Hash(keyData, keySize)) == partition);
+        }
+    }
+    CPPTEST_ASSERT(numRows == 200);
+}
+
+NEW_TEST(HashJoinTest, RadixPartitionedJoinMatchesHashJoin) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> lhsRows;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rhsRows;
+    for (types::IntegerType i = 0; i < 300; ++i) {
+        lhsRows.push_back({i, (types::FloatType) i});
+        rhsRows.push_back({i % 100, 1.f});
+    }
+    auto lhs = GenerateBuffer(lhsRows);
+    auto rhs = GenerateBuffer(rhsRows);
+
+    HashJoin join(HashJoin::JoinType::LEFT, {Integer, Float}, 0, {Integer, Float}, 0);
+    auto expected = OutputRowReader(RunJoin(join, {rhs}, {lhs})).NumRows();
+    CPPTEST_ASSERT(expected == 300 + 200);
+
+    RadixPartitioner partitioner({Integer, Float}, 0, 4);
+    auto lhsPartitions = partitioner.partition(*lhs);
+    auto rhsPartitions = partitioner.partition(*rhs);
+
+    std::size_t numRows = 0;
+    for (std::size_t partition = 0; partition < partitioner.NumPartitions(); ++partition) {
+        HashJoin partitionJoin(HashJoin::JoinType::LEFT, {Integer, Float}, 0, {Integer, Float}, 0);
+        numRows += OutputRowReader(RunJoin(partitionJoin, {rhsPartitions.at(partition)}, {lhsPartitions.at(partition)})).NumRows();
+    }
+    CPPTEST_ASSERT(numRows == expected);
+}
+
+NEW_TEST(HashJoinTest, SpillFileRoundTrip) {
+    using namespace metaldb;
+    std::filesystem::path path;
+    {
+        SpillFile file;
+        path = file.path();
+        file.append(*GenerateBuffer({{1, 1.f}, {2, 2.f}}));
+        file.append(*GenerateBuffer({{3, 3.f}}));
+        CPPTEST_ASSERT(file.NumRows() == 3);
+
+        auto buffers = file.readAll();
+        CPPTEST_ASSERT(buffers.size() == 2);
+        CPPTEST_ASSERT(OutputRowReader(*buffers.at(0)).NumRows() == 2);
+
+        auto [key, keySize] = OutputRowReader(*buffers.at(1)).ColumnData(0, 0);
+        CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(key) == 3);
+        CPPTEST_ASSERT(std::filesystem::exists(path));
+    }
+    // The file is removed once it's no longer used.
+    CPPTEST_ASSERT(!std::filesystem::exists(path));
+}
+
+NEW_TEST(HashJoinTest, GraceJoinRepartitionsOverBudget) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> lhsRows;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rhsRows;
+    for (types::IntegerType i = 0; i < 2000; ++i) {
+        lhsRows.push_back({i, (types::FloatType) i});
+        rhsRows.push_back({i % 1000, 1.f});
+    }
+    auto lhs = GenerateBuffer(lhsRows);
+    auto rhs = GenerateBuffer(rhsRows);
+
+    HashJoin hashJoin(HashJoin::JoinType::LEFT, {Integer, Float}, 0, {Integer, Float}, 0);
+    auto expected = OutputRowReader(RunJoin(hashJoin, {rhs}, {lhs})).NumRows();
+
+    // A tiny budget so every partition is split again.
+    GraceHashJoin graceJoin(HashJoin::JoinType::LEFT, {Integer, Float}, 0, {Integer, Float}, 0, 1, 1024);
+    graceJoin.spillBuild(*rhs);
+    graceJoin.spillProbe(*lhs);
+    CPPTEST_ASSERT(graceJoin.NumBuildBytes() > 1024);
+
+    // The output of every partition is its own buffer.
+    std::size_t numRows = 0;
+    std::size_t numBuffers = 0;
+    graceJoin.join([&](std::vector<char>& buffer) {
+        auto reader = OutputRowReader(buffer);
+        CPPTEST_ASSERT(reader.ColumnTypes() == graceJoin.OutputColumnTypes());
+        numRows += reader.NumRows();
+        ++numBuffers;
+    });
+    CPPTEST_ASSERT(numRows == expected);
+    CPPTEST_ASSERT(numBuffers > 2);
+}
+
+NEW_TEST(HashJoinTest, GraceJoinStopsOnDuplicateKeys) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rows;
+    for (types::IntegerType i = 0; i < 500; ++i) {
+        rows.push_back({7, (types::FloatType) i});
+    }
+    auto rhs = GenerateBuffer(rows);
+    auto lhs = GenerateBuffer({{7, 1.f}, {8, 2.f}});
+
+    GraceHashJoin graceJoin(HashJoin::JoinType::INNER, {Integer, Float}, 0, {Integer, Float}, 0, 2, 64);
+    graceJoin.spillBuild(*rhs);
+    graceJoin.spillProbe(*lhs);
+
+    std::size_t numRows = 0;
+    graceJoin.join([&](std::vector<char>& buffer) {
+        numRows += OutputRowReader(buffer).NumRows();
+    });
+    CPPTEST_ASSERT(numRows == 500);
+}
+
+NEW_TEST(HashJoinTest, SortMergeJoinMatchesHashJoin) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> lhsRows;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rhsRows;
+    for (types::IntegerType i = 0; i < 300; ++i) {
+        lhsRows.push_back({(i * 7) % 50, (types::FloatType) i});
+        rhsRows.push_back({(i * 3) % 80 - 20, 1.f});
+    }
+    auto lhs = GenerateBuffer(lhsRows);
+    auto rhs = GenerateBuffer(rhsRows);
+
+    for (auto joinType : {HashJoin::JoinType::INNER, HashJoin::JoinType::LEFT, HashJoin::JoinType::RIGHT}) {
+        HashJoin hashJoin(joinType, {Integer, Float}, 0, {Integer, Float}, 0);
+        auto expected = OutputRowReader(joinType == HashJoin::JoinType::RIGHT ? RunJoin(hashJoin, {lhs}, {rhs}) : RunJoin(hashJoin, {rhs}, {lhs})).NumRows();
+
+        SortMergeJoin sortMergeJoin(joinType, {Integer, Float}, 0, {Integer, Float}, 0, 1024 * 1024);
+        for (std::size_t startRow = 0; startRow < 300; startRow += 100) {
+            sortMergeJoin.addLhs(*lhs, startRow, startRow + 100);
+            sortMergeJoin.addRhs(*rhs, startRow, startRow + 100);
+        }
+
+        auto output = RunSortMergeJoin(sortMergeJoin);
+        auto reader = OutputRowReader(output);
+        CPPTEST_ASSERT(reader.NumRows() == expected);
+
+        // The output is in key order, with unmatched rows in order of the side they came from.
+        const auto keyColumn = joinType == HashJoin::JoinType::RIGHT ? 2 : 0;
+        for (std::size_t row = 1; row < reader.NumRows(); ++row) {
+            auto previous = ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(keyColumn, row - 1).first);
+            auto current = ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(keyColumn, row).first);
+            CPPTEST_ASSERT(previous <= current);
+        }
+    }
+}
+
+NEW_TEST(HashJoinTest, SortMergeJoinSpillsOverBudget) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> lhsRows;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rhsRows;
+    for (types::IntegerType i = 0; i < 2000; ++i) {
+        lhsRows.push_back({1999 - i, (types::FloatType) i});
+        rhsRows.push_back({i % 1000, 1.f});
+    }
+    auto lhs = GenerateBuffer(lhsRows);
+    auto rhs = GenerateBuffer(rhsRows);
+
+    SortMergeJoin sortMergeJoin(HashJoin::JoinType::LEFT, {Integer, Float}, 0, {Integer, Float}, 0, 4096);
+    for (std::size_t startRow = 0; startRow < 2000; startRow += 250) {
+        sortMergeJoin.addLhs(*lhs, startRow, startRow + 250);
+        sortMergeJoin.addRhs(*rhs, startRow, startRow + 250);
+    }
+    CPPTEST_ASSERT(sortMergeJoin.NumSpilledRuns() > 0);
+
+    // Keys below 1000 match twice, and the rest are kept unmatched.
+    CPPTEST_ASSERT(OutputRowReader(RunSortMergeJoin(sortMergeJoin)).NumRows() == 3000);
+}
+
+NEW_TEST(HashJoinTest, SortMergeJoinMergesSortedSide) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> lhsRows;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rhsRows;
+    for (types::IntegerType i = 0; i < 300; ++i) {
+        lhsRows.push_back({(i * 7) % 50, (types::FloatType) i});
+        rhsRows.push_back({i / 4, 1.f});
+    }
+    auto lhs = GenerateBuffer(lhsRows);
+    auto rhs = GenerateBuffer(rhsRows);
+
+    HashJoin hashJoin(HashJoin::JoinType::INNER, {Integer, Float}, 0, {Integer, Float}, 0);
+    auto expected = OutputRowReader(RunJoin(hashJoin, {rhs}, {lhs})).NumRows();
+
+    // The rhs is already in key order, so its chunks are only split into runs.
+    SortMergeJoin sortMergeJoin(HashJoin::JoinType::INNER, {Integer, Float}, 0, {Integer, Float}, 0, 1024 * 1024, false, true);
+    for (std::size_t startRow = 0; startRow < 300; startRow += 100) {
+        sortMergeJoin.addLhs(*lhs, startRow, startRow + 100);
+        sortMergeJoin.addRhs(*rhs, startRow, startRow + 100);
+    }
+    CPPTEST_ASSERT(OutputRowReader(RunSortMergeJoin(sortMergeJoin)).NumRows() == expected);
+}
+
+NEW_TEST(HashJoinTest, SortMergeJoinOutputsChunks) {
+    using namespace metaldb;
+    std::vector<std::pair<types::IntegerType, types::FloatType>> rows;
+    for (types::IntegerType i = 0; i < 300; ++i) {
+        rows.push_back({0, (types::FloatType) i});
+    }
+    auto lhs = GenerateBuffer(rows);
+    auto rhs = GenerateBuffer(rows);
+
+    SortMergeJoin sortMergeJoin(HashJoin::JoinType::INNER, {Integer, Float}, 0, {Integer, Float}, 0, 1024 * 1024);
+    sortMergeJoin.addLhs(*lhs);
+    sortMergeJoin.addRhs(*rhs);
+
+    // Every row has the same key, so the output is more rows than fit in a single chunk.
+    std::size_t numRows = 0;
+    std::size_t numBuffers = 0;
+    sortMergeJoin.join([&](std::vector<char>& buffer) {
+        auto reader = OutputRowReader(buffer);
+        CPPTEST_ASSERT(reader.NumRows() <= SortMergeJoin::ChunkNumRows);
+        numRows += reader.NumRows();
+        ++numBuffers;
+    });
+    CPPTEST_ASSERT(numRows == 300 * 300);
+    CPPTEST_ASSERT(numBuffers == 2);
+}
+
+CPPTEST_END_CLASS(HashJoinTest)
@@ -0,0 +1,139 @@
+#include <cpptest/cpptest.hpp>
+
+#include "HashSetOperation.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include "temp_row.h"
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+namespace {
+    using Row = std::pair<metaldb::types::IntegerType, std::optional<metaldb::types::FloatType>>;
+
+    std::vector<char> GenerateBuffer(const std::vector<Row>& rows) {
+        metaldb::OutputRowWriter writer;
+        for (const auto& [key, value] : rows) {
+            metaldb::TempRow::TempRowBuilder builder;
+            builder.numColumns = 2;
+            builder.columnTypes[0] = metaldb::ColumnType::Integer;
+            builder.columnTypes[1] = metaldb::ColumnType::Float_opt;
+            builder.columnSizes[1] = value ? sizeof(metaldb::types::FloatType) : 0;
+
+            metaldb::TempRow tempRow = builder;
+            tempRow.Append(key);
+            if (value) {
+                tempRow.Append(*value);
+            }
+            writer.appendTempRow(tempRow);
+        }
+
+        std::vector<char> buffer;
+        writer.write(buffer);
+        return buffer;
+    }
+
+    std::vector<Row> ReadBuffer(const std::vector<char>& buffer) {
+        std::vector<Row> rows;
+        if (buffer.empty()) {
+            return rows;
+        }
+        auto reader = metaldb::OutputRowReader(buffer);
+        for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+            Row row{metaldb::ReadBytesStartingAt<metaldb::types::IntegerType>(reader.ColumnData(0, i).first), std::nullopt};
+            auto [data, size] = reader.ColumnData(1, i);
+            if (size > 0) {
+                row.second = metaldb::ReadBytesStartingAt<metaldb::types::FloatType>(data);
+            }
+            rows.push_back(row);
+        }
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    }
+
+    /**
+     * Runs the operation with every chunk of each side in its own partial.
+     */
+    std::vector<Row> Run(metaldb::HashSetOperation::Operation operation, const std::vector<std::vector<Row>>& lhsChunks, const std::vector<std::vector<Row>>& rhsChunks, std::size_t* numPartialRows = nullptr) {
+        using namespace metaldb;
+        const std::vector<ColumnType> columnTypes = {Integer, Float_opt};
+        HashSetOperation result(operation, columnTypes);
+
+        std::size_t partialRows = 0;
+        for (const auto isLhs : {true, false}) {
+            for (const auto& chunk : isLhs ? lhsChunks : rhsChunks) {
+                auto buffer = GenerateBuffer(chunk);
+                HashSetOperation partial(operation, columnTypes);
+
+                OutputRowWriter::OutputRowBuilder builder;
+                builder.columnTypes = partial.PartialColumnTypes();
+                OutputRowWriter writer(builder);
+                partial.writePartial(buffer, isLhs, writer);
+                partialRows += writer.CurrentNumRows();
+
+                std::vector<char> partialBuffer;
+                writer.write(partialBuffer);
+                result.merge(partialBuffer);
+            }
+        }
+        if (numPartialRows) {
+            *numPartialRows = partialRows;
+        }
+
+        OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = columnTypes;
+        OutputRowWriter writer(builder);
+        result.writeFinal(writer);
+
+        std::vector<char> output;
+        writer.write(output);
+        return ReadBuffer(output);
+    }
+}
+
+class HashSetOperationTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(HashSetOperationTest)
+
+NEW_TEST(HashSetOperationTest, DistinctRemovesDuplicatesWithinAndAcrossChunks) {
+    using namespace metaldb;
+    std::size_t numPartialRows = 0;
+    auto rows = Run(HashSetOperation::Operation::DISTINCT, {{{1, 1.f}, {1, 1.f}, {2, std::nullopt}, {2, std::nullopt}}, {{1, 1.f}, {1, 2.f}}}, {}, &numPartialRows);
+
+    // Duplicates within a chunk never reach the final merge.
+    CPPTEST_ASSERT(numPartialRows == 4);
+    CPPTEST_ASSERT((rows == std::vector<Row>{{1, 1.f}, {1, 2.f}, {2, std::nullopt}}));
+}
+
+NEW_TEST(HashSetOperationTest, Union) {
+    using namespace metaldb;
+    auto rows = Run(HashSetOperation::Operation::UNION, {{{1, 1.f}, {2, 2.f}}}, {{{2, 2.f}, {3, 3.f}}, {{1, 1.f}}});
+    CPPTEST_ASSERT((rows == std::vector<Row>{{1, 1.f}, {2, 2.f}, {3, 3.f}}));
+}
+
+NEW_TEST(HashSetOperationTest, IntersectAndExcept) {
+    using namespace metaldb;
+    const std::vector<std::vector<Row>> lhs = {{{1, 1.f}, {2, 2.f}, {2, 2.f}}, {{3, std::nullopt}, {4, 4.f}}};
+    const std::vector<std::vector<Row>> rhs = {{{2, 2.f}, {3, std::nullopt}}, {{5, 5.f}, {2, 2.f}}};
+
+    auto intersect = Run(HashSetOperation::Operation::INTERSECT, lhs, rhs);
+    CPPTEST_ASSERT((intersect == std::vector<Row>{{2, 2.f}, {3, std::nullopt}}));
+
+    auto except = Run(HashSetOperation::Operation::EXCEPT, lhs, rhs);
+    CPPTEST_ASSERT((except == std::vector<Row>{{1, 1.f}, {4, 4.f}}));
+
+    CPPTEST_ASSERT(Run(HashSetOperation::Operation::INTERSECT, lhs, {}).empty());
+}
+
+CPPTEST_END_CLASS(HashSetOperationTest)
@@ -0,0 +1,109 @@
+#include <cpptest/cpptest.hpp>
+
+#include "hash_table.h"
+
+#include <thread>
+#include <vector>
+
+class HashTableTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(HashTableTest)
+
+NEW_TEST(HashTableTest, FindOrInsert) {
+    using namespace metaldb;
+    std::vector<HashTable::Bucket> buckets(HashTable::NumBucketsFor(100));
+    HashTable table(buckets.data(), buckets.size());
+    table.Clear();
+
+    CPPTEST_ASSERT(table.Capacity() >= 200);
+    CPPTEST_ASSERT(table.Find(7) == HashTable::NotFound);
+
+    const auto slot = table.FindOrInsert(7);
+    CPPTEST_ASSERT(slot != HashTable::NotFound);
+    CPPTEST_ASSERT(table.FindOrInsert(7) == slot);
+    CPPTEST_ASSERT(table.Find(7) == slot);
+    CPPTEST_ASSERT(table.KeyAt(slot) == 7);
+
+    table.FetchAdd(slot, 3);
+    table.FetchAdd(slot, 4);
+    CPPTEST_ASSERT(table.ValueAt(slot) == 7);
+}
+
+NEW_TEST(HashTableTest, FullTable) {
+    using namespace metaldb;
+    std::vector<HashTable::Bucket> buckets(2);
+    HashTable table(buckets.data(), buckets.size());
+    table.Clear();
+
+    for (HashTable::KeyType key = 0; key < table.Capacity(); ++key) {
+        CPPTEST_ASSERT(table.FindOrInsert(key) != HashTable::NotFound);
+    }
+    CPPTEST_ASSERT(table.FindOrInsert((HashTable::KeyType) table.Capacity()) == HashTable::NotFound);
+    for (HashTable::KeyType key = 0; key < table.Capacity(); ++key) {
+        CPPTEST_ASSERT(table.Find(key) != HashTable::NotFound);
+    }
+}
+
+NEW_TEST(HashTableTest, ConcurrentAggregate) {
+    using namespace metaldb;
+    constexpr HashTable::KeyType numKeys = 1000;
+    constexpr std::size_t numThreads = 8;
+    constexpr std::size_t numRepeats = 50;
+
+    std::vector<HashTable::Bucket> buckets(HashTable::NumBucketsFor(numKeys));
+    HashTable table(buckets.data(), buckets.size());
+    table.Clear();
+
+    // Every thread counts every key into the same table.
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 0; thread < numThreads; ++thread) {
+        threads.emplace_back([&]() {
+            for (std::size_t repeat = 0; repeat < numRepeats; ++repeat) {
+                for (HashTable::KeyType key = 0; key < numKeys; ++key) {
+                    auto slot = table.FindOrInsert(key);
+                    table.FetchAdd(slot, 1);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::size_t numUsedSlots = 0;
+    for (std::size_t slot = 0; slot < table.Capacity(); ++slot) {
+        if (table.KeyAt(slot) != HashTable::EmptyKey) {
+            numUsedSlots++;
+            CPPTEST_ASSERT(table.ValueAt(slot) == numThreads * numRepeats);
+        }
+    }
+    CPPTEST_ASSERT(numUsedSlots == numKeys);
+}
+
+NEW_TEST(HashTableTest, FetchMinMax) {
+    using namespace metaldb;
+    std::vector<HashTable::Bucket> buckets(1);
+    HashTable table(buckets.data(), buckets.size());
+    table.Clear();
+
+    const auto minSlot = table.FindOrInsert(1);
+    const auto maxSlot = table.FindOrInsert(2);
+    table.FetchAdd(minSlot, 10);
+    for (HashTable::ValueType value : {12, 4, 9}) {
+        table.FetchMin(minSlot, value);
+        table.FetchMax(maxSlot, value);
+    }
+    CPPTEST_ASSERT(table.ValueAt(minSlot) == 4);
+    CPPTEST_ASSERT(table.ValueAt(maxSlot) == 12);
+}
+
+CPPTEST_END_CLASS(HashTableTest)
@@ -0,0 +1,74 @@
+#include <cpptest/cpptest.hpp>
+
+#include "HyperLogLog.hpp"
+
+#include <cmath>
+#include <string>
+
+namespace {
+    void AddIntegers(metaldb::HyperLogLog::Registers& registers, std::int64_t start, std::int64_t end) {
+        for (auto i = start; i < end; ++i) {
+            metaldb::HyperLogLog::Add(registers, reinterpret_cast<const char*>(&i), sizeof(i));
+        }
+    }
+
+    // 3 standard errors.
+    bool IsClose(std::int64_t estimate, std::int64_t expected) {
+        return std::abs((double) (estimate - expected)) <= 0.2 * expected;
+    }
+}
+
+class HyperLogLogTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(HyperLogLogTest)
+
+NEW_TEST(HyperLogLogTest, Estimate) {
+    using namespace metaldb;
+    HyperLogLog::Registers registers;
+    CPPTEST_ASSERT(HyperLogLog::Estimate(registers) == 0);
+
+    // Small cardinalities are nearly exact.
+    AddIntegers(registers, 0, 10);
+    AddIntegers(registers, 0, 10);
+    CPPTEST_ASSERT(HyperLogLog::Estimate(registers) == 10);
+
+    AddIntegers(registers, 10, 100'000);
+    CPPTEST_ASSERT(IsClose(HyperLogLog::Estimate(registers), 100'000));
+    CPPTEST_ASSERT(registers.size() == HyperLogLog::NumRegisters);
+}
+
+NEW_TEST(HyperLogLogTest, MergeSerializedSketches) {
+    using namespace metaldb;
+    HyperLogLog::Registers expected;
+    AddIntegers(expected, 0, 50'000);
+
+    // Overlapping chunks, so some values are in both.
+    HyperLogLog::Registers lhs;
+    HyperLogLog::Registers rhs;
+    AddIntegers(lhs, 0, 30'000);
+    AddIntegers(rhs, 20'000, 50'000);
+
+    std::string serialized;
+    HyperLogLog::Serialize(HyperLogLog::Registers(), serialized);
+    CPPTEST_ASSERT(serialized.empty());
+
+    HyperLogLog::Registers merged;
+    for (const auto& registers : {lhs, rhs}) {
+        HyperLogLog::Serialize(registers, serialized);
+        CPPTEST_ASSERT(serialized.size() == HyperLogLog::NumSerializedBytes);
+        HyperLogLog::Merge(merged, serialized.data(), serialized.size());
+    }
+    CPPTEST_ASSERT(merged == expected);
+    CPPTEST_ASSERT(IsClose(HyperLogLog::Estimate(merged), 50'000));
+}
+
+CPPTEST_END_CLASS(HyperLogLogTest)
@@ -0,0 +1,129 @@
+#include <cpptest/cpptest.hpp>
+
+#include "ExternalSort.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+#include "ParallelRadixSort.hpp"
+
+#include "radix_sort.h"
+#include "temp_row.h"
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace {
+    std::vector<metaldb::RadixSortItem> GenerateItems(std::size_t numItems, std::uint64_t maxKey) {
+        std::mt19937_64 generator(42);
+        std::uniform_int_distribution<std::uint64_t> keys(0, maxKey);
+
+        std::vector<metaldb::RadixSortItem> items;
+        for (std::size_t i = 0; i < numItems; ++i) {
+            items.push_back({keys(generator), (std::uint32_t) i});
+        }
+        return items;
+    }
+
+    bool SortedLike(const std::vector<metaldb::RadixSortItem>& items, std::vector<metaldb::RadixSortItem> expected) {
+        std::stable_sort(expected.begin(), expected.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.key < rhs.key;
+        });
+        return std::equal(items.begin(), items.end(), expected.begin(), expected.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.key == rhs.key && lhs.row == rhs.row;
+        });
+    }
+}
+
+class ParallelRadixSortTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(ParallelRadixSortTest)
+
+NEW_TEST(ParallelRadixSortTest, SortsLikeStableSort) {
+    using namespace metaldb;
+    auto items = GenerateItems(100'000, ~0ULL);
+    auto sorted = items;
+    ParallelRadixSort::Sort(sorted, 8, 4);
+    CPPTEST_ASSERT(SortedLike(sorted, items));
+
+    // Small keys have many duplicates, and most passes are skipped.
+    items = GenerateItems(50'000, 300);
+    sorted = items;
+    ParallelRadixSort::Sort(sorted, 8, 3);
+    CPPTEST_ASSERT(SortedLike(sorted, items));
+
+    sorted = items;
+    ParallelRadixSort::Sort(sorted, 2, 1);
+    CPPTEST_ASSERT(SortedLike(sorted, items));
+}
+
+NEW_TEST(ParallelRadixSortTest, KeysOrderLikeValues) {
+    using namespace metaldb;
+    CPPTEST_ASSERT(RadixSort::IntegerKey(-5) < RadixSort::IntegerKey(-1));
+    CPPTEST_ASSERT(RadixSort::IntegerKey(-1) < RadixSort::IntegerKey(0));
+    CPPTEST_ASSERT(RadixSort::IntegerKey(0) < RadixSort::IntegerKey(7));
+
+    CPPTEST_ASSERT(RadixSort::FloatKey(-10.5f) < RadixSort::FloatKey(-0.25f));
+    CPPTEST_ASSERT(RadixSort::FloatKey(-0.25f) < RadixSort::FloatKey(0.0f));
+    CPPTEST_ASSERT(RadixSort::FloatKey(0.0f) < RadixSort::FloatKey(3.5f));
+    CPPTEST_ASSERT(RadixSort::FloatKey(3.5f) < (1ULL << 32));
+}
+
+NEW_TEST(ParallelRadixSortTest, ItemsOrderLikeNormalizedKeys) {
+    using namespace metaldb;
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<types::FloatType> values(-100, 100);
+
+    OutputRowWriter writer;
+    for (std::size_t i = 0; i < 200; ++i) {
+        TempRow::TempRowBuilder builder;
+        builder.numColumns = 3;
+        builder.columnTypes[0] = ColumnType::Float_opt;
+        builder.columnTypes[1] = ColumnType::Float;
+        builder.columnTypes[2] = ColumnType::Float;
+        builder.columnSizes[0] = i % 5 == 0 ? 0 : sizeof(types::FloatType);
+
+        TempRow tempRow = builder;
+        if (i % 5 != 0) {
+            tempRow.Append((types::FloatType) (int) values(generator));
+        }
+        tempRow.Append((types::FloatType) (int) values(generator));
+        tempRow.Append(values(generator));
+        writer.appendTempRow(tempRow);
+    }
+    std::vector<char> buffer;
+    writer.write(buffer);
+    auto reader = OutputRowReader(buffer);
+
+    for (const auto& sortColumns : std::vector<std::vector<ExternalSort::SortColumn>>{{{0, true}}, {{0, false}}, {{1, true}, {2, false}}}) {
+        std::vector<RadixSortItem> items;
+        std::uint32_t numKeyBytes = 0;
+        CPPTEST_ASSERT(ExternalSort::MakeRadixSortItems(reader, 0, reader.NumRows(), sortColumns, items, numKeyBytes));
+        CPPTEST_ASSERT(numKeyBytes <= 8);
+
+        for (std::size_t i = 1; i < items.size(); ++i) {
+            std::string lhs;
+            std::string rhs;
+            ExternalSort::AppendNormalizedKey(reader, i - 1, sortColumns, lhs);
+            ExternalSort::AppendNormalizedKey(reader, i, sortColumns, rhs);
+            CPPTEST_ASSERT((lhs < rhs) == (items.at(i - 1).key < items.at(i).key));
+            CPPTEST_ASSERT((lhs == rhs) == (items.at(i - 1).key == items.at(i).key));
+        }
+    }
+
+    // A nullable float and a float need 65 bits.
+    std::vector<RadixSortItem> items;
+    std::uint32_t numKeyBytes = 0;
+    CPPTEST_ASSERT(!ExternalSort::MakeRadixSortItems(reader, 0, reader.NumRows(), {{0}, {1}}, items, numKeyBytes));
+}
+
+CPPTEST_END_CLASS(ParallelRadixSortTest)
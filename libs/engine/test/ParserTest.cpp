@@ -0,0 +1,297 @@
+#include <cpptest/cpptest.hpp>
+
+#include <metaldb/query_engine/parser.hpp>
+#include <metaldb/query_engine/AST/aggregate.hpp>
+#include <metaldb/query_engine/AST/distinct.hpp>
+#include <metaldb/query_engine/AST/filter.hpp>
+#include <metaldb/query_engine/AST/join.hpp>
+#include <metaldb/query_engine/AST/limit.hpp>
+#include <metaldb/query_engine/AST/order_by.hpp>
+#include <metaldb/query_engine/AST/projection.hpp>
+#include <metaldb/query_engine/AST/read.hpp>
+#include <metaldb/query_engine/AST/set_operation.hpp>
+#include <metaldb/query_engine/AST/window.hpp>
+#include <metaldb/query_engine/AST/write.hpp>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+    std::shared_ptr<metaldb::QueryEngine::AST::Expr> Parse(const std::string& query) {
+        return metaldb::QueryEngine::Parser().Parse(query);
+    }
+
+    /**
+     * Returns true if the expression is a read of the table.
+     */
+    bool IsRead(const std::shared_ptr<metaldb::QueryEngine::AST::Expr>& expr, const std::string& tableName) {
+        auto read = std::dynamic_pointer_cast<metaldb::QueryEngine::AST::Read>(expr);
+        return read && read->tableName() == tableName;
+    }
+
+    /**
+     * Returns true if the expression reads the column, of the table when it isn't empty.
+     */
+    bool IsColumn(const std::shared_ptr<metaldb::QueryEngine::AST::BaseFilterExpr>& expr, const std::string& table, const std::string& column) {
+        auto readColumn = std::dynamic_pointer_cast<metaldb::QueryEngine::AST::ReadColumn>(expr);
+        return readColumn && readColumn->table() == table && readColumn->column() == column;
+    }
+}
+
+class ParserTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(ParserTest)
+
+NEW_TEST(ParserTest, SelectColumns) {
+    using namespace metaldb::QueryEngine;
+    CPPTEST_ASSERT(IsRead(Parse("SELECT * FROM trips;"), "trips"));
+    CPPTEST_ASSERT(IsRead(Parse("select * from \"Trips\""), "Trips"));
+
+    // The projection outputs the columns themselves, and the aliases only name them in the output.
+    auto projection = std::dynamic_pointer_cast<AST::Projection>(Parse("SELECT t.id, day AS d FROM trips t"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT(projection->columns() == std::vector<AST::ColumnRef>({{"trips", "id"}, "day"}));
+    CPPTEST_ASSERT(IsRead(projection->child(), "trips"));
+}
+
+NEW_TEST(ParserTest, Where) {
+    using namespace metaldb::QueryEngine;
+    auto filter = std::dynamic_pointer_cast<AST::Filter>(Parse("SELECT * FROM trips WHERE id > 1 AND day = 'mon' OR fare BETWEEN -1.5 AND ?"));
+    CPPTEST_ASSERT(filter);
+    CPPTEST_ASSERT(IsRead(filter->child(), "trips"));
+
+    // AND binds tighter than OR.
+    auto orOperator = std::dynamic_pointer_cast<AST::OrOperator>(filter->expr());
+    CPPTEST_ASSERT(orOperator);
+    auto andOperator = std::dynamic_pointer_cast<AST::AndOperator>(orOperator->lhs());
+    CPPTEST_ASSERT(andOperator);
+    auto greater = std::dynamic_pointer_cast<AST::GTOperator>(andOperator->lhs());
+    CPPTEST_ASSERT(greater && IsColumn(greater->lhs(), "", "id"));
+    auto one = std::dynamic_pointer_cast<AST::ConstantInt>(greater->rhs());
+    CPPTEST_ASSERT(one && one->value() == 1);
+    auto equal = std::dynamic_pointer_cast<AST::EqOperator>(andOperator->rhs());
+    CPPTEST_ASSERT(equal && IsColumn(equal->lhs(), "", "day"));
+    auto monday = std::dynamic_pointer_cast<AST::ConstantString>(equal->rhs());
+    CPPTEST_ASSERT(monday && monday->value() == "mon");
+
+    // BETWEEN is both of its bounds.
+    auto between = std::dynamic_pointer_cast<AST::AndOperator>(orOperator->rhs());
+    CPPTEST_ASSERT(between);
+    auto low = std::dynamic_pointer_cast<AST::GTEOperator>(between->lhs());
+    CPPTEST_ASSERT(low && IsColumn(low->lhs(), "", "fare"));
+    auto lowValue = std::dynamic_pointer_cast<AST::ConstantFloat>(low->rhs());
+    CPPTEST_ASSERT(lowValue && lowValue->value() == -1.5f);
+    auto high = std::dynamic_pointer_cast<AST::LTEOperator>(between->rhs());
+    CPPTEST_ASSERT(high);
+    auto parameter = std::dynamic_pointer_cast<AST::Parameter>(high->rhs());
+    CPPTEST_ASSERT(parameter && parameter->index() == 0);
+}
+
+NEW_TEST(ParserTest, Join) {
+    using namespace metaldb::QueryEngine;
+    auto join = std::dynamic_pointer_cast<AST::Join>(Parse("SELECT * FROM trips t LEFT OUTER JOIN zones AS z ON t.id = z.id"));
+    CPPTEST_ASSERT(join);
+    CPPTEST_ASSERT(join->joinType() == AST::Join::LEFT);
+    CPPTEST_ASSERT(IsRead(join->lhs(), "trips"));
+    CPPTEST_ASSERT(IsRead(join->rhs(), "zones"));
+
+    // Aliases are replaced by their tables.
+    auto condition = std::dynamic_pointer_cast<AST::EqOperator>(join->expr());
+    CPPTEST_ASSERT(condition);
+    CPPTEST_ASSERT(IsColumn(condition->lhs(), "trips", "id"));
+    CPPTEST_ASSERT(IsColumn(condition->rhs(), "zones", "id"));
+
+    // Joins are applied from left to right.
+    auto joins = std::dynamic_pointer_cast<AST::Join>(Parse("SELECT * FROM trips JOIN zones ON trips.id = zones.id RIGHT JOIN fares ON trips.id = fares.id"));
+    CPPTEST_ASSERT(joins && joins->joinType() == AST::Join::RIGHT);
+    CPPTEST_ASSERT(IsRead(joins->rhs(), "fares"));
+    auto inner = std::dynamic_pointer_cast<AST::Join>(joins->lhs());
+    CPPTEST_ASSERT(inner && inner->joinType() == AST::Join::NATURAL);
+}
+
+NEW_TEST(ParserTest, QualifiedColumns) {
+    using namespace metaldb::QueryEngine;
+    // The items come before FROM, but still name the tables their aliases stand for.
+    auto projection = std::dynamic_pointer_cast<AST::Projection>(Parse("SELECT z.name, trips.name FROM trips LEFT JOIN zones z ON trips.id = z.id"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT(projection->columns() == std::vector<AST::ColumnRef>({{"zones", "name"}, {"trips", "name"}}));
+
+    auto sorted = std::dynamic_pointer_cast<AST::OrderBy>(Parse("SELECT z.day, SUM(z.fare) FROM trips t JOIN zones z ON t.id = z.id GROUP BY z.day ORDER BY z.day"));
+    CPPTEST_ASSERT(sorted && sorted->columns().at(0).column == AST::ColumnRef("zones", "day"));
+    auto aggregate = std::dynamic_pointer_cast<AST::Aggregate>(sorted->child());
+    CPPTEST_ASSERT(aggregate);
+    CPPTEST_ASSERT(aggregate->groupBy() == std::vector<AST::ColumnRef>({{"zones", "day"}}));
+    CPPTEST_ASSERT(aggregate->aggregations().at(0).column == AST::ColumnRef("zones", "fare"));
+
+    auto window = std::dynamic_pointer_cast<AST::Window>(Parse("SELECT *, LAG(z.fare) OVER (PARTITION BY z.day ORDER BY t.id) FROM trips t JOIN zones z ON t.id = z.id"));
+    CPPTEST_ASSERT(window);
+    CPPTEST_ASSERT(window->partitionBy() == std::vector<AST::ColumnRef>({{"zones", "day"}}));
+    CPPTEST_ASSERT(window->orderBy().at(0).column == AST::ColumnRef("trips", "id"));
+    CPPTEST_ASSERT(window->functions().at(0).column == AST::ColumnRef("zones", "fare"));
+
+    // A column without a table is in GROUP BY as either side's.
+    CPPTEST_ASSERT(Parse("SELECT t.day, COUNT(*) FROM trips t GROUP BY day"));
+
+    // A table that isn't in FROM.
+    CPPTEST_ASSERT(!Parse("SELECT fares.id FROM trips"));
+    CPPTEST_ASSERT(!Parse("SELECT * FROM trips t WHERE trips2.id > 1"));
+    CPPTEST_ASSERT(!Parse("SELECT id FROM trips ORDER BY z.id"));
+}
+
+NEW_TEST(ParserTest, GroupBy) {
+    using namespace metaldb::QueryEngine;
+    auto aggregate = std::dynamic_pointer_cast<AST::Aggregate>(Parse("SELECT day, COUNT(*), APPROX_PERCENTILE(fare, 0.9) AS p90 FROM trips GROUP BY day"));
+    CPPTEST_ASSERT(aggregate);
+    CPPTEST_ASSERT(aggregate->groupBy() == std::vector<AST::ColumnRef>({"day"}));
+    CPPTEST_ASSERT(IsRead(aggregate->child(), "trips"));
+
+    auto aggregations = aggregate->aggregations();
+    CPPTEST_ASSERT(aggregations.size() == 2);
+    CPPTEST_ASSERT(aggregations.at(0).function == AST::Aggregate::COUNT);
+    CPPTEST_ASSERT(aggregations.at(0).column.column.empty());
+    CPPTEST_ASSERT(aggregations.at(1).function == AST::Aggregate::APPROX_PERCENTILE);
+    CPPTEST_ASSERT(aggregations.at(1).column == "fare");
+    CPPTEST_ASSERT(aggregations.at(1).alias == "p90");
+    CPPTEST_ASSERT(std::abs(aggregations.at(1).percentile - 0.9) < 1e-6);
+
+    // Items in another order than the aggregate outputs them are projected.
+    auto projection = std::dynamic_pointer_cast<AST::Projection>(Parse("SELECT SUM(fare), day FROM trips GROUP BY day"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT(projection->columns() == std::vector<AST::ColumnRef>({"SUM(fare)", "day"}));
+    CPPTEST_ASSERT(std::dynamic_pointer_cast<AST::Aggregate>(projection->child()));
+}
+
+NEW_TEST(ParserTest, Window) {
+    using namespace metaldb::QueryEngine;
+    auto window = std::dynamic_pointer_cast<AST::Window>(Parse("SELECT *, LAG(fare, 2) OVER w, ROW_NUMBER() OVER w FROM trips WINDOW w AS (PARTITION BY day ORDER BY id DESC)"));
+    CPPTEST_ASSERT(window);
+    CPPTEST_ASSERT(window->partitionBy() == std::vector<AST::ColumnRef>({"day"}));
+    CPPTEST_ASSERT(window->orderBy().size() == 1);
+    CPPTEST_ASSERT(window->orderBy().at(0).column == "id");
+    CPPTEST_ASSERT(!window->orderBy().at(0).ascending);
+
+    auto functions = window->functions();
+    CPPTEST_ASSERT(functions.size() == 2);
+    CPPTEST_ASSERT(functions.at(0).function == AST::Window::LAG);
+    CPPTEST_ASSERT(functions.at(0).column == "fare");
+    CPPTEST_ASSERT(functions.at(0).offset == 2);
+    CPPTEST_ASSERT(functions.at(1).function == AST::Window::ROW_NUMBER);
+
+    // A window written after OVER is the same as a named one.
+    auto projection = std::dynamic_pointer_cast<AST::Projection>(Parse("SELECT id, RANK() OVER (ORDER BY fare) AS r FROM trips"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT(projection->columns() == std::vector<AST::ColumnRef>({"id", "r"}));
+    CPPTEST_ASSERT(std::dynamic_pointer_cast<AST::Window>(projection->child()));
+}
+
+NEW_TEST(ParserTest, SetOperationOrderAndLimit) {
+    using namespace metaldb::QueryEngine;
+    auto limit = std::dynamic_pointer_cast<AST::Limit>(Parse("SELECT DISTINCT day FROM trips UNION ALL SELECT day FROM zones ORDER BY day DESC, id LIMIT 10"));
+    CPPTEST_ASSERT(limit && limit->value() == 10);
+
+    auto orderBy = std::dynamic_pointer_cast<AST::OrderBy>(limit->child());
+    CPPTEST_ASSERT(orderBy);
+    auto columns = orderBy->columns();
+    CPPTEST_ASSERT(columns.size() == 2);
+    CPPTEST_ASSERT(columns.at(0).column == "day" && !columns.at(0).ascending);
+    CPPTEST_ASSERT(columns.at(1).column == "id" && columns.at(1).ascending);
+
+    auto setOperation = std::dynamic_pointer_cast<AST::SetOperation>(orderBy->child());
+    CPPTEST_ASSERT(setOperation && setOperation->operation() == AST::SetOperation::UNION_ALL);
+    auto distinct = std::dynamic_pointer_cast<AST::Distinct>(setOperation->lhs());
+    CPPTEST_ASSERT(distinct && std::dynamic_pointer_cast<AST::Projection>(distinct->child()));
+    CPPTEST_ASSERT(std::dynamic_pointer_cast<AST::Projection>(setOperation->rhs()));
+
+    auto except = std::dynamic_pointer_cast<AST::SetOperation>(Parse("SELECT id FROM trips INTERSECT SELECT id FROM zones EXCEPT SELECT id FROM fares"));
+    CPPTEST_ASSERT(except && except->operation() == AST::SetOperation::EXCEPT);
+    auto intersect = std::dynamic_pointer_cast<AST::SetOperation>(except->lhs());
+    CPPTEST_ASSERT(intersect && intersect->operation() == AST::SetOperation::INTERSECT);
+
+    // A single SELECT sorts by the column an alias renames.
+    auto sorted = std::dynamic_pointer_cast<AST::OrderBy>(Parse("SELECT id AS trip FROM trips ORDER BY trip"));
+    CPPTEST_ASSERT(sorted && sorted->columns().at(0).column == "id");
+}
+
+NEW_TEST(ParserTest, Into) {
+    using namespace metaldb::QueryEngine;
+    auto write = std::dynamic_pointer_cast<AST::Write>(Parse("SELECT id AS trip, day INTO 'it''s.csv' FROM trips"));
+    CPPTEST_ASSERT(write);
+    CPPTEST_ASSERT(write->filepath() == "it's.csv");
+    CPPTEST_ASSERT(write->columns() == std::vector<std::string>({"trip", "day"}));
+    CPPTEST_ASSERT(std::dynamic_pointer_cast<AST::Projection>(write->child()));
+}
+
+NEW_TEST(ParserTest, IntegerRange) {
+    using namespace metaldb::QueryEngine;
+    auto filter = std::dynamic_pointer_cast<AST::Filter>(Parse("SELECT * FROM trips WHERE id > -2147483648"));
+    CPPTEST_ASSERT(filter);
+    auto greater = std::dynamic_pointer_cast<AST::GTOperator>(filter->expr());
+    auto value = greater ? std::dynamic_pointer_cast<AST::ConstantInt>(greater->rhs()) : nullptr;
+    CPPTEST_ASSERT(value && value->value() == std::numeric_limits<int>::min());
+
+    // An integer too large for an integer column isn't rounded to a float.
+    CPPTEST_ASSERT(!Parse("SELECT * FROM trips WHERE id > 2147483648"));
+    CPPTEST_ASSERT(!Parse("SELECT * FROM trips WHERE id > -2147483649"));
+    CPPTEST_ASSERT(!Parse("SELECT LAG(id, 99999999999) OVER (ORDER BY id) FROM trips"));
+    CPPTEST_ASSERT(Parse("SELECT * FROM trips WHERE fare > 2147483648.0"));
+
+    // The normalized query keeps the integer, so it fails to parse too.
+    std::vector<AST::Parameter::Value> constants;
+    const auto normalized = Parser().Normalize("SELECT * FROM trips WHERE id > 2147483648 AND id < 5", constants);
+    CPPTEST_ASSERT(normalized == "SELECT * FROM trips WHERE id > 2147483648 AND id < ?");
+    CPPTEST_ASSERT(constants.size() == 1 && std::get<int>(constants.at(0)) == 5);
+}
+
+NEW_TEST(ParserTest, Errors) {
+    const std::vector<std::string> queries = {
+        // Syntax
+        "SELECT FROM trips",
+        "SELECT * trips",
+        "SELECT * FROM trips WHERE (id > 1",
+        "SELECT * FROM trips extra name",
+        "SELECT * FROM trips WHERE day = 'mon",
+        "SELECT * FROM trips LIMIT ten",
+        "SELECT * INTO out FROM trips",
+        "SELECT * FROM trips UNION SELECT * INTO 'out.csv' FROM zones",
+        // Conditions
+        "SELECT * FROM trips WHERE id",
+        "SELECT * FROM trips WHERE id > -day",
+        "SELECT * FROM trips WHERE NOT id > 1",
+        "SELECT * FROM trips WHERE id <> 1",
+        "SELECT * FROM trips WHERE id != 1",
+        "SELECT * FROM trips JOIN zones ON trips.id = 1",
+        // Functions
+        "SELECT COUNT(*, day) FROM trips",
+        "SELECT MEDIAN(fare) FROM trips",
+        "SELECT SUM(fare, 2) FROM trips",
+        "SELECT APPROX_PERCENTILE(fare, 2) FROM trips",
+        "SELECT NTILE(fare) OVER (ORDER BY id) FROM trips",
+        "SELECT LAG(fare, 0) OVER (ORDER BY id) FROM trips",
+        "SELECT LAG(fare, 0.5) OVER (ORDER BY id) FROM trips",
+        // Items
+        "SELECT day, COUNT(*) FROM trips GROUP BY day HAVING COUNT(*) > 1",
+        "SELECT *, COUNT(*) FROM trips",
+        "SELECT id, COUNT(*) FROM trips GROUP BY day",
+        "SELECT ROW_NUMBER() OVER w FROM trips",
+        "SELECT ROW_NUMBER() OVER (ORDER BY id), RANK() OVER (ORDER BY day) FROM trips",
+        "SELECT ROW_NUMBER() OVER (ORDER BY id), * FROM trips",
+        "SELECT *, id FROM trips",
+    };
+    for (const auto& query : queries) {
+        CPPTEST_ASSERT(!Parse(query));
+    }
+}
+
+CPPTEST_END_CLASS(ParserTest)
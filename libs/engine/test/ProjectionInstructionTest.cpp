@@ -1,7 +1,12 @@
 #include <cpptest/cpptest.hpp>
 #include <metaldb/engine/Instructions.hpp>
 
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
 #include "RawTableCreator.hpp"
+#include "RowProjection.hpp"
+
+#include <string_view>
 
 static metaldb::TempRow GenerateTempRow() {
     metaldb::TempRow::TempRowBuilder builder;
@@ -86,4 +91,40 @@ NEW_TEST(ProjectionInstructionTest, ReadProjectionInstruction) {
     }
 }
 
+NEW_TEST(ProjectionInstructionTest, ProjectRowsOnCpu) {
+    using namespace metaldb;
+    OutputRowWriter::OutputRowBuilder inputBuilder;
+    inputBuilder.columnTypes = {Integer, String, Float_opt};
+    OutputRowWriter inputWriter(inputBuilder);
+    const types::IntegerType ids[] = {1, 2, 3};
+    const types::FloatType fare = 2.5f;
+    for (const auto& id : ids) {
+        // The second row has a null fare.
+        const auto name = std::string("row") + std::to_string(id);
+        inputWriter.appendRow({
+            {(const char*) &id, sizeof(id)},
+            {name.data(), (OutputRow::ColumnSizeType) name.size()},
+            id == 2 ? OutputRowWriter::ColumnValue{} : OutputRowWriter::ColumnValue{(const char*) &fare, sizeof(fare)}
+        });
+    }
+    std::vector<char> input;
+    inputWriter.write(input);
+
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = {Float_opt, String};
+    OutputRowWriter writer(builder);
+    RowProjection({2, 1}).project(input, writer, 1);
+
+    std::vector<char> output;
+    writer.write(output);
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 2);
+    CPPTEST_ASSERT(reader.NumColumns() == 2);
+    CPPTEST_ASSERT(reader.ColumnData(0, 0).second == 0);
+    CPPTEST_ASSERT(ReadBytesStartingAt<types::FloatType>(reader.ColumnData(0, 1).first) == fare);
+
+    auto [name, nameSize] = reader.ColumnData(1, 1);
+    CPPTEST_ASSERT(std::string_view(name, nameSize) == "row3");
+}
+
 CPPTEST_END_CLASS(ProjectionInstructionTest)
@@ -0,0 +1,417 @@
+#include <cpptest/cpptest.hpp>
+
+#include <metaldb/query_engine/partials.hpp>
+#include <metaldb/query_engine/query_engine.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace {
+    /**
+     * A query engine over three tables, `trips`, `fares` and `zones`, each with a single file in a temporary directory.
+     * There are many more fares than trips or zones.
+     */
+    struct Tables {
+        std::filesystem::path directory;
+        metaldb::QueryEngine::QueryEngine engine;
+
+        Tables() {
+            using namespace metaldb;
+            directory = std::filesystem::temp_directory_path() / "metaldb_query_planner_test";
+            std::filesystem::remove_all(directory);
+            std::filesystem::create_directories(directory / "trips");
+            std::filesystem::create_directories(directory / "fares");
+            std::filesystem::create_directories(directory / "zones");
+            std::ofstream(directory / "trips" / "0.csv") << "id,day\n1,mon\n2,tue\n";
+            std::ofstream(directory / "zones" / "0.csv") << "id,zone\n1,A\n2,B\n";
+            std::ofstream fares(directory / "fares" / "0.csv");
+            fares << "id,fare\n";
+            for (std::size_t i = 0; i < 1000; ++i) {
+                fares << i << ",2.5\n";
+            }
+
+            QueryEngine::TableDefinition trips;
+            trips.name = "trips";
+            trips.filePath = directory / "trips";
+            trips.columns.emplace_back("id", Integer);
+            trips.columns.emplace_back("day", 3, String);
+            engine.metadata.addTable(trips);
+
+            QueryEngine::TableDefinition faresTable;
+            faresTable.name = "fares";
+            faresTable.filePath = directory / "fares";
+            faresTable.columns.emplace_back("id", Integer);
+            faresTable.columns.emplace_back("fare", Float);
+            engine.metadata.addTable(faresTable);
+
+            QueryEngine::TableDefinition zones;
+            zones.name = "zones";
+            zones.filePath = directory / "zones";
+            zones.columns.emplace_back("id", Integer);
+            zones.columns.emplace_back("zone", 1, String);
+            engine.metadata.addTable(zones);
+        }
+
+        ~Tables() {
+            std::filesystem::remove_all(directory);
+        }
+
+        metaldb::QueryEngine::QueryPlan compile(const std::string& query) {
+            return engine.compile(metaldb::QueryEngine::Parser().Parse(query));
+        }
+    };
+
+    /**
+     * Returns the projection of the only stage of a plan, if it projects the output of its own child stage on the CPU, and
+     * that child is a @b Partial .
+     */
+    template<typename Partial>
+    std::shared_ptr<metaldb::QueryEngine::ProjectionPartial> CpuProjectionOf(const metaldb::QueryEngine::QueryPlan& plan) {
+        using namespace metaldb::QueryEngine;
+        if (plan.stages.size() != 1) {
+            return nullptr;
+        }
+        const auto& stage = plan.stages.at(0);
+        auto projection = std::dynamic_pointer_cast<ProjectionPartial>(stage->partial);
+        if (!projection || stage->execution != CPU || projection->execution != CPU || stage->children.size() != 1) {
+            return nullptr;
+        }
+        if (!std::dynamic_pointer_cast<Partial>(stage->children.at(0)->partial)) {
+            return nullptr;
+        }
+        return projection;
+    }
+
+    /**
+     * Records the statistics of the file of `trips`, whose ids are between 1 and 2.
+     */
+    void AddTripsStatistics(Tables& tables) {
+        using namespace metaldb::QueryEngine;
+        const auto path = (tables.directory / "trips" / "0.csv").string();
+        auto statistics = std::make_shared<FileStatistics>();
+        const auto current = FileEntry{path}.current();
+        statistics->rowCount = 2;
+        statistics->fileSize = current.fileSize;
+        statistics->modifiedTime = current.modifiedTime;
+        statistics->columns.resize(2);
+        statistics->columns.at(0).min = 1;
+        statistics->columns.at(0).max = 2;
+        tables.engine.metadata.fileStatistics[path] = statistics;
+    }
+
+    std::shared_ptr<metaldb::QueryEngine::ReadPartial> FindRead(const std::shared_ptr<metaldb::QueryEngine::StagePartial>& partial) {
+        if (auto read = std::dynamic_pointer_cast<metaldb::QueryEngine::ReadPartial>(partial)) {
+            return read;
+        }
+        for (const auto& child : partial->children) {
+            if (auto read = FindRead(child)) {
+                return read;
+            }
+        }
+        return nullptr;
+    }
+}
+
+class QueryPlannerTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(QueryPlannerTest)
+
+NEW_TEST(QueryPlannerTest, ProjectReadOnGpu) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    auto plan = tables.compile("SELECT day FROM trips");
+
+    // The projection is encoded after the read, in the same GPU stage.
+    CPPTEST_ASSERT(plan.stages.size() == 1);
+    const auto& stage = plan.stages.at(0);
+    auto projection = std::dynamic_pointer_cast<ProjectionPartial>(stage->partial);
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT(stage->execution == GPU);
+    CPPTEST_ASSERT(stage->children.empty());
+    CPPTEST_ASSERT(projection->children.size() == 1);
+    CPPTEST_ASSERT(std::dynamic_pointer_cast<ReadPartial>(projection->children.at(0)));
+}
+
+NEW_TEST(QueryPlannerTest, ProjectFilterOnCpu) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    auto projection = CpuProjectionOf<FilterPartial>(tables.compile("SELECT day FROM trips WHERE id > 1"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT((projection->columnIndexes == std::vector<ProjectionPartial::ColumnIndexType>{1}));
+}
+
+NEW_TEST(QueryPlannerTest, FilterMergesIntegersWithFloats) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    auto predicateOf = [&](const std::string& query) -> std::optional<Predicate> {
+        auto plan = tables.compile(query);
+        auto filter = plan.stages.empty() ? nullptr : std::dynamic_pointer_cast<FilterPartial>(plan.stages.at(0)->partial);
+        if (!filter) {
+            return std::nullopt;
+        }
+        return filter->predicate;
+    };
+
+    // Both bounds of the float column are doubles, so they're found to contradict each other.
+    auto predicate = predicateOf("SELECT * FROM fares WHERE fare > 5 AND fare < 3.0");
+    CPPTEST_ASSERT(predicate && predicate->isFalse());
+
+    predicate = predicateOf("SELECT * FROM fares WHERE fare >= 2 AND fare <= 2.0");
+    CPPTEST_ASSERT(predicate && predicate->operation == Predicate::EQ);
+    CPPTEST_ASSERT(std::get<double>(predicate->value) == 2.0);
+
+    // The bounds of the integer column are rounded to the integers that keep them the same.
+    predicate = predicateOf("SELECT * FROM trips WHERE id >= 1.5 AND id <= 1.9");
+    CPPTEST_ASSERT(predicate && predicate->isFalse());
+
+    predicate = predicateOf("SELECT * FROM trips WHERE id >= 0.5 AND id <= 1");
+    CPPTEST_ASSERT(predicate && predicate->operation == Predicate::EQ);
+    CPPTEST_ASSERT(std::get<std::int64_t>(predicate->value) == 1);
+
+    predicate = predicateOf("SELECT * FROM trips WHERE id = 1.5");
+    CPPTEST_ASSERT(predicate && predicate->isFalse());
+}
+
+NEW_TEST(QueryPlannerTest, ProjectJoinOnCpu) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    auto projection = CpuProjectionOf<JoinPartial>(tables.compile("SELECT trips.day, fares.fare FROM trips JOIN fares ON trips.id = fares.id"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT(projection->definition->columns.size() == 2);
+}
+
+NEW_TEST(QueryPlannerTest, QualifiedColumnsOfJoin) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+
+    // The join outputs trips' id and day, then zones' id, renamed since trips has one too, and zone.
+    auto projection = CpuProjectionOf<JoinPartial>(tables.compile("SELECT zones.id, trips.id, z.zone FROM trips LEFT JOIN zones z ON trips.id = z.id"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT((projection->columnIndexes == std::vector<ProjectionPartial::ColumnIndexType>{2, 0, 3}));
+
+    auto plan = tables.compile("SELECT * FROM trips LEFT JOIN zones ON trips.id = zones.id ORDER BY zones.id DESC");
+    CPPTEST_ASSERT(plan.stages.size() == 1);
+    auto sort = std::dynamic_pointer_cast<SortPartial>(plan.stages.at(0)->partial);
+    CPPTEST_ASSERT(sort && sort->sortColumns.size() == 1 && sort->sortColumns.at(0).column == 2);
+
+    plan = tables.compile("SELECT zones.id, COUNT(*) FROM trips LEFT JOIN zones ON trips.id = zones.id GROUP BY zones.id");
+    CPPTEST_ASSERT(!plan.stages.empty());
+    auto aggregate = std::dynamic_pointer_cast<AggregatePartial>(plan.stages.at(0)->partial);
+    CPPTEST_ASSERT(aggregate && aggregate->groupByColumnIndexes == std::vector<AggregatePartial::ColumnIndexType>{2});
+
+    // A column the table doesn't have isn't found on the other side of the join.
+    CPPTEST_ASSERT(tables.compile("SELECT zones.day FROM trips LEFT JOIN zones ON trips.id = zones.id").stages.empty());
+}
+
+NEW_TEST(QueryPlannerTest, ReorderedJoinProjectsOnCpu) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+
+    // Trips and zones are joined first, since there are fewer of them, then the columns are projected back to where they
+    // were written.
+    auto projection = CpuProjectionOf<JoinPartial>(tables.compile("SELECT * FROM trips JOIN fares ON trips.id = fares.id JOIN zones ON trips.id = zones.id"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT((projection->columnIndexes == std::vector<ProjectionPartial::ColumnIndexType>{0, 1, 4, 5, 2, 3}));
+}
+
+NEW_TEST(QueryPlannerTest, JoinRejectsTooManyColumns) {
+    using namespace metaldb;
+    Tables tables;
+
+    // Each wide table has half of the columns a row can have, so joining it with anything has too many.
+    for (const auto& name : {"lhs", "rhs"}) {
+        QueryEngine::TableDefinition wide;
+        wide.name = name;
+        wide.filePath = tables.directory / "trips";
+        for (std::size_t i = 0; i <= QueryEngine::ProjectionPartial::MaxNumColumns / 2; ++i) {
+            wide.columns.emplace_back("c" + std::to_string(i), Integer);
+        }
+        tables.engine.metadata.addTable(wide);
+    }
+
+    CPPTEST_ASSERT(tables.compile("SELECT * FROM lhs JOIN rhs ON lhs.c0 = rhs.c0").stages.empty());
+    CPPTEST_ASSERT(tables.compile("SELECT * FROM lhs JOIN trips ON lhs.c0 = trips.id JOIN rhs ON trips.id = rhs.c0").stages.empty());
+}
+
+NEW_TEST(QueryPlannerTest, ProjectAggregateOnCpu) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+
+    // The aggregate outputs the group by columns first, so a different order is projected.
+    auto projection = CpuProjectionOf<AggregatePartial>(tables.compile("SELECT COUNT(*) AS n, day FROM trips GROUP BY day"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT((projection->columnIndexes == std::vector<ProjectionPartial::ColumnIndexType>{1, 0}));
+}
+
+NEW_TEST(QueryPlannerTest, ProjectWindowOnCpu) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    auto projection = CpuProjectionOf<WindowPartial>(tables.compile("SELECT day, ROW_NUMBER() OVER (PARTITION BY day ORDER BY id) AS r FROM trips"));
+    CPPTEST_ASSERT(projection);
+    CPPTEST_ASSERT((projection->columnIndexes == std::vector<ProjectionPartial::ColumnIndexType>{1, 2}));
+}
+
+NEW_TEST(QueryPlannerTest, FileChangedInPlaceIgnoresStatistics) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    const auto path = (tables.directory / "trips" / "0.csv").string();
+    auto readOf = [&]{
+        auto plan = tables.compile("SELECT day FROM trips");
+        return plan.stages.empty() ? nullptr : FindRead(plan.stages.at(0)->partial);
+    };
+
+    auto statistics = std::make_shared<FileStatistics>();
+    const auto current = FileEntry{path}.current();
+    statistics->rowCount = 2;
+    statistics->fileSize = current.fileSize;
+    statistics->modifiedTime = current.modifiedTime;
+    tables.engine.metadata.fileStatistics[path] = statistics;
+
+    auto read = readOf();
+    CPPTEST_ASSERT(read);
+    CPPTEST_ASSERT(read->statistics == statistics);
+
+    // Appending doesn't change the directory, so the listing is still cached with the old size.
+    std::ofstream(path, std::ios::app) << "3,wed\n";
+    read = readOf();
+    CPPTEST_ASSERT(read);
+    CPPTEST_ASSERT(!read->statistics);
+    CPPTEST_ASSERT(read->collectedStatistics);
+    CPPTEST_ASSERT(read->fileSize == current.fileSize + 6);
+    CPPTEST_ASSERT(read->collectedStatistics->fileSize == read->fileSize);
+}
+
+NEW_TEST(QueryPlannerTest, ReusedPlanBindsItsFilter) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    AddTripsStatistics(tables);
+
+    Parser parser;
+    auto compile = [&](const std::string& query) {
+        std::vector<AST::Parameter::Value> arguments;
+        auto statement = tables.engine.prepare(parser, query, arguments);
+        return tables.engine.compile(*statement, arguments);
+    };
+    auto filterOf = [](const QueryPlan& plan) {
+        return plan.stages.empty() ? nullptr : std::dynamic_pointer_cast<FilterPartial>(plan.stages.at(0)->partial);
+    };
+
+    // Every id is less than 5, so the file is kept but none of its rows are read.
+    auto plan = compile("SELECT * FROM trips WHERE id > 5");
+    auto filter = filterOf(plan);
+    CPPTEST_ASSERT(filter);
+    auto read = FindRead(plan.stages.at(0)->children.at(0)->partial);
+    CPPTEST_ASSERT(read);
+    CPPTEST_ASSERT(read->rowRanges && read->rowRanges->empty());
+
+    // A copy of the same plan is bound to the new constant, and reads the file again.  The copies keep the ids of the
+    // partials they were copied from.
+    auto reused = compile("SELECT * FROM trips WHERE id > 1");
+    auto reusedFilter = filterOf(reused);
+    CPPTEST_ASSERT(reusedFilter && reusedFilter != filter && reusedFilter->id() == filter->id());
+    CPPTEST_ASSERT(std::get<std::int64_t>(reusedFilter->predicate.value) == 1);
+    auto reusedRead = FindRead(reused.stages.at(0)->children.at(0)->partial);
+    CPPTEST_ASSERT(reusedRead && reusedRead != read && reusedRead->id() == read->id());
+    CPPTEST_ASSERT(!reusedRead->rowRanges);
+
+    reused = compile("SELECT * FROM trips WHERE id > 7");
+    reusedRead = FindRead(reused.stages.at(0)->children.at(0)->partial);
+    CPPTEST_ASSERT(reusedRead && reusedRead->id() == read->id());
+    CPPTEST_ASSERT(reusedRead->rowRanges && reusedRead->rowRanges->empty());
+
+    // No row passes, then every row does, but the filter and its read stay in the plan for the next constants.
+    plan = compile("SELECT * FROM trips WHERE 1 = 2");
+    filter = filterOf(plan);
+    CPPTEST_ASSERT(filter);
+    read = FindRead(plan.stages.at(0)->children.at(0)->partial);
+    CPPTEST_ASSERT(read->rowRanges && read->rowRanges->empty());
+    reused = compile("SELECT * FROM trips WHERE 1 = 1");
+    reusedFilter = filterOf(reused);
+    CPPTEST_ASSERT(reusedFilter && reusedFilter->id() == filter->id());
+    CPPTEST_ASSERT(reusedFilter->predicate.isTrue());
+    CPPTEST_ASSERT(!FindRead(reused.stages.at(0)->children.at(0)->partial)->rowRanges);
+}
+
+NEW_TEST(QueryPlannerTest, ReusedPlansKeepTheirOwnArguments) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    AddTripsStatistics(tables);
+
+    Parser parser;
+    auto compile = [&](const std::string& query) {
+        std::vector<AST::Parameter::Value> arguments;
+        auto statement = tables.engine.prepare(parser, query, arguments);
+        return tables.engine.compile(*statement, arguments);
+    };
+
+    // Compiling the statement again doesn't change the plan compiled before it, so both can be run.
+    auto none = compile("SELECT * FROM trips WHERE id > 5");
+    auto some = compile("SELECT * FROM trips WHERE id > 1");
+    auto noneFilter = std::dynamic_pointer_cast<FilterPartial>(none.stages.at(0)->partial);
+    auto someFilter = std::dynamic_pointer_cast<FilterPartial>(some.stages.at(0)->partial);
+    CPPTEST_ASSERT(noneFilter && someFilter && noneFilter != someFilter);
+    CPPTEST_ASSERT(std::get<std::int64_t>(noneFilter->predicate.value) == 5);
+    CPPTEST_ASSERT(std::get<std::int64_t>(someFilter->predicate.value) == 1);
+    auto noneRead = FindRead(none.stages.at(0)->children.at(0)->partial);
+    auto someRead = FindRead(some.stages.at(0)->children.at(0)->partial);
+    CPPTEST_ASSERT(noneRead && noneRead->rowRanges && noneRead->rowRanges->empty());
+    CPPTEST_ASSERT(someRead && !someRead->rowRanges);
+
+    // A string can't be compared with the ids, so the plan can't be reused, or compiled again.
+    CPPTEST_ASSERT(compile("SELECT * FROM trips WHERE id > 'a'").stages.empty());
+    CPPTEST_ASSERT(std::get<std::int64_t>(noneFilter->predicate.value) == 5);
+    CPPTEST_ASSERT(noneRead->rowRanges && noneRead->rowRanges->empty());
+    auto other = compile("SELECT * FROM trips WHERE id > 0");
+    CPPTEST_ASSERT(!other.stages.empty());
+
+    // The statement is only bound while it's compiled.
+    std::vector<AST::Parameter::Value> arguments;
+    auto statement = tables.engine.prepare(parser, "SELECT * FROM trips WHERE id > 3", arguments);
+    CPPTEST_ASSERT(std::holds_alternative<std::monostate>(statement->parameters.at(0)->value()));
+}
+
+NEW_TEST(QueryPlannerTest, QueryThatFailsToPlanHasNoStages) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    Parser parser;
+
+    // The filter compares two columns, then a column and a table don't exist.
+    for (const auto& query : {"SELECT * FROM trips WHERE id > day", "SELECT fare FROM trips", "SELECT * FROM rides"}) {
+        for (const auto& into : {"", " INTO 'out'"}) {
+            auto text = std::string(query);
+            text.insert(text.find(" FROM"), into);
+            auto expr = parser.Parse(text);
+            CPPTEST_ASSERT(expr);
+            CPPTEST_ASSERT(tables.engine.compile(expr).stages.empty());
+
+            std::vector<AST::Parameter::Value> arguments;
+            auto statement = tables.engine.prepare(parser, text, arguments);
+            CPPTEST_ASSERT(tables.engine.compile(*statement, arguments).stages.empty());
+        }
+    }
+}
+
+NEW_TEST(QueryPlannerTest, PreparedStatementCountsParameters) {
+    using namespace metaldb::QueryEngine;
+    Tables tables;
+    Parser parser;
+
+    // A question mark in the file written to isn't a parameter.
+    std::vector<AST::Parameter::Value> arguments;
+    auto statement = tables.engine.prepare(parser, "SELECT day INTO 'day?.csv' FROM trips WHERE id > 1 AND id < 3", arguments);
+    CPPTEST_ASSERT(statement->numParameters == 2);
+    CPPTEST_ASSERT(arguments.size() == 2);
+}
+
+CPPTEST_END_CLASS(QueryPlannerTest)
@@ -127,4 +127,78 @@ NEW_TEST(RawTableTest, MultiGroupTest) {
     CPPTEST_ASSERT(offset == rawTableCPU.data.size());
 }
 
+NEW_TEST(RawTableTest, RowRangesTest) {
+    auto [rawData, rowIndexes] = StringsToRow("a,b,c",
+                                              "d,e,f",
+                                              "g,h,i",
+                                              "j,k,l",
+                                              "m,n,o",
+                                              "p,q,r",
+                                              "s,t,u",
+                                              "v,w,x");
+    std::vector<std::string> columns{"colA", "colB", "colC"};
+
+    metaldb::reader::RawTable rawTableCPU{std::move(rawData), rowIndexes, columns};
+    CPPTEST_ASSERT(rawTableCPU.NumRows() == 8);
+
+    // Rows 1-3 are split into groups of 2, and the last range runs past the end of the table.
+    std::vector<std::pair<std::size_t, std::size_t>> rowRanges{{1, 4}, {6, 10}};
+    auto serialized = metaldb::Scheduler::SerializeRawTable(rawTableCPU, 2, rowRanges);
+    CPPTEST_ASSERT(serialized.size() == 3);
+
+    std::vector<std::size_t> expectedStartRows{1, 3, 6};
+    std::vector<std::size_t> expectedCounts{2, 1, 2};
+    for (std::size_t chunk = 0; chunk < serialized.size(); ++chunk) {
+        auto& [ser, count] = serialized.at(chunk);
+        CPPTEST_ASSERT(count == expectedCounts.at(chunk));
+
+        auto metalRawTable = metaldb::RawTable(ser->data());
+        CPPTEST_ASSERT(metalRawTable.GetNumRows() == count);
+        CPPTEST_ASSERT(metalRawTable.GetSizeOfData() == 5 * count);
+
+        const auto startRow = expectedStartRows.at(chunk);
+        const auto offset = rowIndexes.at(startRow);
+        for (std::size_t i = 0; i < count; ++i) {
+            CPPTEST_ASSERT(metalRawTable.GetRowIndex(i) + offset == rowIndexes.at(startRow + i));
+        }
+
+        auto* data = metalRawTable.Data();
+        for (std::size_t i = 0; i < metalRawTable.GetSizeOfData(); ++i) {
+            CPPTEST_ASSERT(data[i] == rawTableCPU.data.at(i + offset));
+        }
+    }
+
+    // No rows are serialized when every range was skipped.
+    CPPTEST_ASSERT(metaldb::Scheduler::SerializeRawTable(rawTableCPU, 2, std::vector<std::pair<std::size_t, std::size_t>>{}).empty());
+}
+
+NEW_TEST(RawTableTest, RowSuffixTest) {
+    auto [rawData, rowIndexes] = StringsToRow("a,b", "c,d", "e,f");
+    std::vector<std::string> columns{"colA", "colB"};
+
+    metaldb::reader::RawTable rawTableCPU{std::move(rawData), rowIndexes, columns};
+
+    // The values of partition columns are appended to every row.
+    auto serialized = metaldb::Scheduler::SerializeRawTable(rawTableCPU, 2, std::nullopt, ",2021,06");
+    CPPTEST_ASSERT(serialized.size() == 2);
+
+    const std::string expected = "a,b,2021,06c,d,2021,06e,f,2021,06";
+    std::size_t offset = 0;
+    for (auto& [ser, count] : serialized) {
+        auto metalRawTable = metaldb::RawTable(ser->data());
+        CPPTEST_ASSERT(metalRawTable.GetNumRows() == count);
+        CPPTEST_ASSERT(metalRawTable.GetSizeOfData() == 11 * count);
+        for (std::size_t i = 0; i < count; ++i) {
+            CPPTEST_ASSERT(metalRawTable.GetRowIndex(i) == 11 * i);
+        }
+
+        auto* data = metalRawTable.Data();
+        for (std::size_t i = 0; i < metalRawTable.GetSizeOfData(); ++i) {
+            CPPTEST_ASSERT(data[i] == expected.at(i + offset));
+        }
+        offset += metalRawTable.GetSizeOfData();
+    }
+    CPPTEST_ASSERT(offset == expected.size());
+}
+
 CPPTEST_END_CLASS(RawTableTest)
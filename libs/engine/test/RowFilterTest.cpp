@@ -0,0 +1,240 @@
+#include <cpptest/cpptest.hpp>
+
+#include "RowFilter.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include "temp_row.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Row {
+        metaldb::types::IntegerType id;
+        std::optional<metaldb::types::FloatType> fare;
+        std::string date;
+    };
+
+    std::vector<char> GenerateBuffer(const std::vector<Row>& rows) {
+        metaldb::OutputRowWriter writer;
+        for (const auto& row : rows) {
+            metaldb::TempRow::TempRowBuilder builder;
+            builder.numColumns = 3;
+            builder.columnTypes[0] = metaldb::ColumnType::Integer;
+            builder.columnTypes[1] = metaldb::ColumnType::Float_opt;
+            builder.columnTypes[2] = metaldb::ColumnType::String;
+            builder.columnSizes[1] = row.fare ? sizeof(metaldb::types::FloatType) : 0;
+            builder.columnSizes[2] = row.date.size();
+
+            metaldb::TempRow tempRow = builder;
+            tempRow.Append(row.id);
+            if (row.fare) {
+                tempRow.Append(*row.fare);
+            }
+            auto date = row.date;
+            tempRow.Append(date.data(), date.size());
+            writer.appendTempRow(tempRow);
+        }
+
+        std::vector<char> buffer;
+        writer.write(buffer);
+        return buffer;
+    }
+
+    std::vector<metaldb::types::IntegerType> FilterIds(const std::vector<char>& buffer, const metaldb::QueryEngine::Predicate& predicate) {
+        metaldb::OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = {metaldb::Integer, metaldb::Float_opt, metaldb::String};
+        metaldb::OutputRowWriter writer(builder);
+        metaldb::RowFilter(predicate).filter(buffer, writer);
+
+        std::vector<char> output;
+        writer.write(output);
+        auto reader = metaldb::OutputRowReader(output);
+        std::vector<metaldb::types::IntegerType> ids;
+        for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+            ids.push_back(metaldb::ReadBytesStartingAt<metaldb::types::IntegerType>(reader.ColumnData(0, row).first));
+        }
+        return ids;
+    }
+
+    metaldb::QueryEngine::Predicate Compare(metaldb::QueryEngine::Predicate::Operation operation, metaldb::QueryEngine::Predicate::ColumnIndexType column, std::variant<std::int64_t, double, std::string> value) {
+        metaldb::QueryEngine::Predicate predicate{operation};
+        predicate.column = column;
+        predicate.value = std::move(value);
+        return predicate;
+    }
+}
+
+class RowFilterTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(RowFilterTest)
+
+NEW_TEST(RowFilterTest, FilterRows) {
+    using namespace metaldb;
+    using Predicate = QueryEngine::Predicate;
+    auto buffer = GenerateBuffer({
+        {1, 2.5f, "2021-05-30"},
+        {2, std::nullopt, "2021-06-01"},
+        {3, 10.f, "2021-06-02"},
+        {4, 0.5f, "2021-07-01"},
+    });
+
+    // Integers are compared exactly, and with doubles otherwise.
+    CPPTEST_ASSERT((FilterIds(buffer, Compare(Predicate::GT, 0, (std::int64_t) 2)) == std::vector<types::IntegerType>{3, 4}));
+    CPPTEST_ASSERT((FilterIds(buffer, Compare(Predicate::LTE, 0, 2.5)) == std::vector<types::IntegerType>{1, 2}));
+
+    // Null values never match.
+    CPPTEST_ASSERT((FilterIds(buffer, Compare(Predicate::LT, 1, (std::int64_t) 5)) == std::vector<types::IntegerType>{1, 4}));
+    CPPTEST_ASSERT((FilterIds(buffer, Compare(Predicate::GTE, 1, 0.0)) == std::vector<types::IntegerType>{1, 3, 4}));
+
+    CPPTEST_ASSERT((FilterIds(buffer, Compare(Predicate::GTE, 2, std::string("2021-06-01"))) == std::vector<types::IntegerType>{2, 3, 4}));
+    CPPTEST_ASSERT((FilterIds(buffer, Compare(Predicate::EQ, 2, std::string("2021-06-02"))) == std::vector<types::IntegerType>{3}));
+
+    Predicate andPredicate{Predicate::AND};
+    andPredicate.children = {Compare(Predicate::GTE, 2, std::string("2021-06-01")), Compare(Predicate::GT, 1, 1.0)};
+    CPPTEST_ASSERT((FilterIds(buffer, andPredicate) == std::vector<types::IntegerType>{3}));
+
+    Predicate orPredicate{Predicate::OR};
+    orPredicate.children = {Compare(Predicate::EQ, 0, (std::int64_t) 1), Compare(Predicate::LT, 1, 1.0)};
+    CPPTEST_ASSERT((FilterIds(buffer, orPredicate) == std::vector<types::IntegerType>{1, 4}));
+
+    // Only rows in the range are filtered.
+    CPPTEST_ASSERT((FilterIds(buffer, Compare(Predicate::GT, 0, (std::int64_t) 0)).size() == 4));
+    metaldb::OutputRowWriter writer;
+    RowFilter(Compare(Predicate::GT, 0, (std::int64_t) 0)).filter(buffer, writer, 1, 3);
+    CPPTEST_ASSERT(writer.CurrentNumRows() == 2);
+}
+
+NEW_TEST(RowFilterTest, ZoneMaps) {
+    using namespace metaldb;
+    using Predicate = QueryEngine::Predicate;
+
+    std::vector<QueryEngine::ZoneMap> zoneMaps(3);
+    zoneMaps.at(0).min = 10;
+    zoneMaps.at(0).max = 20;
+    zoneMaps.at(2).minString = "2021-05-01";
+    zoneMaps.at(2).maxString = "2021-05-31";
+
+    CPPTEST_ASSERT(Compare(Predicate::GTE, 0, (std::int64_t) 20).mayMatch(zoneMaps));
+    CPPTEST_ASSERT(!Compare(Predicate::GT, 0, 20.5).mayMatch(zoneMaps));
+    CPPTEST_ASSERT(!Compare(Predicate::EQ, 0, (std::int64_t) 9).mayMatch(zoneMaps));
+    CPPTEST_ASSERT(!Compare(Predicate::GTE, 2, std::string("2021-06-01")).mayMatch(zoneMaps));
+    CPPTEST_ASSERT(Compare(Predicate::LT, 2, std::string("2021-05-02")).mayMatch(zoneMaps));
+
+    // A column without a range may have any value.
+    CPPTEST_ASSERT(Compare(Predicate::LT, 1, 0.0).mayMatch(zoneMaps));
+
+    Predicate andPredicate{Predicate::AND};
+    andPredicate.children = {Compare(Predicate::LT, 1, 0.0), Compare(Predicate::LT, 0, (std::int64_t) 5)};
+    CPPTEST_ASSERT(!andPredicate.mayMatch(zoneMaps));
+
+    Predicate orPredicate{Predicate::OR};
+    orPredicate.children = {Compare(Predicate::LT, 0, (std::int64_t) 5), Compare(Predicate::GT, 2, std::string("2021-05-30"))};
+    CPPTEST_ASSERT(orPredicate.mayMatch(zoneMaps));
+}
+
+NEW_TEST(RowFilterTest, Simplify) {
+    using namespace metaldb;
+    using Predicate = QueryEngine::Predicate;
+    auto buffer = GenerateBuffer({
+        {1, 2.5f, "2021-05-30"},
+        {2, std::nullopt, "2021-06-01"},
+        {3, 10.f, "2021-06-02"},
+        {4, 0.5f, "2021-07-01"},
+    });
+
+    // Only the tightest bounds are kept, and nested ANDs are flattened.
+    Predicate nested{Predicate::AND};
+    nested.children = {Compare(Predicate::GT, 0, (std::int64_t) 1), Compare(Predicate::LTE, 0, (std::int64_t) 3)};
+    Predicate bounds{Predicate::AND};
+    bounds.children = {Compare(Predicate::GTE, 0, (std::int64_t) 1), nested, Compare(Predicate::LT, 0, (std::int64_t) 4), Predicate::True()};
+    auto simplified = bounds.simplified();
+    CPPTEST_ASSERT(simplified.operation == Predicate::AND && simplified.children.size() == 2);
+    CPPTEST_ASSERT(simplified.children.at(0).operation == Predicate::GT && simplified.children.at(1).operation == Predicate::LTE);
+    CPPTEST_ASSERT((FilterIds(buffer, simplified) == FilterIds(buffer, bounds)));
+    CPPTEST_ASSERT((FilterIds(buffer, simplified) == std::vector<types::IntegerType>{2, 3}));
+
+    // Bounds that meet are an EQ.
+    Predicate meet{Predicate::AND};
+    meet.children = {Compare(Predicate::GTE, 2, std::string("2021-06-01")), Compare(Predicate::LTE, 2, std::string("2021-06-01"))};
+    CPPTEST_ASSERT(meet.simplified().operation == Predicate::EQ);
+    CPPTEST_ASSERT((FilterIds(buffer, meet.simplified()) == std::vector<types::IntegerType>{2}));
+
+    // Bounds that don't overlap can't match.
+    Predicate contradiction{Predicate::AND};
+    contradiction.children = {Compare(Predicate::GT, 1, 5.0), Compare(Predicate::LT, 1, 5.0)};
+    CPPTEST_ASSERT(contradiction.simplified().isFalse());
+    CPPTEST_ASSERT(FilterIds(buffer, Predicate::False()).empty());
+    CPPTEST_ASSERT(!Predicate::False().mayMatch(std::vector<QueryEngine::ZoneMap>(3)));
+
+    Predicate eqs{Predicate::AND};
+    eqs.children = {Compare(Predicate::EQ, 0, (std::int64_t) 1), Compare(Predicate::EQ, 0, (std::int64_t) 2)};
+    CPPTEST_ASSERT(eqs.simplified().isFalse());
+
+    // Constants of different kinds aren't merged.
+    Predicate kinds{Predicate::AND};
+    kinds.children = {Compare(Predicate::GT, 0, (std::int64_t) 3), Compare(Predicate::LT, 0, 3.5)};
+    CPPTEST_ASSERT(kinds.simplified().children.size() == 2);
+    CPPTEST_ASSERT((FilterIds(buffer, kinds.simplified()) == std::vector<types::IntegerType>{}));
+
+    // TRUE decides an OR, and FALSE is dropped from one.
+    Predicate orTrue{Predicate::OR};
+    orTrue.children = {Compare(Predicate::EQ, 0, (std::int64_t) 1), Predicate::True()};
+    CPPTEST_ASSERT(orTrue.simplified().isTrue());
+    CPPTEST_ASSERT(FilterIds(buffer, Predicate::True()).size() == 4);
+
+    Predicate orFalse{Predicate::OR};
+    orFalse.children = {Predicate::False(), Compare(Predicate::EQ, 0, (std::int64_t) 1), Compare(Predicate::EQ, 0, (std::int64_t) 1)};
+    CPPTEST_ASSERT(orFalse.simplified().operation == Predicate::EQ);
+}
+
+NEW_TEST(RowFilterTest, SampleConjuncts) {
+    using namespace metaldb;
+    using Predicate = QueryEngine::Predicate;
+    auto buffer = GenerateBuffer({
+        {1, 2.5f, "2021-05-30"},
+        {2, std::nullopt, "2021-06-01"},
+        {3, 10.f, "2021-06-02"},
+        {4, 0.5f, "2021-07-01"},
+    });
+
+    // Every row passes the first conjunct, and one row passes the second.
+    Predicate predicate{Predicate::AND};
+    predicate.children = {Compare(Predicate::GT, 0, (std::int64_t) 0), Compare(Predicate::EQ, 2, std::string("2021-06-02"))};
+    RowFilter rowFilter(predicate);
+    auto statistics = rowFilter.sample(buffer);
+    CPPTEST_ASSERT(statistics.size() == 2);
+    CPPTEST_ASSERT(statistics.at(0).numRows == 4 && statistics.at(0).numPassed == 4);
+    CPPTEST_ASSERT(statistics.at(1).numRows == 4 && statistics.at(1).numPassed == 1);
+
+    // A conjunct that never drops a row goes last, and the rows that match don't change.
+    CPPTEST_ASSERT((QueryEngine::ConjunctStatistics::Order(statistics) == std::vector<std::size_t>{1, 0}));
+    rowFilter.reorder(statistics);
+    OutputRowWriter::OutputRowBuilder builder;
+    builder.columnTypes = {Integer, Float_opt, String};
+    OutputRowWriter writer(builder);
+    rowFilter.filter(buffer, writer);
+    CPPTEST_ASSERT(writer.CurrentNumRows() == 1);
+
+    // Cheaper conjuncts go first when they drop as many rows.
+    QueryEngine::ConjunctStatistics cheap{100, 50, 100};
+    QueryEngine::ConjunctStatistics expensive{100, 50, 1000};
+    QueryEngine::ConjunctStatistics selective{100, 1, 1000};
+    CPPTEST_ASSERT((QueryEngine::ConjunctStatistics::Order({expensive, cheap, selective}) == std::vector<std::size_t>{1, 2, 0}));
+
+    // Only an AND has conjuncts.
+    CPPTEST_ASSERT(RowFilter(Compare(Predicate::GT, 0, (std::int64_t) 0)).sample(buffer).empty());
+}
+
+CPPTEST_END_CLASS(RowFilterTest)
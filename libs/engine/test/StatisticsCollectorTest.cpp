@@ -0,0 +1,182 @@
+#include <cpptest/cpptest.hpp>
+
+#include "StatisticsCollector.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+    metaldb::reader::RawTable MakeRawTable(const std::vector<std::string>& rows) {
+        std::vector<char> buffer;
+        std::vector<metaldb::reader::RawTable::RowIndexType> rowIndexes;
+        for (const auto& row : rows) {
+            rowIndexes.push_back((metaldb::reader::RawTable::RowIndexType) buffer.size());
+            buffer.insert(buffer.end(), row.begin(), row.end());
+        }
+        return metaldb::reader::RawTable(std::move(buffer), std::move(rowIndexes), {"id", "fare", "name"});
+    }
+}
+
+class StatisticsCollectorTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(StatisticsCollectorTest)
+
+NEW_TEST(StatisticsCollectorTest, CollectColumns) {
+    using namespace metaldb;
+    auto rawTable = MakeRawTable({
+        "3,2.5,\"abc\"",
+        "1,,de",
+        "7,10.25,abc",
+        "3,0.5,",
+    });
+
+    StatisticsCollector collector({Integer, Float_opt, String_opt});
+    collector.addRows(rawTable, 0, rawTable.NumRows());
+
+    auto statistics = collector.Statistics();
+    CPPTEST_ASSERT(statistics.rowCount == 4);
+    CPPTEST_ASSERT(statistics.columns.size() == 3);
+
+    const auto& id = statistics.columns.at(0);
+    CPPTEST_ASSERT(id.nullCount == 0);
+    CPPTEST_ASSERT(id.min == 1);
+    CPPTEST_ASSERT(id.max == 7);
+    CPPTEST_ASSERT(id.distinctCount == 3);
+
+    const auto& fare = statistics.columns.at(1);
+    CPPTEST_ASSERT(fare.nullCount == 1);
+    CPPTEST_ASSERT(fare.min == 0.5);
+    CPPTEST_ASSERT(fare.max == 10.25);
+
+    // Quotes are stripped, so both "abc" are a single value.
+    const auto& name = statistics.columns.at(2);
+    CPPTEST_ASSERT(name.nullCount == 1);
+    CPPTEST_ASSERT(!name.min);
+    CPPTEST_ASSERT(name.minString == "abc");
+    CPPTEST_ASSERT(name.maxString == "de");
+    CPPTEST_ASSERT(name.distinctCount == 2);
+    CPPTEST_ASSERT(name.averageSize == 8.0 / 3);
+}
+
+NEW_TEST(StatisticsCollectorTest, MergeChunks) {
+    using namespace metaldb;
+    std::vector<std::string> rows;
+    for (int i = 0; i < 1000; ++i) {
+        rows.push_back(std::to_string(i % 100) + "," + std::to_string(i) + ".5,x" + std::to_string(i % 2));
+    }
+    auto rawTable = MakeRawTable(rows);
+
+    StatisticsCollector expected({Integer, Float_opt, String_opt});
+    expected.addRows(rawTable, 0, rawTable.NumRows());
+
+    StatisticsCollector merged({Integer, Float_opt, String_opt});
+    for (std::size_t startRow = 0; startRow < rows.size(); startRow += 300) {
+        StatisticsCollector chunk({Integer, Float_opt, String_opt});
+        chunk.addRows(rawTable, startRow, startRow + 300);
+        merged.merge(chunk);
+    }
+
+    auto expectedStatistics = expected.Statistics();
+    auto mergedStatistics = merged.Statistics();
+    CPPTEST_ASSERT(mergedStatistics.rowCount == 1000);
+    for (std::size_t column = 0; column < 3; ++column) {
+        CPPTEST_ASSERT(mergedStatistics.columns.at(column).min == expectedStatistics.columns.at(column).min);
+        CPPTEST_ASSERT(mergedStatistics.columns.at(column).max == expectedStatistics.columns.at(column).max);
+        CPPTEST_ASSERT(mergedStatistics.columns.at(column).minString == expectedStatistics.columns.at(column).minString);
+        CPPTEST_ASSERT(mergedStatistics.columns.at(column).maxString == expectedStatistics.columns.at(column).maxString);
+        CPPTEST_ASSERT(mergedStatistics.columns.at(column).distinctCount == expectedStatistics.columns.at(column).distinctCount);
+    }
+    CPPTEST_ASSERT(mergedStatistics.columns.at(1).max == 999.5);
+    CPPTEST_ASSERT(mergedStatistics.columns.at(2).distinctCount == 2);
+    CPPTEST_ASSERT(mergedStatistics.columns.at(2).minString == "x0");
+    CPPTEST_ASSERT(mergedStatistics.columns.at(2).maxString == "x1");
+
+    // Each chunk has its own zone maps.
+    StatisticsCollector chunk({Integer, Float_opt, String_opt});
+    chunk.addRows(rawTable, 100, 200);
+    auto zoneMaps = chunk.ZoneMaps();
+    CPPTEST_ASSERT(zoneMaps.size() == 3);
+    CPPTEST_ASSERT(zoneMaps.at(1).min == 100.5);
+    CPPTEST_ASSERT(zoneMaps.at(1).max == 199.5);
+}
+
+NEW_TEST(StatisticsCollectorTest, ConstantColumns) {
+    using namespace metaldb;
+    auto rawTable = MakeRawTable({
+        "3,2.5",
+        "1,",
+    });
+
+    // The last two columns are partition columns, which aren't in the rows.
+    StatisticsCollector collector({Integer, Float_opt, Integer, String_opt}, {"2021", std::nullopt});
+    collector.addRows(rawTable, 0, rawTable.NumRows());
+
+    auto statistics = collector.Statistics();
+    CPPTEST_ASSERT(statistics.columns.size() == 4);
+    CPPTEST_ASSERT(statistics.columns.at(0).max == 3);
+    CPPTEST_ASSERT(statistics.columns.at(1).nullCount == 1);
+
+    const auto& year = statistics.columns.at(2);
+    CPPTEST_ASSERT(year.nullCount == 0);
+    CPPTEST_ASSERT(year.min == 2021);
+    CPPTEST_ASSERT(year.max == 2021);
+    CPPTEST_ASSERT(year.distinctCount == 1);
+    CPPTEST_ASSERT(statistics.columns.at(3).nullCount == 2);
+}
+
+NEW_TEST(StatisticsCollectorTest, ReadCorruptSizes) {
+    using namespace metaldb::QueryEngine;
+    const auto filepath = (std::filesystem::temp_directory_path() / "metaldb_statistics_test.csv").string();
+    const auto path = StatisticsFile::PathFor(filepath);
+
+    FileStatistics statistics;
+    statistics.fileSize = 10;
+    statistics.rowCount = std::numeric_limits<std::uint32_t>::max();
+    statistics.chunkNumRows = 1;
+    statistics.columns.resize(1);
+    statistics.columns.at(0).minString = "abc";
+    statistics.chunks = {{ZoneMap()}};
+    CPPTEST_ASSERT(StatisticsFile::Write(filepath, statistics));
+    CPPTEST_ASSERT(StatisticsFile::Read(filepath, 10, 0));
+
+    std::string bytes;
+    {
+        std::ifstream stream(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(stream), {});
+    }
+
+    // Sizes past the end of the file are corrupt, rather than something to allocate.
+    const auto corrupt = [&](std::size_t offset) {
+        auto corruptBytes = bytes;
+        const auto size = std::numeric_limits<std::uint32_t>::max();
+        std::copy_n(reinterpret_cast<const char*>(&size), sizeof(size), corruptBytes.begin() + offset);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << corruptBytes;
+        return StatisticsFile::Read(filepath, 10, 0);
+    };
+
+    // The column starts after the magic, version, file size, modification time, row count and number of columns.  Its
+    // minimum string follows two empty numbers, and the chunks follow the column and the number of rows in each chunk.
+    const std::size_t columnsOffset = 8 + 3 * 8 + 4;
+    const auto stringOffset = columnsOffset + 3;
+    const auto chunksOffset = columnsOffset + (4 + 4 + 3) + 3 * 8 + 8;
+    CPPTEST_ASSERT(!corrupt(stringOffset));
+    CPPTEST_ASSERT(!corrupt(chunksOffset));
+    CPPTEST_ASSERT(!corrupt(columnsOffset - 4));
+
+    std::filesystem::remove(path);
+}
+
+CPPTEST_END_CLASS(StatisticsCollectorTest)
@@ -0,0 +1,85 @@
+#include <cpptest/cpptest.hpp>
+
+#include "TDigest.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    std::vector<double> GenerateValues(std::size_t numValues, unsigned int seed) {
+        std::mt19937 generator(seed);
+        std::exponential_distribution<double> distribution(0.1);
+
+        std::vector<double> values;
+        for (std::size_t i = 0; i < numValues; ++i) {
+            values.push_back(distribution(generator));
+        }
+        return values;
+    }
+
+    double ExactQuantile(std::vector<double> values, double q) {
+        std::sort(values.begin(), values.end());
+        return values.at((std::size_t) (q * (values.size() - 1)));
+    }
+
+    bool IsClose(double estimate, double expected, double tolerance) {
+        return std::abs(estimate - expected) <= tolerance * expected;
+    }
+}
+
+class TDigestTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(TDigestTest)
+
+NEW_TEST(TDigestTest, Quantile) {
+    using namespace metaldb;
+    TDigest::Centroids centroids;
+    TDigest::Add(centroids, 7);
+    CPPTEST_ASSERT(TDigest::Quantile(centroids, 0.5) == 7);
+
+    centroids.clear();
+    auto values = GenerateValues(100'000, 42);
+    for (const auto value : values) {
+        TDigest::Add(centroids, value);
+    }
+    CPPTEST_ASSERT(IsClose(TDigest::Quantile(centroids, 0.5), ExactQuantile(values, 0.5), 0.05));
+    CPPTEST_ASSERT(IsClose(TDigest::Quantile(centroids, 0.99), ExactQuantile(values, 0.99), 0.05));
+}
+
+NEW_TEST(TDigestTest, MergeSerializedDigests) {
+    using namespace metaldb;
+    std::vector<double> values;
+    TDigest::Centroids merged;
+    std::string serialized;
+    for (unsigned int seed = 0; seed < 20; ++seed) {
+        auto chunk = GenerateValues(5'000, seed);
+        values.insert(values.end(), chunk.begin(), chunk.end());
+
+        TDigest::Centroids centroids;
+        for (const auto value : chunk) {
+            TDigest::Add(centroids, value);
+        }
+
+        // A serialized digest must fit in a String column.
+        TDigest::Serialize(centroids, serialized);
+        CPPTEST_ASSERT(serialized.size() <= 255);
+        TDigest::Merge(merged, serialized.data(), serialized.size());
+    }
+
+    CPPTEST_ASSERT(IsClose(TDigest::Quantile(merged, 0.5), ExactQuantile(values, 0.5), 0.05));
+    CPPTEST_ASSERT(IsClose(TDigest::Quantile(merged, 0.99), ExactQuantile(values, 0.99), 0.05));
+}
+
+CPPTEST_END_CLASS(TDigestTest)
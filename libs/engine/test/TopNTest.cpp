@@ -0,0 +1,126 @@
+#include <cpptest/cpptest.hpp>
+
+#include "ExternalSort.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+#include "TopN.hpp"
+
+#include "temp_row.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+    std::vector<char> GenerateBuffer(const std::vector<metaldb::types::FloatType>& values) {
+        metaldb::OutputRowWriter writer;
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            metaldb::TempRow::TempRowBuilder builder;
+            builder.numColumns = 2;
+            builder.columnTypes[0] = metaldb::ColumnType::Integer;
+            builder.columnTypes[1] = metaldb::ColumnType::Float;
+
+            metaldb::TempRow tempRow = builder;
+            tempRow.Append((metaldb::types::IntegerType) i);
+            tempRow.Append(values.at(i));
+            writer.appendTempRow(tempRow);
+        }
+
+        std::vector<char> buffer;
+        writer.write(buffer);
+        return buffer;
+    }
+
+    std::vector<metaldb::types::FloatType> ReadValues(const std::vector<char>& buffer) {
+        std::vector<metaldb::types::FloatType> values;
+        if (buffer.empty()) {
+            return values;
+        }
+        auto reader = metaldb::OutputRowReader(buffer);
+        for (std::size_t i = 0; i < reader.NumRows(); ++i) {
+            values.push_back(metaldb::ReadBytesStartingAt<metaldb::types::FloatType>(reader.ColumnData(1, i).first));
+        }
+        return values;
+    }
+
+    std::vector<metaldb::types::FloatType> GenerateValues(std::size_t numRows) {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<metaldb::types::FloatType> values(-1000, 1000);
+
+        std::vector<metaldb::types::FloatType> output;
+        for (std::size_t i = 0; i < numRows; ++i) {
+            output.push_back(values(generator));
+        }
+        return output;
+    }
+
+    std::vector<metaldb::types::FloatType> Run(metaldb::TopN& topN, const std::vector<char>& buffer, std::size_t chunkNumRows) {
+        const auto numRows = metaldb::OutputRowReader(buffer).NumRows();
+        for (std::size_t startRow = 0; startRow < numRows; startRow += chunkNumRows) {
+            topN.addChunk(buffer, startRow, startRow + chunkNumRows);
+        }
+
+        metaldb::OutputRowWriter writer;
+        topN.write(writer);
+
+        std::vector<char> output;
+        writer.write(output);
+        return ReadValues(output);
+    }
+}
+
+class TopNTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(TopNTest)
+
+NEW_TEST(TopNTest, KeepsLargestValues) {
+    using namespace metaldb;
+    auto values = GenerateValues(10'000);
+    auto buffer = GenerateBuffer(values);
+
+    TopN topN({{1, false}}, 100);
+    auto output = Run(topN, buffer, 1000);
+
+    auto expected = values;
+    std::sort(expected.begin(), expected.end(), std::greater<>());
+    expected.resize(100);
+    CPPTEST_ASSERT(output == expected);
+
+    // Once the first chunk is merged, most rows of the later chunks can't make the cut.
+    CPPTEST_ASSERT(topN.NumRows() == 100);
+    CPPTEST_ASSERT(topN.NumDiscardedRows() > 9000);
+}
+
+NEW_TEST(TopNTest, FewerRowsThanLimit) {
+    using namespace metaldb;
+    auto buffer = GenerateBuffer({3.0f, -1.0f, 2.0f});
+
+    TopN topN({{1, true}}, 100);
+    auto output = Run(topN, buffer, 2);
+    CPPTEST_ASSERT((output == std::vector<types::FloatType>{-1.0f, 2.0f, 3.0f}));
+}
+
+NEW_TEST(TopNTest, LimitWithoutSortColumns) {
+    using namespace metaldb;
+    auto values = GenerateValues(500);
+    auto buffer = GenerateBuffer(values);
+
+    TopN topN({}, 10);
+    auto output = Run(topN, buffer, 100);
+    CPPTEST_ASSERT(output.size() == 10);
+    CPPTEST_ASSERT(topN.NumDiscardedRows() == 490);
+
+    TopN empty({{1, true}}, 0);
+    CPPTEST_ASSERT(Run(empty, buffer, 100).empty());
+}
+
+CPPTEST_END_CLASS(TopNTest)
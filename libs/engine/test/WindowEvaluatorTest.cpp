@@ -0,0 +1,169 @@
+#include <cpptest/cpptest.hpp>
+
+#include "WindowEvaluator.hpp"
+#include "OutputRowReader.hpp"
+#include "OutputRowWriter.hpp"
+
+#include "temp_row.h"
+
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace {
+    struct Row {
+        metaldb::types::IntegerType vendor;
+        metaldb::types::IntegerType time;
+        std::optional<metaldb::types::FloatType> fare;
+    };
+
+    std::vector<char> GenerateBuffer(const std::vector<Row>& rows) {
+        metaldb::OutputRowWriter writer;
+        for (const auto& row : rows) {
+            metaldb::TempRow::TempRowBuilder builder;
+            builder.numColumns = 3;
+            builder.columnTypes[0] = metaldb::ColumnType::Integer;
+            builder.columnTypes[1] = metaldb::ColumnType::Integer;
+            builder.columnTypes[2] = metaldb::ColumnType::Float_opt;
+            builder.columnSizes[2] = row.fare ? sizeof(metaldb::types::FloatType) : 0;
+
+            metaldb::TempRow tempRow = builder;
+            tempRow.Append(row.vendor);
+            tempRow.Append(row.time);
+            if (row.fare) {
+                tempRow.Append(*row.fare);
+            }
+            writer.appendTempRow(tempRow);
+        }
+
+        std::vector<char> buffer;
+        writer.write(buffer);
+        return buffer;
+    }
+
+    std::vector<char> Evaluate(const metaldb::WindowEvaluator& window) {
+        metaldb::OutputRowWriter::OutputRowBuilder builder;
+        builder.columnTypes = window.OutputColumnTypes();
+        metaldb::OutputRowWriter writer(builder);
+        for (std::size_t bucket = 0; bucket < metaldb::WindowEvaluator::NumBuckets; ++bucket) {
+            window.evaluateBucket(bucket, writer);
+        }
+
+        std::vector<char> output;
+        writer.write(output);
+        return output;
+    }
+
+    std::optional<metaldb::types::FloatType> ReadFloat(const metaldb::OutputRowReader<std::vector<char>>& reader, std::size_t column, std::size_t row) {
+        auto [data, size] = reader.ColumnData(column, row);
+        if (size == 0) {
+            return std::nullopt;
+        }
+        return metaldb::ReadBytesStartingAt<metaldb::types::FloatType>(data);
+    }
+}
+
+class WindowEvaluatorTest : public cpptest::BaseCppTest {
+public:
+    void SetUp() override {
+        // Run before every test
+    }
+
+    void TearDown() override {
+        // Run After every test
+    }
+};
+
+CPPTEST_CLASS(WindowEvaluatorTest)
+
+NEW_TEST(WindowEvaluatorTest, PartitionedFunctions) {
+    using namespace metaldb;
+    using Function = WindowEvaluator::Function;
+
+    // Two vendors, with the trips out of order and split over two chunks.
+    auto buffer = GenerateBuffer({
+        {1, 30, 3.f}, {2, 10, 100.f}, {1, 10, 1.f}, {1, 20, std::nullopt},
+        {2, 20, 200.f}, {1, 20, 2.f}, {1, 40, 4.f},
+    });
+
+    WindowEvaluator window({Integer, Integer, Float_opt}, {0}, {{1, true}}, {
+        {Function::ROW_NUMBER, std::nullopt},
+        {Function::RANK, std::nullopt},
+        {Function::SUM, 2},
+        {Function::LAG, 2},
+        {Function::LEAD, 2, 2},
+    });
+    window.addChunk(buffer, 0, 4);
+    window.addChunk(buffer, 4);
+
+    auto columnTypes = window.OutputColumnTypes();
+    CPPTEST_ASSERT(columnTypes.size() == 8);
+    CPPTEST_ASSERT(columnTypes.at(3) == Integer);
+    CPPTEST_ASSERT(columnTypes.at(5) == Float_opt);
+    CPPTEST_ASSERT(columnTypes.at(6) == Float_opt);
+
+    auto output = Evaluate(window);
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == 7);
+
+    // Each vendor's rows are together and in time order.
+    std::map<types::IntegerType, std::vector<std::size_t>> rowsByVendor;
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        rowsByVendor[ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(0, row).first)].push_back(row);
+    }
+    CPPTEST_ASSERT(rowsByVendor.at(1).size() == 5);
+    CPPTEST_ASSERT(rowsByVendor.at(2).size() == 2);
+    CPPTEST_ASSERT(rowsByVendor.at(1).back() - rowsByVendor.at(1).front() == 4);
+
+    const std::vector<types::IntegerType> expectedRowNumbers = {1, 2, 3, 4, 5};
+    const std::vector<types::IntegerType> expectedRanks = {1, 2, 2, 4, 5};
+    for (std::size_t i = 0; i < 5; ++i) {
+        const auto row = rowsByVendor.at(1).at(i);
+        CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(3, row).first) == expectedRowNumbers.at(i));
+        CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(4, row).first) == expectedRanks.at(i));
+    }
+
+    // The running sum skips the null fare.
+    const auto& vendor1 = rowsByVendor.at(1);
+    CPPTEST_ASSERT(ReadFloat(reader, 5, vendor1.at(0)) == 1.f);
+    CPPTEST_ASSERT(ReadFloat(reader, 5, vendor1.at(4)) == 10.f);
+
+    // The first row has no previous fare, and the last two have no fare two rows ahead.
+    CPPTEST_ASSERT(!ReadFloat(reader, 6, vendor1.at(0)));
+    CPPTEST_ASSERT(ReadFloat(reader, 6, vendor1.at(4)) == 3.f);
+    CPPTEST_ASSERT(ReadFloat(reader, 7, vendor1.at(2)) == 4.f);
+    CPPTEST_ASSERT(!ReadFloat(reader, 7, vendor1.at(3)));
+
+    // Partitions don't read each other's rows.
+    const auto& vendor2 = rowsByVendor.at(2);
+    CPPTEST_ASSERT(ReadFloat(reader, 5, vendor2.at(1)) == 300.f);
+    CPPTEST_ASSERT(!ReadFloat(reader, 6, vendor2.at(0)));
+    CPPTEST_ASSERT(ReadFloat(reader, 6, vendor2.at(1)) == 100.f);
+}
+
+NEW_TEST(WindowEvaluatorTest, NoPartitionBy) {
+    using namespace metaldb;
+    using Function = WindowEvaluator::Function;
+
+    std::vector<Row> rows;
+    for (types::IntegerType i = 0; i < 1000; ++i) {
+        rows.push_back({i % 3, 999 - i, 1.f});
+    }
+    auto buffer = GenerateBuffer(rows);
+
+    WindowEvaluator window({Integer, Integer, Float_opt}, {}, {{1, true}}, {{Function::ROW_NUMBER, std::nullopt}});
+    for (std::size_t startRow = 0; startRow < rows.size(); startRow += 300) {
+        window.addChunk(buffer, startRow, startRow + 300);
+    }
+    CPPTEST_ASSERT(window.NumRows(0) == rows.size());
+
+    auto output = Evaluate(window);
+    auto reader = OutputRowReader(output);
+    CPPTEST_ASSERT(reader.NumRows() == rows.size());
+    for (std::size_t row = 0; row < reader.NumRows(); ++row) {
+        CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(1, row).first) == (types::IntegerType) row);
+        CPPTEST_ASSERT(ReadBytesStartingAt<types::IntegerType>(reader.ColumnData(3, row).first) == (types::IntegerType) row + 1);
+    }
+}
+
+CPPTEST_END_CLASS(WindowEvaluatorTest)
@@ -76,4 +76,72 @@ T ThreadGroupReduceCooperativeAlgorithm(threadgroup T* scratch, T value, uint32_
     return simdAdd;
 }
 
+/**
+ * Reduction operators for @b ThreadgroupCooperativeReduce .
+ */
+template<typename T>
+struct ReduceSum {
+    static T Identity() { return 0; }
+    static T Simd(T value) { return metal::simd_sum(value); }
+};
+
+template<typename T>
+struct ReduceMin {
+    static T Identity() { return metal::numeric_limits<T>::max(); }
+    static T Simd(T value) { return metal::simd_min(value); }
+};
+
+template<typename T>
+struct ReduceMax {
+    static T Identity() { return metal::numeric_limits<T>::lowest(); }
+    static T Simd(T value) { return metal::simd_max(value); }
+};
+
+/**
+ * Performs a reduce operation on an array, with an operator such as @b ReduceMin .
+ * The result is only valid in the first simdgroup.  @b scratch can be reused once this returns.
+ */
+template<uint32_t BLOCK_SIZE, typename Op, typename T>
+T ThreadgroupCooperativeReduce(threadgroup T* scratch, T value, uint32_t local_id /*[[thread_position_in_threadgroup]]*/, ushort simdWidth /* [[ thread_execution_width ]]*/) {
+    const uint32_t numSimdGroups = (BLOCK_SIZE + simdWidth - 1) / simdWidth;
+
+    // First level of reduction in simdgroup
+    T simdValue = Op::Simd(value);
+
+    // Simdgroups without any threads must not change the result.
+    if (local_id < numSimdGroups) {
+        scratch[local_id] = Op::Identity();
+    }
+    threadgroup_barrier(metal::mem_flags::mem_threadgroup);
+
+    if (local_id % simdWidth == 0) {
+        // First thread writes to local memory
+        scratch[local_id / simdWidth] = simdValue;
+    }
+    threadgroup_barrier(metal::mem_flags::mem_threadgroup);
+
+    if (local_id < simdWidth) {
+        simdValue = (local_id < numSimdGroups) ? scratch[local_id] : Op::Identity();
+        simdValue = Op::Simd(simdValue);
+    }
+    threadgroup_barrier(metal::mem_flags::mem_threadgroup);
+
+    return simdValue;
+}
+
 #endif
+
+/**
+ * Replaces each value with the sum of the values before it, and returns the sum of every value.
+ * This is the scan for a single thread, such as on the CPU, where there is no simdgroup to cooperate with.
+ */
+template<typename T>
+static T ExclusivePrefixSum(METAL_DEVICE T* values, uint32_t count) CPP_NOEXCEPT {
+    T sum = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const T value = values[i];
+        values[i] = sum;
+        sum += value;
+    }
+    return sum;
+}
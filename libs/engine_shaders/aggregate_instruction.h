@@ -0,0 +1,284 @@
+#pragma once
+
+#include "constants.h"
+#include "column_type.h"
+#include "db_constants.h"
+#include "output_row.h"
+#include "temp_row.h"
+#include "PrefixSum.h"
+
+#ifndef __METAL__
+#include <limits>
+#endif
+
+namespace metaldb {
+    /**
+     * Reduces the @b TempRow of every thread in the threadgroup into a single row of partial aggregates, so each chunk
+     * outputs one row instead of one per input row.  It must be immediately followed by an @b OutputInstruction .
+     *
+     * The output has a column for each aggregation: an Integer count for COUNT, a nullable Float for SUM, MIN and MAX,
+     * or a Float sum followed by an Integer count for AVG.  SUM, MIN, MAX and AVG only reduce Float columns.
+     */
+    class AggregateInstruction {
+    public:
+        enum Function : InstSerializedValue {
+            // Counts every row, `COUNT(*)`
+            COUNT_ALL,
+            // Counts the non-null values of a column.
+            COUNT,
+            SUM,
+            MIN,
+            MAX,
+            AVG
+        };
+
+        /**
+         * The type to store the number of aggregations.
+         */
+        using NumAggregationsType = uint8_t;
+
+        /**
+         * The starting offset of the number of aggregations.
+         */
+        METAL_CONSTANT static constexpr auto NumAggregationsOffset = 0;
+
+        /**
+         * The type to store the index of the column to aggregate.
+         */
+        using ColumnIndexType = OutputRow::NumColumnsType;
+
+        /**
+         * The starting offset of the aggregations.  Each is its @b Function followed by the column it reduces.
+         */
+        METAL_CONSTANT static constexpr auto AggregationsOffset = sizeof(NumAggregationsType) + NumAggregationsOffset;
+
+        METAL_CONSTANT static constexpr auto SizeOfAggregation = sizeof(Function) + sizeof(ColumnIndexType);
+
+        /**
+         * The maximum number of aggregations in a single instruction, bounded by the space each thread keeps for the results.
+         */
+        METAL_CONSTANT static constexpr NumAggregationsType MAX_NUM_AGGREGATIONS = 16;
+
+#ifndef __METAL__
+        AggregateInstruction() CPP_NOEXCEPT : _instructions(nullptr) {}
+#endif
+        AggregateInstruction(InstSerializedValuePtr instructions) CPP_NOEXCEPT : _instructions(instructions) {}
+
+        NumAggregationsType NumAggregations() const CPP_NOEXCEPT {
+            return ReadBytesStartingAt<NumAggregationsType>(&this->_instructions[NumAggregationsOffset]);
+        }
+
+        Function GetFunction(NumAggregationsType index) const CPP_NOEXCEPT {
+            return ReadBytesStartingAt<Function>(&this->_instructions[AggregationsOffset + (index * SizeOfAggregation)]);
+        }
+
+        /**
+         * Returns the column reduced by an aggregation.  It is unused by `COUNT(*)`.
+         */
+        ColumnIndexType GetColumnIndex(NumAggregationsType index) const CPP_NOEXCEPT {
+            return ReadBytesStartingAt<ColumnIndexType>(&this->_instructions[AggregationsOffset + (index * SizeOfAggregation) + sizeof(Function)]);
+        }
+
+        /**
+         * Returns a pointer 1 past the end of the aggregate instruction.  This will either be an unknown if we exceed the end of the array or
+         * an encoded @b InstructionType .
+         */
+        InstSerializedValuePtr End() const CPP_NOEXCEPT {
+            // Returns 1 past the end of the instruction
+            const auto numAggregations = this->NumAggregations();
+            const auto offset = AggregationsOffset + (numAggregations * SizeOfAggregation);
+            return &this->_instructions[offset];
+        }
+
+        /**
+         * Reduces the rows of every thread.  The first thread returns the row of partial aggregates, and every other thread
+         * returns an empty row, which the @b OutputInstruction skips.
+         *
+         * In metal, the reduction is done cooperatively with simdgroup reductions in @b constants.rowSizeScratch .
+         * On the CPU, the threads run one after another, so each thread folds its row into a running total kept in
+         * @b constants.rowSizeScratch , and replaces the row written by the thread before it.
+         *
+         * @param row The row of this thread.  Rows removed by a filter are empty, and contribute nothing.
+         * @param constants The struct of constants to use as temporary storage.
+         */
+        TempRow GetRow(TempRow METAL_THREAD & row, DbConstants METAL_THREAD & constants) const CPP_NOEXCEPT {
+            const auto numAggregations = this->NumAggregations();
+            const bool isFirstThread = constants.thread_position_in_threadgroup == 0;
+
+            uint32_t counts[MAX_NUM_AGGREGATIONS];
+            types::FloatType values[MAX_NUM_AGGREGATIONS];
+            for (NumAggregationsType i = 0; i < numAggregations; ++i) {
+                const auto function = this->GetFunction(i);
+                const auto column = this->GetColumnIndex(i);
+
+                const bool hasValue = row.NumColumns() > 0 && (function == COUNT_ALL || row.HasValue(column));
+                const uint32_t count = hasValue ? 1 : 0;
+                types::FloatType value = AggregateInstruction::Identity(function);
+                if (hasValue && function != COUNT_ALL && function != COUNT) {
+                    value = row.ReadColumnFloat(column);
+                }
+#ifdef __METAL__
+                // Every thread runs the same function, so every thread reaches the same barriers.
+                counts[i] = ThreadgroupCooperativeReduce<DbConstants::MAX_NUM_ROWS, ReduceSum<uint32_t>>(constants.rowSizeScratch, count, constants.thread_position_in_threadgroup, constants.thread_execution_width);
+
+                auto floatScratch = (threadgroup types::FloatType*) constants.rowSizeScratch;
+                switch (function) {
+                case COUNT_ALL:
+                case COUNT:
+                    values[i] = value;
+                    break;
+                case SUM:
+                case AVG:
+                    values[i] = ThreadgroupCooperativeReduce<DbConstants::MAX_NUM_ROWS, ReduceSum<types::FloatType>>(floatScratch, value, constants.thread_position_in_threadgroup, constants.thread_execution_width);
+                    break;
+                case MIN:
+                    values[i] = ThreadgroupCooperativeReduce<DbConstants::MAX_NUM_ROWS, ReduceMin<types::FloatType>>(floatScratch, value, constants.thread_position_in_threadgroup, constants.thread_execution_width);
+                    break;
+                case MAX:
+                    values[i] = ThreadgroupCooperativeReduce<DbConstants::MAX_NUM_ROWS, ReduceMax<types::FloatType>>(floatScratch, value, constants.thread_position_in_threadgroup, constants.thread_execution_width);
+                    break;
+                }
+#else
+                // Each aggregation keeps its count, then the bits of its value.
+                auto* runningCount = &constants.rowSizeScratch[2 * i];
+                auto* runningValue = &constants.rowSizeScratch[(2 * i) + 1];
+                if (isFirstThread) {
+                    *runningCount = 0;
+                    *runningValue = FloatToBits(AggregateInstruction::Identity(function));
+                }
+                counts[i] = *runningCount += count;
+                values[i] = AggregateInstruction::Combine(function, BitsToFloat(*runningValue), value);
+                *runningValue = FloatToBits(values[i]);
+#endif
+            }
+
+            if (!isFirstThread) {
+#ifdef __METAL__
+                return TempRow();
+#else
+                // Rewind the output to the end of its header, so the output instruction overwrites the previous running row.
+                const NumBytesType lengthOfHeader = ReadBytesStartingAt<OutputRow::SizeOfHeaderType>(&constants.outputBuffer[OutputRow::SizeOfHeaderOffset]);
+                WriteBytesStartingAt(&constants.outputBuffer[OutputRow::NumBytesOffset], lengthOfHeader);
+#endif
+            }
+
+            return this->MakeRow(counts, values);
+        }
+
+    private:
+        using NumBytesType = OutputRow::NumBytesType;
+
+        InstSerializedValuePtr _instructions;
+
+        static types::FloatType Identity(Function function) CPP_NOEXCEPT {
+            switch (function) {
+            case MIN:
+#ifdef __METAL__
+                return metal::numeric_limits<types::FloatType>::max();
+#else
+                return std::numeric_limits<types::FloatType>::max();
+#endif
+            case MAX:
+#ifdef __METAL__
+                return metal::numeric_limits<types::FloatType>::lowest();
+#else
+                return std::numeric_limits<types::FloatType>::lowest();
+#endif
+            case COUNT_ALL:
+            case COUNT:
+            case SUM:
+            case AVG:
+                return 0;
+            }
+        }
+
+#ifndef __METAL__
+        static types::FloatType Combine(Function function, types::FloatType lhs, types::FloatType rhs) CPP_NOEXCEPT {
+            switch (function) {
+            case MIN:
+                return rhs < lhs ? rhs : lhs;
+            case MAX:
+                return rhs > lhs ? rhs : lhs;
+            case SUM:
+            case AVG:
+                return lhs + rhs;
+            case COUNT_ALL:
+            case COUNT:
+                return lhs;
+            }
+        }
+
+        static NumBytesType FloatToBits(types::FloatType value) CPP_NOEXCEPT {
+            static_assert(sizeof(NumBytesType) == sizeof(types::FloatType));
+            union {
+                types::FloatType a;
+                NumBytesType bits;
+            } thing;
+            thing.a = value;
+            return thing.bits;
+        }
+
+        static types::FloatType BitsToFloat(NumBytesType bits) CPP_NOEXCEPT {
+            union {
+                NumBytesType bits;
+                types::FloatType a;
+            } thing;
+            thing.bits = bits;
+            return thing.a;
+        }
+#endif
+
+        /**
+         * Builds the row of partial aggregates from the reduced count and value of each aggregation.
+         */
+        TempRow MakeRow(const METAL_THREAD uint32_t* counts, const METAL_THREAD types::FloatType* values) const CPP_NOEXCEPT {
+            const auto numAggregations = this->NumAggregations();
+
+            TempRow::TempRowBuilder builder;
+            for (NumAggregationsType i = 0; i < numAggregations; ++i) {
+                switch (this->GetFunction(i)) {
+                case COUNT_ALL:
+                case COUNT:
+                    builder.columnTypes[builder.numColumns] = Integer;
+                    builder.columnSizes[builder.numColumns++] = sizeof(types::IntegerType);
+                    break;
+                case AVG:
+                    builder.columnTypes[builder.numColumns] = Float;
+                    builder.columnSizes[builder.numColumns++] = sizeof(types::FloatType);
+                    builder.columnTypes[builder.numColumns] = Integer;
+                    builder.columnSizes[builder.numColumns++] = sizeof(types::IntegerType);
+                    break;
+                case SUM:
+                case MIN:
+                case MAX:
+                    // Null when there were no values.
+                    builder.columnTypes[builder.numColumns] = Float_opt;
+                    builder.columnSizes[builder.numColumns++] = counts[i] > 0 ? sizeof(types::FloatType) : 0;
+                    break;
+                }
+            }
+
+            TempRow newRow = builder;
+            for (NumAggregationsType i = 0; i < numAggregations; ++i) {
+                switch (this->GetFunction(i)) {
+                case COUNT_ALL:
+                case COUNT:
+                    newRow.Append((types::IntegerType) counts[i]);
+                    break;
+                case AVG:
+                    newRow.Append(values[i]);
+                    newRow.Append((types::IntegerType) counts[i]);
+                    break;
+                case SUM:
+                case MIN:
+                case MAX:
+                    if (counts[i] > 0) {
+                        newRow.Append(values[i]);
+                    }
+                    break;
+                }
+            }
+            return newRow;
+        }
+    };
+}
@@ -7,6 +7,7 @@
 #include "projection_instruction.h"
 #include "filter_instruction.h"
 #include "output_instruction.h"
+#include "aggregate_instruction.h"
 #include "method.h"
 #include "temp_row.h"
 #include "db_constants.h"
@@ -57,6 +58,13 @@ namespace metaldb {
                 currentInstruction = filterInstruction.End();
                 break;
             }
+            case metaldb::AGGREGATE: {
+                auto aggregateInstruction = AggregateInstruction(&currentInstruction[1]);
+                row = aggregateInstruction.GetRow(row, constants);
+
+                currentInstruction = aggregateInstruction.End();
+                break;
+            }
             case metaldb::OUTPUT: {
                 auto outputInstruction = OutputInstruction(&currentInstruction[1]);
                 outputInstruction.WriteRow(row, constants);
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "constants.h"
+
+#ifndef __METAL__
+#include <atomic>
+#endif
+
+namespace metaldb {
+#ifdef __METAL__
+    using AtomicUInt32 = metal::atomic_uint;
+#else
+    using AtomicUInt32 = std::atomic<uint32_t>;
+#endif
+
+    /**
+     * A fixed capacity, open addressing hash table from 32 bit keys to 32 bit values, safe to use from many threads at once.
+     *
+     * The table does not own its memory, so it can be placed in a metal buffer.  The slots are grouped into buckets the size of
+     * a cache line, and a key is probed bucket by bucket, starting from the bucket of its hash.  Keys are claimed with an
+     * atomic compare and swap, and are never removed, so threads can insert and update values without locks.
+     *
+     * One key, @b EmptyKey , is reserved to mark empty slots.
+     */
+    class HashTable {
+    public:
+        using KeyType = uint32_t;
+        using ValueType = uint32_t;
+        using SizeType = types::SizeType;
+
+        METAL_CONSTANT static constexpr KeyType EmptyKey = 0xffffffff;
+
+        /**
+         * Returned by @b Find and @b FindOrInsert when the key is not in the table, or the table is full.
+         */
+        METAL_CONSTANT static constexpr SizeType NotFound = 0xffffffffffffffff;
+
+        METAL_CONSTANT static constexpr SizeType SlotsPerBucket = 8;
+
+        /**
+         * The keys of a bucket are kept together, so a probe reads a single cache line.
+         */
+        struct Bucket {
+            AtomicUInt32 keys[SlotsPerBucket];
+            AtomicUInt32 values[SlotsPerBucket];
+        };
+
+        /**
+         * @param buckets The memory for the table.  It must be cleared with @b Clear before the first insert.
+         * @param numBuckets The number of buckets in @b buckets , which must be a power of 2.
+         */
+        HashTable(METAL_DEVICE Bucket* buckets, SizeType numBuckets) CPP_NOEXCEPT : _buckets(buckets), _numBuckets(numBuckets) {}
+
+        /**
+         * Returns the number of buckets needed to hold @b numKeys keys, keeping the table at most half full.
+         */
+        static SizeType NumBucketsFor(SizeType numKeys) CPP_NOEXCEPT {
+            SizeType numBuckets = 1;
+            while (numBuckets * SlotsPerBucket < numKeys * 2) {
+                numBuckets <<= 1;
+            }
+            return numBuckets;
+        }
+
+        /**
+         * Marks every slot as empty.  This must not run at the same time as any other method.
+         */
+        void Clear() CPP_NOEXCEPT {
+            for (SizeType i = 0; i < this->Capacity(); ++i) {
+                HashTable::Store(this->KeyPtr(i), EmptyKey);
+                HashTable::Store(this->ValuePtr(i), 0);
+            }
+        }
+
+        /**
+         * Returns the number of slots in the table.
+         */
+        SizeType Capacity() const CPP_NOEXCEPT {
+            return this->_numBuckets * SlotsPerBucket;
+        }
+
+        /**
+         * Returns the slot of a key, or @b NotFound .
+         */
+        SizeType Find(KeyType key) const CPP_NOEXCEPT {
+            auto bucket = HashTable::Hash(key) & (this->_numBuckets - 1);
+            for (SizeType probe = 0; probe < this->_numBuckets; ++probe) {
+                for (SizeType i = 0; i < SlotsPerBucket; ++i) {
+                    const auto slot = (bucket * SlotsPerBucket) + i;
+                    const auto current = HashTable::Load(this->KeyPtr(slot));
+                    if (current == key) {
+                        return slot;
+                    }
+                    if (current == EmptyKey) {
+                        // Keys are never removed, so the key would have been inserted here.
+                        return NotFound;
+                    }
+                }
+                bucket = (bucket + 1) & (this->_numBuckets - 1);
+            }
+            return NotFound;
+        }
+
+        /**
+         * Returns the slot of a key, inserting it if it is not in the table.  Returns @b NotFound if the table is full.
+         */
+        SizeType FindOrInsert(KeyType key) CPP_NOEXCEPT {
+            auto bucket = HashTable::Hash(key) & (this->_numBuckets - 1);
+            for (SizeType probe = 0; probe < this->_numBuckets; ++probe) {
+                for (SizeType i = 0; i < SlotsPerBucket; ++i) {
+                    const auto slot = (bucket * SlotsPerBucket) + i;
+                    auto METAL_DEVICE * keyPtr = this->KeyPtr(slot);
+                    const auto current = HashTable::Load(keyPtr);
+                    if (current == key) {
+                        return slot;
+                    }
+                    if (current != EmptyKey) {
+                        continue;
+                    }
+
+                    // Claim the slot.  If another thread claimed it first, it may have been for the same key.
+                    // A spurious failure leaves the slot empty, so try again rather than skip over it.
+                    KeyType expected = EmptyKey;
+                    while (!HashTable::CompareExchange(keyPtr, expected, key) && expected == EmptyKey) {}
+                    if (expected == EmptyKey || expected == key) {
+                        return slot;
+                    }
+                }
+                bucket = (bucket + 1) & (this->_numBuckets - 1);
+            }
+            return NotFound;
+        }
+
+        /**
+         * Returns the key in a slot, which is @b EmptyKey if the slot is unused.
+         */
+        KeyType KeyAt(SizeType slot) const CPP_NOEXCEPT {
+            return HashTable::Load(this->KeyPtr(slot));
+        }
+
+        ValueType ValueAt(SizeType slot) const CPP_NOEXCEPT {
+            return HashTable::Load(this->ValuePtr(slot));
+        }
+
+        /**
+         * Atomically adds to the value in a slot, returning the previous value.
+         */
+        ValueType FetchAdd(SizeType slot, ValueType value) CPP_NOEXCEPT {
+#ifdef __METAL__
+            return metal::atomic_fetch_add_explicit(this->ValuePtr(slot), value, metal::memory_order_relaxed);
+#else
+            return this->ValuePtr(slot)->fetch_add(value, std::memory_order_relaxed);
+#endif
+        }
+
+        /**
+         * Atomically replaces the value in a slot with the smaller of it and @b value .
+         */
+        void FetchMin(SizeType slot, ValueType value) CPP_NOEXCEPT {
+#ifdef __METAL__
+            metal::atomic_fetch_min_explicit(this->ValuePtr(slot), value, metal::memory_order_relaxed);
+#else
+            auto current = this->ValuePtr(slot)->load(std::memory_order_relaxed);
+            while (value < current && !this->ValuePtr(slot)->compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+#endif
+        }
+
+        /**
+         * Atomically replaces the value in a slot with the larger of it and @b value .
+         */
+        void FetchMax(SizeType slot, ValueType value) CPP_NOEXCEPT {
+#ifdef __METAL__
+            metal::atomic_fetch_max_explicit(this->ValuePtr(slot), value, metal::memory_order_relaxed);
+#else
+            auto current = this->ValuePtr(slot)->load(std::memory_order_relaxed);
+            while (value > current && !this->ValuePtr(slot)->compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+#endif
+        }
+
+        // Finalizer from MurmurHash3, spreads every input bit across the output.
+        static KeyType Hash(KeyType key) CPP_NOEXCEPT {
+            key ^= key >> 16;
+            key *= 0x85ebca6b;
+            key ^= key >> 13;
+            key *= 0xc2b2ae35;
+            key ^= key >> 16;
+            return key;
+        }
+
+    private:
+        METAL_DEVICE Bucket* _buckets;
+        SizeType _numBuckets;
+
+        METAL_DEVICE AtomicUInt32* KeyPtr(SizeType slot) const CPP_NOEXCEPT {
+            return &this->_buckets[slot / SlotsPerBucket].keys[slot % SlotsPerBucket];
+        }
+
+        METAL_DEVICE AtomicUInt32* ValuePtr(SizeType slot) const CPP_NOEXCEPT {
+            return &this->_buckets[slot / SlotsPerBucket].values[slot % SlotsPerBucket];
+        }
+
+        static uint32_t Load(METAL_DEVICE AtomicUInt32* ptr) CPP_NOEXCEPT {
+#ifdef __METAL__
+            return metal::atomic_load_explicit(ptr, metal::memory_order_relaxed);
+#else
+            return ptr->load(std::memory_order_acquire);
+#endif
+        }
+
+        static void Store(METAL_DEVICE AtomicUInt32* ptr, uint32_t value) CPP_NOEXCEPT {
+#ifdef __METAL__
+            metal::atomic_store_explicit(ptr, value, metal::memory_order_relaxed);
+#else
+            ptr->store(value, std::memory_order_release);
+#endif
+        }
+
+        static bool CompareExchange(METAL_DEVICE AtomicUInt32* ptr, METAL_THREAD uint32_t & expected, uint32_t desired) CPP_NOEXCEPT {
+#ifdef __METAL__
+            return metal::atomic_compare_exchange_weak_explicit(ptr, &expected, desired, metal::memory_order_relaxed, metal::memory_order_relaxed);
+#else
+            return ptr->compare_exchange_strong(expected, desired, std::memory_order_acq_rel, std::memory_order_acquire);
+#endif
+        }
+    };
+
+#ifndef __METAL__
+    static_assert(sizeof(HashTable::Bucket) == 64, "A bucket should fill a cache line.");
+#endif
+}
@@ -8,5 +8,6 @@ namespace metaldb {
         PROJECTION,
         FILTER,
         OUTPUT,
+        AGGREGATE,
     };
 }
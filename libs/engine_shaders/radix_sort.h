@@ -0,0 +1,100 @@
+#pragma once
+
+#include "constants.h"
+#include "PrefixSum.h"
+
+namespace metaldb {
+    /**
+     * A key to sort by, and the row it came from.
+     */
+    struct RadixSortItem {
+        uint64_t key;
+        uint32_t row;
+    };
+
+    /**
+     * The steps of a least significant digit radix sort over @b RadixSortItem , shared by the metal kernels and the CPU.
+     *
+     * The items are split into blocks, and each block is handled by a single thread.  Every pass sorts by one 8 bit digit of
+     * the key, starting from the least significant:
+     *   1. @b Histogram counts the digits of each block.
+     *   2. The counts are laid out digit by digit, then block by block, so @b ExclusivePrefixSum turns them into the offset each
+     *      block writes each of its digits to.
+     *   3. @b Scatter moves the items of each block to their offsets.  This keeps the order of equal digits, so the order from
+     *      the earlier passes is kept.
+     *
+     * Keys compare as unsigned integers, so signed and floating point values are first mapped with @b IntegerKey and @b FloatKey .
+     */
+    class RadixSort {
+    public:
+        using SizeType = uint32_t;
+
+        METAL_CONSTANT static constexpr uint32_t RadixBits = 8;
+        METAL_CONSTANT static constexpr uint32_t NumBuckets = 1 << RadixBits;
+
+        /**
+         * Returns the number of passes needed to sort keys which only use their lowest @b numKeyBytes bytes.
+         */
+        static uint32_t NumPasses(uint32_t numKeyBytes) CPP_NOEXCEPT {
+            return (numKeyBytes * 8 + RadixBits - 1) / RadixBits;
+        }
+
+        static uint32_t Digit(uint64_t key, uint32_t pass) CPP_NOEXCEPT {
+            return (uint32_t) ((key >> (pass * RadixBits)) & (NumBuckets - 1));
+        }
+
+        /**
+         * Returns the index of the count of @b digit in @b block , in the counts of every block.
+         */
+        static SizeType CountIndex(uint32_t digit, SizeType block, SizeType numBlocks) CPP_NOEXCEPT {
+            return (digit * numBlocks) + block;
+        }
+
+        /**
+         * Counts the digits of the items in `[begin, end)`, which are the items of @b block .
+         * @param counts The counts of every block, with `NumBuckets * numBlocks` values.
+         */
+        static void Histogram(const METAL_DEVICE RadixSortItem* items, SizeType begin, SizeType end, uint32_t pass, SizeType block, SizeType numBlocks, METAL_DEVICE SizeType* counts) CPP_NOEXCEPT {
+            for (uint32_t digit = 0; digit < NumBuckets; ++digit) {
+                counts[CountIndex(digit, block, numBlocks)] = 0;
+            }
+            for (SizeType i = begin; i < end; ++i) {
+                counts[CountIndex(Digit(items[i].key, pass), block, numBlocks)] += 1;
+            }
+        }
+
+        /**
+         * Moves the items of @b block into @b output , after the counts of every block have been scanned into offsets.
+         */
+        static void Scatter(const METAL_DEVICE RadixSortItem* items, SizeType begin, SizeType end, uint32_t pass, SizeType block, SizeType numBlocks, const METAL_DEVICE SizeType* offsets, METAL_DEVICE RadixSortItem* output) CPP_NOEXCEPT {
+            SizeType next[NumBuckets];
+            for (uint32_t digit = 0; digit < NumBuckets; ++digit) {
+                next[digit] = offsets[CountIndex(digit, block, numBlocks)];
+            }
+            for (SizeType i = begin; i < end; ++i) {
+                output[next[Digit(items[i].key, pass)]++] = items[i];
+            }
+        }
+
+        /**
+         * Maps an integer to a key, flipping the sign bit so negative numbers come first.
+         */
+        static uint64_t IntegerKey(types::IntegerType value) CPP_NOEXCEPT {
+            return ((uint64_t) value) ^ (((uint64_t) 1) << 63);
+        }
+
+        /**
+         * Maps a float to a key.  Positive numbers have their sign bit flipped, and negative numbers have every bit flipped,
+         * so larger magnitudes come first.
+         */
+        static uint64_t FloatKey(types::FloatType value) CPP_NOEXCEPT {
+            union {
+                types::FloatType value;
+                uint32_t bits;
+            } thing;
+            thing.value = value;
+            const uint32_t bits = (thing.bits & 0x80000000) ? ~thing.bits : thing.bits ^ 0x80000000;
+            return bits;
+        }
+    };
+}
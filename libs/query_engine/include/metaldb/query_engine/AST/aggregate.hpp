@@ -0,0 +1,60 @@
+#pragma once
+
+#include "column_ref.hpp"
+#include "expr.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace metaldb::QueryEngine::AST {
+    class Aggregate final : public Expr {
+    public:
+        enum Function {
+            COUNT,
+            SUM,
+            MIN,
+            MAX,
+            AVG,
+            APPROX_COUNT_DISTINCT,
+            APPROX_PERCENTILE
+        };
+
+        struct Aggregation {
+            Function function;
+
+            // The column to aggregate.  Empty for `COUNT(*)`.
+            ColumnRef column;
+
+            // The name of the output column.  Defaults to `FUNCTION(column)` when empty.
+            std::string alias;
+
+            // The quantile estimated by `APPROX_PERCENTILE`, between 0 and 1.
+            double percentile = 0.5;
+        };
+
+        Aggregate(std::vector<ColumnRef> groupBy, std::vector<Aggregation> aggregations, std::shared_ptr<Expr> child) : _groupBy(std::move(groupBy)), _aggregations(std::move(aggregations)), _child(std::move(child)) {}
+        ~Aggregate() noexcept = default;
+
+        bool hasChild() const noexcept {
+            return this->child().operator bool();
+        }
+
+        std::shared_ptr<Expr> child() const noexcept {
+            return this->_child;
+        }
+
+        std::vector<ColumnRef> groupBy() const noexcept {
+            return this->_groupBy;
+        }
+
+        std::vector<Aggregation> aggregations() const noexcept {
+            return this->_aggregations;
+        }
+
+    private:
+        std::vector<ColumnRef> _groupBy;
+        std::vector<Aggregation> _aggregations;
+        std::shared_ptr<Expr> _child;
+    };
+}
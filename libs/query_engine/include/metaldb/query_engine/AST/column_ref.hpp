@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+namespace metaldb::QueryEngine::AST {
+    /**
+     * A column named by a query, either on its own or as `table.column`.
+     */
+    struct ColumnRef {
+        ColumnRef() = default;
+        ColumnRef(std::string column_) : column(std::move(column_)) {}
+        ColumnRef(const char* column_) : column(column_) {}
+        ColumnRef(std::string table_, std::string column_) : table(std::move(table_)), column(std::move(column_)) {}
+
+        /**
+         * The column as it was written, which is also how the columns computed from it are named.
+         */
+        std::string name() const {
+            return this->table.empty() ? this->column : this->table + "." + this->column;
+        }
+
+        bool operator==(const ColumnRef& other) const noexcept {
+            return this->table == other.table && this->column == other.column;
+        }
+
+        // The table the column is read from, or empty when the query doesn't say.
+        std::string table;
+        std::string column;
+    };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "expr.hpp"
+
+#include <memory>
+
+namespace metaldb::QueryEngine::AST {
+    /**
+     * `SELECT DISTINCT`, which removes duplicate rows from its child.
+     */
+    class Distinct final : public Expr {
+    public:
+        Distinct(std::shared_ptr<Expr> child) : _child(std::move(child)) {}
+        ~Distinct() noexcept = default;
+
+        bool hasChild() const noexcept {
+            return this->child().operator bool();
+        }
+
+        std::shared_ptr<Expr> child() const noexcept {
+            return this->_child;
+        }
+
+    private:
+        std::shared_ptr<Expr> _child;
+    };
+}
@@ -11,6 +11,18 @@ namespace metaldb::QueryEngine::AST {
         Filter(std::shared_ptr<BaseFilterExpr> expr, std::shared_ptr<Expr> child) : _expr(expr), _child(child) {}
         ~Filter() noexcept = default;
 
+        std::shared_ptr<BaseFilterExpr> expr() const noexcept {
+            return this->_expr;
+        }
+
+        bool hasChild() const noexcept {
+            return this->_child != nullptr;
+        }
+
+        std::shared_ptr<Expr> child() const noexcept {
+            return this->_child;
+        }
+
     private:
         std::shared_ptr<BaseFilterExpr> _expr;
         std::shared_ptr<Expr> _child;
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <variant>
 
 namespace metaldb::QueryEngine::AST {
     class BaseFilterExpr {
@@ -15,6 +16,10 @@ namespace metaldb::QueryEngine::AST {
         ConstantInt(int value) : _value(value) {}
         ~ConstantInt() noexcept = default;
 
+        int value() const noexcept {
+            return this->_value;
+        }
+
     private:
         int _value;
     };
@@ -24,6 +29,10 @@ namespace metaldb::QueryEngine::AST {
         ConstantFloat(float value) : _value(value) {}
         ~ConstantFloat() noexcept = default;
 
+        float value() const noexcept {
+            return this->_value;
+        }
+
     private:
         float _value;
     };
@@ -33,16 +42,75 @@ namespace metaldb::QueryEngine::AST {
         ConstantString(std::string value) : _value(std::move(value)) {}
         ~ConstantString() noexcept = default;
 
+        std::string value() const noexcept {
+            return this->_value;
+        }
+
     private:
         std::string _value;
     };
 
+    /**
+     * TRUE or FALSE, such as a comparison of two constants after it's folded.
+     */
+    class ConstantBool : public BaseFilterExpr {
+    public:
+        ConstantBool(bool value) : _value(value) {}
+        ~ConstantBool() noexcept = default;
+
+        bool value() const noexcept {
+            return this->_value;
+        }
+
+    private:
+        bool _value;
+    };
+
+    /**
+     * A `?` in a prepared query, which is replaced by the constant bound to it each time the query is compiled.
+     */
+    class Parameter : public BaseFilterExpr {
+    public:
+        // Nothing is bound yet.
+        using Value = std::variant<std::monostate, int, float, std::string>;
+
+        Parameter(std::size_t index) : _index(index) {}
+        ~Parameter() noexcept = default;
+
+        /**
+         * The position of the parameter in the query, starting at 0.
+         */
+        std::size_t index() const noexcept {
+            return this->_index;
+        }
+
+        const Value& value() const noexcept {
+            return this->_value;
+        }
+
+        void bind(Value value) noexcept {
+            this->_value = std::move(value);
+        }
+
+    private:
+        std::size_t _index;
+        Value _value;
+    };
+
     class ReadColumn : public BaseFilterExpr {
     public:
         ReadColumn(std::string table, std::string column) : _table(std::move(table)), _column(std::move(column)) {}
         ReadColumn(std::string column) : _table(""), _column(std::move(column)) {}
         ~ReadColumn() noexcept = default;
 
+        std::string table() const noexcept {
+            return this->_table;
+        }
+
+        std::string column() const noexcept {
+            return this->_column;
+        }
+
     private:
         std::string _table;
         std::string _column;
@@ -53,6 +121,14 @@ namespace metaldb::QueryEngine::AST {
         LTOperator(std::shared_ptr<BaseFilterExpr> lhs, std::shared_ptr<BaseFilterExpr> rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
         ~LTOperator() noexcept = default;
 
+        std::shared_ptr<BaseFilterExpr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<BaseFilterExpr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
     private:
         std::shared_ptr<BaseFilterExpr> _lhs;
         std::shared_ptr<BaseFilterExpr> _rhs;
@@ -63,6 +139,50 @@ namespace metaldb::QueryEngine::AST {
         GTOperator(std::shared_ptr<BaseFilterExpr> lhs, std::shared_ptr<BaseFilterExpr> rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
         ~GTOperator() noexcept = default;
 
+        std::shared_ptr<BaseFilterExpr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<BaseFilterExpr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
+    private:
+        std::shared_ptr<BaseFilterExpr> _lhs;
+        std::shared_ptr<BaseFilterExpr> _rhs;
+    };
+
+    class LTEOperator : public BaseFilterExpr {
+    public:
+        LTEOperator(std::shared_ptr<BaseFilterExpr> lhs, std::shared_ptr<BaseFilterExpr> rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
+        ~LTEOperator() noexcept = default;
+
+        std::shared_ptr<BaseFilterExpr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<BaseFilterExpr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
+    private:
+        std::shared_ptr<BaseFilterExpr> _lhs;
+        std::shared_ptr<BaseFilterExpr> _rhs;
+    };
+
+    class GTEOperator : public BaseFilterExpr {
+    public:
+        GTEOperator(std::shared_ptr<BaseFilterExpr> lhs, std::shared_ptr<BaseFilterExpr> rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
+        ~GTEOperator() noexcept = default;
+
+        std::shared_ptr<BaseFilterExpr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<BaseFilterExpr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
     private:
         std::shared_ptr<BaseFilterExpr> _lhs;
         std::shared_ptr<BaseFilterExpr> _rhs;
@@ -73,6 +193,14 @@ namespace metaldb::QueryEngine::AST {
         AndOperator(std::shared_ptr<BaseFilterExpr> lhs, std::shared_ptr<BaseFilterExpr> rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
         ~AndOperator() noexcept = default;
 
+        std::shared_ptr<BaseFilterExpr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<BaseFilterExpr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
     private:
         std::shared_ptr<BaseFilterExpr> _lhs;
         std::shared_ptr<BaseFilterExpr> _rhs;
@@ -83,6 +211,14 @@ namespace metaldb::QueryEngine::AST {
         OrOperator(std::shared_ptr<BaseFilterExpr> lhs, std::shared_ptr<BaseFilterExpr> rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
         ~OrOperator() noexcept = default;
 
+        std::shared_ptr<BaseFilterExpr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<BaseFilterExpr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
     private:
         std::shared_ptr<BaseFilterExpr> _lhs;
         std::shared_ptr<BaseFilterExpr> _rhs;
@@ -93,6 +229,14 @@ namespace metaldb::QueryEngine::AST {
         EqOperator(std::shared_ptr<BaseFilterExpr> lhs, std::shared_ptr<BaseFilterExpr> rhs) : _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
         ~EqOperator() noexcept = default;
 
+        std::shared_ptr<BaseFilterExpr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<BaseFilterExpr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
     private:
         std::shared_ptr<BaseFilterExpr> _lhs;
         std::shared_ptr<BaseFilterExpr> _rhs;
@@ -17,6 +17,22 @@ namespace metaldb::QueryEngine::AST {
         Join(JoinType joinType, std::shared_ptr<BaseFilterExpr> expr, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : _type(joinType), _expr(std::move(expr)), _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
         ~Join() noexcept = default;
 
+        JoinType joinType() const noexcept {
+            return this->_type;
+        }
+
+        std::shared_ptr<BaseFilterExpr> expr() const noexcept {
+            return this->_expr;
+        }
+
+        std::shared_ptr<Expr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<Expr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
     private:
         JoinType _type;
         std::shared_ptr<BaseFilterExpr> _expr;
@@ -10,6 +10,21 @@ namespace metaldb::QueryEngine::AST {
         Limit(std::size_t value, std::shared_ptr<Expr> parent) : _value(value), _parent(std::move(parent)) {}
         ~Limit() noexcept = default;
 
+        bool hasChild() const noexcept {
+            return this->child().operator bool();
+        }
+
+        std::shared_ptr<Expr> child() const noexcept {
+            return this->_parent;
+        }
+
+        /**
+         * The maximum number of rows to output.
+         */
+        std::size_t value() const noexcept {
+            return this->_value;
+        }
+
     private:
         std::size_t _value;
         std::shared_ptr<Expr> _parent;
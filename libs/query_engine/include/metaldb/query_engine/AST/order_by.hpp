@@ -0,0 +1,40 @@
+#pragma once
+
+#include "column_ref.hpp"
+#include "expr.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace metaldb::QueryEngine::AST {
+    class OrderBy final : public Expr {
+    public:
+        struct SortColumn {
+            ColumnRef column;
+            bool ascending = true;
+        };
+
+        OrderBy(std::vector<SortColumn> columns, std::shared_ptr<Expr> child) : _columns(std::move(columns)), _child(std::move(child)) {}
+        ~OrderBy() noexcept = default;
+
+        bool hasChild() const noexcept {
+            return this->child().operator bool();
+        }
+
+        std::shared_ptr<Expr> child() const noexcept {
+            return this->_child;
+        }
+
+        /**
+         * The columns to sort by, with the first column the most significant.
+         */
+        std::vector<SortColumn> columns() const noexcept {
+            return this->_columns;
+        }
+
+    private:
+        std::vector<SortColumn> _columns;
+        std::shared_ptr<Expr> _child;
+    };
+}
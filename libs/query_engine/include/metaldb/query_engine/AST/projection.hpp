@@ -1,5 +1,6 @@
 #pragma once
 
+#include "column_ref.hpp"
 #include "expr.hpp"
 
 #include <string>
@@ -9,7 +10,7 @@
 namespace metaldb::QueryEngine::AST {
     class Projection final : public Expr {
     public:
-        Projection(std::vector<std::string> columns, std::shared_ptr<Expr> child) : _columns(std::move(columns)), _child(std::move(child)) {}
+        Projection(std::vector<ColumnRef> columns, std::shared_ptr<Expr> child) : _columns(std::move(columns)), _child(std::move(child)) {}
         ~Projection() noexcept = default;
 
         bool hasChild() const noexcept {
@@ -20,11 +21,11 @@ namespace metaldb::QueryEngine::AST {
             return this->_child;
         }
 
-        std::vector<std::string> columns() const noexcept {
+        std::vector<ColumnRef> columns() const noexcept {
             return this->_columns;
         }
 
-        std::string column(std::size_t i) const {
+        ColumnRef column(std::size_t i) const {
             return this->_columns.at(i);
         }
 
@@ -33,7 +34,7 @@ namespace metaldb::QueryEngine::AST {
         }
 
     private:
-        std::vector<std::string> _columns;
+        std::vector<ColumnRef> _columns;
         std::shared_ptr<Expr> _child;
     };
 }
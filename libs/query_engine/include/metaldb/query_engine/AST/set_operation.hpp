@@ -0,0 +1,41 @@
+#pragma once
+
+#include "expr.hpp"
+
+#include <memory>
+
+namespace metaldb::QueryEngine::AST {
+    /**
+     * Combines the rows of two queries with the same columns.  Every operation but `UNION ALL` removes duplicate rows.
+     */
+    class SetOperation final : public Expr {
+    public:
+        enum Operation {
+            UNION,
+            // Keeps every row of both sides, so the sides are read one after the other.
+            UNION_ALL,
+            INTERSECT,
+            EXCEPT
+        };
+
+        SetOperation(Operation operation, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : _operation(operation), _lhs(std::move(lhs)), _rhs(std::move(rhs)) {}
+        ~SetOperation() noexcept = default;
+
+        Operation operation() const noexcept {
+            return this->_operation;
+        }
+
+        std::shared_ptr<Expr> lhs() const noexcept {
+            return this->_lhs;
+        }
+
+        std::shared_ptr<Expr> rhs() const noexcept {
+            return this->_rhs;
+        }
+
+    private:
+        Operation _operation;
+        std::shared_ptr<Expr> _lhs;
+        std::shared_ptr<Expr> _rhs;
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "column_ref.hpp"
+#include "expr.hpp"
+#include "order_by.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace metaldb::QueryEngine::AST {
+    /**
+     * Appends a column for each window function to the rows of its child, evaluated over `PARTITION BY ... ORDER BY ...`.
+     */
+    class Window final : public Expr {
+    public:
+        enum Function {
+            ROW_NUMBER,
+            RANK,
+            // A running sum from the start of the partition to the current row.
+            SUM,
+            LAG,
+            LEAD
+        };
+
+        struct WindowFunction {
+            Function function;
+
+            // The column to evaluate.  Empty for `ROW_NUMBER()` and `RANK()`.
+            ColumnRef column;
+
+            // The name of the output column.  Defaults to `FUNCTION(column)` when empty.
+            std::string alias;
+
+            // How many rows back or ahead `LAG` and `LEAD` read.
+            std::size_t offset = 1;
+        };
+
+        Window(std::vector<ColumnRef> partitionBy, std::vector<OrderBy::SortColumn> orderBy, std::vector<WindowFunction> functions, std::shared_ptr<Expr> child) : _partitionBy(std::move(partitionBy)), _orderBy(std::move(orderBy)), _functions(std::move(functions)), _child(std::move(child)) {}
+        ~Window() noexcept = default;
+
+        bool hasChild() const noexcept {
+            return this->child().operator bool();
+        }
+
+        std::shared_ptr<Expr> child() const noexcept {
+            return this->_child;
+        }
+
+        std::vector<ColumnRef> partitionBy() const noexcept {
+            return this->_partitionBy;
+        }
+
+        std::vector<OrderBy::SortColumn> orderBy() const noexcept {
+            return this->_orderBy;
+        }
+
+        std::vector<WindowFunction> functions() const noexcept {
+            return this->_functions;
+        }
+
+    private:
+        std::vector<ColumnRef> _partitionBy;
+        std::vector<OrderBy::SortColumn> _orderBy;
+        std::vector<WindowFunction> _functions;
+        std::shared_ptr<Expr> _child;
+    };
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "metadata.hpp"
+
+#include <string>
+
+namespace metaldb::QueryEngine {
+    /**
+     * Persists the tables, file lists and statistics of a @b Metadata in a single binary file.  Loading it at startup means
+     * the directories of a table aren't listed again until they change, and statistics don't have to be collected again.
+     */
+    class Catalog final {
+    public:
+        /**
+         * Returns false if the catalog couldn't be written.  The catalog is written next to the path first, then renamed
+         * over it, so a reader never sees half of it.
+         */
+        static bool Write(const std::string& path, const Metadata& metadata) noexcept;
+
+        /**
+         * Adds the tables, file lists and statistics in the catalog to @b metadata , replacing tables with the same name.
+         * Returns false if there is no catalog, or it's corrupt, in which case @b metadata is left unchanged.
+         */
+        static bool Read(const std::string& path, Metadata& metadata) noexcept;
+    };
+}
@@ -16,5 +16,12 @@ namespace metaldb::QueryEngine {
         std::size_t maxSize = std::numeric_limits<std::size_t>::max();
         metaldb::ColumnType type;
         bool nullable = false;
+
+        // A virtual column whose value comes from a `key=value` directory the file is in, instead of the file itself.
+        bool partition = false;
+
+        // The table the column was read from, so `table.column` still finds it after a join has renamed it.  Empty for a
+        // column computed by the query.
+        std::string table;
     };
 }
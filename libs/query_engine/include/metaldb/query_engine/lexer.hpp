@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace metaldb::QueryEngine {
+    /**
+     * Splits the text of a query into tokens.  Tokens point into the query rather than copying it, so the query has to
+     * outlive them, and lexing allocates nothing.
+     */
+    class Lexer final {
+    public:
+        struct Token {
+            enum Type {
+                // A name or a keyword, which are told apart by the parser.
+                IDENTIFIER,
+                // A name in double quotes, which may have spaces or dots in it, or be a keyword.
+                QUOTED_IDENTIFIER,
+                // A string in single quotes.
+                STRING,
+                // A number without its sign.
+                NUMBER,
+                // A `?`, whose value is bound when the query is compiled.
+                PARAMETER,
+                // Punctuation and operators, such as `(`, `,` and `<=`.
+                SYMBOL,
+                END,
+                // A string or quoted name that isn't closed, or a character that isn't part of any token.
+                INVALID
+            };
+
+            Type type = END;
+
+            // The text of the token, without the quotes of a string or a quoted name.
+            std::string_view text;
+
+            // The position of the token in the query.
+            std::size_t offset = 0;
+
+            // Whether there is whitespace between the previous token and this one.
+            bool followsSpace = false;
+
+            /**
+             * Returns true if the token is the keyword, ignoring case.  The keyword has to be in upper case.
+             */
+            bool isKeyword(std::string_view keyword) const noexcept;
+
+            bool isSymbol(std::string_view symbol) const noexcept {
+                return this->type == SYMBOL && this->text == symbol;
+            }
+
+            /**
+             * The text of a string or quoted name, with its doubled quotes replaced by single ones.
+             */
+            std::string unescaped() const;
+        };
+
+        Lexer(std::string_view query) : _query(query) {}
+        ~Lexer() noexcept = default;
+
+        /**
+         * Returns the next token, or an END token once the query is done.
+         */
+        Token next() noexcept;
+
+        /**
+         * Returns the next token without moving past it.
+         */
+        Token peek() noexcept;
+
+        /**
+         * Returns true if the name is a keyword of the SQL the parser understands, ignoring case, so it can't be used as
+         * an unquoted name.
+         */
+        static bool IsReserved(std::string_view name) noexcept;
+
+    private:
+        std::string_view _query;
+        std::size_t _offset = 0;
+    };
+}
@@ -1,20 +1,137 @@
 #pragma once
 
+#include "statistics.hpp"
 #include "table_definition.hpp"
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace metaldb::QueryEngine {
+    /**
+     * A file in the directory of a table, with its size and modification time from when the directory was listed.
+     */
+    struct FileEntry {
+        std::string path;
+        std::size_t fileSize = 0;
+        std::int64_t modifiedTime = 0;
+
+        /**
+         * Returns the entry with the size and modification time the file has now, or as it was listed if the file can't be
+         * read.  A file changed in place doesn't change its directory, so the listing keeps its old size and time.
+         */
+        FileEntry current() const noexcept;
+    };
+
+    /**
+     * The files under the directory of a table, along with every directory that was walked to find them.
+     *
+     * Adding, removing or renaming a file changes the modification time of its directory, so the list is only listed again
+     * once one of them changes.  Files are expected to be replaced rather than modified in place, like a partitioned dataset
+     * is written.  A file modified in place keeps its old size and time in the list, so the planner checks @b FileEntry::current
+     * before trusting its statistics, and the list itself needs @b Metadata::invalidateFiles .
+     */
+    struct FileList {
+        struct Directory {
+            std::string path;
+            std::int64_t modifiedTime = 0;
+        };
+
+        std::vector<Directory> directories;
+
+        // Sorted by path, so plans don't depend on the order the file system lists them in.
+        std::vector<FileEntry> files;
+
+        // Different every time the files are listed, so a plan made from an older list can tell it's stale.
+        std::uint64_t generation = 0;
+
+        static std::uint64_t NextGeneration() noexcept;
+    };
+
     struct Metadata {
+        /**
+         * Returns the table with the name, or nullptr if there isn't one.  Tables are indexed by name.
+         */
         const TableDefinition* getTable(const std::string& name) const noexcept {
-            for (const auto& table : this->tables) {
-                if (table.name == name) {
-                    return &table;
-                }
+            auto it = this->_tableIndexes.find(name);
+            return it == this->_tableIndexes.end() ? nullptr : &this->_tables.at(it->second);
+        }
+
+        const std::vector<TableDefinition>& getTables() const noexcept {
+            return this->_tables;
+        }
+
+        /**
+         * Adds a table, replacing the table with the same name if there is one.
+         */
+        void addTable(TableDefinition table) noexcept {
+            this->_tablesGeneration++;
+            if (auto it = this->_tableIndexes.find(table.name); it != this->_tableIndexes.end()) {
+                this->_tables.at(it->second) = std::move(table);
+                return;
             }
-            return nullptr;
+            this->_tableIndexes[table.name] = this->_tables.size();
+            this->_tables.push_back(std::move(table));
         }
 
-        std::vector<TableDefinition> tables;
+        /**
+         * Changes every time a table is added or replaced.
+         */
+        std::uint64_t tablesGeneration() const noexcept {
+            return this->_tablesGeneration;
+        }
+
+        /**
+         * Returns the statistics of a file, or nullptr if it hasn't been read yet.
+         */
+        std::shared_ptr<const FileStatistics> getFileStatistics(const std::string& filepath) const noexcept {
+            auto it = this->fileStatistics.find(filepath);
+            return it == this->fileStatistics.end() ? nullptr : it->second;
+        }
+
+        /**
+         * Returns every file under the directory of a table.  The list is cached, and only listed again once a directory
+         * under the table changes.
+         */
+        const std::vector<FileEntry>& listFiles(const TableDefinition& table) const noexcept;
+
+        /**
+         * Returns the @b FileList::generation of the files of a table, listing them again first if they changed.
+         */
+        std::uint64_t filesGeneration(const TableDefinition& table) const noexcept;
+
+        /**
+         * Drops the cached files of a table, so they are listed again by the next query.
+         */
+        void invalidateFiles(const TableDefinition& table) noexcept {
+            this->fileLists.erase(table.filePath);
+        }
+
+        // The statistics of every file that has been read, by the path of the file.
+        std::unordered_map<std::string, std::shared_ptr<const FileStatistics>> fileStatistics;
+
+        // The statistics of the conjuncts of filters that have run, by the table and conjunct, so later queries start with
+        // the cheapest and most selective conjunct.
+        std::unordered_map<std::string, ConjunctStatistics> conjunctStatistics;
+
+        // The files of each table, by the path of the table.  Listing is a cache, so it's done while planning a query.
+        mutable std::unordered_map<std::string, FileList> fileLists;
+
+        /**
+         * The default number of bytes an operator can hold in memory before it has to spill to disk.
+         */
+        static constexpr std::size_t DefaultMemoryBudget = 1024 * 1024 * 1024;
+
+        /**
+         * The number of bytes an operator can hold in memory before it has to spill to disk.
+         */
+        std::size_t memoryBudget = DefaultMemoryBudget;
+
+    private:
+        std::vector<TableDefinition> _tables;
+        std::unordered_map<std::string, std::size_t> _tableIndexes;
+        std::uint64_t _tablesGeneration = 0;
     };
 }
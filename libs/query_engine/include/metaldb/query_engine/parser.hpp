@@ -1,9 +1,11 @@
 #pragma once
 
 #include "AST/expr.hpp"
+#include "AST/filter_expr.hpp"
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace metaldb::QueryEngine {
     class Parser final {
@@ -11,6 +13,19 @@ namespace metaldb::QueryEngine {
         Parser() = default;
         ~Parser() noexcept = default;
 
+        /**
+         * Returns the expression of a SQL query, or nullptr if it can't be parsed, after printing why.  A query is a SELECT
+         * with FROM, JOIN ... ON, WHERE, GROUP BY and WINDOW clauses, which may be combined with UNION, INTERSECT and EXCEPT,
+         * and followed by ORDER BY and LIMIT.  `SELECT ... INTO 'file'` writes the rows to the file.  Each `?` becomes a
+         * parameter, numbered from 0 in the order they are in the query.
+         */
         std::shared_ptr<AST::Expr> Parse(const std::string& query) const;
+
+        /**
+         * Returns the query with each constant compared with rows replaced by a `?` and whitespace collapsed, so queries
+         * that only differ in those constants have the same text.  A value is appended to @b constants for each `?` in the
+         * result, which is empty for a `?` that was already in the query.
+         */
+        std::string Normalize(const std::string& query, std::vector<AST::Parameter::Value>& constants) const;
     };
 }
@@ -1,11 +1,16 @@
 #pragma once
 
+#include "predicate.hpp"
+#include "statistics.hpp"
+#include "AST/filter_expr.hpp"
 #include "table_definition.hpp"
 #include "engine.h"
 
 #include <string>
 #include <memory>
 #include <atomic>
+#include <limits>
+#include <optional>
 
 namespace metaldb::QueryEngine {
     enum Execution {
@@ -44,25 +49,342 @@ namespace metaldb::QueryEngine {
     };
 
     struct ReadPartial : public StagePartial {
-        ReadPartial(std::string filepath_, metaldb::Method method_) : filepath(std::move(filepath_)), method(method_) {}
+        ReadPartial(std::string filepath_, metaldb::Method method_, std::size_t fileSize_ = 0) : filepath(std::move(filepath_)), method(method_), fileSize(fileSize_) {}
 
         std::string filepath;
         metaldb::Method method;
+
+        // The size of the file on disk in bytes, used to estimate the size of intermediate results.
+        std::size_t fileSize;
+
+        // The modification time of the file when the plan was made.  A reused plan is compiled again once the file changes.
+        std::int64_t modifiedTime = 0;
+
+        // The statistics of the file from the last time it was read, if it has been.
+        std::shared_ptr<const FileStatistics> statistics;
+
+        // Files without statistics collect them while they are read, so they can be recorded once the query is done.
+        std::shared_ptr<FileStatistics> collectedStatistics;
+
+        // The ranges of rows `[start, end)` to parse, when the zone maps of the other chunks of the file can't match the filter
+        // pushed down to the read.  When unset, every row is parsed.
+        std::optional<std::vector<std::pair<std::size_t, std::size_t>>> rowRanges;
+
+        // The values of the partition columns at the end of the definition, from the `key=value` directories the file is in.
+        // A file that isn't in a directory for a column has a null value.
+        std::vector<std::optional<std::string>> partitionValues;
     };
 
     struct ProjectionPartial : public StagePartial {
         using ColumnIndexType = uint8_t;
+
+        /**
+         * The most columns a row can have, so that every column has an index.
+         */
+        static constexpr std::size_t MaxNumColumns = std::numeric_limits<ColumnIndexType>::max();
+
         ProjectionPartial(std::vector<ColumnIndexType> columnIndexes_) : columnIndexes(std::move(columnIndexes_)) {}
 
         std::vector<ColumnIndexType> columnIndexes;
     };
 
+    /**
+     * Keeps the rows of its child that match a predicate.  A filter over a read is also pushed down to it, skipping the files
+     * and chunks of rows whose zone maps can't match.
+     *
+     * The rows are filtered on the CPU by a @b RowFilter rather than by the GPU's @b FilterInstruction .  That instruction
+     * replaces a row that doesn't match with an empty row, and the first thread of a threadgroup writes the output header from
+     * its own row, so the header loses its columns whenever the first row is filtered out.  Its bytecode also has no AND or
+     * OR, and can't compare strings, which the predicates here need.  Folding and ordering the conjuncts of the predicate is
+     * therefore done for the @b RowFilter .
+     */
+    struct FilterPartial : public StagePartial {
+        FilterPartial(Predicate predicate_) : predicate(std::move(predicate_)) {
+            this->execution = CPU;
+        }
+
+        Predicate predicate;
+
+        // The expression the predicate was resolved from.  It's resolved again when the plan is reused with other values
+        // bound to its parameters.
+        std::shared_ptr<AST::BaseFilterExpr> expr;
+
+        // When the predicate ANDs several conjuncts, the key of each one in @b Metadata::conjunctStatistics .
+        std::vector<std::string> conjunctKeys;
+
+        // The statistics of each conjunct, sampled from the first rows while the filter runs, so they can be recorded once
+        // the query is done.  The filter orders the conjuncts from them for the rest of the rows.
+        std::shared_ptr<std::vector<ConjunctStatistics>> observedConjuncts;
+    };
+
     struct ShuffleOutputPartial : public StagePartial {
         ShuffleOutputPartial(std::shared_ptr<StagePartial> child) : StagePartial(*child) {
             this->children = {child};
         }
     };
 
+    struct JoinPartial : public StagePartial {
+        using ColumnIndexType = ProjectionPartial::ColumnIndexType;
+
+        enum JoinType {
+            INNER,
+            LEFT,
+            RIGHT
+        };
+
+        enum Strategy {
+            // A single hash table over the whole build side.
+            HASH,
+            // Both sides are split into partitions by the hash of the key, and each partition is joined independently.
+            RADIX_PARTITIONED,
+            // Like radix partitioned, but the partitions are spilled to disk and joined one at a time.
+            GRACE,
+            // The build side is small, so its hash table is built once and shared by a join for each partial of the probe side.
+            // Each probe partial is still scanned on the GPU, and probed on the CPU as soon as its own scan is done, rather
+            // than waiting for every probe partial to be shuffled into one stage.  The GPU instructions work on a single
+            // chunk of rows at a time, and none of them can look rows up in a hash table, so the probe isn't part of the scan.
+            BROADCAST,
+            // Both sides are sorted on the key and merged, so neither side has to fit in memory.  The output is in key order.
+            SORT_MERGE
+        };
+
+        /**
+         * Build sides estimated to be larger than this are radix partitioned, so each partition's hash table fits in the CPU caches.
+         */
+        static constexpr std::size_t MaxHashBuildBytes = 8 * 1024 * 1024;
+
+        /**
+         * The approximate size of the build side of each partition when radix partitioning.
+         */
+        static constexpr std::size_t TargetPartitionBytes = 256 * 1024;
+
+        /**
+         * Build sides estimated to be at most this size are broadcast to every partial of the probe side.
+         */
+        static constexpr std::size_t MaxBroadcastBytes = 16 * 1024 * 1024;
+
+        /**
+         * The maximum number of bits used to partition, bounding the number of partitions.
+         */
+        static constexpr std::uint8_t MaxNumPartitionBits = 12;
+
+        /**
+         * The children of a join are all of the lhs partials, followed by all of the rhs partials.
+         * @b numLhsChildren marks where one side ends and the other begins.
+         */
+        JoinPartial(JoinType joinType_, ColumnIndexType lhsColumnIndex_, ColumnIndexType rhsColumnIndex_, std::size_t numLhsChildren_) : joinType(joinType_), lhsColumnIndex(lhsColumnIndex_), rhsColumnIndex(rhsColumnIndex_), numLhsChildren(numLhsChildren_), buildLhs(joinType_ == RIGHT) {
+            this->execution = CPU;
+        }
+
+        JoinType joinType;
+        ColumnIndexType lhsColumnIndex;
+        ColumnIndexType rhsColumnIndex;
+        std::size_t numLhsChildren;
+
+        // The side preserved by an outer join is always the probe side.  An inner join may build either side.
+        bool buildLhs;
+
+        Strategy strategy = HASH;
+
+        // When radix partitioned, there are `2^numPartitionBits` partitions.
+        std::uint8_t numPartitionBits = 0;
+
+        // The number of bytes of the build side that can be held in memory at once by a grace join, or of both sides by a
+        // sort merge join.
+        std::size_t memoryBudget = 0;
+
+        // A side of a sort merge join that's already in order of its key, like the output of a sort, is merged without being
+        // sorted again.
+        bool lhsSorted = false;
+        bool rhsSorted = false;
+
+        /**
+         * Returns the index in the output of the key of the side preserved by an outer join, which is never replaced by a null.
+         */
+        ColumnIndexType outputColumnIndex() const noexcept {
+            if (this->joinType == RIGHT) {
+                return (ColumnIndexType) (this->lhsDefinition->columns.size() + this->rhsColumnIndex);
+            }
+            return this->lhsColumnIndex;
+        }
+
+        /**
+         * Returns true if the lhs is the build side.
+         */
+        bool buildIsLhs() const noexcept {
+            return this->buildLhs;
+        }
+
+        // The children are detached when stages are combined, so keep the schema of each side.
+        std::shared_ptr<TableDefinition> lhsDefinition;
+        std::shared_ptr<TableDefinition> rhsDefinition;
+    };
+
+    /**
+     * The partial phase runs on the CPU by default.  Without a group by, it may instead run on the GPU with the AGGREGATE
+     * instruction, which outputs a single row per chunk.
+     */
+    struct AggregatePartial : public StagePartial {
+        using ColumnIndexType = ProjectionPartial::ColumnIndexType;
+
+        enum Function {
+            COUNT,
+            SUM,
+            MIN,
+            MAX,
+            AVG,
+            // Estimated with a HyperLogLog sketch, merged by the final phase.
+            APPROX_COUNT_DISTINCT,
+            // Estimated with a t-digest sketch, merged by the final phase.
+            APPROX_PERCENTILE
+        };
+
+        enum Phase {
+            // Aggregates the rows of a single child into partial aggregates, one table per chunk.
+            PARTIAL,
+            // Merges the partial aggregates of every child into the final values.
+            FINAL
+        };
+
+        struct Aggregation {
+            Function function;
+
+            // The column to aggregate, or nothing for `COUNT(*)`.
+            std::optional<ColumnIndexType> column;
+
+            // The quantile estimated by `APPROX_PERCENTILE`, between 0 and 1.
+            double percentile = 0.5;
+        };
+
+        /**
+         * The number of rows aggregated into each partial table, unless the planner estimates the number of groups.
+         */
+        static constexpr std::size_t DefaultChunkNumRows = 64 * 1024;
+
+        /**
+         * With few groups, every chunk reduces to a handful of rows, so smaller chunks only add parallelism.
+         */
+        static constexpr std::size_t MinChunkNumRows = 16 * 1024;
+
+        /**
+         * With many groups, each chunk has to see more rows for the partial phase to shrink them at all.
+         */
+        static constexpr std::size_t MaxChunkNumRows = 256 * 1024;
+
+        AggregatePartial(Phase phase_, std::vector<ColumnIndexType> groupByColumnIndexes_, std::vector<Aggregation> aggregations_) : phase(phase_), groupByColumnIndexes(std::move(groupByColumnIndexes_)), aggregations(std::move(aggregations_)) {
+            this->execution = CPU;
+        }
+
+        Phase phase;
+        std::vector<ColumnIndexType> groupByColumnIndexes;
+        std::vector<Aggregation> aggregations;
+
+        // The schema of the rows being aggregated, before the partial phase.
+        std::shared_ptr<TableDefinition> inputDefinition;
+
+        // The number of rows each chunk of a partial phase on the CPU aggregates into its own table.
+        std::size_t chunkNumRows = DefaultChunkNumRows;
+    };
+
+    /**
+     * Removes duplicate rows, comparing every column.  The partial phase removes the duplicates within each chunk, which shrinks
+     * the rows that reach the final phase.
+     *
+     * For `INTERSECT` and `EXCEPT`, each partial also tags its rows with the side of the operation its child is on.
+     */
+    struct SetOperationPartial : public StagePartial {
+        using Phase = AggregatePartial::Phase;
+
+        enum Operation {
+            DISTINCT,
+            UNION,
+            INTERSECT,
+            EXCEPT
+        };
+
+        SetOperationPartial(Operation operation_, Phase phase_, bool isLhs_ = true) : operation(operation_), phase(phase_), isLhs(isLhs_) {
+            this->execution = CPU;
+        }
+
+        Operation operation;
+        Phase phase;
+
+        // Which side of the operation the child of a partial phase is on.  Distinct only has a lhs.
+        bool isLhs;
+    };
+
+    struct SortPartial : public StagePartial {
+        using ColumnIndexType = ProjectionPartial::ColumnIndexType;
+
+        struct SortColumn {
+            ColumnIndexType column;
+            bool ascending = true;
+        };
+
+        /**
+         * Sorts the rows of every child together.  Each chunk is sorted into a run, and the runs are merged.
+         *
+         * With a limit, only the first rows are kept instead.  Each chunk keeps its best rows in a bounded heap, and the heaps
+         * are merged, so the rows are never fully sorted.
+         */
+        SortPartial(std::vector<SortColumn> sortColumns_) : sortColumns(std::move(sortColumns_)) {
+            this->execution = CPU;
+        }
+
+        // The first column is the most significant.
+        std::vector<SortColumn> sortColumns;
+
+        // Once the sorted runs exceed this many bytes, they are spilled to disk.
+        std::size_t memoryBudget = 0;
+
+        // The number of rows to keep, for an `ORDER BY ... LIMIT`.  Without any sort columns, any rows are kept.
+        std::optional<std::size_t> limit;
+    };
+
+    /**
+     * Appends a column for each window function to every row of its children.
+     *
+     * Rows are split into buckets by the hash of their partition columns, so every partition is in a single bucket and the
+     * buckets are evaluated in parallel.  Each bucket is sorted by its partition and order columns, then every function is
+     * evaluated in a single pass over the sorted rows.
+     */
+    struct WindowPartial : public StagePartial {
+        using ColumnIndexType = ProjectionPartial::ColumnIndexType;
+        using SortColumn = SortPartial::SortColumn;
+
+        enum Function {
+            ROW_NUMBER,
+            RANK,
+            SUM,
+            LAG,
+            LEAD
+        };
+
+        struct WindowFunction {
+            Function function;
+
+            // The column to evaluate, or nothing for `ROW_NUMBER` and `RANK`.
+            std::optional<ColumnIndexType> column;
+
+            // How many rows back or ahead `LAG` and `LEAD` read.
+            std::size_t offset = 1;
+        };
+
+        WindowPartial(std::vector<ColumnIndexType> partitionColumns_, std::vector<SortColumn> sortColumns_, std::vector<WindowFunction> functions_) : partitionColumns(std::move(partitionColumns_)), sortColumns(std::move(sortColumns_)), functions(std::move(functions_)) {
+            this->execution = CPU;
+        }
+
+        std::vector<ColumnIndexType> partitionColumns;
+
+        // The order of the rows within each partition.
+        std::vector<SortColumn> sortColumns;
+
+        std::vector<WindowFunction> functions;
+
+        // The schema of the rows before the function columns are appended.
+        std::shared_ptr<TableDefinition> inputDefinition;
+    };
+
     struct WritePartial : public StagePartial {
         WritePartial(std::string filepath_, metaldb::Method method_, std::vector<std::string> columnNames_ = {}) : filepath(std::move(filepath_)), method(method_), columnNames(std::move(columnNames_)) {
             this->execution = CPU;
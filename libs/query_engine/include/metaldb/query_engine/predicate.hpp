@@ -0,0 +1,81 @@
+#pragma once
+
+#include "statistics.hpp"
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace metaldb::QueryEngine {
+    /**
+     * A filter expression with its columns resolved to their indexes.  Every comparison is between a column and a constant,
+     * and comparisons are combined with AND and OR.  A comparison with a null value never matches.  An AND without children
+     * always matches, and an OR without children never does.
+     */
+    struct Predicate {
+        using ColumnIndexType = uint8_t;
+
+        enum Operation {
+            AND,
+            OR,
+            EQ,
+            LT,
+            LTE,
+            GT,
+            GTE
+        };
+
+        Predicate(Operation operation_) : operation(operation_) {}
+
+        Operation operation;
+
+        // The operands of an AND or an OR.
+        std::vector<Predicate> children;
+
+        // The column and constant of a comparison.  An integer is only compared exactly with an integer column, other numbers
+        // are compared as doubles, and strings are compared byte by byte.  The planner gives a number the kind of its column
+        // where it can, so the comparisons of a column can be merged.
+        ColumnIndexType column = 0;
+        std::variant<std::int64_t, double, std::string> value;
+
+        /**
+         * Returns false if no row with values in the ranges of @b zoneMaps can match, so the rows can be skipped.
+         * There must be a zone map for every column.  A column without a range may have any value.
+         */
+        bool mayMatch(const std::vector<ZoneMap>& zoneMaps) const noexcept;
+
+        static Predicate True() noexcept {
+            return Predicate{AND};
+        }
+
+        static Predicate False() noexcept {
+            return Predicate{OR};
+        }
+
+        bool isTrue() const noexcept {
+            return this->operation == AND && this->children.empty();
+        }
+
+        bool isFalse() const noexcept {
+            return this->operation == OR && this->children.empty();
+        }
+
+        bool isComparison() const noexcept {
+            return this->operation != AND && this->operation != OR;
+        }
+
+        /**
+         * Returns an equivalent predicate that's cheaper to evaluate.  Nested ANDs and ORs are flattened, and TRUE and FALSE
+         * operands are folded away.  The comparisons of a column with constants of the same kind under an AND are merged into
+         * at most a lower and an upper bound, or an EQ, and are FALSE if no value is in all of them.
+         */
+        Predicate simplified() const noexcept;
+
+        /**
+         * Puts the children in the order of @b order , which has the index of each child once, such as from
+         * @b ConjunctStatistics::Order .
+         */
+        void reorder(const std::vector<std::size_t>& order) noexcept;
+    };
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "AST/expr.hpp"
+#include "AST/filter_expr.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace metaldb::QueryEngine {
+    /**
+     * A parsed query whose constants are parameters, so it can be compiled again with other constants without being
+     * parsed again.  Created by @b QueryEngine::prepare .
+     */
+    struct PreparedStatement {
+        // The normalized text of the query, which identifies the statement.
+        std::string text;
+
+        std::shared_ptr<AST::Expr> expr;
+
+        // The number of values that have to be bound to compile the statement.
+        std::size_t numParameters = 0;
+
+        // Every parameter in the expression.  A parameter used twice in the query appears once for each use.
+        std::vector<std::shared_ptr<AST::Parameter>> parameters;
+
+        // The tables the query reads, whose files are checked before a compiled plan is reused.
+        std::vector<std::string> tableNames;
+    };
+}
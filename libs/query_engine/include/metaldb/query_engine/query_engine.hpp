@@ -2,9 +2,16 @@
 
 #include "query_plan.hpp"
 #include "metadata.hpp"
+#include "parser.hpp"
+#include "prepared_statement.hpp"
 #include "AST/expr.hpp"
 
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace metaldb::QueryEngine {
     class QueryEngine {
@@ -13,8 +20,97 @@ namespace metaldb::QueryEngine {
 
         ~QueryEngine() noexcept = default;
 
+        /**
+         * Returns the plan of a query, or an empty plan if it can't be planned, like when it reads a column or a table that
+         * doesn't exist.  A table without any files can't be planned either, since there is nothing to run.
+         */
         QueryPlan compile(const std::shared_ptr<AST::Expr>& expr) const;
 
+        /**
+         * Returns the statement of a query, with its constants replaced by parameters.  The constants are appended to
+         * @b arguments , which are then bound by @b compile .  Statements are cached by their normalized text, so a query
+         * is only parsed the first time it's seen with any constants.
+         */
+        std::shared_ptr<const PreparedStatement> prepare(const Parser& parser, const std::string& query, std::vector<AST::Parameter::Value>& arguments);
+
+        /**
+         * Returns the plan of a statement with @b arguments bound to its parameters, or an empty plan if they don't match or
+         * the statement can't be planned.
+         * Plans are cached by the statement, and reused until the tables they read or their files change, or statistics are
+         * recorded for new files.
+         *
+         * A plan is reused with other arguments by resolving the predicate of each filter again, and pruning the reads
+         * under it again.  The rest of the plan, like the order and strategy of its joins, is kept from the arguments it
+         * was compiled with.  The cached plan is never run itself: every compile returns a copy with its own partials, so
+         * plans of the same statement with different arguments can be held and run at the same time.
+         */
+        QueryPlan compile(const PreparedStatement& statement, const std::vector<AST::Parameter::Value>& arguments);
+
+        /**
+         * Records the statistics collected by the reads of an executed plan in the @b metadata , so later queries can use them.
+         */
+        void recordStatistics(const QueryPlan& plan);
+
         Metadata metadata;
+
+        /**
+         * The number of compiled plans that are kept.  The least recently used plan is dropped to make room.
+         */
+        static constexpr std::size_t MaxNumCachedPlans = 256;
+
+    private:
+        /**
+         * A filter of a cached plan with the reads under it, which aren't its children anymore once the plan is combined
+         * into stages.
+         */
+        struct CachedFilter {
+            std::shared_ptr<FilterPartial> filter;
+
+            // The reads that are children of the filter, which its predicate prunes.
+            std::vector<std::shared_ptr<ReadPartial>> prunedReads;
+
+            // Every read under the filter, which reads nothing if no row can match.
+            std::vector<std::shared_ptr<ReadPartial>> reads;
+        };
+
+        struct CachedPlan {
+            QueryPlan plan;
+
+            // The filters and reads of the plan, which are bound again in each copy of it.
+            std::vector<CachedFilter> filters;
+            std::vector<std::shared_ptr<ReadPartial>> reads;
+
+            // The generations the plan was compiled at, with the files generation of each table it reads.
+            std::uint64_t tablesGeneration = 0;
+            std::vector<std::pair<std::string, std::uint64_t>> filesGenerations;
+
+            std::uint64_t lastUsed = 0;
+        };
+
+        bool isValid(const CachedPlan& cached) const noexcept;
+
+        /**
+         * Collects the filters and reads under a partial, before the partials of the plan are combined.
+         */
+        static void CollectCached(const std::shared_ptr<StagePartial>& partial, CachedPlan& cached);
+
+        /**
+         * Copies the stages and partials of a cached plan, along with its filters and reads, so the copy can be bound
+         * without changing the plans returned before it.
+         */
+        static CachedPlan Copy(const CachedPlan& cached);
+
+        /**
+         * Binds a copy of a cached plan to the values bound to the parameters of its statement, as if it was compiled with
+         * them.  Returns false if the plan can't be reused, because one of the files it reads changed in place or one of
+         * its filters no longer resolves, in which case the copy is left as it was.
+         */
+        bool rebind(const CachedPlan& copy) const;
+
+        // The caches are not thread safe, and the arguments are bound to the parameters of a statement while it's
+        // compiled, so a query engine compiles one query at a time.
+        std::unordered_map<std::string, std::shared_ptr<PreparedStatement>> _statements;
+        std::unordered_map<std::string, CachedPlan> _plans;
+        std::uint64_t _numCompiles = 0;
     };
 }
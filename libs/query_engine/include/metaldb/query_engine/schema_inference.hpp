@@ -0,0 +1,53 @@
+#pragma once
+
+#include "metadata.hpp"
+#include "table_definition.hpp"
+
+#include <optional>
+#include <string>
+
+namespace metaldb::QueryEngine {
+    /**
+     * Infers the @b TableDefinition of a directory of CSV files from their header and a sample of their rows, so a table
+     * doesn't need a hand-written definition.
+     *
+     * Only a bounded number of bytes are read, however large the files are: a few files are picked evenly from the table,
+     * and a few blocks are read from evenly spaced offsets in each of them.  Fields are split like the ParseRow instruction
+     * splits them.  Since only a sample is read, a value that doesn't fit the inferred type can still be in the files.
+     */
+    class SchemaInference final {
+    public:
+        struct Options {
+            // The number of files sampled from the table.
+            std::size_t maxNumFiles = 16;
+
+            // The number of blocks read from each file.
+            std::size_t numBlocksPerFile = 8;
+
+            // The number of bytes in each block.  The header has to fit in one block.
+            std::size_t blockNumBytes = 64 * 1024;
+        };
+
+        /**
+         * Returns the definition of the table in @b filePath , or std::nullopt if it has no CSV files or their headers can't
+         * be read.  A column is an Integer if every sampled value is one, a Float if every sampled value is a number, and a
+         * String otherwise.  A column with an empty value is nullable, and a String column's @b maxSize is its widest sampled
+         * value.  Partition columns aren't included, since reading the table finds them from its directories.
+         */
+        static std::optional<TableDefinition> Infer(const std::string& name, const std::string& filePath, const Metadata& metadata, const Options& options) noexcept;
+
+        static std::optional<TableDefinition> Infer(const std::string& name, const std::string& filePath, const Metadata& metadata) noexcept {
+            return Infer(name, filePath, metadata, Options());
+        }
+
+        /**
+         * Infers the table and adds it to @b metadata , replacing the table with the same name.  Returns false if it couldn't
+         * be inferred, in which case @b metadata is left unchanged.
+         */
+        static bool Register(const std::string& name, const std::string& filePath, Metadata& metadata, const Options& options) noexcept;
+
+        static bool Register(const std::string& name, const std::string& filePath, Metadata& metadata) noexcept {
+            return Register(name, filePath, metadata, Options());
+        }
+    };
+}
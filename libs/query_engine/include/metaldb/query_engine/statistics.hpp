@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace metaldb::QueryEngine {
+    /**
+     * The range of the values of a column, over a whole file or a chunk of its rows.  Rows whose ranges can't match a predicate
+     * are skipped without being parsed.  Nulls are not part of the range.
+     */
+    struct ZoneMap {
+        // The smallest and largest values of a number column.  Empty for strings, or when every value is null.
+        std::optional<double> min;
+        std::optional<double> max;
+
+        // The smallest and largest values of a string column, compared byte by byte.
+        std::optional<std::string> minString;
+        std::optional<std::string> maxString;
+    };
+
+    /**
+     * Statistics of a single column of a file, collected while the file is read.
+     */
+    struct ColumnStatistics : public ZoneMap {
+        std::size_t nullCount = 0;
+
+        // An estimate of the number of distinct values, excluding nulls.
+        std::size_t distinctCount = 0;
+
+        // The average size in bytes of the values that aren't null, as they are written in the file.
+        double averageSize = 0;
+    };
+
+    /**
+     * Statistics of a file, with a @b ColumnStatistics for each column of its table.
+     */
+    struct FileStatistics {
+        std::size_t rowCount = 0;
+        std::vector<ColumnStatistics> columns;
+
+        // The zone maps of each chunk of rows, in the order they are in the file, with a @b ZoneMap for each column.
+        // Every chunk has @b chunkNumRows rows, except the last.
+        std::size_t chunkNumRows = 0;
+        std::vector<std::vector<ZoneMap>> chunks;
+
+        // The size and modification time of the file the statistics were collected from.  Once the file changes, they are stale.
+        std::size_t fileSize = 0;
+        std::int64_t modifiedTime = 0;
+    };
+
+    /**
+     * How often a conjunct of a filter passed, and how long it took, over the rows it was sampled on.
+     */
+    struct ConjunctStatistics {
+        std::uint64_t numRows = 0;
+        std::uint64_t numPassed = 0;
+        double nanoseconds = 0;
+
+        void merge(const ConjunctStatistics& other) noexcept {
+            this->numRows += other.numRows;
+            this->numPassed += other.numPassed;
+            this->nanoseconds += other.nanoseconds;
+        }
+
+        /**
+         * The time spent for each row the conjunct filters out.  Evaluating conjuncts in increasing rank evaluates the least
+         * for each row, as long as they are independent.  A conjunct that never filters a row out goes last.
+         */
+        double rank() const noexcept;
+
+        /**
+         * Returns the order to evaluate conjuncts in, as indexes into @b conjuncts .  Ties keep their order.
+         */
+        static std::vector<std::size_t> Order(const std::vector<ConjunctStatistics>& conjuncts) noexcept;
+    };
+
+    /**
+     * Persists the statistics of a file in a file next to it, so its zone maps and estimates outlive the process.
+     */
+    class StatisticsFile final {
+    public:
+        /**
+         * Appended to the path of the file the statistics describe.
+         */
+        static constexpr const char* Extension = ".stats";
+
+        static std::string PathFor(const std::string& filepath) noexcept;
+
+        /**
+         * Returns false if the statistics couldn't be written, such as when the directory is read only.
+         */
+        static bool Write(const std::string& filepath, const FileStatistics& statistics) noexcept;
+
+        /**
+         * Returns the statistics of a file, or nullptr if there are none, or they were collected before the file last changed.
+         */
+        static std::shared_ptr<FileStatistics> Read(const std::string& filepath, std::size_t fileSize, std::int64_t modifiedTime) noexcept;
+    };
+}
@@ -3,14 +3,28 @@
 #include "column_definition.hpp"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <optional>
 
 namespace metaldb::QueryEngine {
     struct TableDefinition {
+        /**
+         * Looks the column up in a hash index of the columns.  The index is rebuilt when a column isn't where it says, since
+         * @b columns can change after a lookup.  Not thread safe, which is fine for the planner.
+         */
         std::optional<std::size_t> getColumnIndex(const std::string& column) const noexcept {
+            if (auto it = this->_columnIndexes.find(column); it != this->_columnIndexes.end() && it->second < this->columns.size() && this->columns.at(it->second).name == column) {
+                return it->second;
+            }
+
+            // Either there's no such column, or it was added after the index was built.
             for (std::size_t i = 0; i < this->columns.size(); ++i) {
                 if (this->columns.at(i).name == column) {
+                    this->_columnIndexes.clear();
+                    for (std::size_t j = this->columns.size(); j-- > 0;) {
+                        this->_columnIndexes[this->columns.at(j).name] = j;
+                    }
                     return i;
                 }
             }
@@ -18,19 +32,29 @@ namespace metaldb::QueryEngine {
         }
 
         const ColumnDefinition* getColumnDefinition(const std::string& column) const noexcept {
-            for (auto& c : this->columns) {
-                if (c.name == column) {
-                    return &c;
-                }
+            if (auto index = this->getColumnIndex(column)) {
+                return &this->columns.at(*index);
             }
-
             return nullptr;
         }
 
+        /**
+         * The number of columns read from the files themselves, which come before the partition columns.
+         */
+        std::size_t numFileColumns() const noexcept {
+            std::size_t numColumns = 0;
+            for (const auto& c : this->columns) {
+                numColumns += c.partition ? 0 : 1;
+            }
+            return numColumns;
+        }
 
         std::string name;
         std::string filePath;
 
         std::vector<ColumnDefinition> columns;
+
+    private:
+        mutable std::unordered_map<std::string, std::size_t> _columnIndexes;
     };
 }
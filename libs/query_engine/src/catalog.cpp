@@ -0,0 +1,253 @@
+#include <metaldb/query_engine/catalog.hpp>
+
+#include "serialization.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    using namespace metaldb::QueryEngine;
+    using namespace metaldb::QueryEngine::Serialization;
+
+    // Identifies a catalog file, and the version of its layout.
+    constexpr std::uint32_t Magic = 0x4342444d;
+    constexpr std::uint32_t Version = 2;
+
+    // Columns are indexed by a byte everywhere else.
+    constexpr std::uint32_t MaxNumColumns = 256;
+
+    // The fewest bytes each entry is written in, with every string empty, which bounds how many of them a catalog can hold.
+    constexpr std::uint64_t MinTableSize = 3 * sizeof(std::uint32_t);
+    constexpr std::uint64_t MinColumnSize = sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(metaldb::ColumnType) + 2;
+    constexpr std::uint64_t MinFileListSize = sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t);
+    constexpr std::uint64_t MinDirectorySize = sizeof(std::uint32_t) + sizeof(std::int64_t);
+    constexpr std::uint64_t MinFileSize = sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(std::int64_t);
+    constexpr std::uint64_t MinStatisticsSize = sizeof(std::uint32_t) + 4 * sizeof(std::uint64_t) + 2 * sizeof(std::uint32_t);
+    constexpr std::uint64_t MinConjunctSize = sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t) + sizeof(double);
+
+    void WriteTable(std::ostream& stream, const TableDefinition& table) {
+        WriteValue(stream, table.name);
+        WriteValue(stream, table.filePath);
+        WriteValue(stream, (std::uint32_t) table.columns.size());
+        for (const auto& column : table.columns) {
+            WriteValue(stream, column.name);
+            WriteValue(stream, (std::uint64_t) column.maxSize);
+            WriteValue(stream, column.type);
+            WriteValue(stream, (std::uint8_t) column.nullable);
+            WriteValue(stream, (std::uint8_t) column.partition);
+        }
+    }
+
+    auto ReadTable(std::istream& stream, TableDefinition& table) -> bool {
+        std::uint32_t numColumns = 0;
+        if (!ReadValue(stream, table.name) || !ReadValue(stream, table.filePath) || !ReadCount(stream, numColumns, MinColumnSize) || numColumns > MaxNumColumns) {
+            return false;
+        }
+
+        for (std::uint32_t i = 0; i < numColumns; ++i) {
+            std::string name;
+            std::uint64_t maxSize = 0;
+            metaldb::ColumnType type;
+            std::uint8_t nullable = 0;
+            std::uint8_t partition = 0;
+            if (!ReadValue(stream, name) || !ReadValue(stream, maxSize) || !ReadValue(stream, type) || !ReadValue(stream, nullable) || !ReadValue(stream, partition) || type > metaldb::Integer_opt) {
+                return false;
+            }
+
+            ColumnDefinition column(std::move(name), (std::size_t) maxSize, type);
+            column.nullable = nullable;
+            column.partition = partition;
+            table.columns.push_back(std::move(column));
+        }
+        return true;
+    }
+
+    void WriteFileList(std::ostream& stream, const FileList& fileList) {
+        WriteValue(stream, (std::uint64_t) fileList.directories.size());
+        for (const auto& directory : fileList.directories) {
+            WriteValue(stream, directory.path);
+            WriteValue(stream, directory.modifiedTime);
+        }
+
+        WriteValue(stream, (std::uint64_t) fileList.files.size());
+        for (const auto& file : fileList.files) {
+            WriteValue(stream, file.path);
+            WriteValue(stream, (std::uint64_t) file.fileSize);
+            WriteValue(stream, file.modifiedTime);
+        }
+    }
+
+    auto ReadFileList(std::istream& stream, FileList& fileList) -> bool {
+        std::uint64_t numDirectories = 0;
+        if (!ReadCount(stream, numDirectories, MinDirectorySize)) {
+            return false;
+        }
+        for (std::uint64_t i = 0; i < numDirectories; ++i) {
+            FileList::Directory directory;
+            if (!ReadValue(stream, directory.path) || !ReadValue(stream, directory.modifiedTime)) {
+                return false;
+            }
+            fileList.directories.push_back(std::move(directory));
+        }
+
+        std::uint64_t numFiles = 0;
+        if (!ReadCount(stream, numFiles, MinFileSize)) {
+            return false;
+        }
+        for (std::uint64_t i = 0; i < numFiles; ++i) {
+            FileEntry file;
+            std::uint64_t fileSize = 0;
+            if (!ReadValue(stream, file.path) || !ReadValue(stream, fileSize) || !ReadValue(stream, file.modifiedTime)) {
+                return false;
+            }
+            file.fileSize = fileSize;
+            fileList.files.push_back(std::move(file));
+        }
+        return true;
+    }
+}
+
+bool metaldb::QueryEngine::Catalog::Write(const std::string& path, const Metadata& metadata) noexcept {
+    const auto temporaryPath = path + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            std::cerr << "Failed to write catalog: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return false;
+        }
+
+        WriteValue(stream, Magic);
+        WriteValue(stream, Version);
+
+        const auto& tables = metadata.getTables();
+        WriteValue(stream, (std::uint32_t) tables.size());
+        for (const auto& table : tables) {
+            WriteTable(stream, table);
+        }
+
+        WriteValue(stream, (std::uint64_t) metadata.fileLists.size());
+        for (const auto& [tablePath, fileList] : metadata.fileLists) {
+            WriteValue(stream, tablePath);
+            WriteFileList(stream, fileList);
+        }
+
+        WriteValue(stream, (std::uint64_t) metadata.fileStatistics.size());
+        for (const auto& [filepath, statistics] : metadata.fileStatistics) {
+            WriteValue(stream, filepath);
+            WriteStatistics(stream, *statistics);
+        }
+
+        WriteValue(stream, (std::uint64_t) metadata.conjunctStatistics.size());
+        for (const auto& [key, statistics] : metadata.conjunctStatistics) {
+            WriteValue(stream, key);
+            WriteValue(stream, statistics.numRows);
+            WriteValue(stream, statistics.numPassed);
+            WriteValue(stream, statistics.nanoseconds);
+        }
+
+        if (!stream.flush()) {
+            std::cerr << "Failed to write catalog: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return false;
+        }
+    }
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace catalog: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool metaldb::QueryEngine::Catalog::Read(const std::string& path, Metadata& metadata) noexcept {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        return false;
+    }
+
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    if (!ReadValue(stream, magic) || !ReadValue(stream, version) || magic != Magic || version != Version) {
+        std::cerr << "Catalog is not a catalog, or is from another version: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        return false;
+    }
+
+    // Everything is read before any of it is added, so a corrupt catalog doesn't leave half of it behind.
+    std::uint32_t numTables = 0;
+    if (!ReadCount(stream, numTables, MinTableSize)) {
+        return false;
+    }
+    std::vector<TableDefinition> tables;
+    for (std::uint32_t i = 0; i < numTables; ++i) {
+        TableDefinition table;
+        if (!ReadTable(stream, table)) {
+            std::cerr << "Catalog is corrupt: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return false;
+        }
+        tables.push_back(std::move(table));
+    }
+
+    std::uint64_t numFileLists = 0;
+    if (!ReadCount(stream, numFileLists, MinFileListSize)) {
+        return false;
+    }
+    std::unordered_map<std::string, FileList> fileLists;
+    for (std::uint64_t i = 0; i < numFileLists; ++i) {
+        std::string tablePath;
+        FileList fileList;
+        if (!ReadValue(stream, tablePath) || !ReadFileList(stream, fileList)) {
+            std::cerr << "Catalog is corrupt: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return false;
+        }
+        fileLists[tablePath] = std::move(fileList);
+    }
+
+    std::uint64_t numStatistics = 0;
+    if (!ReadCount(stream, numStatistics, MinStatisticsSize)) {
+        return false;
+    }
+    std::unordered_map<std::string, std::shared_ptr<const FileStatistics>> fileStatistics;
+    for (std::uint64_t i = 0; i < numStatistics; ++i) {
+        std::string filepath;
+        if (!ReadValue(stream, filepath)) {
+            return false;
+        }
+        auto statistics = ReadStatistics(stream);
+        if (!statistics) {
+            std::cerr << "Catalog is corrupt: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return false;
+        }
+        fileStatistics[filepath] = std::move(statistics);
+    }
+
+    std::uint64_t numConjuncts = 0;
+    if (!ReadCount(stream, numConjuncts, MinConjunctSize)) {
+        return false;
+    }
+    std::unordered_map<std::string, ConjunctStatistics> conjunctStatistics;
+    for (std::uint64_t i = 0; i < numConjuncts; ++i) {
+        std::string key;
+        ConjunctStatistics statistics;
+        if (!ReadValue(stream, key) || !ReadValue(stream, statistics.numRows) || !ReadValue(stream, statistics.numPassed) || !ReadValue(stream, statistics.nanoseconds)) {
+            std::cerr << "Catalog is corrupt: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return false;
+        }
+        conjunctStatistics[key] = statistics;
+    }
+
+    for (auto& table : tables) {
+        metadata.addTable(std::move(table));
+    }
+    for (auto& [tablePath, fileList] : fileLists) {
+        fileList.generation = FileList::NextGeneration();
+        metadata.fileLists[tablePath] = std::move(fileList);
+    }
+    for (auto& [filepath, statistics] : fileStatistics) {
+        metadata.fileStatistics[filepath] = std::move(statistics);
+    }
+    for (auto& [key, statistics] : conjunctStatistics) {
+        metadata.conjunctStatistics[key] = statistics;
+    }
+    return true;
+}
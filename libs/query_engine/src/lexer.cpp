@@ -0,0 +1,163 @@
+#include <metaldb/query_engine/lexer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+namespace {
+    auto IsIdentifierStart(char c) -> bool {
+        return std::isalpha((unsigned char) c) || c == '_';
+    }
+
+    auto IsIdentifierChar(char c) -> bool {
+        return std::isalnum((unsigned char) c) || c == '_';
+    }
+
+    auto IsDigit(char c) -> bool {
+        return c >= '0' && c <= '9';
+    }
+
+    auto EqualsIgnoringCase(std::string_view text, std::string_view upper) -> bool {
+        return text.size() == upper.size() && std::equal(text.begin(), text.end(), upper.begin(), [](char lhs, char rhs) {
+            return std::toupper((unsigned char) lhs) == rhs;
+        });
+    }
+
+    /**
+     * Returns the length of the string or quoted name at the start of @b text , including both quotes, or 0 if it isn't
+     * closed.  A quote inside it is written twice.
+     */
+    auto QuotedLength(std::string_view text) -> std::size_t {
+        const auto quote = text.front();
+        for (std::size_t i = 1; i < text.size(); ++i) {
+            if (text[i] != quote) {
+                continue;
+            }
+            if (i + 1 < text.size() && text[i + 1] == quote) {
+                ++i;
+                continue;
+            }
+            return i + 1;
+        }
+        return 0;
+    }
+
+    /**
+     * Returns the length of the number at the start of @b text , with an optional fraction and exponent, or 0 if it doesn't
+     * start with one.
+     */
+    auto NumberLength(std::string_view text) -> std::size_t {
+        std::size_t i = 0;
+        std::size_t numDigits = 0;
+        for (; i < text.size() && IsDigit(text[i]); ++i, ++numDigits) {}
+        if (i < text.size() && text[i] == '.') {
+            for (++i; i < text.size() && IsDigit(text[i]); ++i, ++numDigits) {}
+        }
+        if (numDigits == 0) {
+            return 0;
+        }
+
+        if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+            auto exponent = i + 1;
+            if (exponent < text.size() && (text[exponent] == '-' || text[exponent] == '+')) {
+                ++exponent;
+            }
+            if (exponent < text.size() && IsDigit(text[exponent])) {
+                for (i = exponent; i < text.size() && IsDigit(text[i]); ++i) {}
+            }
+        }
+        return i;
+    }
+
+    constexpr std::array<std::string_view, 41> ReservedWords = {
+        "ALL", "AND", "AS", "ASC", "BETWEEN", "BY", "CROSS", "DESC", "DISTINCT", "EXCEPT", "FALSE", "FROM", "FULL", "GROUP",
+        "HAVING", "IN", "INNER", "INTERSECT", "INTO", "IS", "JOIN", "LEFT", "LIKE", "LIMIT", "NOT", "NULL", "OFFSET", "ON",
+        "OR", "ORDER", "OUTER", "OVER", "PARTITION", "RIGHT", "SELECT", "TRUE", "UNION", "USING", "WHERE", "WINDOW", "WITH"
+    };
+}
+
+bool metaldb::QueryEngine::Lexer::Token::isKeyword(std::string_view keyword) const noexcept {
+    return this->type == IDENTIFIER && EqualsIgnoringCase(this->text, keyword);
+}
+
+auto metaldb::QueryEngine::Lexer::Token::unescaped() const -> std::string {
+    const char quote = this->type == QUOTED_IDENTIFIER ? '"' : '\'';
+    std::string value;
+    value.reserve(this->text.size());
+    for (std::size_t i = 0; i < this->text.size(); ++i) {
+        value += this->text[i];
+        if (this->text[i] == quote) {
+            ++i;
+        }
+    }
+    return value;
+}
+
+bool metaldb::QueryEngine::Lexer::IsReserved(std::string_view name) noexcept {
+    return std::any_of(ReservedWords.begin(), ReservedWords.end(), [&](std::string_view word) {
+        return EqualsIgnoringCase(name, word);
+    });
+}
+
+auto metaldb::QueryEngine::Lexer::peek() noexcept -> Token {
+    const auto offset = this->_offset;
+    auto token = this->next();
+    this->_offset = offset;
+    return token;
+}
+
+auto metaldb::QueryEngine::Lexer::next() noexcept -> Token {
+    const auto start = this->_offset;
+    while (this->_offset < this->_query.size() && std::isspace((unsigned char) this->_query[this->_offset])) {
+        ++this->_offset;
+    }
+
+    Token token;
+    token.offset = this->_offset;
+    token.followsSpace = this->_offset > start;
+    const auto text = this->_query.substr(this->_offset);
+    if (text.empty()) {
+        token.type = Token::END;
+        return token;
+    }
+
+    const auto c = text.front();
+    std::size_t length = 1;
+    if (IsIdentifierStart(c)) {
+        token.type = Token::IDENTIFIER;
+        for (; length < text.size() && IsIdentifierChar(text[length]); ++length) {}
+        token.text = text.substr(0, length);
+    } else if (c == '\'' || c == '"') {
+        length = QuotedLength(text);
+        if (length == 0) {
+            token.type = Token::INVALID;
+            length = text.size();
+            token.text = text;
+        } else {
+            token.type = c == '"' ? Token::QUOTED_IDENTIFIER : Token::STRING;
+            token.text = text.substr(1, length - 2);
+        }
+    } else if (auto numberLength = NumberLength(text)) {
+        token.type = Token::NUMBER;
+        length = numberLength;
+        token.text = text.substr(0, length);
+    } else if (c == '?') {
+        token.type = Token::PARAMETER;
+        token.text = text.substr(0, 1);
+    } else if (std::string_view("(),.;*=+-/").find(c) != std::string_view::npos) {
+        token.type = Token::SYMBOL;
+        token.text = text.substr(0, 1);
+    } else if (c == '<' || c == '>' || c == '!') {
+        // <=, >=, <> and !=
+        const auto isPair = text.size() > 1 && (text[1] == '=' || (c == '<' && text[1] == '>'));
+        length = isPair ? 2 : 1;
+        token.type = c == '!' && !isPair ? Token::INVALID : Token::SYMBOL;
+        token.text = text.substr(0, length);
+    } else {
+        token.type = Token::INVALID;
+        token.text = text.substr(0, 1);
+    }
+
+    this->_offset += length;
+    return token;
+}
@@ -0,0 +1,86 @@
+#include <metaldb/query_engine/metadata.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+namespace {
+    using namespace metaldb::QueryEngine;
+
+    auto ModifiedTime(const std::filesystem::path& path, std::error_code& error) -> std::int64_t {
+        return (std::int64_t) std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    }
+
+    /**
+     * Returns false once a file or directory was added, removed or renamed since the list was made.  Only the directories
+     * are checked, which is much less work than checking every file.
+     */
+    auto IsFresh(const FileList& fileList) -> bool {
+        std::error_code error;
+        for (const auto& directory : fileList.directories) {
+            if (ModifiedTime(directory.path, error) != directory.modifiedTime || error) {
+                return false;
+            }
+        }
+        return !fileList.directories.empty();
+    }
+
+    auto ListFiles(const std::string& path) -> FileList {
+        FileList fileList;
+        std::error_code error;
+        const auto rootModifiedTime = ModifiedTime(path, error);
+        if (error) {
+            std::cerr << "Failed to list the files of: " << path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return fileList;
+        }
+        fileList.directories.push_back({path, rootModifiedTime});
+        fileList.generation = FileList::NextGeneration();
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+            const auto entryModifiedTime = ModifiedTime(entry.path(), error);
+            if (entry.is_directory(error)) {
+                fileList.directories.push_back({entry.path().string(), entryModifiedTime});
+            } else if (entry.is_regular_file(error)) {
+                fileList.files.push_back({entry.path().string(), (std::size_t) entry.file_size(error), entryModifiedTime});
+            }
+        }
+
+        std::sort(fileList.files.begin(), fileList.files.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.path < rhs.path;
+        });
+        return fileList;
+    }
+}
+
+auto metaldb::QueryEngine::FileEntry::current() const noexcept -> FileEntry {
+    std::error_code error;
+    const auto fileSize = std::filesystem::file_size(this->path, error);
+    if (error) {
+        return *this;
+    }
+    const auto modifiedTime = ModifiedTime(this->path, error);
+    if (error) {
+        return *this;
+    }
+    return {this->path, (std::size_t) fileSize, modifiedTime};
+}
+
+auto metaldb::QueryEngine::FileList::NextGeneration() noexcept -> std::uint64_t {
+    static std::atomic<std::uint64_t> nextGeneration = 1;
+    return nextGeneration++;
+}
+
+auto metaldb::QueryEngine::Metadata::listFiles(const TableDefinition& table) const noexcept -> const std::vector<FileEntry>& {
+    auto& fileList = this->fileLists[table.filePath];
+    if (!IsFresh(fileList)) {
+        fileList = ListFiles(table.filePath);
+    }
+    return fileList.files;
+}
+
+auto metaldb::QueryEngine::Metadata::filesGeneration(const TableDefinition& table) const noexcept -> std::uint64_t {
+    this->listFiles(table);
+    return this->fileLists.at(table.filePath).generation;
+}
@@ -1,70 +1,924 @@
 #include <metaldb/query_engine/parser.hpp>
+#include <metaldb/query_engine/lexer.hpp>
+#include <metaldb/query_engine/AST/aggregate.hpp>
+#include <metaldb/query_engine/AST/distinct.hpp>
 #include <metaldb/query_engine/AST/filter.hpp>
 #include <metaldb/query_engine/AST/join.hpp>
 #include <metaldb/query_engine/AST/limit.hpp>
+#include <metaldb/query_engine/AST/order_by.hpp>
+#include <metaldb/query_engine/AST/set_operation.hpp>
+#include <metaldb/query_engine/AST/window.hpp>
 #include <metaldb/query_engine/AST/read.hpp>
-#include <metaldb/query_engine/AST/rho.hpp>
 #include <metaldb/query_engine/AST/projection.hpp>
 #include <metaldb/query_engine/AST/write.hpp>
 
-auto metaldb::QueryEngine::Parser::Parse(const std::string& query) const -> std::shared_ptr<AST::Expr> {
-    std::shared_ptr<AST::Expr> expr;
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
 
-    /**
-     * SELECT * FROM mytable;
-     */
-    expr = std::make_shared<AST::Read>("iris");
+namespace {
+    using namespace metaldb::QueryEngine;
+    using Token = Lexer::Token;
 
     /**
-     * SELECT colA, colB FROM mytable;
+     * Returns the value of a number, an int if it has no fraction or exponent, otherwise a float.  Returns nullopt for an
+     * integer that doesn't fit in an int, the size of an integer column, rather than round it to a float.
      */
-    expr = std::make_shared<AST::Projection>(std::vector<std::string>{"lpep_pickup_datetime", "lpep_dropoff_datetime"},
-                                             std::make_shared<AST::Read>("taxi_sample"));
-
-
-//    expr = std::make_shared<AST::Projection>(std::vector<std::string>{"sepal.length", "petal.length"},
-//                                             std::make_shared<AST::Read>("iris"));
-    return std::make_shared<AST::Write>("output", std::vector<std::string>{"pickup", "dropoff"}, CSV, expr);
+    auto NumberValue(std::string_view text, bool negative) -> std::optional<AST::Parameter::Value> {
+        std::string literal = negative ? "-" : "";
+        literal.append(text);
 
+        if (literal.find_first_of(".eE") != std::string::npos) {
+            return std::strtof(literal.c_str(), nullptr);
+        }
+        int integer = 0;
+        const auto [end, error] = std::from_chars(literal.data(), literal.data() + literal.size(), integer);
+        if (error != std::errc() || end != literal.data() + literal.size()) {
+            return std::nullopt;
+        }
+        return integer;
+    }
 
     /**
-     * SELECT colA, colB as colC FROM mytable;
+     * Returns true if a `-` after this token is a sign rather than a subtraction.
      */
-    expr = std::make_shared<AST::Rho>("colB", "colC",
-                                      std::make_shared<AST::Projection>(std::vector<std::string>{"colA", "colB"},
-                                                                        std::make_shared<AST::Read>("mytable")));
+    auto StartsOperand(const std::optional<Token>& previous) -> bool {
+        if (!previous) {
+            return true;
+        }
+        if (previous->type == Token::SYMBOL) {
+            return previous->text != ")";
+        }
+        return previous->type == Token::IDENTIFIER && Lexer::IsReserved(previous->text);
+    }
 
     /**
-     * SELECT * FROM mytable WHERE colA > 5.0;
+     * Whether two columns of a SELECT are the same column, where a name without a table is the same as either side of a
+     * join that has it.
      */
-    expr = std::make_shared<AST::Filter>(std::make_shared<AST::GTOperator>(std::make_shared<AST::ReadColumn>("colA"),
-                                                                           std::make_shared<AST::ConstantFloat>(5.0)),
-                                         std::make_shared<AST::Read>("mytable"));
+    auto IsSameColumn(const AST::ColumnRef& lhs, const AST::ColumnRef& rhs) -> bool {
+        return lhs.column == rhs.column && (lhs.table.empty() || rhs.table.empty() || lhs.table == rhs.table);
+    }
 
-    /**
-     * SELECT * FROM mytable WHERE colA > 5.0 AND colB < 2.0;
-     */
-    expr = std::make_shared<AST::Filter>(std::make_shared<AST::AndOperator>(std::make_shared<AST::GTOperator>(std::make_shared<AST::ReadColumn>("colA"),
-                                                                                                              std::make_shared<AST::ConstantFloat>(5.0)),
-                                                                            std::make_shared<AST::LTOperator>(std::make_shared<AST::ReadColumn>("colB"),
-                                                                                                              std::make_shared<AST::ConstantFloat>(2.0))),
-                                         std::make_shared<AST::Read>("mytable"));
+    struct WindowSpec {
+        std::vector<AST::ColumnRef> partitionBy;
+        std::vector<AST::OrderBy::SortColumn> orderBy;
+
+        bool operator==(const WindowSpec& other) const noexcept {
+            return this->partitionBy == other.partitionBy && std::equal(this->orderBy.begin(), this->orderBy.end(), other.orderBy.begin(), other.orderBy.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.column == rhs.column && lhs.ascending == rhs.ascending;
+            });
+        }
+    };
+
+    struct SelectItem {
+        enum Kind {
+            ALL,
+            COLUMN,
+            AGGREGATE,
+            WINDOW
+        };
+
+        Kind kind = ALL;
+        AST::ColumnRef column;
+        std::string alias;
+        AST::Aggregate::Aggregation aggregation{};
+        AST::Window::WindowFunction windowFunction{};
+
+        // The window of a window function, either written after OVER, or named by a WINDOW clause.
+        std::optional<WindowSpec> window;
+        std::string windowName;
+
+        /**
+         * The name of the column the item outputs, before the alias of a column is applied.  Functions are named the same
+         * way the query engine names them.
+         */
+        AST::ColumnRef name() const {
+            switch (this->kind) {
+            case ALL:
+            case COLUMN:
+                return this->column;
+            case AGGREGATE:
+                return this->alias.empty() ? FunctionName(this->aggregation.function) + "(" + (this->column.column.empty() ? "*" : this->column.name()) + ")" : this->alias;
+            case WINDOW:
+                return this->alias.empty() ? FunctionName(this->windowFunction.function) + "(" + this->column.name() + ")" : this->alias;
+            }
+            return this->column;
+        }
+
+        static std::string FunctionName(AST::Aggregate::Function function) {
+            switch (function) {
+            case AST::Aggregate::COUNT:
+                return "COUNT";
+            case AST::Aggregate::SUM:
+                return "SUM";
+            case AST::Aggregate::MIN:
+                return "MIN";
+            case AST::Aggregate::MAX:
+                return "MAX";
+            case AST::Aggregate::AVG:
+                return "AVG";
+            case AST::Aggregate::APPROX_COUNT_DISTINCT:
+                return "APPROX_COUNT_DISTINCT";
+            case AST::Aggregate::APPROX_PERCENTILE:
+                return "APPROX_PERCENTILE";
+            }
+            return "";
+        }
+
+        static std::string FunctionName(AST::Window::Function function) {
+            switch (function) {
+            case AST::Window::ROW_NUMBER:
+                return "ROW_NUMBER";
+            case AST::Window::RANK:
+                return "RANK";
+            case AST::Window::SUM:
+                return "SUM";
+            case AST::Window::LAG:
+                return "LAG";
+            case AST::Window::LEAD:
+                return "LEAD";
+            }
+            return "";
+        }
+    };
 
     /**
-     * SELECT * FROM mytable JOIN mytable2 ON mytable.colA = mytable2.colA;
+     * The expression of a single SELECT, along with what a statement around it needs to know about its columns.
      */
-    expr = std::make_shared<AST::Join>(AST::Join::JoinType::NATURAL,
-                                       std::make_shared<AST::EqOperator>(std::make_shared<AST::ReadColumn>("mytable", "colA"),
-                                                                         std::make_shared<AST::ReadColumn>("mytable2", "colB")),
-                                       std::make_shared<AST::Read>("mytable2"),
-                                       std::make_shared<AST::Read>("mytable"));
+    struct Select {
+        std::shared_ptr<AST::Expr> expr;
+
+        // The names of the output columns, after aliases, or empty for `SELECT *`.
+        std::vector<std::string> outputNames;
+
+        // The columns renamed by an alias, by the alias, so ORDER BY can sort by the original column.
+        std::unordered_map<std::string, AST::ColumnRef> aliases;
+
+        // The file the rows are written to by `SELECT ... INTO 'file'`.
+        std::optional<std::string> into;
+    };
 
     /**
-     * SELECT colA, colB FROM mytable LIMIT 10;
+     * Parses a single statement by recursive descent, one token ahead.  Once a token doesn't fit, the error is printed
+     * and every method returns nullptr or an empty value, so the statement isn't partially built.
+     *
+     *     statement := select ((UNION [ALL] | INTERSECT | EXCEPT) select)* [ORDER BY sort, ...] [LIMIT n] [;]
+     *     select    := SELECT [DISTINCT] item, ... [INTO 'file'] FROM table [[AS] alias] join*
+     *                  [WHERE condition] [GROUP BY column, ...] [WINDOW name AS (window), ...]
+     *     join      := [INNER | LEFT [OUTER] | RIGHT [OUTER]] JOIN table [[AS] alias] ON column = column
+     *     item      := * | column [[AS] alias] | function(...) [OVER (name | (window))] [[AS] alias]
+     *     window    := [PARTITION BY column, ...] [ORDER BY sort, ...]
+     *     condition := comparison, combined with AND and OR, or with BETWEEN
      */
-    expr = std::make_shared<AST::Limit>(10,
-                                        std::make_shared<AST::Projection>(std::vector<std::string>{"colA", "colB"},
-                                                                          std::make_shared<AST::Read>("mytable")));
+    class StatementParser final {
+    public:
+        StatementParser(std::string_view query) : _lexer(query), _token(_lexer.next()) {}
+
+        auto parse() -> std::shared_ptr<AST::Expr> {
+            auto first = this->parseSelect();
+            auto expr = first.expr;
+            bool isCompound = false;
+            while (expr) {
+                std::optional<AST::SetOperation::Operation> operation;
+                if (this->accept("UNION")) {
+                    operation = this->accept("ALL") ? AST::SetOperation::UNION_ALL : AST::SetOperation::UNION;
+                } else if (this->accept("INTERSECT")) {
+                    operation = AST::SetOperation::INTERSECT;
+                } else if (this->accept("EXCEPT")) {
+                    operation = AST::SetOperation::EXCEPT;
+                } else {
+                    break;
+                }
+
+                auto rhs = this->parseSelect();
+                if (rhs.into) {
+                    this->error("Only the first SELECT can have INTO");
+                }
+                expr = rhs.expr ? std::make_shared<AST::SetOperation>(*operation, expr, rhs.expr) : nullptr;
+                isCompound = true;
+            }
+
+            if (expr && this->accept("ORDER")) {
+                // The sides of a set operation may rename their columns differently, so only a single SELECT's are used.
+                auto columns = this->parseSortColumns(isCompound ? nullptr : &first.aliases);
+                expr = this->_failed ? nullptr : std::make_shared<AST::OrderBy>(std::move(columns), expr);
+            }
+            if (expr && this->accept("LIMIT")) {
+                std::size_t value = 0;
+                const auto text = this->_token.text;
+                const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+                if (this->_token.type != Token::NUMBER || error != std::errc() || end != text.data() + text.size()) {
+                    this->error("Expected the number of rows of LIMIT");
+                } else {
+                    this->advance();
+                    expr = std::make_shared<AST::Limit>(value, expr);
+                }
+            }
+
+            while (this->_token.isSymbol(";")) {
+                this->advance();
+            }
+            if (this->_token.type != Token::END) {
+                this->error("Expected the end of the query");
+            }
+            if (this->_failed || !expr) {
+                return nullptr;
+            }
+
+            if (first.into) {
+                return std::make_shared<AST::Write>(*first.into, std::move(first.outputNames), metaldb::CSV, expr);
+            }
+            return expr;
+        }
+
+    private:
+        void advance() noexcept {
+            this->_token = this->_lexer.next();
+        }
+
+        /**
+         * Prints the first error of the query.  A syntax error also prints the token it was found at.
+         */
+        void error(const std::string& message, bool isSyntax = true) {
+            if (this->_failed) {
+                return;
+            }
+            this->_failed = true;
+            if (!isSyntax) {
+                std::cerr << message << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            } else if (this->_token.type == Token::INVALID) {
+                std::cerr << "Unexpected character or unclosed quote at offset " << this->_token.offset << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            } else {
+                const auto found = this->_token.type == Token::END ? std::string("the end of the query") : "'" + std::string(this->_token.text) + "'";
+                std::cerr << message << ", found " << found << " at offset " << this->_token.offset << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            }
+        }
+
+        bool accept(std::string_view keyword) noexcept {
+            if (this->_failed || !this->_token.isKeyword(keyword)) {
+                return false;
+            }
+            this->advance();
+            return true;
+        }
+
+        bool acceptSymbol(std::string_view symbol) noexcept {
+            if (this->_failed || !this->_token.isSymbol(symbol)) {
+                return false;
+            }
+            this->advance();
+            return true;
+        }
+
+        bool expect(std::string_view keyword) {
+            if (this->accept(keyword)) {
+                return true;
+            }
+            this->error("Expected " + std::string(keyword));
+            return false;
+        }
+
+        bool expectSymbol(std::string_view symbol) {
+            if (this->acceptSymbol(symbol)) {
+                return true;
+            }
+            this->error("Expected '" + std::string(symbol) + "'");
+            return false;
+        }
+
+        bool isName() const noexcept {
+            return !this->_failed && (this->_token.type == Token::QUOTED_IDENTIFIER || (this->_token.type == Token::IDENTIFIER && !Lexer::IsReserved(this->_token.text)));
+        }
+
+        auto parseName() -> std::string {
+            if (!this->isName()) {
+                this->error("Expected a name");
+                return "";
+            }
+            auto name = this->_token.type == Token::QUOTED_IDENTIFIER ? this->_token.unescaped() : std::string(this->_token.text);
+            this->advance();
+            return name;
+        }
+
+        /**
+         * A name after `AS`, or a name on its own after a table or a column.
+         */
+        auto parseAlias() -> std::string {
+            if (this->accept("AS")) {
+                return this->parseName();
+            }
+            return this->isName() ? this->parseName() : "";
+        }
+
+        /**
+         * `column` or `table.column`, with an alias of a table replaced by the table.  The items of a SELECT come before its
+         * FROM, so their tables are resolved once FROM has been parsed.
+         */
+        auto parseColumnRef() -> AST::ColumnRef {
+            AST::ColumnRef ref(this->parseName());
+            if (this->acceptSymbol(".")) {
+                ref.table = std::move(ref.column);
+                ref.column = this->parseName();
+            }
+            if (!this->_tables.empty()) {
+                this->resolveTable(ref);
+            }
+            return ref;
+        }
+
+        /**
+         * Replaces the alias of a table by the table, and rejects a table that isn't in FROM.
+         */
+        void resolveTable(AST::ColumnRef& ref) {
+            if (ref.table.empty()) {
+                return;
+            }
+            auto it = this->_tables.find(ref.table);
+            if (it == this->_tables.end()) {
+                this->error("Unknown table " + ref.table, false);
+                return;
+            }
+            ref.table = it->second;
+        }
+
+        auto parseColumnList() -> std::vector<AST::ColumnRef> {
+            std::vector<AST::ColumnRef> columns;
+            do {
+                columns.push_back(this->parseColumnRef());
+            } while (this->acceptSymbol(","));
+            return columns;
+        }
+
+        /**
+         * The columns after ORDER BY.  An alias of a column in @b aliases sorts by the column it renames.
+         */
+        auto parseSortColumns(const std::unordered_map<std::string, AST::ColumnRef>* aliases) -> std::vector<AST::OrderBy::SortColumn> {
+            this->expect("BY");
+            std::vector<AST::OrderBy::SortColumn> columns;
+            do {
+                AST::OrderBy::SortColumn column;
+                column.column = this->parseColumnRef();
+                if (aliases && column.column.table.empty()) {
+                    if (auto it = aliases->find(column.column.column); it != aliases->end()) {
+                        column.column = it->second;
+                    }
+                }
+                if (this->accept("DESC")) {
+                    column.ascending = false;
+                } else {
+                    this->accept("ASC");
+                }
+                columns.push_back(std::move(column));
+            } while (this->acceptSymbol(","));
+            return columns;
+        }
+
+        auto parseWindowSpec() -> WindowSpec {
+            WindowSpec window;
+            this->expectSymbol("(");
+            if (this->accept("PARTITION")) {
+                this->expect("BY");
+                window.partitionBy = this->parseColumnList();
+            }
+            if (this->accept("ORDER")) {
+                window.orderBy = this->parseSortColumns(nullptr);
+            }
+            this->expectSymbol(")");
+            return window;
+        }
+
+        void parseFunction(SelectItem& item) {
+            const auto name = this->_token.text;
+            auto nameToken = this->_token;
+            this->advance();
+            this->expectSymbol("(");
+
+            // Every function takes a column, except `COUNT(*)`, `ROW_NUMBER()` and `RANK()`.
+            if (this->acceptSymbol("*")) {
+                item.column = AST::ColumnRef();
+            } else if (!this->_token.isSymbol(")")) {
+                item.column = this->parseColumnRef();
+            }
+
+            // The percentile of `APPROX_PERCENTILE`, or the offset of `LAG` and `LEAD`.
+            std::optional<AST::Parameter::Value> argument;
+            if (this->acceptSymbol(",")) {
+                if (this->_token.type != Token::NUMBER) {
+                    this->error("Expected a number");
+                    return;
+                }
+                argument = NumberValue(this->_token.text, false);
+                if (!argument) {
+                    this->error("Integer is out of range");
+                    return;
+                }
+                this->advance();
+            }
+            this->expectSymbol(")");
+
+            auto isFunction = [&](std::string_view function) {
+                return nameToken.isKeyword(function);
+            };
+            if (this->accept("OVER")) {
+                item.kind = SelectItem::WINDOW;
+                if (isFunction("ROW_NUMBER")) {
+                    item.windowFunction.function = AST::Window::ROW_NUMBER;
+                } else if (isFunction("RANK")) {
+                    item.windowFunction.function = AST::Window::RANK;
+                } else if (isFunction("SUM")) {
+                    item.windowFunction.function = AST::Window::SUM;
+                } else if (isFunction("LAG")) {
+                    item.windowFunction.function = AST::Window::LAG;
+                } else if (isFunction("LEAD")) {
+                    item.windowFunction.function = AST::Window::LEAD;
+                } else {
+                    this->error("Unknown window function " + std::string(name));
+                    return;
+                }
+
+                if (auto offset = argument ? std::get_if<int>(&*argument) : nullptr; offset && *offset > 0) {
+                    item.windowFunction.offset = (std::size_t) *offset;
+                } else if (argument) {
+                    this->error("Expected a positive offset");
+                    return;
+                }
+                item.windowFunction.column = item.column;
+
+                if (this->_token.isSymbol("(")) {
+                    item.window = this->parseWindowSpec();
+                } else {
+                    item.windowName = this->parseName();
+                }
+                return;
+            }
+
+            item.kind = SelectItem::AGGREGATE;
+            if (isFunction("COUNT")) {
+                item.aggregation.function = AST::Aggregate::COUNT;
+            } else if (isFunction("SUM")) {
+                item.aggregation.function = AST::Aggregate::SUM;
+            } else if (isFunction("MIN")) {
+                item.aggregation.function = AST::Aggregate::MIN;
+            } else if (isFunction("MAX")) {
+                item.aggregation.function = AST::Aggregate::MAX;
+            } else if (isFunction("AVG")) {
+                item.aggregation.function = AST::Aggregate::AVG;
+            } else if (isFunction("APPROX_COUNT_DISTINCT")) {
+                item.aggregation.function = AST::Aggregate::APPROX_COUNT_DISTINCT;
+            } else if (isFunction("APPROX_PERCENTILE")) {
+                item.aggregation.function = AST::Aggregate::APPROX_PERCENTILE;
+            } else {
+                this->error("Unknown aggregate function " + std::string(name));
+                return;
+            }
 
-    return expr;
+            if (item.aggregation.function == AST::Aggregate::APPROX_PERCENTILE && argument) {
+                const auto* integer = std::get_if<int>(&*argument);
+                item.aggregation.percentile = integer ? *integer : std::get<float>(*argument);
+                if (item.aggregation.percentile < 0 || item.aggregation.percentile > 1) {
+                    this->error("Expected a percentile between 0 and 1");
+                    return;
+                }
+            } else if (argument) {
+                this->error("Unexpected argument to " + std::string(name));
+                return;
+            }
+            item.aggregation.column = item.column;
+        }
+
+        auto parseSelectItem() -> SelectItem {
+            SelectItem item;
+            if (this->acceptSymbol("*")) {
+                item.kind = SelectItem::ALL;
+                return item;
+            }
+
+            if (this->_token.type == Token::IDENTIFIER && this->_lexer.peek().isSymbol("(")) {
+                this->parseFunction(item);
+            } else {
+                item.kind = SelectItem::COLUMN;
+                item.column = this->parseColumnRef();
+            }
+
+            item.alias = this->parseAlias();
+            item.aggregation.alias = item.alias;
+            item.windowFunction.alias = item.alias;
+            return item;
+        }
+
+        auto parseOperand() -> std::shared_ptr<AST::BaseFilterExpr> {
+            if (this->_failed) {
+                return nullptr;
+            }
+
+            const auto token = this->_token;
+            if (token.type == Token::PARAMETER) {
+                this->advance();
+                return std::make_shared<AST::Parameter>(this->_numParameters++);
+            }
+            if (token.type == Token::STRING) {
+                this->advance();
+                return std::make_shared<AST::ConstantString>(token.unescaped());
+            }
+            if (token.isKeyword("TRUE") || token.isKeyword("FALSE")) {
+                this->advance();
+                return std::make_shared<AST::ConstantBool>(token.isKeyword("TRUE"));
+            }
+
+            const auto negative = token.isSymbol("-");
+            if (negative || token.isSymbol("+")) {
+                this->advance();
+            }
+            if (this->_token.type == Token::NUMBER) {
+                const auto value = NumberValue(this->_token.text, negative);
+                if (!value) {
+                    this->error("Integer is out of range");
+                    return nullptr;
+                }
+                this->advance();
+                if (auto integer = std::get_if<int>(&*value)) {
+                    return std::make_shared<AST::ConstantInt>(*integer);
+                }
+                return std::make_shared<AST::ConstantFloat>(std::get<float>(*value));
+            }
+            if (negative) {
+                this->error("Expected a number");
+                return nullptr;
+            }
+
+            auto ref = this->parseColumnRef();
+            if (this->_failed) {
+                return nullptr;
+            }
+            return ref.table.empty() ? std::make_shared<AST::ReadColumn>(std::move(ref.column)) : std::make_shared<AST::ReadColumn>(std::move(ref.table), std::move(ref.column));
+        }
+
+        auto parseComparison() -> std::shared_ptr<AST::BaseFilterExpr> {
+            if (this->acceptSymbol("(")) {
+                auto expr = this->parseCondition();
+                this->expectSymbol(")");
+                return this->_failed ? nullptr : expr;
+            }
+            if (this->_token.isKeyword("NOT")) {
+                this->error("NOT isn't supported");
+                return nullptr;
+            }
+
+            auto lhs = this->parseOperand();
+            if (this->accept("BETWEEN")) {
+                auto low = this->parseOperand();
+                this->expect("AND");
+                auto high = this->parseOperand();
+                if (this->_failed) {
+                    return nullptr;
+                }
+                return std::make_shared<AST::AndOperator>(std::make_shared<AST::GTEOperator>(lhs, low),
+                                                          std::make_shared<AST::LTEOperator>(lhs, high));
+            }
+
+            const auto op = this->_token;
+            if (op.type != Token::SYMBOL || op.isSymbol(")") || op.isSymbol(";")) {
+                // TRUE and FALSE are conditions on their own.
+                if (std::dynamic_pointer_cast<AST::ConstantBool>(lhs)) {
+                    return lhs;
+                }
+                this->error("Expected a comparison");
+                return nullptr;
+            }
+            if (op.isSymbol("<>") || op.isSymbol("!=")) {
+                this->error("Not equal isn't supported");
+                return nullptr;
+            }
+            this->advance();
+            auto rhs = this->parseOperand();
+            if (this->_failed) {
+                return nullptr;
+            }
+
+            if (op.isSymbol("=")) {
+                return std::make_shared<AST::EqOperator>(lhs, rhs);
+            } else if (op.isSymbol("<")) {
+                return std::make_shared<AST::LTOperator>(lhs, rhs);
+            } else if (op.isSymbol("<=")) {
+                return std::make_shared<AST::LTEOperator>(lhs, rhs);
+            } else if (op.isSymbol(">")) {
+                return std::make_shared<AST::GTOperator>(lhs, rhs);
+            } else if (op.isSymbol(">=")) {
+                return std::make_shared<AST::GTEOperator>(lhs, rhs);
+            }
+            this->error("Expected a comparison");
+            return nullptr;
+        }
+
+        auto parseConjunction() -> std::shared_ptr<AST::BaseFilterExpr> {
+            auto expr = this->parseComparison();
+            while (expr && this->accept("AND")) {
+                auto rhs = this->parseComparison();
+                expr = rhs ? std::make_shared<AST::AndOperator>(expr, rhs) : nullptr;
+            }
+            return expr;
+        }
+
+        auto parseCondition() -> std::shared_ptr<AST::BaseFilterExpr> {
+            auto expr = this->parseConjunction();
+            while (expr && this->accept("OR")) {
+                auto rhs = this->parseConjunction();
+                expr = rhs ? std::make_shared<AST::OrOperator>(expr, rhs) : nullptr;
+            }
+            return expr;
+        }
+
+        auto parseTable() -> std::shared_ptr<AST::Expr> {
+            auto table = this->parseName();
+            auto alias = this->parseAlias();
+            this->_tables[table] = table;
+            if (!alias.empty()) {
+                this->_tables[alias] = table;
+            }
+            return this->_failed ? nullptr : std::make_shared<AST::Read>(std::move(table));
+        }
+
+        auto parseFrom() -> std::shared_ptr<AST::Expr> {
+            auto expr = this->parseTable();
+            while (expr) {
+                AST::Join::JoinType joinType = AST::Join::NATURAL;
+                if (this->accept("LEFT")) {
+                    joinType = AST::Join::LEFT;
+                    this->accept("OUTER");
+                } else if (this->accept("RIGHT")) {
+                    joinType = AST::Join::RIGHT;
+                    this->accept("OUTER");
+                } else if (!this->accept("INNER") && !this->_token.isKeyword("JOIN")) {
+                    break;
+                }
+                this->expect("JOIN");
+
+                auto rhs = this->parseTable();
+                this->expect("ON");
+                auto lhsColumn = this->parseOperand();
+                this->expectSymbol("=");
+                auto rhsColumn = this->parseOperand();
+                if (this->_failed) {
+                    return nullptr;
+                }
+                if (!std::dynamic_pointer_cast<AST::ReadColumn>(lhsColumn) || !std::dynamic_pointer_cast<AST::ReadColumn>(rhsColumn)) {
+                    this->error("A join has to be on a column of each table");
+                    return nullptr;
+                }
+                expr = std::make_shared<AST::Join>(joinType, std::make_shared<AST::EqOperator>(lhsColumn, rhsColumn), expr, rhs);
+            }
+            return expr;
+        }
+
+        auto parseSelect() -> Select {
+            Select select;
+            this->_tables.clear();
+            this->expect("SELECT");
+            const auto isDistinct = this->accept("DISTINCT");
+
+            std::vector<SelectItem> items;
+            do {
+                items.push_back(this->parseSelectItem());
+            } while (this->acceptSymbol(","));
+
+            if (this->accept("INTO")) {
+                if (this->_token.type != Token::STRING) {
+                    this->error("Expected the file to write to");
+                    return select;
+                }
+                select.into = this->_token.unescaped();
+                this->advance();
+            }
+
+            this->expect("FROM");
+            auto expr = this->parseFrom();
+            for (auto& item : items) {
+                this->resolveTable(item.column);
+                item.aggregation.column = item.column;
+                item.windowFunction.column = item.column;
+                if (item.window) {
+                    std::for_each(item.window->partitionBy.begin(), item.window->partitionBy.end(), [&](auto& column) { this->resolveTable(column); });
+                    std::for_each(item.window->orderBy.begin(), item.window->orderBy.end(), [&](auto& column) { this->resolveTable(column.column); });
+                }
+            }
+            if (expr && this->accept("WHERE")) {
+                auto condition = this->parseCondition();
+                expr = condition ? std::make_shared<AST::Filter>(condition, expr) : nullptr;
+            }
+
+            std::vector<AST::ColumnRef> groupBy;
+            if (this->accept("GROUP")) {
+                this->expect("BY");
+                groupBy = this->parseColumnList();
+            }
+            if (this->_token.isKeyword("HAVING")) {
+                this->error("HAVING isn't supported");
+            }
+
+            std::unordered_map<std::string, WindowSpec> windows;
+            if (this->accept("WINDOW")) {
+                do {
+                    auto name = this->parseName();
+                    this->expect("AS");
+                    windows[name] = this->parseWindowSpec();
+                } while (this->acceptSymbol(","));
+            }
+            if (this->_failed || !expr) {
+                return select;
+            }
+
+            select.expr = this->applySelectItems(items, groupBy, windows, expr);
+            if (select.expr && isDistinct) {
+                select.expr = std::make_shared<AST::Distinct>(select.expr);
+            }
+            for (const auto& item : items) {
+                if (item.kind == SelectItem::ALL) {
+                    continue;
+                }
+                select.outputNames.push_back(item.alias.empty() ? item.name().column : item.alias);
+                if (item.kind == SelectItem::COLUMN && !item.alias.empty()) {
+                    select.aliases[item.alias] = item.column;
+                }
+            }
+            return select;
+        }
+
+        /**
+         * Wraps the rows of FROM in the aggregate, window or projection that outputs the items of the SELECT.  A column that
+         * isn't an aggregate is one of the GROUP BY columns, and every window function shares one window.
+         */
+        auto applySelectItems(const std::vector<SelectItem>& items, const std::vector<AST::ColumnRef>& groupBy, const std::unordered_map<std::string, WindowSpec>& windows, std::shared_ptr<AST::Expr> expr) -> std::shared_ptr<AST::Expr> {
+            auto hasKind = [&](SelectItem::Kind kind) {
+                return std::any_of(items.begin(), items.end(), [&](const auto& item) { return item.kind == kind; });
+            };
+            const auto hasAll = hasKind(SelectItem::ALL);
+            const auto hasAggregate = hasKind(SelectItem::AGGREGATE);
+            const auto hasWindow = hasKind(SelectItem::WINDOW);
+
+            std::vector<AST::ColumnRef> columns;
+            for (const auto& item : items) {
+                columns.push_back(item.name());
+            }
+
+            if (hasAggregate || !groupBy.empty()) {
+                if (hasAll || hasWindow) {
+                    this->error("A grouped SELECT can only have GROUP BY columns and aggregates", false);
+                    return nullptr;
+                }
+
+                // The aggregate outputs its GROUP BY columns and then its aggregates, so the items only need to be projected
+                // when they are in another order.
+                std::vector<AST::Aggregate::Aggregation> aggregations;
+                std::vector<AST::ColumnRef> aggregateColumns = groupBy;
+                for (const auto& item : items) {
+                    if (item.kind == SelectItem::AGGREGATE) {
+                        aggregations.push_back(item.aggregation);
+                        aggregateColumns.push_back(item.name());
+                    } else if (std::none_of(groupBy.begin(), groupBy.end(), [&](const auto& column) { return IsSameColumn(column, item.column); })) {
+                        this->error("Column " + item.column.name() + " has to be in GROUP BY", false);
+                        return nullptr;
+                    }
+                }
+                expr = std::make_shared<AST::Aggregate>(groupBy, std::move(aggregations), expr);
+                return columns == aggregateColumns ? expr : std::make_shared<AST::Projection>(std::move(columns), expr);
+            }
+
+            if (hasWindow) {
+                std::optional<WindowSpec> window;
+                std::vector<AST::Window::WindowFunction> functions;
+                for (const auto& item : items) {
+                    if (item.kind != SelectItem::WINDOW) {
+                        continue;
+                    }
+                    auto it = windows.find(item.windowName);
+                    if (!item.window && it == windows.end()) {
+                        this->error("Unknown window " + item.windowName, false);
+                        return nullptr;
+                    }
+                    const auto& itemWindow = item.window ? *item.window : it->second;
+                    if (window && !(*window == itemWindow)) {
+                        this->error("Every window function has to use the same window", false);
+                        return nullptr;
+                    }
+                    window = itemWindow;
+                    functions.push_back(item.windowFunction);
+                }
+                expr = std::make_shared<AST::Window>(window->partitionBy, window->orderBy, std::move(functions), expr);
+
+                // `SELECT *, function() OVER w` is every column followed by the functions, which is what the window outputs.
+                const auto isAllFirst = items.front().kind == SelectItem::ALL && std::all_of(items.begin() + 1, items.end(), [](const auto& item) {
+                    return item.kind == SelectItem::WINDOW;
+                });
+                if (isAllFirst) {
+                    return expr;
+                }
+                if (hasAll) {
+                    this->error("* has to come before the window functions", false);
+                    return nullptr;
+                }
+                return std::make_shared<AST::Projection>(std::move(columns), expr);
+            }
+
+            if (hasAll) {
+                if (items.size() != 1) {
+                    this->error("* can't be selected with other columns", false);
+                    return nullptr;
+                }
+                return expr;
+            }
+            return std::make_shared<AST::Projection>(std::move(columns), expr);
+        }
+
+        Lexer _lexer;
+        Token _token;
+
+        // The tables of the current SELECT, by their names and aliases.
+        std::unordered_map<std::string, std::string> _tables;
+
+        std::size_t _numParameters = 0;
+        bool _failed = false;
+    };
+}
+
+auto metaldb::QueryEngine::Parser::Normalize(const std::string& query, std::vector<AST::Parameter::Value>& constants) const -> std::string {
+    std::string normalized;
+    normalized.reserve(query.size());
+    Lexer lexer(query);
+
+    // Whether each open parenthesis is a function call's, whose constants are part of the query rather than values that
+    // rows are compared with, like the percentile of `APPROX_PERCENTILE(fare_amount, 0.99)`.
+    std::vector<bool> calls;
+    std::optional<Token> previous;
+    for (auto token = lexer.next(); token.type != Token::END; previous = token, token = lexer.next()) {
+        if (token.followsSpace && !normalized.empty()) {
+            normalized += ' ';
+        }
+
+        const auto isStructural = (previous && (previous->isKeyword("LIMIT") || previous->isKeyword("OFFSET") || previous->isKeyword("INTO")))
+                                  || (!calls.empty() && calls.back());
+        if (token.isSymbol("(")) {
+            calls.push_back(previous && previous->type == Token::IDENTIFIER && !Lexer::IsReserved(previous->text));
+        } else if (token.isSymbol(")") && !calls.empty()) {
+            calls.pop_back();
+        }
+
+        const auto negative = token.isSymbol("-") && StartsOperand(previous) && lexer.peek().type == Token::NUMBER;
+        if (negative) {
+            normalized += '-';
+            token = lexer.next();
+        }
+
+        switch (token.type) {
+        case Token::STRING:
+            if (isStructural) {
+                normalized += '\'';
+                normalized.append(token.text);
+                normalized += '\'';
+            } else {
+                normalized += '?';
+                constants.emplace_back(token.unescaped());
+            }
+            break;
+        case Token::NUMBER:
+            // An integer out of range is kept, so the normalized query fails to parse like the query does.
+            if (auto value = NumberValue(token.text, negative); isStructural || !value) {
+                normalized.append(token.text);
+            } else {
+                if (negative) {
+                    normalized.pop_back();
+                }
+                normalized += '?';
+                constants.emplace_back(std::move(*value));
+            }
+            break;
+        case Token::PARAMETER:
+            normalized += '?';
+            constants.emplace_back();
+            break;
+        case Token::QUOTED_IDENTIFIER:
+            normalized += '"';
+            normalized.append(token.text);
+            normalized += '"';
+            break;
+        default:
+            normalized.append(token.text);
+            break;
+        }
+    }
+
+    // Trailing whitespace and semicolons don't change the query.
+    while (!normalized.empty() && (normalized.back() == ' ' || normalized.back() == ';')) {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+auto metaldb::QueryEngine::Parser::Parse(const std::string& query) const -> std::shared_ptr<AST::Expr> {
+    StatementParser parser(query);
+    return parser.parse();
 }
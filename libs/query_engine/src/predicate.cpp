@@ -0,0 +1,223 @@
+#include <metaldb/query_engine/predicate.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+
+namespace {
+    using namespace metaldb::QueryEngine;
+
+    /**
+     * Returns true if a value in `[min, max]` can compare with @b value as @b operation does.  Strict comparisons are checked
+     * as if they weren't, since rounding integers to doubles can make distinct values equal.
+     */
+    template<typename T>
+    auto RangeMayMatch(Predicate::Operation operation, const T& min, const T& max, const T& value) -> bool {
+        switch (operation) {
+        case Predicate::EQ:
+            return min <= value && value <= max;
+        case Predicate::LT:
+        case Predicate::LTE:
+            return min <= value;
+        case Predicate::GT:
+        case Predicate::GTE:
+            return max >= value;
+        case Predicate::AND:
+        case Predicate::OR:
+            return true;
+        }
+    }
+
+    /**
+     * The comparisons of a column with constants of one kind under an AND.  Only the tightest bound on each side is needed.
+     */
+    struct Bounds {
+        Bounds(Predicate::ColumnIndexType column_, std::size_t kind_) : column(column_), kind(kind_) {}
+
+        Predicate::ColumnIndexType column;
+        std::size_t kind;
+        std::optional<Predicate> eq;
+        std::optional<Predicate> lower;
+        std::optional<Predicate> upper;
+
+        // Two different EQs.
+        bool contradiction = false;
+
+        void add(const Predicate& comparison) {
+            switch (comparison.operation) {
+            case Predicate::EQ:
+                this->contradiction = this->contradiction || (this->eq && this->eq->value != comparison.value);
+                this->eq = comparison;
+                break;
+            case Predicate::GT:
+            case Predicate::GTE:
+                if (!this->lower || comparison.value > this->lower->value || (comparison.value == this->lower->value && comparison.operation == Predicate::GT)) {
+                    this->lower = comparison;
+                }
+                break;
+            case Predicate::LT:
+            case Predicate::LTE:
+                if (!this->upper || comparison.value < this->upper->value || (comparison.value == this->upper->value && comparison.operation == Predicate::LT)) {
+                    this->upper = comparison;
+                }
+                break;
+            case Predicate::AND:
+            case Predicate::OR:
+                break;
+            }
+        }
+
+        /**
+         * Adds the merged comparisons to @b children .  Returns false if no value is in every bound.
+         */
+        auto merge(std::vector<Predicate>& children) const -> bool {
+            if (this->contradiction) {
+                return false;
+            }
+
+            const auto& value = this->eq ? this->eq->value : this->lower ? this->lower->value : this->upper->value;
+            const auto aboveLower = [&](const auto& value) {
+                return !this->lower || value > this->lower->value || (value == this->lower->value && this->lower->operation == Predicate::GTE);
+            };
+            const auto belowUpper = [&](const auto& value) {
+                return !this->upper || value < this->upper->value || (value == this->upper->value && this->upper->operation == Predicate::LTE);
+            };
+
+            if (this->eq) {
+                if (!aboveLower(value) || !belowUpper(value)) {
+                    return false;
+                }
+                children.push_back(*this->eq);
+                return true;
+            }
+
+            if (this->lower && this->upper && !(this->lower->value < this->upper->value)) {
+                if (this->lower->value != this->upper->value || !aboveLower(value) || !belowUpper(value)) {
+                    return false;
+                }
+
+                // `colA >= 5 AND colA <= 5` is `colA = 5`.
+                auto eq = *this->lower;
+                eq.operation = Predicate::EQ;
+                children.push_back(std::move(eq));
+                return true;
+            }
+
+            if (this->lower) {
+                children.push_back(*this->lower);
+            }
+            if (this->upper) {
+                children.push_back(*this->upper);
+            }
+            return true;
+        }
+    };
+
+    auto SameComparison(const Predicate& lhs, const Predicate& rhs) -> bool {
+        return lhs.isComparison() && rhs.isComparison() && lhs.operation == rhs.operation && lhs.column == rhs.column && lhs.value == rhs.value;
+    }
+}
+
+bool metaldb::QueryEngine::Predicate::mayMatch(const std::vector<ZoneMap>& zoneMaps) const noexcept {
+    switch (this->operation) {
+    case AND:
+        for (const auto& child : this->children) {
+            if (!child.mayMatch(zoneMaps)) {
+                return false;
+            }
+        }
+        return true;
+    case OR:
+        for (const auto& child : this->children) {
+            if (child.mayMatch(zoneMaps)) {
+                return true;
+            }
+        }
+        return false;
+    case EQ:
+    case LT:
+    case LTE:
+    case GT:
+    case GTE:
+        break;
+    }
+
+    const auto& zoneMap = zoneMaps.at(this->column);
+    if (const auto* value = std::get_if<std::string>(&this->value)) {
+        if (!zoneMap.minString || !zoneMap.maxString) {
+            return true;
+        }
+        return RangeMayMatch(this->operation, *zoneMap.minString, *zoneMap.maxString, *value);
+    }
+
+    if (!zoneMap.min || !zoneMap.max) {
+        return true;
+    }
+    const auto value = std::holds_alternative<std::int64_t>(this->value) ? (double) std::get<std::int64_t>(this->value) : std::get<double>(this->value);
+    return RangeMayMatch(this->operation, *zoneMap.min, *zoneMap.max, value);
+}
+
+auto metaldb::QueryEngine::Predicate::simplified() const noexcept -> Predicate {
+    if (this->isComparison()) {
+        return *this;
+    }
+
+    // A TRUE under an AND, or a FALSE under an OR, has no children to flatten, so it's dropped.  A FALSE under an AND, or a
+    // TRUE under an OR, decides the whole predicate.
+    std::vector<Predicate> children;
+    for (const auto& child : this->children) {
+        auto simplified = child.simplified();
+        if (simplified.operation == this->operation) {
+            std::move(simplified.children.begin(), simplified.children.end(), std::back_inserter(children));
+        } else if ((this->operation == AND && simplified.isFalse()) || (this->operation == OR && simplified.isTrue())) {
+            return simplified;
+        } else if (std::none_of(children.begin(), children.end(), [&](const auto& existing) { return SameComparison(existing, simplified); })) {
+            children.push_back(std::move(simplified));
+        }
+    }
+
+    if (this->operation == AND) {
+        // Merged comparisons go first, since they're cheaper than the ORs left.
+        std::vector<Bounds> bounds;
+        std::vector<Predicate> others;
+        for (auto& child : children) {
+            if (!child.isComparison()) {
+                others.push_back(std::move(child));
+                continue;
+            }
+
+            auto it = std::find_if(bounds.begin(), bounds.end(), [&](const auto& bound) {
+                return bound.column == child.column && bound.kind == child.value.index();
+            });
+            if (it == bounds.end()) {
+                it = bounds.insert(bounds.end(), Bounds{child.column, child.value.index()});
+            }
+            it->add(child);
+        }
+
+        children.clear();
+        for (const auto& bound : bounds) {
+            if (!bound.merge(children)) {
+                return Predicate::False();
+            }
+        }
+        std::move(others.begin(), others.end(), std::back_inserter(children));
+    }
+
+    if (children.size() == 1) {
+        return std::move(children.front());
+    }
+
+    Predicate predicate{this->operation};
+    predicate.children = std::move(children);
+    return predicate;
+}
+
+void metaldb::QueryEngine::Predicate::reorder(const std::vector<std::size_t>& order) noexcept {
+    std::vector<Predicate> children;
+    children.reserve(this->children.size());
+    for (const auto index : order) {
+        children.push_back(std::move(this->children.at(index)));
+    }
+    this->children = std::move(children);
+}
@@ -1,67 +1,1577 @@
 #include <metaldb/query_engine/query_engine.hpp>
 #include <metaldb/query_engine/partials.hpp>
 
+#include <metaldb/query_engine/AST/aggregate.hpp>
+#include <metaldb/query_engine/AST/distinct.hpp>
 #include <metaldb/query_engine/AST/filter.hpp>
 #include <metaldb/query_engine/AST/read.hpp>
 #include <metaldb/query_engine/AST/projection.hpp>
 #include <metaldb/query_engine/AST/limit.hpp>
 #include <metaldb/query_engine/AST/join.hpp>
+#include <metaldb/query_engine/AST/order_by.hpp>
+#include <metaldb/query_engine/AST/set_operation.hpp>
+#include <metaldb/query_engine/AST/window.hpp>
 #include <metaldb/query_engine/AST/write.hpp>
 
+#include <algorithm>
 #include <filesystem>
 #include <vector>
 #include <string>
 #include <memory>
 #include <set>
+#include <unordered_map>
+#include <optional>
+#include <tuple>
+#include <type_traits>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <variant>
 
 namespace {
     using namespace metaldb::QueryEngine;
     auto DispatchAST(const std::shared_ptr<AST::Expr>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>>;
 
-    auto listDir(const std::string& path) -> std::vector<std::filesystem::path> {
-        std::vector<std::filesystem::path> output;
-        auto iterator = std::filesystem::recursive_directory_iterator(path);
+    /**
+     * Written by Hive for partitions whose value is null.
+     */
+    constexpr auto NullPartitionValue = "__HIVE_DEFAULT_PARTITION__";
 
-        for (const std::filesystem::directory_entry& dir_entry : iterator) {
-            output.push_back(dir_entry);
+    /**
+     * Returns the `key=value` directories between the path of a table and a file in it, outermost first.  Values with
+     * commas are not partitions, since they are appended to the rows of the file when it's parsed.
+     */
+    auto ParsePartitions(const std::filesystem::path& tablePath, const std::filesystem::path& file) -> std::vector<std::pair<std::string, std::optional<std::string>>> {
+        std::vector<std::pair<std::string, std::optional<std::string>>> partitions;
+        for (const auto& segment : file.parent_path().lexically_relative(tablePath)) {
+            const auto name = segment.string();
+            const auto separator = name.find('=');
+            if (separator == std::string::npos || separator == 0 || name.find(',') != std::string::npos) {
+                continue;
+            }
+
+            auto value = name.substr(separator + 1);
+            if (value == NullPartitionValue) {
+                partitions.emplace_back(name.substr(0, separator), std::nullopt);
+            } else {
+                partitions.emplace_back(name.substr(0, separator), std::move(value));
+            }
+        }
+        return partitions;
+    }
+
+    /**
+     * Returns the narrowest type that can hold every value of a partition column.
+     */
+    auto InferPartitionType(const std::vector<std::string>& values) -> metaldb::ColumnType {
+        auto isInteger = [](const std::string& value) {
+            const std::size_t start = (!value.empty() && value.front() == '-') ? 1 : 0;
+            return value.size() > start && std::all_of(value.begin() + start, value.end(), [](char c) { return c >= '0' && c <= '9'; });
+        };
+        auto isFloat = [](const std::string& value) {
+            char* end = nullptr;
+            std::strtod(value.c_str(), &end);
+            return !value.empty() && end == value.c_str() + value.size();
+        };
+
+        if (values.empty()) {
+            return metaldb::String;
+        } else if (std::all_of(values.begin(), values.end(), isInteger)) {
+            return metaldb::Integer;
+        } else if (std::all_of(values.begin(), values.end(), isFloat)) {
+            return metaldb::Float;
+        }
+        return metaldb::String;
+    }
+
+    /**
+     * Returns the index of the column a query names.  `table.column` is the column read from that table, which a join
+     * renames to `table.column` when the other side has a column of the same name.  A qualified name that more than one
+     * column answers to, like either side of a table joined with itself, is rejected rather than picking one.
+     */
+    auto ResolveColumn(const TableDefinition& tableDef, const AST::ColumnRef& ref) -> std::optional<std::size_t> {
+        if (ref.table.empty()) {
+            return tableDef.getColumnIndex(ref.column);
+        }
+
+        std::optional<std::size_t> index;
+        for (std::size_t i = 0; i < tableDef.columns.size(); ++i) {
+            const auto& column = tableDef.columns.at(i);
+            if (column.table != ref.table || (column.name != ref.column && column.name != ref.name())) {
+                continue;
+            }
+            if (index) {
+                std::cerr << "Column is ambiguous: " << ref.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return std::nullopt;
+            }
+            index = i;
+        }
+        return index;
+    }
+
+    auto ProcessReadAST(const std::shared_ptr<AST::Read>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        // This has no children, so no recursive call
+        std::vector<std::shared_ptr<StagePartial>> partials;
+        const auto* tableDef = metadata.getTable(expr->tableName());
+
+        if (tableDef == nullptr) {
+            std::cout << "Failed to find table: " << expr->tableName() << std::endl;
+            return partials;
+        }
+
+        // Read list of files
+        const auto& listOfFiles = metadata.listFiles(*tableDef);
+        std::cout << "Reading " << listOfFiles.size() << " files" << std::endl;
+        std::vector<std::tuple<const FileEntry*, metaldb::Method, std::vector<std::pair<std::string, std::optional<std::string>>>>> files;
+        for (const auto& entry : listOfFiles) {
+            const std::filesystem::path file(entry.path);
+            metaldb::Method method = metaldb::CSV;
+            const auto extension = file.extension();
+            if (extension == StatisticsFile::Extension) {
+                // Statistics are kept next to the files they describe.
+                continue;
+            } else if (extension == ".csv") {
+                method = metaldb::CSV;
+            } else {
+                std::cout << "Unsure how to handle extension (" << __FILE__ << ", " << __LINE__ << "): " << extension << std::endl;
+                continue;
+            }
+            files.emplace_back(&entry, method, ParsePartitions(tableDef->filePath, file));
+        }
+
+        // The columns of the files come first, then the partition columns.  Partition columns that aren't in the table
+        // definition are found from the directories, in the order they are nested.
+        auto definition = std::make_shared<TableDefinition>(*tableDef);
+        definition->columns.clear();
+        std::copy_if(tableDef->columns.begin(), tableDef->columns.end(), std::back_inserter(definition->columns), [](const auto& c) { return !c.partition; });
+        std::copy_if(tableDef->columns.begin(), tableDef->columns.end(), std::back_inserter(definition->columns), [](const auto& c) { return c.partition; });
+        for (const auto& [file, method, partitions] : files) {
+            for (const auto& [key, value] : partitions) {
+                if (!definition->getColumnDefinition(key)) {
+                    ColumnDefinition column(key, metaldb::String);
+                    column.partition = true;
+                    definition->columns.push_back(std::move(column));
+                }
+            }
+        }
+
+        for (auto& column : definition->columns) {
+            column.table = tableDef->name;
+        }
+
+        const auto numFileColumns = definition->numFileColumns();
+        std::vector<std::vector<std::optional<std::string>>> partitionValues(files.size());
+        for (auto column = numFileColumns; column < definition->columns.size(); ++column) {
+            auto& columnDef = definition->columns.at(column);
+            std::vector<std::string> values;
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                const auto& partitions = std::get<2>(files.at(i));
+                auto it = std::find_if(partitions.begin(), partitions.end(), [&](const auto& partition) { return partition.first == columnDef.name; });
+                auto value = it == partitions.end() ? std::nullopt : it->second;
+                if (value) {
+                    values.push_back(*value);
+                } else {
+                    columnDef.nullable = true;
+                }
+                partitionValues.at(i).push_back(std::move(value));
+            }
+
+            const auto declared = tableDef->getColumnDefinition(columnDef.name) != nullptr;
+            if (!declared) {
+                columnDef.type = InferPartitionType(values);
+            }
+        }
+
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            const auto& [entry, method, partitions] = files.at(i);
+            for (const auto& [key, value] : partitions) {
+                if (auto columnDef = definition->getColumnDefinition(key); !columnDef->partition) {
+                    std::cerr << "Partition directory has the name of a column in the file: " << key << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                }
+            }
+
+            // The listing misses a file changed in place, so each file is checked again before its statistics prune the read.
+            const auto current = entry->current();
+            const auto& file = current.path;
+            const auto fileSize = current.fileSize;
+            const auto modifiedTime = current.modifiedTime;
+            auto partial = std::make_shared<ReadPartial>(file, method, fileSize);
+            partial->modifiedTime = modifiedTime;
+            partial->definition = definition;
+            partial->partitionValues = std::move(partitionValues.at(i));
+
+            // Statistics from before the file last changed are stale.
+            partial->statistics = metadata.getFileStatistics(file);
+            if (!partial->statistics || partial->statistics->fileSize != fileSize || partial->statistics->modifiedTime != modifiedTime) {
+                // Sidecars are in the listing too, so only the ones that exist are opened.
+                const auto statisticsPath = StatisticsFile::PathFor(file);
+                auto it = std::lower_bound(listOfFiles.begin(), listOfFiles.end(), statisticsPath, [](const FileEntry& entry, const std::string& path) {
+                    return entry.path < path;
+                });
+                const auto hasStatisticsFile = it != listOfFiles.end() && it->path == statisticsPath;
+                partial->statistics = hasStatisticsFile ? StatisticsFile::Read(file, fileSize, modifiedTime) : nullptr;
+            }
+            if (!partial->statistics) {
+                partial->collectedStatistics = std::make_shared<FileStatistics>();
+                partial->collectedStatistics->fileSize = fileSize;
+                partial->collectedStatistics->modifiedTime = modifiedTime;
+            }
+            partials.emplace_back(partial);
+        }
+        
+        return partials;
+    }
+
+    /**
+     * Projects each child partial.  A projection joins the GPU stage of a child that runs on the GPU, such as a read, but the
+     * output of a CPU partial is projected on the CPU, since it never passes through the GPU.
+     */
+    auto MakeProjectionPartials(const std::vector<ProjectionPartial::ColumnIndexType>& columnIndexes, const std::vector<std::shared_ptr<StagePartial>>& childPartials, const std::shared_ptr<TableDefinition>& tableDef) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<StagePartial>> partials;
+        for (auto& p : childPartials) {
+            auto partial = std::make_shared<ProjectionPartial>(columnIndexes);
+            partial->children.push_back(p);
+            partial->definition = tableDef;
+            partial->execution = p->execution;
+            partials.push_back(partial);
+        }
+        return partials;
+    }
+
+    auto ProcessProjectionAST(const std::shared_ptr<AST::Projection>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<StagePartial>> partials;
+        std::vector<std::shared_ptr<StagePartial>> childPartials;
+        if (expr->hasChild()) {
+            childPartials = DispatchAST(expr->child(), metadata);
+        }
+
+        if (childPartials.empty()) {
+            std::cout << "Projection got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+
+        // Make the new table definition
+        auto childTableDef = childPartials.at(0)->definition;
+        auto tableDef = std::make_shared<TableDefinition>();
+        tableDef->name = childTableDef->name;
+
+        // Lookup column indexes
+        std::vector<ProjectionPartial::ColumnIndexType> columnIndexes;
+        columnIndexes.reserve(expr->numColumns());
+        for (const auto& column : expr->columns()) {
+            // Store the current table definiton in the AST?
+            auto index = ResolveColumn(*childTableDef, column);
+            if (index) {
+                tableDef->columns.push_back(childTableDef->columns.at(*index));
+                columnIndexes.push_back(*index);
+            } else {
+                std::cerr << "Failed to get column name: " << column.name() << std::endl;
+                return partials;
+            }
+        }
+
+        return MakeProjectionPartials(columnIndexes, childPartials, tableDef);
+    }
+
+    /**
+     * The estimated output of a partial, from the statistics of the files it reads.
+     */
+    struct CardinalityEstimate {
+        double numRows = 0;
+        double rowBytes = 0;
+
+        // The estimated number of distinct values of each column.
+        std::vector<double> distinctCounts;
+
+        double numBytes() const noexcept {
+            return this->numRows * this->rowBytes;
+        }
+    };
+
+    /**
+     * Files without statistics are assumed to have rows of this many bytes, with every value distinct.
+     */
+    constexpr double DefaultRowBytes = 64;
+
+    auto EstimateCardinality(const std::vector<std::shared_ptr<StagePartial>>& partials) -> CardinalityEstimate;
+
+    /**
+     * Estimates the rows of an equi-join, assuming every key of the side with fewer distinct keys matches the other side.
+     */
+    auto EstimateJoin(JoinPartial::JoinType joinType, const CardinalityEstimate& lhs, std::size_t lhsColumnIndex, const CardinalityEstimate& rhs, std::size_t rhsColumnIndex) -> CardinalityEstimate {
+        const auto numDistinctKeys = std::max({lhs.distinctCounts.at(lhsColumnIndex), rhs.distinctCounts.at(rhsColumnIndex), 1.0});
+
+        CardinalityEstimate estimate;
+        estimate.numRows = lhs.numRows * rhs.numRows / numDistinctKeys;
+        if (joinType == JoinPartial::LEFT) {
+            estimate.numRows = std::max(estimate.numRows, lhs.numRows);
+        } else if (joinType == JoinPartial::RIGHT) {
+            estimate.numRows = std::max(estimate.numRows, rhs.numRows);
+        }
+        estimate.rowBytes = lhs.rowBytes + rhs.rowBytes;
+        estimate.distinctCounts = lhs.distinctCounts;
+        estimate.distinctCounts.insert(estimate.distinctCounts.end(), rhs.distinctCounts.begin(), rhs.distinctCounts.end());
+        return estimate;
+    }
+
+    /**
+     * Estimates the number of groups, assuming the group by columns are independent.  Without a group by, there is a single group.
+     */
+    auto EstimateNumGroups(const CardinalityEstimate& input, const std::vector<AggregatePartial::ColumnIndexType>& groupByColumnIndexes) -> double {
+        double numGroups = 1;
+        for (const auto index : groupByColumnIndexes) {
+            numGroups *= input.distinctCounts.at(index);
+        }
+        return std::min(numGroups, std::max(input.numRows, 1.0));
+    }
+
+    auto EstimateCardinality(const std::shared_ptr<StagePartial>& partial) -> CardinalityEstimate {
+        const auto numColumns = partial->definition->columns.size();
+        CardinalityEstimate estimate;
+        if (auto read = std::dynamic_pointer_cast<ReadPartial>(partial)) {
+            const auto& statistics = read->statistics;
+            if (statistics && statistics->rowCount > 0 && statistics->columns.size() == numColumns) {
+                estimate.numRows = statistics->rowCount;
+                estimate.rowBytes = (double) read->fileSize / statistics->rowCount;
+                for (const auto& column : statistics->columns) {
+                    estimate.distinctCounts.push_back(column.distinctCount);
+                }
+            } else {
+                estimate.numRows = read->fileSize / DefaultRowBytes;
+                estimate.rowBytes = DefaultRowBytes;
+            }
+
+            // Only the rows a pushed down filter didn't skip are read.
+            if (read->rowRanges) {
+                double numRows = 0;
+                for (const auto& [startRow, endRow] : *read->rowRanges) {
+                    numRows += endRow - startRow;
+                }
+                estimate.numRows = std::min(estimate.numRows, numRows);
+            }
+        } else if (auto join = std::dynamic_pointer_cast<JoinPartial>(partial)) {
+            const auto middle = partial->children.begin() + join->numLhsChildren;
+            auto lhs = EstimateCardinality(std::vector(partial->children.begin(), middle));
+            auto rhs = EstimateCardinality(std::vector(middle, partial->children.end()));
+            lhs.distinctCounts.resize(join->lhsDefinition->columns.size(), lhs.numRows);
+            rhs.distinctCounts.resize(join->rhsDefinition->columns.size(), rhs.numRows);
+            estimate = EstimateJoin(join->joinType, lhs, join->lhsColumnIndex, rhs, join->rhsColumnIndex);
+        } else if (auto aggregate = std::dynamic_pointer_cast<AggregatePartial>(partial); aggregate && aggregate->phase == AggregatePartial::FINAL) {
+            // The children are partial phases, so estimate the rows they aggregate.
+            std::vector<std::shared_ptr<StagePartial>> inputPartials;
+            for (const auto& child : partial->children) {
+                inputPartials.insert(inputPartials.end(), child->children.begin(), child->children.end());
+            }
+            auto input = EstimateCardinality(inputPartials);
+            const auto numInputColumns = aggregate->inputDefinition->columns.size();
+            input.distinctCounts.resize(numInputColumns, input.numRows);
+
+            estimate.numRows = EstimateNumGroups(input, aggregate->groupByColumnIndexes);
+            estimate.rowBytes = input.rowBytes * numColumns / std::max<std::size_t>(numInputColumns, 1);
+            for (const auto index : aggregate->groupByColumnIndexes) {
+                estimate.distinctCounts.push_back(input.distinctCounts.at(index));
+            }
+        } else if (auto projection = std::dynamic_pointer_cast<ProjectionPartial>(partial)) {
+            auto input = EstimateCardinality(partial->children);
+            const auto numInputColumns = partial->children.empty() ? 0 : partial->children.at(0)->definition->columns.size();
+            input.distinctCounts.resize(numInputColumns, input.numRows);
+
+            estimate.numRows = input.numRows;
+            estimate.rowBytes = input.rowBytes * numColumns / std::max<std::size_t>(numInputColumns, 1);
+            for (const auto index : projection->columnIndexes) {
+                estimate.distinctCounts.push_back(input.distinctCounts.at(index));
+            }
+        } else {
+            estimate = EstimateCardinality(partial->children);
+            if (auto sort = std::dynamic_pointer_cast<SortPartial>(partial); sort && sort->limit) {
+                estimate.numRows = std::min<double>(estimate.numRows, *sort->limit);
+            }
+        }
+
+        // Columns without statistics, or added by the partial, may have every value distinct.
+        estimate.distinctCounts.resize(numColumns, estimate.numRows);
+        for (auto& distinctCount : estimate.distinctCounts) {
+            distinctCount = std::clamp(distinctCount, 1.0, std::max(estimate.numRows, 1.0));
+        }
+        return estimate;
+    }
+
+    /**
+     * Estimates the output of a list of partials together.  The partials usually read files of the same table, which share
+     * their values, so the distinct counts are not added up.
+     */
+    auto EstimateCardinality(const std::vector<std::shared_ptr<StagePartial>>& partials) -> CardinalityEstimate {
+        CardinalityEstimate estimate;
+        double numBytes = 0;
+        for (const auto& partial : partials) {
+            const auto partialEstimate = EstimateCardinality(partial);
+            estimate.numRows += partialEstimate.numRows;
+            numBytes += partialEstimate.numBytes();
+
+            const auto& distinctCounts = partialEstimate.distinctCounts;
+            estimate.distinctCounts.resize(std::max(estimate.distinctCounts.size(), distinctCounts.size()), 0);
+            for (std::size_t i = 0; i < distinctCounts.size(); ++i) {
+                estimate.distinctCounts.at(i) = std::max(estimate.distinctCounts.at(i), distinctCounts.at(i));
+            }
+        }
+        estimate.rowBytes = estimate.numRows > 0 ? numBytes / estimate.numRows : 0;
+        return estimate;
+    }
+
+    void CollectParameters(const std::shared_ptr<AST::BaseFilterExpr>& expr, std::vector<std::shared_ptr<AST::Parameter>>& parameters) {
+        if (auto parameter = std::dynamic_pointer_cast<AST::Parameter>(expr)) {
+            parameters.push_back(parameter);
+            return;
+        }
+
+        auto collect = [&](const auto& op) {
+            CollectParameters(op->lhs(), parameters);
+            CollectParameters(op->rhs(), parameters);
+        };
+        if (auto op = std::dynamic_pointer_cast<AST::AndOperator>(expr)) {
+            collect(op);
+        } else if (auto op = std::dynamic_pointer_cast<AST::OrOperator>(expr)) {
+            collect(op);
+        } else if (auto op = std::dynamic_pointer_cast<AST::EqOperator>(expr)) {
+            collect(op);
+        } else if (auto op = std::dynamic_pointer_cast<AST::LTOperator>(expr)) {
+            collect(op);
+        } else if (auto op = std::dynamic_pointer_cast<AST::LTEOperator>(expr)) {
+            collect(op);
+        } else if (auto op = std::dynamic_pointer_cast<AST::GTOperator>(expr)) {
+            collect(op);
+        } else if (auto op = std::dynamic_pointer_cast<AST::GTEOperator>(expr)) {
+            collect(op);
+        }
+    }
+
+    /**
+     * Returns the constant bound to a parameter, or the expression itself if it isn't a parameter.  A parameter without a
+     * value is left as it is, for @b ResolvePredicate to reject.
+     */
+    auto BindParameter(const std::shared_ptr<AST::BaseFilterExpr>& expr) -> std::shared_ptr<AST::BaseFilterExpr> {
+        auto parameter = std::dynamic_pointer_cast<AST::Parameter>(expr);
+        if (!parameter) {
+            return expr;
+        }
+
+        const auto& value = parameter->value();
+        if (const auto* constant = std::get_if<int>(&value)) {
+            return std::make_shared<AST::ConstantInt>(*constant);
+        } else if (const auto* constant = std::get_if<float>(&value)) {
+            return std::make_shared<AST::ConstantFloat>(*constant);
+        } else if (const auto* constant = std::get_if<std::string>(&value)) {
+            return std::make_shared<AST::ConstantString>(*constant);
+        }
+        return expr;
+    }
+
+    /**
+     * Folds the comparisons of two constants into TRUE or FALSE, and ANDs and ORs with a TRUE or FALSE operand into the
+     * other operand or a constant.  A comparison with the constant first is flipped, so `5.0 < colA` is `colA > 5.0`.
+     * Parameters are replaced by the constants bound to them first.  Anything else is left as it is, for
+     * @b ResolvePredicate to reject.
+     */
+    auto SimplifyFilterExpr(const std::shared_ptr<AST::BaseFilterExpr>& expr) -> std::shared_ptr<AST::BaseFilterExpr> {
+        using Operation = Predicate::Operation;
+
+        auto numberOf = [](const std::shared_ptr<AST::BaseFilterExpr>& expr) -> std::optional<double> {
+            if (auto constant = std::dynamic_pointer_cast<AST::ConstantInt>(expr)) {
+                return constant->value();
+            } else if (auto constant = std::dynamic_pointer_cast<AST::ConstantFloat>(expr)) {
+                return constant->value();
+            }
+            return std::nullopt;
+        };
+
+        auto compare = [](Operation operation, const auto& lhs, const auto& rhs) {
+            switch (operation) {
+            case Predicate::EQ:
+                return lhs == rhs;
+            case Predicate::LT:
+                return lhs < rhs;
+            case Predicate::LTE:
+                return lhs <= rhs;
+            case Predicate::GT:
+                return lhs > rhs;
+            case Predicate::GTE:
+                return lhs >= rhs;
+            case Predicate::AND:
+            case Predicate::OR:
+                break;
+            }
+            return false;
+        };
+
+        auto simplifyComparison = [&](Operation operation, auto make, auto makeFlipped, const std::shared_ptr<AST::BaseFilterExpr>& unboundLhs, const std::shared_ptr<AST::BaseFilterExpr>& unboundRhs) -> std::shared_ptr<AST::BaseFilterExpr> {
+            const auto lhs = BindParameter(unboundLhs);
+            const auto rhs = BindParameter(unboundRhs);
+            if (auto lhsNumber = numberOf(lhs), rhsNumber = numberOf(rhs); lhsNumber && rhsNumber) {
+                return std::make_shared<AST::ConstantBool>(compare(operation, *lhsNumber, *rhsNumber));
+            }
+
+            auto lhsString = std::dynamic_pointer_cast<AST::ConstantString>(lhs);
+            auto rhsString = std::dynamic_pointer_cast<AST::ConstantString>(rhs);
+            if (lhsString && rhsString) {
+                return std::make_shared<AST::ConstantBool>(compare(operation, lhsString->value(), rhsString->value()));
+            }
+
+            if (!std::dynamic_pointer_cast<AST::ReadColumn>(lhs) && std::dynamic_pointer_cast<AST::ReadColumn>(rhs)) {
+                return makeFlipped(rhs, lhs);
+            } else if (lhs != unboundLhs || rhs != unboundRhs) {
+                return make(lhs, rhs);
+            }
+            return expr;
+        };
+
+        auto simplifyConnective = [&](Operation operation, const std::shared_ptr<AST::BaseFilterExpr>& lhs, const std::shared_ptr<AST::BaseFilterExpr>& rhs) -> std::shared_ptr<AST::BaseFilterExpr> {
+            auto simplifiedLhs = SimplifyFilterExpr(lhs);
+            auto simplifiedRhs = SimplifyFilterExpr(rhs);
+
+            // TRUE is the identity of AND, and FALSE is the identity of OR.  The other constant decides the result.
+            const auto identity = operation == Predicate::AND;
+            for (const auto& [operand, other] : {std::pair(simplifiedLhs, simplifiedRhs), std::pair(simplifiedRhs, simplifiedLhs)}) {
+                if (auto constant = std::dynamic_pointer_cast<AST::ConstantBool>(operand)) {
+                    return constant->value() == identity ? other : operand;
+                }
+            }
+
+            if (simplifiedLhs == lhs && simplifiedRhs == rhs) {
+                return expr;
+            } else if (operation == Predicate::AND) {
+                return std::make_shared<AST::AndOperator>(simplifiedLhs, simplifiedRhs);
+            }
+            return std::make_shared<AST::OrOperator>(simplifiedLhs, simplifiedRhs);
+        };
+
+        if (auto op = std::dynamic_pointer_cast<AST::AndOperator>(expr)) {
+            return simplifyConnective(Predicate::AND, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::OrOperator>(expr)) {
+            return simplifyConnective(Predicate::OR, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::EqOperator>(expr)) {
+            return simplifyComparison(Predicate::EQ, [](auto lhs, auto rhs) { return std::make_shared<AST::EqOperator>(lhs, rhs); }, [](auto lhs, auto rhs) { return std::make_shared<AST::EqOperator>(lhs, rhs); }, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::LTOperator>(expr)) {
+            return simplifyComparison(Predicate::LT, [](auto lhs, auto rhs) { return std::make_shared<AST::LTOperator>(lhs, rhs); }, [](auto lhs, auto rhs) { return std::make_shared<AST::GTOperator>(lhs, rhs); }, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::LTEOperator>(expr)) {
+            return simplifyComparison(Predicate::LTE, [](auto lhs, auto rhs) { return std::make_shared<AST::LTEOperator>(lhs, rhs); }, [](auto lhs, auto rhs) { return std::make_shared<AST::GTEOperator>(lhs, rhs); }, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::GTOperator>(expr)) {
+            return simplifyComparison(Predicate::GT, [](auto lhs, auto rhs) { return std::make_shared<AST::GTOperator>(lhs, rhs); }, [](auto lhs, auto rhs) { return std::make_shared<AST::LTOperator>(lhs, rhs); }, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::GTEOperator>(expr)) {
+            return simplifyComparison(Predicate::GTE, [](auto lhs, auto rhs) { return std::make_shared<AST::GTEOperator>(lhs, rhs); }, [](auto lhs, auto rhs) { return std::make_shared<AST::LTEOperator>(lhs, rhs); }, op->lhs(), op->rhs());
+        }
+        return expr;
+    }
+
+    /**
+     * Gives the constant of a comparison with a column of @b type the column's own kind of number where it can, so
+     * @b Predicate::simplified merges the comparisons of the column whichever kind they were written with.  A float column
+     * compares with a double.  An integer column compares with the integer that keeps the comparison the same, so
+     * `colA > 5.5` is `colA > 5` and `colA >= 5.5` is `colA >= 6`, and never equals a double with a fraction.
+     */
+    auto NormalizeConstant(Predicate predicate, metaldb::ColumnType type) -> Predicate {
+        if (type == metaldb::Float || type == metaldb::Float_opt) {
+            if (const auto* value = std::get_if<std::int64_t>(&predicate.value)) {
+                predicate.value = (double) *value;
+            }
+            return predicate;
+        }
+
+        const auto* value = std::get_if<double>(&predicate.value);
+        if ((type != metaldb::Integer && type != metaldb::Integer_opt) || !value) {
+            return predicate;
+        }
+
+        const auto roundDown = predicate.operation == Predicate::GT || predicate.operation == Predicate::LTE;
+        const auto rounded = roundDown ? std::floor(*value) : std::ceil(*value);
+        if (!(rounded >= -0x1p63 && rounded < 0x1p63)) {
+            // Out of the range of an integer, or not a number, so it's still compared as a double.
+            return predicate;
+        }
+        if (predicate.operation == Predicate::EQ && rounded != *value) {
+            return Predicate::False();
+        }
+        predicate.value = (std::int64_t) rounded;
+        return predicate;
+    }
+
+    /**
+     * Resolves a filter expression against the columns of a table.  A comparison must be between a column and a constant of
+     * the same kind, with the column first, as @b SimplifyFilterExpr leaves it.
+     */
+    auto ResolvePredicate(const std::shared_ptr<AST::BaseFilterExpr>& expr, const TableDefinition& tableDef) -> std::optional<Predicate> {
+        auto resolveOperands = [&](Predicate::Operation operation, const std::shared_ptr<AST::BaseFilterExpr>& lhs, const std::shared_ptr<AST::BaseFilterExpr>& rhs) -> std::optional<Predicate> {
+            if (operation == Predicate::AND || operation == Predicate::OR) {
+                auto lhsPredicate = ResolvePredicate(lhs, tableDef);
+                auto rhsPredicate = ResolvePredicate(rhs, tableDef);
+                if (!lhsPredicate || !rhsPredicate) {
+                    return std::nullopt;
+                }
+                Predicate predicate{operation};
+                predicate.children = {std::move(*lhsPredicate), std::move(*rhsPredicate)};
+                return predicate;
+            }
+
+            auto readColumn = std::dynamic_pointer_cast<AST::ReadColumn>(lhs);
+            const auto& constant = rhs;
+            if (!readColumn) {
+                std::cerr << "Filter comparisons must read a column (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return std::nullopt;
+            }
+
+            const AST::ColumnRef ref(readColumn->table(), readColumn->column());
+            auto index = ResolveColumn(tableDef, ref);
+            if (!index) {
+                std::cerr << "Failed to get filter column name: " << ref.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return std::nullopt;
+            }
+
+            Predicate predicate{operation};
+            predicate.column = (Predicate::ColumnIndexType) *index;
+            const auto type = tableDef.columns.at(*index).type;
+            if (auto constantInt = std::dynamic_pointer_cast<AST::ConstantInt>(constant); constantInt && type != metaldb::String) {
+                predicate.value = (std::int64_t) constantInt->value();
+            } else if (auto constantFloat = std::dynamic_pointer_cast<AST::ConstantFloat>(constant); constantFloat && type != metaldb::String) {
+                predicate.value = (double) constantFloat->value();
+            } else if (auto constantString = std::dynamic_pointer_cast<AST::ConstantString>(constant); constantString && type == metaldb::String) {
+                predicate.value = constantString->value();
+            } else {
+                std::cerr << "Filter column must be compared with a constant of its type: " << readColumn->column() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return std::nullopt;
+            }
+            return NormalizeConstant(std::move(predicate), type);
+        };
+
+        if (auto constant = std::dynamic_pointer_cast<AST::ConstantBool>(expr)) {
+            return constant->value() ? Predicate::True() : Predicate::False();
+        } else if (auto op = std::dynamic_pointer_cast<AST::AndOperator>(expr)) {
+            return resolveOperands(Predicate::AND, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::OrOperator>(expr)) {
+            return resolveOperands(Predicate::OR, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::EqOperator>(expr)) {
+            return resolveOperands(Predicate::EQ, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::LTOperator>(expr)) {
+            return resolveOperands(Predicate::LT, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::LTEOperator>(expr)) {
+            return resolveOperands(Predicate::LTE, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::GTOperator>(expr)) {
+            return resolveOperands(Predicate::GT, op->lhs(), op->rhs());
+        } else if (auto op = std::dynamic_pointer_cast<AST::GTEOperator>(expr)) {
+            return resolveOperands(Predicate::GTE, op->lhs(), op->rhs());
+        }
+
+        std::cerr << "Unsupported filter expression (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        return std::nullopt;
+    }
+
+    /**
+     * Returns a predicate as text with the names of its columns, such as `fare_amount > 5`.
+     */
+    auto DescribePredicate(const Predicate& predicate, const TableDefinition& tableDef) -> std::string {
+        if (!predicate.isComparison()) {
+            if (predicate.children.empty()) {
+                return predicate.isTrue() ? "TRUE" : "FALSE";
+            }
+
+            std::string description = "(";
+            for (std::size_t i = 0; i < predicate.children.size(); ++i) {
+                if (i > 0) {
+                    description += predicate.operation == Predicate::AND ? " AND " : " OR ";
+                }
+                description += DescribePredicate(predicate.children.at(i), tableDef);
+            }
+            return description + ")";
+        }
+
+        std::string description = tableDef.columns.at(predicate.column).name;
+        switch (predicate.operation) {
+        case Predicate::EQ:
+            description += " = ";
+            break;
+        case Predicate::LT:
+            description += " < ";
+            break;
+        case Predicate::LTE:
+            description += " <= ";
+            break;
+        case Predicate::GT:
+            description += " > ";
+            break;
+        case Predicate::GTE:
+            description += " >= ";
+            break;
+        case Predicate::AND:
+        case Predicate::OR:
+            break;
+        }
+
+        if (const auto* value = std::get_if<std::int64_t>(&predicate.value)) {
+            description += std::to_string(*value);
+        } else if (const auto* value = std::get_if<double>(&predicate.value)) {
+            // Enough digits that different doubles are different text.
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.17g", *value);
+            description += buffer;
+        } else {
+            description += "'" + std::get<std::string>(predicate.value) + "'";
+        }
+        return description;
+    }
+
+    /**
+     * Makes every read under a partial read none of the rows, so none of the files are opened.
+     */
+    void ReadNothing(StagePartial& partial) {
+        if (auto read = dynamic_cast<ReadPartial*>(&partial)) {
+            read->rowRanges.emplace();
+
+            // Nothing is read to collect statistics from.
+            read->collectedStatistics = nullptr;
+        }
+        for (const auto& child : partial.children) {
+            ReadNothing(*child);
+        }
+    }
+
+    /**
+     * Pushes a predicate down to a read, so it only parses the chunks of rows whose zone maps may match.
+     * Returns false if no row of the file can match, so the file doesn't need to be read at all.
+     */
+    auto PruneRead(ReadPartial& read, const Predicate& predicate) -> bool {
+        const auto& statistics = read.statistics;
+        const auto numColumns = read.definition->columns.size();
+
+        // Partition columns have a single value for the whole file, so whole directories are skipped without any statistics.
+        if (!read.partitionValues.empty()) {
+            const auto numFileColumns = numColumns - read.partitionValues.size();
+            std::vector<ZoneMap> partitionZoneMaps(numColumns);
+            for (std::size_t i = 0; i < read.partitionValues.size(); ++i) {
+                const auto& value = read.partitionValues.at(i);
+                auto& zoneMap = partitionZoneMaps.at(numFileColumns + i);
+                if (!value) {
+                    continue;
+                } else if (read.definition->columns.at(numFileColumns + i).type == metaldb::String) {
+                    zoneMap.minString = value;
+                    zoneMap.maxString = value;
+                } else {
+                    zoneMap.min = std::strtod(value->c_str(), nullptr);
+                    zoneMap.max = zoneMap.min;
+                }
+            }
+            if (!predicate.mayMatch(partitionZoneMaps)) {
+                return false;
+            }
+        }
+
+        if (!statistics || statistics->columns.size() != numColumns) {
+            return true;
+        }
+
+        const std::vector<ZoneMap> fileZoneMaps(statistics->columns.begin(), statistics->columns.end());
+        if (!predicate.mayMatch(fileZoneMaps)) {
+            return false;
+        }
+        if (statistics->chunkNumRows == 0 || statistics->chunks.empty()) {
+            return true;
+        }
+
+        // Adjacent chunks that may match are parsed as a single range.
+        std::vector<std::pair<std::size_t, std::size_t>> rowRanges;
+        for (std::size_t i = 0; i < statistics->chunks.size(); ++i) {
+            const auto& chunk = statistics->chunks.at(i);
+            if (chunk.size() == numColumns && !predicate.mayMatch(chunk)) {
+                continue;
+            }
+
+            const auto startRow = i * statistics->chunkNumRows;
+            const auto endRow = std::min(startRow + statistics->chunkNumRows, statistics->rowCount);
+            if (!rowRanges.empty() && rowRanges.back().second == startRow) {
+                rowRanges.back().second = endRow;
+            } else {
+                rowRanges.emplace_back(startRow, endRow);
+            }
+        }
+
+        if (rowRanges.empty()) {
+            return false;
+        }
+        if (rowRanges.size() > 1 || rowRanges.at(0) != std::pair<std::size_t, std::size_t>(0, statistics->rowCount)) {
+            read.rowRanges = std::move(rowRanges);
+        }
+        return true;
+    }
+
+    /**
+     * Returns the simplified predicate of a filter over rows of @b tableDef , with the constants bound to its parameters.
+     */
+    auto ResolveFilterPredicate(const std::shared_ptr<AST::BaseFilterExpr>& expr, const TableDefinition& tableDef) -> std::optional<Predicate> {
+        auto predicate = ResolvePredicate(SimplifyFilterExpr(expr), tableDef);
+        if (!predicate) {
+            return std::nullopt;
+        }
+        return predicate->simplified();
+    }
+
+    /**
+     * Puts the conjuncts of a predicate in the order that was cheapest for earlier queries, and returns the key of each one
+     * in @b Metadata::conjunctStatistics .  Each filter samples them again while it runs, and orders them for the rest of its
+     * rows.  A predicate that isn't an AND has no keys.
+     */
+    auto OrderConjuncts(Predicate& predicate, const TableDefinition& tableDef, const Metadata& metadata) -> std::vector<std::string> {
+        std::vector<std::string> conjunctKeys;
+        if (predicate.operation != Predicate::AND) {
+            return conjunctKeys;
+        }
+
+        std::vector<ConjunctStatistics> history;
+        for (const auto& child : predicate.children) {
+            conjunctKeys.push_back(tableDef.name + ": " + DescribePredicate(child, tableDef));
+            if (auto it = metadata.conjunctStatistics.find(conjunctKeys.back()); it != metadata.conjunctStatistics.end()) {
+                history.push_back(it->second);
+            }
+        }
+
+        if (history.size() == conjunctKeys.size()) {
+            const auto order = ConjunctStatistics::Order(history);
+            predicate.reorder(order);
+
+            std::vector<std::string> orderedKeys;
+            for (const auto index : order) {
+                orderedKeys.push_back(std::move(conjunctKeys.at(index)));
+            }
+            conjunctKeys = std::move(orderedKeys);
+        }
+        return conjunctKeys;
+    }
+
+    /**
+     * Estimates the number of bytes produced by a list of partials.
+     */
+    auto EstimateNumBytes(const std::vector<std::shared_ptr<StagePartial>>& partials) -> std::size_t {
+        return (std::size_t) EstimateCardinality(partials).numBytes();
+    }
+
+    /**
+     * Picks how to execute a join based on the estimated size of its build side.
+     */
+    void ChooseJoinStrategy(JoinPartial& join, std::size_t buildNumBytes, std::size_t probeNumBytes, std::size_t memoryBudget) {
+        if (buildNumBytes <= JoinPartial::MaxHashBuildBytes) {
+            join.strategy = JoinPartial::HASH;
+            return;
+        }
+
+        // When neither side fits, a grace join would spill both sides anyway, and a sort merge join doesn't need any partition to fit.
+        if (buildNumBytes > memoryBudget && probeNumBytes > memoryBudget) {
+            join.strategy = JoinPartial::SORT_MERGE;
+            join.memoryBudget = memoryBudget;
+            return;
+        }
+
+        // The hash table and the rows it points to both have to fit, so leave room for the table.
+        const auto targetPartitionBytes = buildNumBytes > memoryBudget ? memoryBudget / 2 : JoinPartial::TargetPartitionBytes;
+
+        // Enough partitions that each one's build side is about the target size.
+        std::uint8_t numPartitionBits = 1;
+        while (numPartitionBits < JoinPartial::MaxNumPartitionBits && (buildNumBytes >> numPartitionBits) > targetPartitionBytes) {
+            numPartitionBits++;
+        }
+        join.strategy = buildNumBytes > memoryBudget ? JoinPartial::GRACE : JoinPartial::RADIX_PARTITIONED;
+        join.numPartitionBits = numPartitionBits;
+        join.memoryBudget = memoryBudget;
+    }
+
+    /**
+     * Returns true if the partials are a single sort, whose output is ordered by @b column first.
+     */
+    auto IsSortedOn(const std::vector<std::shared_ptr<StagePartial>>& partials, std::size_t column) -> bool {
+        if (partials.size() != 1) {
+            return false;
+        }
+        auto sort = std::dynamic_pointer_cast<SortPartial>(partials.at(0));
+        return sort && !sort->sortColumns.empty() && sort->sortColumns.at(0).column == column && sort->sortColumns.at(0).ascending;
+    }
+
+    /**
+     * Returns which side of a join to broadcast, if either is small enough.  True for the lhs, false for the rhs.
+     * Only the side that is not preserved by an outer join can be built.
+     */
+    auto ChooseBroadcastSide(JoinPartial::JoinType joinType, std::size_t lhsNumBytes, std::size_t rhsNumBytes) -> std::optional<bool> {
+        const bool lhsCanBuild = joinType != JoinPartial::LEFT && lhsNumBytes <= JoinPartial::MaxBroadcastBytes;
+        const bool rhsCanBuild = joinType != JoinPartial::RIGHT && rhsNumBytes <= JoinPartial::MaxBroadcastBytes;
+        if (lhsCanBuild && rhsCanBuild) {
+            return lhsNumBytes < rhsNumBytes;
+        } else if (lhsCanBuild || rhsCanBuild) {
+            return lhsCanBuild;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * Resolves a column referenced in a join condition to the first table it belongs to.
+     * Returns the index of that table in @b tableDefs , along with the column index in that table.
+     */
+    auto ResolveJoinColumn(const std::shared_ptr<AST::BaseFilterExpr>& expr, const std::vector<std::shared_ptr<TableDefinition>>& tableDefs) -> std::optional<std::pair<std::size_t, std::size_t>> {
+        auto readColumn = std::dynamic_pointer_cast<AST::ReadColumn>(expr);
+        if (!readColumn) {
+            return std::nullopt;
+        }
+
+        for (std::size_t i = 0; i < tableDefs.size(); ++i) {
+            if (auto index = ResolveColumn(*tableDefs.at(i), AST::ColumnRef(readColumn->table(), readColumn->column()))) {
+                return std::make_pair(i, *index);
+            }
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * The output of a join is every lhs column followed by every rhs column.
+     * Columns from the side that is not preserved by an outer join may be null.
+     */
+    auto JoinOutputDefinition(const TableDefinition& lhsTableDef, const TableDefinition& rhsTableDef, JoinPartial::JoinType joinType) -> std::shared_ptr<TableDefinition> {
+        auto tableDef = std::make_shared<TableDefinition>();
+        tableDef->name = lhsTableDef.name;
+        for (const auto isLhs : {true, false}) {
+            const auto& sideDef = isLhs ? lhsTableDef : rhsTableDef;
+            const bool sideMayBeNull = isLhs ? joinType == JoinPartial::RIGHT : joinType == JoinPartial::LEFT;
+            for (auto column : sideDef.columns) {
+                if (tableDef->getColumnIndex(column.name)) {
+                    column.name = sideDef.name + "." + column.name;
+                }
+                column.nullable = column.nullable || sideMayBeNull;
+                tableDef->columns.push_back(std::move(column));
+            }
+        }
+        return tableDef;
+    }
+
+    /**
+     * Makes the partials joining two sides on a column of each, picking the join algorithm from the estimated size of each side.
+     */
+    auto MakeJoinPartials(JoinPartial::JoinType joinType, const std::vector<std::shared_ptr<StagePartial>>& lhsPartials, const std::vector<std::shared_ptr<StagePartial>>& rhsPartials, std::size_t lhsColumnIndex, std::size_t rhsColumnIndex, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<StagePartial>> partials;
+        auto lhsTableDef = lhsPartials.at(0)->definition;
+        auto rhsTableDef = rhsPartials.at(0)->definition;
+        auto tableDef = JoinOutputDefinition(*lhsTableDef, *rhsTableDef, joinType);
+
+        auto makeJoinPartial = [&](const std::vector<std::shared_ptr<StagePartial>>& lhsChildren, const std::vector<std::shared_ptr<StagePartial>>& rhsChildren) {
+            auto partial = std::make_shared<JoinPartial>(joinType, lhsColumnIndex, rhsColumnIndex, lhsChildren.size());
+            partial->children = lhsChildren;
+            std::copy(rhsChildren.begin(), rhsChildren.end(), std::back_inserter(partial->children));
+            partial->definition = tableDef;
+            partial->lhsDefinition = lhsTableDef;
+            partial->rhsDefinition = rhsTableDef;
+            return partial;
+        };
+
+        // A side that is already sorted on its key only needs the other side sorted to merge them.
+        const auto lhsSorted = IsSortedOn(lhsPartials, lhsColumnIndex);
+        const auto rhsSorted = IsSortedOn(rhsPartials, rhsColumnIndex);
+        if (lhsSorted || rhsSorted) {
+            auto partial = makeJoinPartial(lhsPartials, rhsPartials);
+            partial->strategy = JoinPartial::SORT_MERGE;
+            partial->memoryBudget = metadata.memoryBudget;
+            partial->lhsSorted = lhsSorted;
+            partial->rhsSorted = rhsSorted;
+            partials.push_back(partial);
+            return partials;
+        }
+
+        const auto lhsNumBytes = EstimateNumBytes(lhsPartials);
+        const auto rhsNumBytes = EstimateNumBytes(rhsPartials);
+        auto buildLhs = ChooseBroadcastSide(joinType, lhsNumBytes, rhsNumBytes);
+        const auto& probePartials = buildLhs.value_or(false) ? rhsPartials : lhsPartials;
+        if (buildLhs && probePartials.size() > 1) {
+            // Make a join for every partial of the probe side, which all share the same build partials.
+            // That way the probe side is never shuffled into a single stage.
+            for (const auto& probePartial : probePartials) {
+                auto partial = *buildLhs ? makeJoinPartial(lhsPartials, {probePartial}) : makeJoinPartial({probePartial}, rhsPartials);
+                partial->strategy = JoinPartial::BROADCAST;
+                partial->buildLhs = *buildLhs;
+                partials.push_back(partial);
+            }
+            return partials;
+        }
+
+        auto partial = makeJoinPartial(lhsPartials, rhsPartials);
+        if (joinType == JoinPartial::INNER) {
+            // The smaller side makes the smaller hash table.
+            partial->buildLhs = lhsNumBytes < rhsNumBytes;
+        }
+        ChooseJoinStrategy(*partial, partial->buildIsLhs() ? lhsNumBytes : rhsNumBytes, partial->buildIsLhs() ? rhsNumBytes : lhsNumBytes, metadata.memoryBudget);
+        partials.push_back(partial);
+
+        return partials;
+    }
+
+    /**
+     * Returns the join if it is an inner join, which can be reordered with the inner joins around it.
+     */
+    auto AsInnerJoin(const std::shared_ptr<AST::Expr>& expr) -> std::shared_ptr<AST::Join> {
+        auto join = std::dynamic_pointer_cast<AST::Join>(expr);
+        if (join && join->joinType() == AST::Join::NATURAL) {
+            return join;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Collects the tables and conditions of a tree of inner joins, in the order they were written.
+     */
+    void FlattenInnerJoins(const std::shared_ptr<AST::Expr>& expr, std::vector<std::shared_ptr<AST::Expr>>& tables, std::vector<std::shared_ptr<AST::BaseFilterExpr>>& conditions) {
+        auto join = AsInnerJoin(expr);
+        if (!join) {
+            tables.push_back(expr);
+            return;
+        }
+        FlattenInnerJoins(join->lhs(), tables, conditions);
+        FlattenInnerJoins(join->rhs(), tables, conditions);
+        conditions.push_back(join->expr());
+    }
+
+    /**
+     * Returns the output of a tree of inner joins in the order it was written, from the definition of each of its tables.
+     */
+    auto WrittenJoinDefinition(const std::shared_ptr<AST::Expr>& expr, const std::vector<std::shared_ptr<TableDefinition>>& tableDefs, std::size_t& tableIndex) -> std::shared_ptr<TableDefinition> {
+        auto join = AsInnerJoin(expr);
+        if (!join) {
+            return tableDefs.at(tableIndex++);
+        }
+        auto lhs = WrittenJoinDefinition(join->lhs(), tableDefs, tableIndex);
+        auto rhs = WrittenJoinDefinition(join->rhs(), tableDefs, tableIndex);
+        return JoinOutputDefinition(*lhs, *rhs, JoinPartial::INNER);
+    }
+
+    /**
+     * Joins three or more tables with inner equi-joins in the order estimated to make the smallest intermediate results,
+     * instead of the order they were written in.
+     *
+     * The tables are joined left deep, greedily.  The first join is the pair of tables with the smallest estimated output,
+     * then each join adds the table connected by a condition that keeps the output smallest.  The columns are projected back
+     * into their written order, so the plan's output doesn't change.
+     */
+    auto ProcessInnerJoinsAST(const std::shared_ptr<AST::Join>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<AST::Expr>> tables;
+        std::vector<std::shared_ptr<AST::BaseFilterExpr>> conditions;
+        FlattenInnerJoins(expr, tables, conditions);
+
+        std::vector<std::vector<std::shared_ptr<StagePartial>>> tablePartials;
+        std::vector<std::shared_ptr<TableDefinition>> tableDefs;
+        std::vector<CardinalityEstimate> tableEstimates;
+        for (const auto& table : tables) {
+            auto partials = DispatchAST(table, metadata);
+            if (partials.empty()) {
+                std::cout << "Join got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return {};
+            }
+            tableDefs.push_back(partials.at(0)->definition);
+            tableEstimates.push_back(EstimateCardinality(partials));
+            tableEstimates.back().distinctCounts.resize(tableDefs.back()->columns.size(), tableEstimates.back().numRows);
+            tablePartials.push_back(std::move(partials));
+        }
+
+        std::size_t numJoinedColumns = 0;
+        for (const auto& tableDef : tableDefs) {
+            numJoinedColumns += tableDef->columns.size();
+        }
+        if (numJoinedColumns > ProjectionPartial::MaxNumColumns) {
+            std::cerr << "Join outputs more than " << ProjectionPartial::MaxNumColumns << " columns (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return {};
+        }
+
+        // Each condition connects a column of two different tables.
+        struct Edge {
+            std::size_t lhsTable;
+            std::size_t lhsColumnIndex;
+            std::size_t rhsTable;
+            std::size_t rhsColumnIndex;
+        };
+        std::vector<Edge> edges;
+        for (const auto& conditionExpr : conditions) {
+            auto condition = std::dynamic_pointer_cast<AST::EqOperator>(conditionExpr);
+            if (!condition) {
+                std::cerr << "Join only supports an equality condition (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return {};
+            }
+            auto first = ResolveJoinColumn(condition->lhs(), tableDefs);
+            auto second = ResolveJoinColumn(condition->rhs(), tableDefs);
+            if (!first || !second || first->first == second->first) {
+                std::cerr << "Join condition must compare columns of two tables (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return {};
+            }
+            if (tableDefs.at(first->first)->columns.at(first->second).type != tableDefs.at(second->first)->columns.at(second->second).type) {
+                std::cerr << "Join columns must be of the same type (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return {};
+            }
+            edges.push_back({first->first, first->second, second->first, second->second});
+        }
+
+        // The first join is between the pair of tables with the smallest estimated output.  Ties keep the written order.
+        std::optional<Edge> firstEdge;
+        double firstNumRows = 0;
+        for (auto edge : edges) {
+            if (edge.lhsTable > edge.rhsTable) {
+                edge = {edge.rhsTable, edge.rhsColumnIndex, edge.lhsTable, edge.lhsColumnIndex};
+            }
+            const auto numRows = EstimateJoin(JoinPartial::INNER, tableEstimates.at(edge.lhsTable), edge.lhsColumnIndex, tableEstimates.at(edge.rhsTable), edge.rhsColumnIndex).numRows;
+            if (!firstEdge || numRows < firstNumRows) {
+                firstEdge = edge;
+                firstNumRows = numRows;
+            }
+        }
+
+        // The columns of each joined table start at an offset in the output so far.
+        std::vector<std::optional<std::size_t>> offsets(tables.size());
+        auto partials = tablePartials.at(firstEdge->lhsTable);
+        auto estimate = tableEstimates.at(firstEdge->lhsTable);
+        auto numColumns = tableDefs.at(firstEdge->lhsTable)->columns.size();
+        offsets.at(firstEdge->lhsTable) = 0;
+
+        auto joinTable = [&](std::size_t lhsColumnIndex, std::size_t table, std::size_t rhsColumnIndex) {
+            partials = MakeJoinPartials(JoinPartial::INNER, partials, tablePartials.at(table), lhsColumnIndex, rhsColumnIndex, metadata);
+            estimate = EstimateJoin(JoinPartial::INNER, estimate, lhsColumnIndex, tableEstimates.at(table), rhsColumnIndex);
+            offsets.at(table) = numColumns;
+            numColumns += tableDefs.at(table)->columns.size();
+        };
+        joinTable(firstEdge->lhsColumnIndex, firstEdge->rhsTable, firstEdge->rhsColumnIndex);
+
+        // Then each join adds the table whose join keeps the output smallest.
+        for (std::size_t numJoined = 2; numJoined < tables.size(); ++numJoined) {
+            std::optional<std::tuple<std::size_t, std::size_t, std::size_t>> next;
+            double nextNumRows = 0;
+            for (const auto& edge : edges) {
+                for (const auto isLhs : {true, false}) {
+                    const auto joinedTable = isLhs ? edge.lhsTable : edge.rhsTable;
+                    const auto table = isLhs ? edge.rhsTable : edge.lhsTable;
+                    if (!offsets.at(joinedTable) || offsets.at(table)) {
+                        continue;
+                    }
+
+                    const auto lhsColumnIndex = *offsets.at(joinedTable) + (isLhs ? edge.lhsColumnIndex : edge.rhsColumnIndex);
+                    const auto rhsColumnIndex = isLhs ? edge.rhsColumnIndex : edge.lhsColumnIndex;
+                    const auto numRows = EstimateJoin(JoinPartial::INNER, estimate, lhsColumnIndex, tableEstimates.at(table), rhsColumnIndex).numRows;
+                    if (!next || numRows < nextNumRows) {
+                        next = std::make_tuple(lhsColumnIndex, table, rhsColumnIndex);
+                        nextNumRows = numRows;
+                    }
+                }
+            }
+
+            if (!next) {
+                std::cerr << "Join conditions must connect every table (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return {};
+            }
+            std::apply(joinTable, *next);
+        }
+
+        // Project the columns of each table back to where they were written.
+        std::vector<ProjectionPartial::ColumnIndexType> columnIndexes;
+        for (std::size_t table = 0; table < tables.size(); ++table) {
+            for (std::size_t i = 0; i < tableDefs.at(table)->columns.size(); ++i) {
+                columnIndexes.push_back((ProjectionPartial::ColumnIndexType) (*offsets.at(table) + i));
+            }
+        }
+        if (std::is_sorted(columnIndexes.begin(), columnIndexes.end())) {
+            return partials;
+        }
+
+        // The joins run on the CPU, so they're projected there too.
+        std::size_t tableIndex = 0;
+        auto tableDef = WrittenJoinDefinition(expr, tableDefs, tableIndex);
+        return MakeProjectionPartials(columnIndexes, partials, tableDef);
+    }
+
+    auto ProcessJoinAST(const std::shared_ptr<AST::Join>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        // Only inner joins can be reordered, and there is no choice of order with two tables.
+        if (AsInnerJoin(expr) && (AsInnerJoin(expr->lhs()) || AsInnerJoin(expr->rhs()))) {
+            return ProcessInnerJoinsAST(expr, metadata);
+        }
+
+        std::vector<std::shared_ptr<StagePartial>> partials;
+        auto lhsPartials = DispatchAST(expr->lhs(), metadata);
+        auto rhsPartials = DispatchAST(expr->rhs(), metadata);
+        if (lhsPartials.empty() || rhsPartials.empty()) {
+            std::cout << "Join got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+
+        const std::vector<std::shared_ptr<TableDefinition>> tableDefs = {lhsPartials.at(0)->definition, rhsPartials.at(0)->definition};
+        if (tableDefs.at(0)->columns.size() + tableDefs.at(1)->columns.size() > ProjectionPartial::MaxNumColumns) {
+            std::cerr << "Join outputs more than " << ProjectionPartial::MaxNumColumns << " columns (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+
+        // Only equi-joins are supported
+        auto condition = std::dynamic_pointer_cast<AST::EqOperator>(expr->expr());
+        if (!condition) {
+            std::cerr << "Join only supports an equality condition (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+        auto first = ResolveJoinColumn(condition->lhs(), tableDefs);
+        auto second = ResolveJoinColumn(condition->rhs(), tableDefs);
+        if (!first || !second || first->first == second->first) {
+            std::cerr << "Join condition must compare one column from each side (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+        const auto lhsColumnIndex = first->first == 0 ? first->second : second->second;
+        const auto rhsColumnIndex = first->first == 0 ? second->second : first->second;
+        if (tableDefs.at(0)->columns.at(lhsColumnIndex).type != tableDefs.at(1)->columns.at(rhsColumnIndex).type) {
+            std::cerr << "Join columns must be of the same type (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+
+        auto joinType = [&]{
+            switch (expr->joinType()) {
+            case AST::Join::LEFT:
+                return JoinPartial::LEFT;
+            case AST::Join::RIGHT:
+                return JoinPartial::RIGHT;
+            case AST::Join::NATURAL:
+                // With an explicit condition, a natural join only keeps matching rows.
+                return JoinPartial::INNER;
+            }
+        }();
+
+        return MakeJoinPartials(joinType, lhsPartials, rhsPartials, lhsColumnIndex, rhsColumnIndex, metadata);
+    }
+
+    /**
+     * The partial phase can run in the kernel with the AGGREGATE instruction when there is no group by, and every
+     * aggregation is a COUNT or reduces a Float column.  Each chunk then outputs a single row.  Sketches are only built on
+     * the CPU.
+     */
+    auto CanAggregateInKernel(const std::vector<AggregatePartial::ColumnIndexType>& groupByColumnIndexes, const std::vector<AggregatePartial::Aggregation>& aggregations, const TableDefinition& childTableDef) -> bool {
+        if (!groupByColumnIndexes.empty() || aggregations.size() > metaldb::AggregateInstruction::MAX_NUM_AGGREGATIONS) {
+            return false;
+        }
+
+        for (const auto& aggregation : aggregations) {
+            if (aggregation.function == AggregatePartial::COUNT) {
+                continue;
+            }
+            if (aggregation.function == AggregatePartial::APPROX_COUNT_DISTINCT || aggregation.function == AggregatePartial::APPROX_PERCENTILE) {
+                return false;
+            }
+            if (childTableDef.columns.at(*aggregation.column).type != metaldb::Float) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Picks how many rows each chunk of the partial phase aggregates, from the estimated number of groups.
+     */
+    auto ChooseAggregateChunkNumRows(double numGroups) -> std::size_t {
+        if (numGroups * 16 <= AggregatePartial::MinChunkNumRows) {
+            return AggregatePartial::MinChunkNumRows;
+        }
+        if (numGroups * 2 >= AggregatePartial::DefaultChunkNumRows) {
+            return AggregatePartial::MaxChunkNumRows;
+        }
+        return AggregatePartial::DefaultChunkNumRows;
+    }
+
+    auto ProcessAggregateAST(const std::shared_ptr<AST::Aggregate>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<StagePartial>> partials;
+        std::vector<std::shared_ptr<StagePartial>> childPartials;
+        if (expr->hasChild()) {
+            childPartials = DispatchAST(expr->child(), metadata);
+        }
+
+        if (childPartials.empty()) {
+            std::cout << "Aggregate got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+
+        auto childTableDef = childPartials.at(0)->definition;
+        auto partialTableDef = std::make_shared<TableDefinition>();
+        auto finalTableDef = std::make_shared<TableDefinition>();
+        partialTableDef->name = childTableDef->name;
+        finalTableDef->name = childTableDef->name;
+
+        std::vector<AggregatePartial::ColumnIndexType> groupByColumnIndexes;
+        for (const auto& column : expr->groupBy()) {
+            auto index = ResolveColumn(*childTableDef, column);
+            if (!index) {
+                std::cerr << "Failed to get group by column name: " << column.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return partials;
+            }
+            groupByColumnIndexes.push_back(*index);
+            partialTableDef->columns.push_back(childTableDef->columns.at(*index));
+            finalTableDef->columns.push_back(childTableDef->columns.at(*index));
+        }
+
+        std::vector<AggregatePartial::Aggregation> aggregations;
+        std::vector<std::size_t> averageSumColumns;
+        for (const auto& aggregation : expr->aggregations()) {
+            auto [function, functionName] = [&]() -> std::pair<AggregatePartial::Function, std::string> {
+                switch (aggregation.function) {
+                case AST::Aggregate::COUNT:
+                    return {AggregatePartial::COUNT, "COUNT"};
+                case AST::Aggregate::SUM:
+                    return {AggregatePartial::SUM, "SUM"};
+                case AST::Aggregate::MIN:
+                    return {AggregatePartial::MIN, "MIN"};
+                case AST::Aggregate::MAX:
+                    return {AggregatePartial::MAX, "MAX"};
+                case AST::Aggregate::AVG:
+                    return {AggregatePartial::AVG, "AVG"};
+                case AST::Aggregate::APPROX_COUNT_DISTINCT:
+                    return {AggregatePartial::APPROX_COUNT_DISTINCT, "APPROX_COUNT_DISTINCT"};
+                case AST::Aggregate::APPROX_PERCENTILE:
+                    return {AggregatePartial::APPROX_PERCENTILE, "APPROX_PERCENTILE"};
+                }
+            }();
+            auto name = aggregation.alias.empty() ? functionName + "(" + (aggregation.column.column.empty() ? "*" : aggregation.column.name()) + ")" : aggregation.alias;
+
+            if (aggregation.column.column.empty()) {
+                if (function != AggregatePartial::COUNT) {
+                    std::cerr << "Only COUNT can aggregate every row (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                    return partials;
+                }
+                aggregations.push_back({function, std::nullopt});
+                partialTableDef->columns.emplace_back(name, metaldb::Integer);
+                finalTableDef->columns.emplace_back(name, metaldb::Integer);
+                continue;
+            }
+
+            auto index = ResolveColumn(*childTableDef, aggregation.column);
+            if (!index) {
+                std::cerr << "Failed to get aggregate column name: " << aggregation.column.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return partials;
+            }
+            const auto& column = childTableDef->columns.at(*index);
+            if ((function == AggregatePartial::SUM || function == AggregatePartial::AVG || function == AggregatePartial::APPROX_PERCENTILE) && column.type == metaldb::String) {
+                std::cerr << "Can't " << functionName << " a string column: " << aggregation.column.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return partials;
+            }
+            if (aggregation.percentile < 0 || aggregation.percentile > 1) {
+                std::cerr << "Percentile must be between 0 and 1: " << aggregation.percentile << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return partials;
+            }
+            aggregations.push_back({function, *index, aggregation.percentile});
+
+            if (function == AggregatePartial::COUNT) {
+                partialTableDef->columns.emplace_back(name, metaldb::Integer);
+                finalTableDef->columns.emplace_back(name, metaldb::Integer);
+                continue;
+            }
+
+            if (function == AggregatePartial::APPROX_COUNT_DISTINCT) {
+                // The partial keeps a sketch, which is merged and estimated by the final phase.
+                partialTableDef->columns.emplace_back(name + ".sketch", metaldb::String);
+                finalTableDef->columns.emplace_back(name, metaldb::Integer);
+                continue;
+            }
+
+            // Without a group by there is always an output row, which is null when there are no values.
+            const bool nullable = column.nullable || groupByColumnIndexes.empty();
+            if (function == AggregatePartial::APPROX_PERCENTILE) {
+                partialTableDef->columns.emplace_back(name + ".sketch", metaldb::String);
+                finalTableDef->columns.emplace_back(name, metaldb::Float, nullable);
+            } else if (function == AggregatePartial::AVG) {
+                // The partial keeps the sum and the count so they can be merged.  The sum is the bytes of a double, so it isn't
+                // rounded to a float in every partial.
+                averageSumColumns.push_back(partialTableDef->columns.size());
+                partialTableDef->columns.emplace_back(name + ".sum", metaldb::String);
+                partialTableDef->columns.emplace_back(name + ".count", metaldb::Integer);
+                finalTableDef->columns.emplace_back(name, metaldb::Float, nullable);
+            } else {
+                auto resultColumn = column;
+                resultColumn.name = name;
+                resultColumn.nullable = nullable;
+                resultColumn.table.clear();
+                partialTableDef->columns.push_back(resultColumn);
+                finalTableDef->columns.push_back(std::move(resultColumn));
+            }
+        }
+
+        // Each child aggregates its own chunks, then a single partial merges them.
+        const bool aggregateInKernel = CanAggregateInKernel(groupByColumnIndexes, aggregations, *childTableDef);
+        const auto chunkNumRows = ChooseAggregateChunkNumRows(EstimateNumGroups(EstimateCardinality(childPartials), groupByColumnIndexes));
+        auto finalPartial = std::make_shared<AggregatePartial>(AggregatePartial::FINAL, groupByColumnIndexes, aggregations);
+        finalPartial->definition = finalTableDef;
+        finalPartial->inputDefinition = childTableDef;
+
+        // The kernel reduces floats, so it writes the sum of AVG as one.
+        auto kernelPartialTableDef = std::make_shared<TableDefinition>(*partialTableDef);
+        for (const auto& column : averageSumColumns) {
+            kernelPartialTableDef->columns.at(column).type = metaldb::Float;
+        }
+        for (auto& child : childPartials) {
+            auto partial = std::make_shared<AggregatePartial>(AggregatePartial::PARTIAL, groupByColumnIndexes, aggregations);
+            partial->children.push_back(child);
+            partial->definition = partialTableDef;
+            partial->inputDefinition = childTableDef;
+            partial->chunkNumRows = chunkNumRows;
+            if (aggregateInKernel && child->execution == GPU) {
+                partial->execution = GPU;
+                partial->definition = kernelPartialTableDef;
+            }
+            finalPartial->children.push_back(partial);
+        }
+        partials.push_back(finalPartial);
+
+        return partials;
+    }
+
+    /**
+     * Makes a partial for every child of each side, which remove duplicates chunk by chunk, and a single final partial that
+     * merges them.
+     */
+    auto MakeSetOperationPartials(SetOperationPartial::Operation operation, const std::vector<std::shared_ptr<StagePartial>>& lhsPartials, const std::vector<std::shared_ptr<StagePartial>>& rhsPartials, const std::shared_ptr<TableDefinition>& tableDef) -> std::vector<std::shared_ptr<StagePartial>> {
+        auto finalPartial = std::make_shared<SetOperationPartial>(operation, AggregatePartial::FINAL);
+        finalPartial->definition = tableDef;
+        for (const auto isLhs : {true, false}) {
+            for (const auto& child : isLhs ? lhsPartials : rhsPartials) {
+                auto partial = std::make_shared<SetOperationPartial>(operation, AggregatePartial::PARTIAL, isLhs);
+                partial->children.push_back(child);
+                partial->definition = tableDef;
+                finalPartial->children.push_back(partial);
+            }
+        }
+        return {finalPartial};
+    }
+
+    auto ProcessDistinctAST(const std::shared_ptr<AST::Distinct>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<StagePartial>> childPartials;
+        if (expr->hasChild()) {
+            childPartials = DispatchAST(expr->child(), metadata);
+        }
+
+        if (childPartials.empty()) {
+            std::cout << "Distinct got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return childPartials;
+        }
+
+        return MakeSetOperationPartials(SetOperationPartial::DISTINCT, childPartials, {}, childPartials.at(0)->definition);
+    }
+
+    /**
+     * Makes the columns of a partial nullable wherever they are in @b tableDef .  Only a read can parse a column as nullable,
+     * so this returns false if any other partial doesn't already match.
+     */
+    auto MatchNullability(StagePartial& partial, const TableDefinition& tableDef) -> bool {
+        bool matches = true;
+        for (std::size_t i = 0; i < tableDef.columns.size(); ++i) {
+            matches = matches && partial.definition->columns.at(i).nullable == tableDef.columns.at(i).nullable;
+        }
+        if (matches) {
+            return true;
+        }
+        if (!dynamic_cast<ReadPartial*>(&partial)) {
+            return false;
+        }
+
+        auto definition = std::make_shared<TableDefinition>(*partial.definition);
+        for (std::size_t i = 0; i < tableDef.columns.size(); ++i) {
+            definition->columns.at(i).nullable = tableDef.columns.at(i).nullable;
+        }
+        partial.definition = std::move(definition);
+        return true;
+    }
+
+    auto ProcessSetOperationAST(const std::shared_ptr<AST::SetOperation>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<StagePartial>> partials;
+        auto lhsPartials = DispatchAST(expr->lhs(), metadata);
+        auto rhsPartials = DispatchAST(expr->rhs(), metadata);
+        if (lhsPartials.empty() || rhsPartials.empty()) {
+            std::cout << "Set operation got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+
+        // Columns are matched by position, and take their names from the lhs.
+        const auto& lhsTableDef = lhsPartials.at(0)->definition;
+        const auto& rhsTableDef = rhsPartials.at(0)->definition;
+        if (lhsTableDef->columns.size() != rhsTableDef->columns.size()) {
+            std::cerr << "Set operation sides must have the same number of columns (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+
+        auto tableDef = std::make_shared<TableDefinition>(*lhsTableDef);
+        for (std::size_t i = 0; i < tableDef->columns.size(); ++i) {
+            auto& column = tableDef->columns.at(i);
+            const auto& rhsColumn = rhsTableDef->columns.at(i);
+            if (column.type != rhsColumn.type) {
+                std::cerr << "Set operation columns must be of the same type: " << column.name << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return partials;
+            }
+            column.nullable = column.nullable || rhsColumn.nullable;
+        }
+
+        if (expr->operation() == AST::SetOperation::UNION_ALL) {
+            // The partials of both sides feed the parent directly, like the files of a single table.
+            partials = lhsPartials;
+            partials.insert(partials.end(), rhsPartials.begin(), rhsPartials.end());
+            for (auto& partial : partials) {
+                if (!MatchNullability(*partial, *tableDef)) {
+                    std::cerr << "Union all columns must have the same nullability (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                    return {};
+                }
+            }
+            return partials;
         }
 
-        return output;
+        auto operation = [&]{
+            switch (expr->operation()) {
+            case AST::SetOperation::UNION:
+            case AST::SetOperation::UNION_ALL:
+                return SetOperationPartial::UNION;
+            case AST::SetOperation::INTERSECT:
+                return SetOperationPartial::INTERSECT;
+            case AST::SetOperation::EXCEPT:
+                return SetOperationPartial::EXCEPT;
+            }
+        }();
+        return MakeSetOperationPartials(operation, lhsPartials, rhsPartials, tableDef);
     }
 
-    auto ProcessReadAST(const std::shared_ptr<AST::Read>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
-        // This has no children, so no recursive call
+    auto ProcessOrderByAST(const std::shared_ptr<AST::OrderBy>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
         std::vector<std::shared_ptr<StagePartial>> partials;
-        const auto* tableDef = metadata.getTable(expr->tableName());
+        std::vector<std::shared_ptr<StagePartial>> childPartials;
+        if (expr->hasChild()) {
+            childPartials = DispatchAST(expr->child(), metadata);
+        }
 
-        if (tableDef == nullptr) {
-            std::cout << "Failed to find table: " << expr->tableName() << std::endl;
+        if (childPartials.empty()) {
+            std::cout << "Order by got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
             return partials;
         }
 
-        // Read list of files
-        auto listOfFiles = listDir(tableDef->filePath);
-        std::cout << "Reading " << listOfFiles.size() << " files" << std::endl;
-        for (const auto& file : listOfFiles) {
-            metaldb::Method method = metaldb::CSV;
-            const auto extension = file.extension();
-            if (extension == ".csv") {
-                method = metaldb::CSV;
-            } else {
-                std::cout << "Unsure how to handle extension (" << __FILE__ << ", " << __LINE__ << "): " << extension << std::endl;
-                continue;
+        auto childTableDef = childPartials.at(0)->definition;
+        std::vector<SortPartial::SortColumn> sortColumns;
+        for (const auto& column : expr->columns()) {
+            auto index = ResolveColumn(*childTableDef, column.column);
+            if (!index) {
+                std::cerr << "Failed to get order by column name: " << column.column.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return partials;
             }
+            sortColumns.push_back({(SortPartial::ColumnIndexType) *index, column.ascending});
+        }
 
-            auto partial = std::make_shared<ReadPartial>(file, method);
-            partial->definition = std::make_shared<TableDefinition>(*tableDef);
-            partials.emplace_back(partial);
+        // Ordering a join by its key only needs the join to be a sort merge join, whose output is already in key order.
+        if (childPartials.size() == 1 && sortColumns.size() == 1 && sortColumns.at(0).ascending) {
+            auto join = std::dynamic_pointer_cast<JoinPartial>(childPartials.at(0));
+            if (join && sortColumns.at(0).column == join->outputColumnIndex()) {
+                join->strategy = JoinPartial::SORT_MERGE;
+                join->memoryBudget = metadata.memoryBudget;
+                return childPartials;
+            }
         }
-        
+
+        // A single partial sorts the rows of every child, so the output is in a single order.
+        auto partial = std::make_shared<SortPartial>(std::move(sortColumns));
+        partial->children = childPartials;
+        partial->definition = childTableDef;
+        partial->memoryBudget = metadata.memoryBudget;
+        partials.push_back(partial);
+
         return partials;
     }
 
-    auto ProcessProjectionAST(const std::shared_ptr<AST::Projection>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+    auto ProcessWindowAST(const std::shared_ptr<AST::Window>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
         std::vector<std::shared_ptr<StagePartial>> partials;
         std::vector<std::shared_ptr<StagePartial>> childPartials;
         if (expr->hasChild()) {
@@ -69,42 +1579,210 @@ namespace {
         }
 
         if (childPartials.empty()) {
-            std::cout << "Projection got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            std::cout << "Window got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
             return partials;
         }
 
-        // Make the new table definition
         auto childTableDef = childPartials.at(0)->definition;
-        auto tableDef = std::make_shared<TableDefinition>();
-        tableDef->name = childTableDef->name;
+        auto tableDef = std::make_shared<TableDefinition>(*childTableDef);
 
-        // Lookup column indexes
-        std::vector<ProjectionPartial::ColumnIndexType> columnIndexes;
-        columnIndexes.reserve(expr->numColumns());
-        for (const auto& column : expr->columns()) {
-            // Store the current table definiton in the AST?
-            auto index = childTableDef->getColumnIndex(column);
-            if (index) {
-                tableDef->columns.push_back(childTableDef->columns.at(*index));
-                columnIndexes.push_back(*index);
-            } else {
-                std::cerr << "Failed to get column name: " << column << std::endl;
+        std::vector<WindowPartial::ColumnIndexType> partitionColumns;
+        for (const auto& column : expr->partitionBy()) {
+            auto index = ResolveColumn(*childTableDef, column);
+            if (!index) {
+                std::cerr << "Failed to get partition by column name: " << column.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
                 return partials;
             }
+            partitionColumns.push_back(*index);
         }
 
-        for (auto& p : childPartials) {
-            auto partial = std::make_shared<ProjectionPartial>(columnIndexes);
-            partial->children.push_back(p);
-            partial->definition = tableDef;
-            partials.push_back(partial);
+        std::vector<WindowPartial::SortColumn> sortColumns;
+        for (const auto& column : expr->orderBy()) {
+            auto index = ResolveColumn(*childTableDef, column.column);
+            if (!index) {
+                std::cerr << "Failed to get order by column name: " << column.column.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return partials;
+            }
+            sortColumns.push_back({(WindowPartial::ColumnIndexType) *index, column.ascending});
+        }
+
+        std::vector<WindowPartial::WindowFunction> functions;
+        for (const auto& function : expr->functions()) {
+            auto [windowFunction, functionName] = [&]() -> std::pair<WindowPartial::Function, std::string> {
+                switch (function.function) {
+                case AST::Window::ROW_NUMBER:
+                    return {WindowPartial::ROW_NUMBER, "ROW_NUMBER"};
+                case AST::Window::RANK:
+                    return {WindowPartial::RANK, "RANK"};
+                case AST::Window::SUM:
+                    return {WindowPartial::SUM, "SUM"};
+                case AST::Window::LAG:
+                    return {WindowPartial::LAG, "LAG"};
+                case AST::Window::LEAD:
+                    return {WindowPartial::LEAD, "LEAD"};
+                }
+            }();
+            auto name = function.alias.empty() ? functionName + "(" + function.column.name() + ")" : function.alias;
+
+            if (windowFunction == WindowPartial::ROW_NUMBER || windowFunction == WindowPartial::RANK) {
+                functions.push_back({windowFunction, std::nullopt});
+                tableDef->columns.emplace_back(name, metaldb::Integer);
+                continue;
+            }
+
+            auto index = ResolveColumn(*childTableDef, function.column);
+            if (!index) {
+                std::cerr << "Failed to get window function column name: " << function.column.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                return partials;
+            }
+            const auto& column = childTableDef->columns.at(*index);
+            functions.push_back({windowFunction, *index, function.offset});
+
+            if (windowFunction == WindowPartial::SUM) {
+                if (column.type == metaldb::String) {
+                    std::cerr << "Can't SUM a string column: " << function.column.name() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+                    return partials;
+                }
+                tableDef->columns.emplace_back(name, column.type, column.nullable);
+            } else {
+                // The first or last rows of a partition have no row at the offset.
+                auto resultColumn = column;
+                resultColumn.name = name;
+                resultColumn.nullable = true;
+                resultColumn.table.clear();
+                tableDef->columns.push_back(std::move(resultColumn));
+            }
+        }
+
+        // A single partial sees the rows of every child, and evaluates its partitions in parallel.
+        auto partial = std::make_shared<WindowPartial>(std::move(partitionColumns), std::move(sortColumns), std::move(functions));
+        partial->children = childPartials;
+        partial->definition = tableDef;
+        partial->inputDefinition = childTableDef;
+        partials.push_back(partial);
+
+        return partials;
+    }
+
+    auto ProcessFilterAST(const std::shared_ptr<AST::Filter>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<StagePartial>> partials;
+        std::vector<std::shared_ptr<StagePartial>> childPartials;
+        if (expr->hasChild()) {
+            childPartials = DispatchAST(expr->child(), metadata);
+        }
+
+        if (childPartials.empty()) {
+            std::cout << "Filter got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return partials;
+        }
+
+        auto childTableDef = childPartials.at(0)->definition;
+        auto predicate = ResolveFilterPredicate(expr->expr(), *childTableDef);
+        if (!predicate) {
+            return partials;
+        }
+
+        // A predicate with parameters is resolved again each time its plan is reused with other values, so the plan can't
+        // depend on this one.  The filter and every file are kept, and files are skipped by reading none of their rows.
+        std::vector<std::shared_ptr<AST::Parameter>> parameters;
+        CollectParameters(expr->expr(), parameters);
+        const auto isBound = !parameters.empty();
+
+        // A filter every row passes does nothing.
+        if (predicate->isTrue() && !isBound) {
+            return childPartials;
+        }
+
+        const auto conjunctKeys = OrderConjuncts(*predicate, *childTableDef, metadata);
+        auto makeFilterPartial = [&](const std::shared_ptr<StagePartial>& child) {
+            auto partial = std::make_shared<FilterPartial>(*predicate);
+            partial->expr = expr->expr();
+            partial->children.push_back(child);
+            partial->definition = child->definition;
+            if (!conjunctKeys.empty()) {
+                partial->conjunctKeys = conjunctKeys;
+                partial->observedConjuncts = std::make_shared<std::vector<ConjunctStatistics>>();
+            }
+            return partial;
+        };
+
+        // No row can pass, but the output still needs a partial.  Plan a single child that reads none of its files.
+        if (predicate->isFalse() && !isBound) {
+            std::cout << "Filter can't match any row, skipping every file" << std::endl;
+            ReadNothing(*childPartials.at(0));
+            partials.push_back(makeFilterPartial(childPartials.at(0)));
+            return partials;
+        }
+
+        // Files whose zone maps can't match are never read.
+        for (const auto& child : childPartials) {
+            auto read = std::dynamic_pointer_cast<ReadPartial>(child);
+            if (read && !PruneRead(*read, *predicate)) {
+                std::cout << "Skipping file: " << read->filepath << std::endl;
+                if (!isBound) {
+                    continue;
+                }
+                ReadNothing(*read);
+            } else if (predicate->isFalse()) {
+                ReadNothing(*child);
+            }
+            partials.push_back(makeFilterPartial(child));
+        }
+
+        // Every file was skipped, but the output still needs a partial.  Read none of the rows of a single file.
+        if (partials.empty()) {
+            ReadNothing(*childPartials.at(0));
+            partials.push_back(makeFilterPartial(childPartials.at(0)));
         }
 
         return partials;
     }
 
+    auto ProcessLimitAST(const std::shared_ptr<AST::Limit>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
+        std::vector<std::shared_ptr<StagePartial>> childPartials;
+        if (expr->hasChild()) {
+            childPartials = DispatchAST(expr->child(), metadata);
+        }
+
+        if (childPartials.empty()) {
+            std::cout << "Limit got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return childPartials;
+        }
+
+        // An order by followed by a limit becomes a top-n, which never sorts every row.
+        if (childPartials.size() == 1) {
+            if (auto sort = std::dynamic_pointer_cast<SortPartial>(childPartials.at(0))) {
+                sort->limit = std::min(sort->limit.value_or(expr->value()), expr->value());
+                return childPartials;
+            }
+        }
+
+        // An order by on the key of a join is done by a sort merge join, so keep its order.
+        std::vector<SortPartial::SortColumn> sortColumns;
+        if (childPartials.size() == 1) {
+            auto join = std::dynamic_pointer_cast<JoinPartial>(childPartials.at(0));
+            if (join && join->strategy == JoinPartial::SORT_MERGE) {
+                sortColumns.push_back({join->outputColumnIndex(), true});
+            }
+        }
+
+        // Otherwise without an order, the rows of every child are cut down to the limit together.
+        auto partial = std::make_shared<SortPartial>(std::move(sortColumns));
+        partial->children = childPartials;
+        partial->definition = childPartials.at(0)->definition;
+        partial->memoryBudget = metadata.memoryBudget;
+        partial->limit = expr->value();
+
+        return {partial};
+    }
+
     auto ProcessWriteAST(const std::shared_ptr<AST::Write>& expr, const Metadata& metadata) -> std::vector<std::shared_ptr<StagePartial>> {
         auto children = DispatchAST(expr->child(), metadata);
+        if (children.empty()) {
+            std::cerr << "Write got no child partials (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return {};
+        }
+
         auto partial = std::make_shared<WritePartial>(expr->filepath(), expr->method());
         partial->columnNames = expr->columns();
         partial->children = children;
@@ -119,51 +1797,465 @@ namespace {
         if (auto proj = std::dynamic_pointer_cast<AST::Projection>(expr)) {
             return ProcessProjectionAST(proj, metadata);
         }
+        if (auto filter = std::dynamic_pointer_cast<AST::Filter>(expr)) {
+            return ProcessFilterAST(filter, metadata);
+        }
         if (auto write = std::dynamic_pointer_cast<AST::Write>(expr)) {
             return ProcessWriteAST(write, metadata);
         }
+        if (auto join = std::dynamic_pointer_cast<AST::Join>(expr)) {
+            return ProcessJoinAST(join, metadata);
+        }
+        if (auto aggregate = std::dynamic_pointer_cast<AST::Aggregate>(expr)) {
+            return ProcessAggregateAST(aggregate, metadata);
+        }
+        if (auto orderBy = std::dynamic_pointer_cast<AST::OrderBy>(expr)) {
+            return ProcessOrderByAST(orderBy, metadata);
+        }
+        if (auto limit = std::dynamic_pointer_cast<AST::Limit>(expr)) {
+            return ProcessLimitAST(limit, metadata);
+        }
+        if (auto window = std::dynamic_pointer_cast<AST::Window>(expr)) {
+            return ProcessWindowAST(window, metadata);
+        }
+        if (auto distinct = std::dynamic_pointer_cast<AST::Distinct>(expr)) {
+            return ProcessDistinctAST(distinct, metadata);
+        }
+        if (auto setOperation = std::dynamic_pointer_cast<AST::SetOperation>(expr)) {
+            return ProcessSetOperationAST(setOperation, metadata);
+        }
 
         return {};
      }
 
-    auto CombinePartials(const std::vector<std::shared_ptr<StagePartial>>& partials) -> std::vector<std::shared_ptr<Stage>> {
+    /**
+     * Partials shared by more than one parent, such as the build side of a broadcast join, become a single stage.
+     */
+    using CombinedStages = std::unordered_map<const StagePartial*, std::shared_ptr<Stage>>;
+
+    auto CombinePartials(const std::vector<std::shared_ptr<StagePartial>>& partials, CombinedStages& combined) -> std::vector<std::shared_ptr<Stage>> {
         std::vector<std::shared_ptr<Stage>> stages;
         for (const auto& p : partials) {
-            auto childStages = CombinePartials(p->children);
+            if (auto it = combined.find(p.get()); it != combined.end()) {
+                stages.push_back(it->second);
+                continue;
+            }
+
+            auto childStages = CombinePartials(p->children, combined);
             auto stage = std::make_shared<Stage>();
             stage->partial = p;
             stage->execution = p->execution;
 
-            if (childStages.size() > 1 || (!childStages.empty() && p->execution != childStages.at(0)->execution)) {
+            // CPU partials each do their own work over their children's output, so they are never combined with a child.
+            if (childStages.size() > 1 || (!childStages.empty() && (p->execution != childStages.at(0)->execution || childStages.at(0)->execution == CPU))) {
                 // If it has 0 or 1 child, combine them in a partial.
                 // Move them out of their original location;
                 // Split them out if they execute in different places.
-                if (childStages.at(0)->execution == GPU && p->execution == CPU) {
-                    // Add output instruction
-                    for (auto& child : childStages) {
+                for (auto& child : childStages) {
+                    const bool isShuffled = std::dynamic_pointer_cast<ShuffleOutputPartial>(child->partial) != nullptr;
+                    if (child->execution == GPU && p->execution == CPU && !isShuffled) {
                         // Wrap the child in a shuffle operation.
                         child->partial = std::make_shared<ShuffleOutputPartial>(child->partial);
-                        stage->children.push_back(child);
                     }
-                } else {
-                    stage->children = childStages;
+                    stage->children.push_back(child);
                 }
 
                 stage->partial->children = {};
             }
 
+            combined.emplace(p.get(), stage);
             stages.push_back(stage);
         }
 
         return stages;
     }
+
+    void CollectStatistics(const std::shared_ptr<StagePartial>& partial, std::unordered_map<std::string, std::shared_ptr<const FileStatistics>>& fileStatistics) {
+        if (auto read = std::dynamic_pointer_cast<ReadPartial>(partial)) {
+            // A read that failed never filled in its columns.
+            const auto& collected = read->collectedStatistics;
+            if (collected && collected->columns.size() == read->definition->columns.size()) {
+                fileStatistics[read->filepath] = collected;
+            }
+        }
+        for (const auto& child : partial->children) {
+            CollectStatistics(child, fileStatistics);
+        }
+    }
+
+    void CollectStatistics(const std::shared_ptr<Stage>& stage, std::unordered_map<std::string, std::shared_ptr<const FileStatistics>>& fileStatistics) {
+        CollectStatistics(stage->partial, fileStatistics);
+        for (const auto& child : stage->children) {
+            CollectStatistics(child, fileStatistics);
+        }
+    }
+
+    void CollectConjunctStatistics(const std::shared_ptr<StagePartial>& partial, std::unordered_map<std::string, ConjunctStatistics>& conjunctStatistics) {
+        if (auto filter = std::dynamic_pointer_cast<FilterPartial>(partial)) {
+            // A filter that never sampled its rows has no statistics.
+            const auto& observed = filter->observedConjuncts;
+            if (observed && observed->size() == filter->conjunctKeys.size()) {
+                for (std::size_t i = 0; i < observed->size(); ++i) {
+                    conjunctStatistics[filter->conjunctKeys.at(i)].merge(observed->at(i));
+                }
+            }
+        }
+        for (const auto& child : partial->children) {
+            CollectConjunctStatistics(child, conjunctStatistics);
+        }
+    }
+
+    void CollectConjunctStatistics(const std::shared_ptr<Stage>& stage, std::unordered_map<std::string, ConjunctStatistics>& conjunctStatistics) {
+        CollectConjunctStatistics(stage->partial, conjunctStatistics);
+        for (const auto& child : stage->children) {
+            CollectConjunctStatistics(child, conjunctStatistics);
+        }
+    }
+
+    /**
+     * Collects the parameters and the names of the tables read by an expression.
+     */
+    void CollectStatement(const std::shared_ptr<AST::Expr>& expr, PreparedStatement& statement) {
+        if (auto read = std::dynamic_pointer_cast<AST::Read>(expr)) {
+            if (std::find(statement.tableNames.begin(), statement.tableNames.end(), read->tableName()) == statement.tableNames.end()) {
+                statement.tableNames.push_back(read->tableName());
+            }
+        } else if (auto filter = std::dynamic_pointer_cast<AST::Filter>(expr)) {
+            CollectParameters(filter->expr(), statement.parameters);
+            CollectStatement(filter->child(), statement);
+        } else if (auto join = std::dynamic_pointer_cast<AST::Join>(expr)) {
+            CollectParameters(join->expr(), statement.parameters);
+            CollectStatement(join->lhs(), statement);
+            CollectStatement(join->rhs(), statement);
+        } else if (auto setOperation = std::dynamic_pointer_cast<AST::SetOperation>(expr)) {
+            CollectStatement(setOperation->lhs(), statement);
+            CollectStatement(setOperation->rhs(), statement);
+        } else if (auto proj = std::dynamic_pointer_cast<AST::Projection>(expr)) {
+            CollectStatement(proj->child(), statement);
+        } else if (auto aggregate = std::dynamic_pointer_cast<AST::Aggregate>(expr)) {
+            CollectStatement(aggregate->child(), statement);
+        } else if (auto distinct = std::dynamic_pointer_cast<AST::Distinct>(expr)) {
+            CollectStatement(distinct->child(), statement);
+        } else if (auto limit = std::dynamic_pointer_cast<AST::Limit>(expr)) {
+            CollectStatement(limit->child(), statement);
+        } else if (auto orderBy = std::dynamic_pointer_cast<AST::OrderBy>(expr)) {
+            CollectStatement(orderBy->child(), statement);
+        } else if (auto window = std::dynamic_pointer_cast<AST::Window>(expr)) {
+            CollectStatement(window->child(), statement);
+        } else if (auto write = std::dynamic_pointer_cast<AST::Write>(expr)) {
+            CollectStatement(write->child(), statement);
+        }
+    }
+
+    /**
+     * Copies a partial of any of the partial types.
+     */
+    template<typename Partial, typename... Partials>
+    auto CopyPartialOf(const StagePartial& partial) -> std::shared_ptr<StagePartial> {
+        if (const auto* p = dynamic_cast<const Partial*>(&partial)) {
+            return std::make_shared<Partial>(*p);
+        }
+        if constexpr (sizeof...(Partials) > 0) {
+            return CopyPartialOf<Partials...>(partial);
+        } else {
+            assert(false && "Unknown partial type");
+            return nullptr;
+        }
+    }
+
+    /**
+     * The copies of the partials and stages of a plan, by the originals, so a partial or stage shared by more than one
+     * parent is copied once and stays shared.
+     */
+    struct CopiedPlan {
+        std::unordered_map<const StagePartial*, std::shared_ptr<StagePartial>> partials;
+        std::unordered_map<const Stage*, std::shared_ptr<Stage>> stages;
+    };
+
+    auto CopyPartial(const std::shared_ptr<StagePartial>& partial, CopiedPlan& copied) -> std::shared_ptr<StagePartial> {
+        if (auto it = copied.partials.find(partial.get()); it != copied.partials.end()) {
+            return it->second;
+        }
+        auto copy = CopyPartialOf<ReadPartial, ProjectionPartial, FilterPartial, ShuffleOutputPartial, JoinPartial, AggregatePartial, SetOperationPartial, SortPartial, WindowPartial, WritePartial>(*partial);
+        copied.partials.emplace(partial.get(), copy);
+        for (auto& child : copy->children) {
+            child = CopyPartial(child, copied);
+        }
+        return copy;
+    }
+
+    auto CopyStage(const std::shared_ptr<Stage>& stage, CopiedPlan& copied) -> std::shared_ptr<Stage> {
+        if (auto it = copied.stages.find(stage.get()); it != copied.stages.end()) {
+            return it->second;
+        }
+        auto copy = std::make_shared<Stage>(*stage);
+        copied.stages.emplace(stage.get(), copy);
+        copy->partial = CopyPartial(stage->partial, copied);
+        for (auto& child : copy->children) {
+            child = CopyStage(child, copied);
+        }
+        return copy;
+    }
+
+    /**
+     * Binds arguments to the parameters of a statement for as long as it's compiled.  The statement is shared by every
+     * compile of its query, so it's left unbound for the next one.
+     */
+    class BoundParameters final {
+    public:
+        BoundParameters(const PreparedStatement& statement, const std::vector<AST::Parameter::Value>& arguments) : _statement(statement) {
+            for (const auto& parameter : this->_statement.parameters) {
+                parameter->bind(arguments.at(parameter->index()));
+            }
+        }
+
+        ~BoundParameters() noexcept {
+            for (const auto& parameter : this->_statement.parameters) {
+                parameter->bind(std::monostate());
+            }
+        }
+
+        BoundParameters(const BoundParameters&) = delete;
+        BoundParameters& operator=(const BoundParameters&) = delete;
+
+    private:
+        const PreparedStatement& _statement;
+    };
+
+    void CollectReads(const std::shared_ptr<StagePartial>& partial, std::vector<std::shared_ptr<ReadPartial>>& reads) {
+        if (auto read = std::dynamic_pointer_cast<ReadPartial>(partial)) {
+            reads.push_back(read);
+        }
+        for (const auto& child : partial->children) {
+            CollectReads(child, reads);
+        }
+    }
 }
 
 auto metaldb::QueryEngine::QueryEngine::compile(const std::shared_ptr<AST::Expr>& expr) const -> QueryPlan {
     auto partials = DispatchAST(expr, this->metadata);
-    auto stages = CombinePartials(partials);
+    if (partials.empty()) {
+        std::cerr << "Failed to plan the query (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        return QueryPlan();
+    }
+    CombinedStages combined;
+    auto stages = CombinePartials(partials, combined);
 
     QueryPlan plan;
     plan.stages = stages;
     return plan;
 }
+
+void metaldb::QueryEngine::QueryEngine::recordStatistics(const QueryPlan& plan) {
+    std::unordered_map<std::string, std::shared_ptr<const FileStatistics>> fileStatistics;
+    for (const auto& stage : plan.stages) {
+        CollectStatistics(stage, fileStatistics);
+    }
+
+    // The statistics are also written next to each file, so later processes can skip its chunks too.
+    for (auto& [filepath, statistics] : fileStatistics) {
+        StatisticsFile::Write(filepath, *statistics);
+        this->metadata.fileStatistics[filepath] = std::move(statistics);
+    }
+
+    // Plans compiled before the statistics existed can't skip any of the files' chunks.
+    if (!fileStatistics.empty()) {
+        this->_plans.clear();
+    }
+
+    // Conjuncts are sampled again by every query, so the latest statistics replace the old ones as the data changes.
+    std::unordered_map<std::string, ConjunctStatistics> conjunctStatistics;
+    for (const auto& stage : plan.stages) {
+        CollectConjunctStatistics(stage, conjunctStatistics);
+    }
+    for (auto& [key, statistics] : conjunctStatistics) {
+        this->metadata.conjunctStatistics[key] = statistics;
+    }
+}
+
+auto metaldb::QueryEngine::QueryEngine::prepare(const Parser& parser, const std::string& query, std::vector<AST::Parameter::Value>& arguments) -> std::shared_ptr<const PreparedStatement> {
+    auto text = parser.Normalize(query, arguments);
+    if (auto it = this->_statements.find(text); it != this->_statements.end()) {
+        return it->second;
+    }
+
+    auto statement = std::make_shared<PreparedStatement>();
+    statement->expr = parser.Parse(text);
+    CollectStatement(statement->expr, *statement);
+    for (const auto& parameter : statement->parameters) {
+        statement->numParameters = std::max(statement->numParameters, parameter->index() + 1);
+    }
+    statement->text = std::move(text);
+    this->_statements.emplace(statement->text, statement);
+    return statement;
+}
+
+bool metaldb::QueryEngine::QueryEngine::isValid(const CachedPlan& cached) const noexcept {
+    if (cached.tablesGeneration != this->metadata.tablesGeneration()) {
+        return false;
+    }
+    for (const auto& [tableName, generation] : cached.filesGenerations) {
+        const auto* tableDef = this->metadata.getTable(tableName);
+        if (!tableDef || this->metadata.filesGeneration(*tableDef) != generation) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto metaldb::QueryEngine::QueryEngine::compile(const PreparedStatement& statement, const std::vector<AST::Parameter::Value>& arguments) -> QueryPlan {
+    if (arguments.size() != statement.numParameters) {
+        std::cerr << "Expected " << statement.numParameters << " arguments, got " << arguments.size() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        return QueryPlan();
+    }
+    for (const auto& parameter : statement.parameters) {
+        if (parameter->index() >= arguments.size() || std::holds_alternative<std::monostate>(arguments.at(parameter->index()))) {
+            std::cerr << "No value bound to parameter " << parameter->index() << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            return QueryPlan();
+        }
+    }
+
+    const BoundParameters bound(statement, arguments);
+    const auto lastUsed = ++this->_numCompiles;
+    if (auto it = this->_plans.find(statement.text); it != this->_plans.end()) {
+        if (this->isValid(it->second)) {
+            auto copy = Copy(it->second);
+            if (this->rebind(copy)) {
+                it->second.lastUsed = lastUsed;
+                return copy.plan;
+            }
+        }
+        this->_plans.erase(it);
+    }
+
+    CachedPlan cached;
+    cached.tablesGeneration = this->metadata.tablesGeneration();
+    for (const auto& tableName : statement.tableNames) {
+        if (const auto* tableDef = this->metadata.getTable(tableName)) {
+            cached.filesGenerations.emplace_back(tableName, this->metadata.filesGeneration(*tableDef));
+        }
+    }
+    auto partials = DispatchAST(statement.expr, this->metadata);
+    if (partials.empty()) {
+        std::cerr << "Failed to plan the query (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        return QueryPlan();
+    }
+    for (const auto& partial : partials) {
+        CollectCached(partial, cached);
+    }
+    CombinedStages combined;
+    cached.plan.stages = CombinePartials(partials, combined);
+    cached.lastUsed = lastUsed;
+
+    if (this->_plans.size() >= MaxNumCachedPlans) {
+        auto leastRecentlyUsed = std::min_element(this->_plans.begin(), this->_plans.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second.lastUsed < rhs.second.lastUsed;
+        });
+        this->_plans.erase(leastRecentlyUsed);
+    }
+    return Copy(this->_plans.emplace(statement.text, std::move(cached)).first->second).plan;
+}
+
+auto metaldb::QueryEngine::QueryEngine::Copy(const CachedPlan& cached) -> CachedPlan {
+    CopiedPlan copied;
+    CachedPlan copy;
+    copy.tablesGeneration = cached.tablesGeneration;
+    copy.filesGenerations = cached.filesGenerations;
+    copy.lastUsed = cached.lastUsed;
+    for (const auto& stage : cached.plan.stages) {
+        copy.plan.stages.push_back(CopyStage(stage, copied));
+    }
+
+    // Every filter and read is in the stages, either as the partial of a stage or under one.
+    auto copyOf = [&](const auto& partial) {
+        using Partial = typename std::decay_t<decltype(partial)>::element_type;
+        return std::static_pointer_cast<Partial>(copied.partials.at(partial.get()));
+    };
+    for (const auto& read : cached.reads) {
+        copy.reads.push_back(copyOf(read));
+    }
+    for (const auto& [filter, prunedReads, reads] : cached.filters) {
+        CachedFilter cachedFilter;
+        cachedFilter.filter = copyOf(filter);
+        std::transform(prunedReads.begin(), prunedReads.end(), std::back_inserter(cachedFilter.prunedReads), copyOf);
+        std::transform(reads.begin(), reads.end(), std::back_inserter(cachedFilter.reads), copyOf);
+        copy.filters.push_back(std::move(cachedFilter));
+    }
+    return copy;
+}
+
+void metaldb::QueryEngine::QueryEngine::CollectCached(const std::shared_ptr<StagePartial>& partial, CachedPlan& cached) {
+    if (auto filter = std::dynamic_pointer_cast<FilterPartial>(partial)) {
+        CachedFilter cachedFilter;
+        cachedFilter.filter = filter;
+        for (const auto& child : filter->children) {
+            if (auto read = std::dynamic_pointer_cast<ReadPartial>(child)) {
+                cachedFilter.prunedReads.push_back(read);
+            }
+            CollectReads(child, cachedFilter.reads);
+        }
+        cached.filters.push_back(std::move(cachedFilter));
+    } else if (auto read = std::dynamic_pointer_cast<ReadPartial>(partial)) {
+        cached.reads.push_back(read);
+    }
+
+    for (const auto& child : partial->children) {
+        CollectCached(child, cached);
+    }
+}
+
+bool metaldb::QueryEngine::QueryEngine::rebind(const CachedPlan& copy) const {
+    // A file changed in place keeps its listing, but the plan pruned it with its old statistics.
+    for (const auto& read : copy.reads) {
+        const auto current = FileEntry{read->filepath}.current();
+        if (current.fileSize != read->fileSize || current.modifiedTime != read->modifiedTime) {
+            return false;
+        }
+    }
+
+    // Every filter is resolved before anything is changed, so a plan that can't be reused is left as it was.
+    std::vector<Predicate> predicates;
+    predicates.reserve(copy.filters.size());
+    for (const auto& cachedFilter : copy.filters) {
+        auto predicate = ResolveFilterPredicate(cachedFilter.filter->expr, *cachedFilter.filter->definition);
+        if (!predicate) {
+            return false;
+        }
+        predicates.push_back(std::move(*predicate));
+    }
+
+    // Every read starts over as it was planned, before any filter pruned it.
+    for (const auto& read : copy.reads) {
+        read->rowRanges.reset();
+        if (!read->statistics) {
+            read->collectedStatistics = std::make_shared<FileStatistics>();
+            read->collectedStatistics->fileSize = read->fileSize;
+            read->collectedStatistics->modifiedTime = read->modifiedTime;
+        }
+    }
+
+    for (std::size_t i = 0; i < copy.filters.size(); ++i) {
+        const auto& [filter, prunedReads, reads] = copy.filters.at(i);
+        auto& predicate = predicates.at(i);
+        auto conjunctKeys = OrderConjuncts(predicate, *filter->definition, this->metadata);
+        filter->predicate = std::move(predicate);
+        filter->observedConjuncts = conjunctKeys.empty() ? nullptr : std::make_shared<std::vector<ConjunctStatistics>>();
+        filter->conjunctKeys = std::move(conjunctKeys);
+
+        if (filter->predicate.isFalse()) {
+            for (const auto& read : reads) {
+                ReadNothing(*read);
+            }
+            continue;
+        }
+
+        // A read that an outer filter already skipped stays skipped.
+        for (const auto& read : prunedReads) {
+            const auto isSkipped = read->rowRanges && read->rowRanges->empty();
+            if (!isSkipped && !PruneRead(*read, filter->predicate)) {
+                ReadNothing(*read);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,273 @@
+#include <metaldb/query_engine/schema_inference.hpp>
+
+#include "constants.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+    using namespace metaldb::QueryEngine;
+
+    struct ColumnState {
+        bool isInteger = true;
+        bool isNumber = true;
+        bool hasValue = false;
+        bool hasNull = false;
+        std::size_t maxSize = 0;
+    };
+
+    auto IsDigit(char c) -> bool {
+        return c >= '0' && c <= '9';
+    }
+
+    /**
+     * Returns true if the value is an optional sign, digits, an optional fraction and an optional exponent.
+     */
+    auto IsNumber(std::string_view value) -> bool {
+        std::size_t i = 0;
+        if (i < value.size() && (value[i] == '-' || value[i] == '+')) {
+            ++i;
+        }
+
+        std::size_t numDigits = 0;
+        for (; i < value.size() && IsDigit(value[i]); ++i, ++numDigits) {}
+        if (i < value.size() && value[i] == '.') {
+            for (++i; i < value.size() && IsDigit(value[i]); ++i, ++numDigits) {}
+        }
+        if (numDigits == 0) {
+            return false;
+        }
+
+        if (i < value.size() && (value[i] == 'e' || value[i] == 'E')) {
+            ++i;
+            if (i < value.size() && (value[i] == '-' || value[i] == '+')) {
+                ++i;
+            }
+            const auto exponentStart = i;
+            for (; i < value.size() && IsDigit(value[i]); ++i) {}
+            if (i == exponentStart) {
+                return false;
+            }
+        }
+        return i == value.size();
+    }
+
+    /**
+     * Returns true if the value is an integer that fits in an Integer column.
+     */
+    auto IsInteger(std::string_view value) -> bool {
+        if (!value.empty() && value.front() == '+') {
+            value.remove_prefix(1);
+        }
+        metaldb::types::IntegerType result;
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+        return !value.empty() && error == std::errc() && end == value.data() + value.size();
+    }
+
+    /**
+     * Calls @b f with each field of a row, split and unquoted like the ParseRow instruction does.
+     */
+    template <typename F>
+    void ForEachField(std::string_view row, F&& f) {
+        std::size_t column = 0;
+        while (true) {
+            const auto end = std::min(row.find(','), row.size());
+            auto field = row.substr(0, end);
+            if (field.size() >= 2 && ((field.front() == '"' && field.back() == '"') || (field.front() == '\'' && field.back() == '\''))) {
+                field = field.substr(1, field.size() - 2);
+            }
+            f(column++, field);
+            if (end == row.size()) {
+                break;
+            }
+            row.remove_prefix(end + 1);
+        }
+    }
+
+    /**
+     * Calls @b f with each complete, non-empty line of a block.  A block that doesn't start the file starts part way into
+     * a line, and a block that doesn't end the file ends part way into one, so those partial lines are skipped.
+     */
+    template <typename F>
+    void ForEachLine(std::string_view block, bool startsLine, bool endsFile, F&& f) {
+        if (!startsLine) {
+            const auto newLine = block.find('\n');
+            block.remove_prefix(newLine == std::string_view::npos ? block.size() : newLine + 1);
+        }
+        if (!endsFile) {
+            const auto newLine = block.rfind('\n');
+            block = block.substr(0, newLine == std::string_view::npos ? 0 : newLine);
+        }
+
+        while (!block.empty()) {
+            const auto end = std::min(block.find('\n'), block.size());
+            auto line = block.substr(0, end);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!line.empty()) {
+                f(line);
+            }
+            block.remove_prefix(std::min(end + 1, block.size()));
+        }
+    }
+
+    /**
+     * Reads up to @b numBytes from @b offset into the buffer, which is reused between blocks.
+     */
+    auto ReadBlock(std::ifstream& stream, std::size_t offset, std::size_t numBytes, std::vector<char>& buffer) -> std::string_view {
+        buffer.resize(numBytes);
+        stream.clear();
+        stream.seekg((std::streamoff) offset);
+        stream.read(buffer.data(), (std::streamsize) numBytes);
+        return std::string_view(buffer.data(), (std::size_t) std::max<std::streamsize>(stream.gcount(), 0));
+    }
+
+    /**
+     * Returns the column names in the header of the file, with quotes removed like the reader removes them.  @b headerSize
+     * is set to the number of bytes in the header line, including its newline.
+     */
+    auto ReadHeader(std::ifstream& stream, std::size_t numBytes, std::vector<char>& buffer, std::size_t& headerSize) -> std::optional<std::vector<std::string>> {
+        const auto block = ReadBlock(stream, 0, numBytes, buffer);
+        const auto newLine = block.find('\n');
+        if (newLine == std::string_view::npos && block.size() == numBytes) {
+            return std::nullopt;
+        }
+        headerSize = newLine == std::string_view::npos ? block.size() : newLine + 1;
+
+        auto line = block.substr(0, newLine == std::string_view::npos ? block.size() : newLine);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            return std::nullopt;
+        }
+
+        std::vector<std::string> columns;
+        ForEachField(line, [&](std::size_t, std::string_view field) {
+            std::string name;
+            std::copy_if(field.begin(), field.end(), std::back_inserter(name), [](char c) { return c != '"' && c != '\''; });
+            columns.push_back(std::move(name));
+        });
+        return columns;
+    }
+
+    void AddRow(std::string_view row, std::vector<ColumnState>& columns) {
+        std::size_t numFields = 0;
+        ForEachField(row, [&](std::size_t column, std::string_view field) {
+            numFields = column + 1;
+            if (column >= columns.size()) {
+                return;
+            }
+
+            auto& state = columns.at(column);
+            if (field.empty()) {
+                state.hasNull = true;
+                return;
+            }
+            state.hasValue = true;
+            state.maxSize = std::max(state.maxSize, field.size());
+            state.isNumber = state.isNumber && IsNumber(field);
+            state.isInteger = state.isInteger && state.isNumber && IsInteger(field);
+        });
+
+        // Missing trailing columns are empty.
+        for (auto column = numFields; column < columns.size(); ++column) {
+            columns.at(column).hasNull = true;
+        }
+    }
+}
+
+auto metaldb::QueryEngine::SchemaInference::Infer(const std::string& name, const std::string& filePath, const Metadata& metadata, const Options& options) noexcept -> std::optional<TableDefinition> {
+    TableDefinition table;
+    table.name = name;
+    table.filePath = filePath;
+
+    std::vector<const FileEntry*> files;
+    for (const auto& entry : metadata.listFiles(table)) {
+        if (std::filesystem::path(entry.path).extension() == ".csv") {
+            files.push_back(&entry);
+        }
+    }
+    if (files.empty() || options.maxNumFiles == 0 || options.numBlocksPerFile == 0 || options.blockNumBytes == 0) {
+        std::cerr << "No CSV files to infer the table from: " << filePath << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        return std::nullopt;
+    }
+
+    std::optional<std::vector<std::string>> columnNames;
+    std::vector<ColumnState> columns;
+    std::vector<char> buffer;
+    const auto numFiles = std::min(files.size(), options.maxNumFiles);
+    for (std::size_t i = 0; i < numFiles; ++i) {
+        // Spread the sampled files out, since files written at different times can differ.
+        const auto& file = *files.at(i * files.size() / numFiles);
+        std::ifstream stream(file.path, std::ios::binary);
+        if (!stream) {
+            std::cerr << "Failed to open: " << file.path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            continue;
+        }
+
+        std::size_t headerSize = 0;
+        auto header = ReadHeader(stream, options.blockNumBytes, buffer, headerSize);
+        if (!header) {
+            std::cerr << "Failed to read the header of: " << file.path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            continue;
+        }
+        if (!columnNames) {
+            columnNames = std::move(header);
+            columns.resize(columnNames->size());
+        } else if (*header != *columnNames) {
+            std::cerr << "Skipping file with different columns: " << file.path << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+            continue;
+        }
+
+        // Small files are read whole, otherwise blocks are read from evenly spaced offsets, the last ending the file.
+        const auto bodySize = file.fileSize - std::min(headerSize, file.fileSize);
+        const auto numBlocks = bodySize <= options.numBlocksPerFile * options.blockNumBytes ? 1 : options.numBlocksPerFile;
+        const auto blockNumBytes = numBlocks == 1 ? bodySize : options.blockNumBytes;
+        for (std::size_t block = 0; block < numBlocks; ++block) {
+            const auto offset = headerSize + (numBlocks == 1 ? 0 : block * (bodySize - blockNumBytes) / (numBlocks - 1));
+            const auto data = ReadBlock(stream, offset, blockNumBytes, buffer);
+            const auto endsFile = offset + data.size() >= file.fileSize;
+            ForEachLine(data, /* startsLine */ block == 0, endsFile, [&](std::string_view row) {
+                AddRow(row, columns);
+            });
+        }
+    }
+
+    if (!columnNames) {
+        return std::nullopt;
+    }
+
+    for (std::size_t i = 0; i < columnNames->size(); ++i) {
+        const auto& state = columns.at(i);
+        auto type = metaldb::String;
+        if (state.hasValue && state.isInteger) {
+            type = metaldb::Integer;
+        } else if (state.hasValue && state.isNumber) {
+            type = metaldb::Float;
+        }
+
+        ColumnDefinition column(columnNames->at(i), type, state.hasNull || !state.hasValue);
+        if (type == metaldb::String) {
+            column.maxSize = state.maxSize;
+        }
+        table.columns.push_back(std::move(column));
+    }
+    return table;
+}
+
+bool metaldb::QueryEngine::SchemaInference::Register(const std::string& name, const std::string& filePath, Metadata& metadata, const Options& options) noexcept {
+    auto table = SchemaInference::Infer(name, filePath, metadata, options);
+    if (!table) {
+        return false;
+    }
+    metadata.addTable(std::move(*table));
+    return true;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <metaldb/query_engine/statistics.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+/**
+ * Helpers for the binary files the query engine persists.  Values are written in the byte order of the machine, since the
+ * files are a cache of the machine they are on.
+ */
+namespace metaldb::QueryEngine::Serialization {
+    template<typename T>
+    void WriteValue(std::ostream& stream, const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    inline void WriteValue(std::ostream& stream, const std::string& value) {
+        WriteValue(stream, (std::uint32_t) value.size());
+        stream.write(value.data(), value.size());
+    }
+
+    template<typename T>
+    void WriteValue(std::ostream& stream, const std::optional<T>& value) {
+        WriteValue(stream, (std::uint8_t) value.has_value());
+        if (value) {
+            WriteValue(stream, *value);
+        }
+    }
+
+    template<typename T>
+    auto ReadValue(std::istream& stream, T& value) -> bool {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return (bool) stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
+    /**
+     * Returns the number of bytes left to read in a stream, or 0 if it can't tell.
+     */
+    inline auto RemainingBytes(std::istream& stream) -> std::uint64_t {
+        const auto position = stream.tellg();
+        if (position < 0) {
+            return 0;
+        }
+        stream.seekg(0, std::ios::end);
+        const auto end = stream.tellg();
+        stream.seekg(position);
+        return end > position ? (std::uint64_t) (end - position) : 0;
+    }
+
+    /**
+     * Reads the number of values that follow, and fails if they couldn't fit in what is left of the stream, so a corrupt
+     * file can't make the reader allocate more than the file holds.
+     */
+    template<typename T>
+    auto ReadCount(std::istream& stream, T& count, std::uint64_t minValueSize) -> bool {
+        static_assert(std::is_unsigned_v<T>);
+        if (!ReadValue(stream, count)) {
+            return false;
+        }
+        return count == 0 || count <= RemainingBytes(stream) / std::max<std::uint64_t>(minValueSize, 1);
+    }
+
+    inline auto ReadValue(std::istream& stream, std::string& value) -> bool {
+        // Short strings are read without seeking, since they can't allocate much even when corrupt.
+        constexpr std::uint32_t MaxUncheckedSize = 4096;
+
+        std::uint32_t size = 0;
+        if (!ReadValue(stream, size) || (size > MaxUncheckedSize && size > RemainingBytes(stream))) {
+            return false;
+        }
+        value.resize(size);
+        return (bool) stream.read(value.data(), size);
+    }
+
+    template<typename T>
+    auto ReadValue(std::istream& stream, std::optional<T>& value) -> bool {
+        std::uint8_t hasValue = 0;
+        if (!ReadValue(stream, hasValue)) {
+            return false;
+        }
+        value.reset();
+        if (hasValue) {
+            value.emplace();
+            return ReadValue(stream, *value);
+        }
+        return true;
+    }
+
+    /**
+     * Writes the statistics of a file, including the size and modification time of the file they were collected from.
+     */
+    void WriteStatistics(std::ostream& stream, const FileStatistics& statistics);
+
+    /**
+     * Returns nullptr if the statistics are truncated or corrupt.
+     */
+    std::shared_ptr<FileStatistics> ReadStatistics(std::istream& stream);
+}
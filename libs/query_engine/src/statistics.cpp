@@ -0,0 +1,161 @@
+#include <metaldb/query_engine/statistics.hpp>
+
+#include "serialization.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+namespace {
+    using namespace metaldb::QueryEngine;
+    using namespace metaldb::QueryEngine::Serialization;
+
+    // Identifies a statistics file, and the version of its layout.
+    constexpr std::uint32_t Magic = 0x5342444d;
+    constexpr std::uint32_t Version = 1;
+
+    // Columns are indexed by a byte everywhere else.
+    constexpr std::uint32_t MaxNumColumns = 256;
+
+    // The fewest bytes each entry is written in, which bounds how many of them the rest of a file can hold.  A zone map
+    // has a byte for whether each of its values is there.
+    constexpr std::uint64_t MinZoneMapSize = 4;
+    constexpr std::uint64_t MinColumnSize = MinZoneMapSize + 2 * sizeof(std::uint64_t) + sizeof(double);
+
+    void WriteZoneMap(std::ostream& stream, const ZoneMap& zoneMap) {
+        WriteValue(stream, zoneMap.min);
+        WriteValue(stream, zoneMap.max);
+        WriteValue(stream, zoneMap.minString);
+        WriteValue(stream, zoneMap.maxString);
+    }
+
+    auto ReadZoneMap(std::istream& stream, ZoneMap& zoneMap) -> bool {
+        return ReadValue(stream, zoneMap.min) && ReadValue(stream, zoneMap.max) && ReadValue(stream, zoneMap.minString) && ReadValue(stream, zoneMap.maxString);
+    }
+}
+
+void metaldb::QueryEngine::Serialization::WriteStatistics(std::ostream& stream, const FileStatistics& statistics) {
+    WriteValue(stream, (std::uint64_t) statistics.fileSize);
+    WriteValue(stream, statistics.modifiedTime);
+    WriteValue(stream, (std::uint64_t) statistics.rowCount);
+
+    WriteValue(stream, (std::uint32_t) statistics.columns.size());
+    for (const auto& column : statistics.columns) {
+        WriteZoneMap(stream, column);
+        WriteValue(stream, (std::uint64_t) column.nullCount);
+        WriteValue(stream, (std::uint64_t) column.distinctCount);
+        WriteValue(stream, column.averageSize);
+    }
+
+    WriteValue(stream, (std::uint64_t) statistics.chunkNumRows);
+    WriteValue(stream, (std::uint32_t) statistics.chunks.size());
+    for (const auto& chunk : statistics.chunks) {
+        WriteValue(stream, (std::uint32_t) chunk.size());
+        for (const auto& zoneMap : chunk) {
+            WriteZoneMap(stream, zoneMap);
+        }
+    }
+}
+
+auto metaldb::QueryEngine::Serialization::ReadStatistics(std::istream& stream) -> std::shared_ptr<FileStatistics> {
+    auto statistics = std::make_shared<FileStatistics>();
+
+    std::uint64_t fileSize = 0;
+    std::uint64_t rowCount = 0;
+    std::uint32_t numColumns = 0;
+    if (!ReadValue(stream, fileSize) || !ReadValue(stream, statistics->modifiedTime) || !ReadValue(stream, rowCount) || !ReadCount(stream, numColumns, MinColumnSize) || numColumns > MaxNumColumns) {
+        return nullptr;
+    }
+    statistics->fileSize = fileSize;
+    statistics->rowCount = rowCount;
+
+    statistics->columns.resize(numColumns);
+    for (auto& column : statistics->columns) {
+        std::uint64_t nullCount = 0;
+        std::uint64_t distinctCount = 0;
+        if (!ReadZoneMap(stream, column) || !ReadValue(stream, nullCount) || !ReadValue(stream, distinctCount) || !ReadValue(stream, column.averageSize)) {
+            return nullptr;
+        }
+        column.nullCount = nullCount;
+        column.distinctCount = distinctCount;
+    }
+
+    std::uint64_t chunkNumRows = 0;
+    std::uint32_t numChunks = 0;
+    // A corrupt file could otherwise claim more chunks than there are rows, or than the file holds.
+    if (!ReadValue(stream, chunkNumRows) || !ReadCount(stream, numChunks, sizeof(std::uint32_t) + MinZoneMapSize * numColumns) || (numChunks > 0 && (chunkNumRows == 0 || numChunks > (rowCount / chunkNumRows) + 1))) {
+        return nullptr;
+    }
+    statistics->chunkNumRows = chunkNumRows;
+
+    statistics->chunks.resize(numChunks);
+    for (auto& chunk : statistics->chunks) {
+        std::uint32_t numZoneMaps = 0;
+        if (!ReadValue(stream, numZoneMaps) || numZoneMaps != numColumns) {
+            return nullptr;
+        }
+        chunk.resize(numZoneMaps);
+        for (auto& zoneMap : chunk) {
+            if (!ReadZoneMap(stream, zoneMap)) {
+                return nullptr;
+            }
+        }
+    }
+    return statistics;
+}
+
+auto metaldb::QueryEngine::ConjunctStatistics::rank() const noexcept -> double {
+    if (this->numRows == 0 || this->numPassed >= this->numRows) {
+        return std::numeric_limits<double>::infinity();
+    }
+    const auto costPerRow = this->nanoseconds / this->numRows;
+    const auto dropRate = 1.0 - ((double) this->numPassed / this->numRows);
+    return costPerRow / dropRate;
+}
+
+auto metaldb::QueryEngine::ConjunctStatistics::Order(const std::vector<ConjunctStatistics>& conjuncts) noexcept -> std::vector<std::size_t> {
+    std::vector<std::size_t> order(conjuncts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return conjuncts.at(lhs).rank() < conjuncts.at(rhs).rank();
+    });
+    return order;
+}
+
+auto metaldb::QueryEngine::StatisticsFile::PathFor(const std::string& filepath) noexcept -> std::string {
+    return filepath + StatisticsFile::Extension;
+}
+
+bool metaldb::QueryEngine::StatisticsFile::Write(const std::string& filepath, const FileStatistics& statistics) noexcept {
+    std::ofstream stream(StatisticsFile::PathFor(filepath), std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        std::cerr << "Failed to write statistics of: " << filepath << " (" << __FILE__ << ", " << __LINE__ << ")" << std::endl;
+        return false;
+    }
+
+    WriteValue(stream, Magic);
+    WriteValue(stream, Version);
+    WriteStatistics(stream, statistics);
+    return (bool) stream;
+}
+
+auto metaldb::QueryEngine::StatisticsFile::Read(const std::string& filepath, std::size_t fileSize, std::int64_t modifiedTime) noexcept -> std::shared_ptr<FileStatistics> {
+    std::ifstream stream(StatisticsFile::PathFor(filepath), std::ios::binary);
+    if (!stream) {
+        return nullptr;
+    }
+
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    if (!ReadValue(stream, magic) || !ReadValue(stream, version) || magic != Magic || version != Version) {
+        return nullptr;
+    }
+
+    auto statistics = ReadStatistics(stream);
+    if (!statistics || statistics->fileSize != fileSize || statistics->modifiedTime != modifiedTime) {
+        return nullptr;
+    }
+    return statistics;
+}